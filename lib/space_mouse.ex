@@ -12,6 +12,7 @@ defmodule SpaceMouse do
   - Real-time 6DOF motion tracking (X, Y, Z translation + rotation)
   - Button press/release event handling
   - LED control (when supported)
+  - Multiple devices at once, each with a stable device ID
   - Automatic device connection/reconnection
   - Clean GenServer-based architecture
   - Platform-specific optimizations
@@ -38,24 +39,44 @@ defmodule SpaceMouse do
   - `{:spacemouse_connected, device_info}` - Device connected
   - `{:spacemouse_disconnected, device_info}` - Device disconnected
   - `{:spacemouse_motion, motion_data}` - 6DOF motion data  
-  - `{:spacemouse_button, button_data}` - Button events
+  - `{:spacemouse_buttons, button_data}` - Button events, one per report
   - `{:spacemouse_led_changed, led_change}` - LED state change events
   
   ## Motion Data Format
   
       %{
+        device_id: integer(),  # Device the frame came from
         x: float(),   # Translation X (-1.0 to +1.0)
         y: float(),   # Translation Y (-1.0 to +1.0)
         z: float(),   # Translation Z (-1.0 to +1.0)
         rx: float(),  # Rotation X (-1.0 to +1.0)
         ry: float(),  # Rotation Y (-1.0 to +1.0)
-        rz: float()   # Rotation Z (-1.0 to +1.0)
+        rz: float(),  # Rotation Z (-1.0 to +1.0)
+        device_timestamp: integer(),  # Report capture time, µs (reader clock)
+        received_at: integer()        # BEAM receive time, µs (monotonic)
       }
   
+  Button events carry the same device ID and timestamps next to the
+  `:buttons` bitmask (bit 0 is button 1), the `:changed` bits and the
+  `:pressed` / `:released` button IDs, so a chord arrives as one message.
+  `SpaceMouse.button_pressed?(1)` and `SpaceMouse.buttons()` query the
+  current state. `SpaceMouse.subscribe(device: 2)` limits events to one device,
+  `SpaceMouse.subscribe(delivery: :latest)` with `SpaceMouse.ack()` keeps a
+  slow subscriber's mailbox to the newest frame,
+  `SpaceMouse.subscribe(events: [:buttons], buttons: [1])` filters in the
+  dispatcher, `SpaceMouse.subscribe_sampled(120)` delivers motion at a
+  fixed rate, `SpaceMouse.subscribe_pose()` and `SpaceMouse.pose()` the
+  integrated position and orientation,
+  `SpaceMouse.set_led(:on, device: 2)` addresses one LED and
+  `SpaceMouse.devices()` lists what is attached.
+  
   ## Platform Support
   
   - **macOS**: Uses IOKit HID Manager (bypasses kernel HID driver)
-  - **Linux**: Direct libusb access (planned)
+  - **Linux**: hidraw, read by an epoll reader process, or in the VM by an
+    optional NIF (`config :space_mouse, platform: :linux_nif`)
+  - **Simulator**: synthetic devices on any Unix host
+    (`config :space_mouse, platform: :simulator`)
   - **Windows**: HID API (planned)
   
   The appropriate platform implementation is automatically selected at runtime.
@@ -64,13 +85,25 @@ defmodule SpaceMouse do
   # Delegate all public API functions to the Core.Api module
   defdelegate start_monitoring(), to: SpaceMouse.Core.Api
   defdelegate stop_monitoring(), to: SpaceMouse.Core.Api
-  defdelegate subscribe(pid \\ self()), to: SpaceMouse.Core.Api
+  defdelegate subscribe(pid_or_opts \\ self(), opts \\ []), to: SpaceMouse.Core.Api
   defdelegate unsubscribe(pid \\ self()), to: SpaceMouse.Core.Api
-  defdelegate set_led(state), to: SpaceMouse.Core.Api
+  defdelegate ack(pid \\ self()), to: SpaceMouse.Core.Api
+  defdelegate subscribe_sampled(rate, opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate unsubscribe_sampled(pid \\ self()), to: SpaceMouse.Core.Api
+  defdelegate subscribe_pose(opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate unsubscribe_pose(pid \\ self()), to: SpaceMouse.Core.Api
+  defdelegate pose(opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate reset_pose(opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate set_led(state, opts \\ []), to: SpaceMouse.Core.Api
   defdelegate get_led_state(), to: SpaceMouse.Core.Api
+  defdelegate calibrate(opts \\ []), to: SpaceMouse.Core.Api
   defdelegate connected?(), to: SpaceMouse.Core.Api
   defdelegate connection_state(), to: SpaceMouse.Core.Api
   defdelegate platform_info(), to: SpaceMouse.Core.Api
-  defdelegate get_motion_state(), to: SpaceMouse.Core.Api
+  defdelegate get_motion_state(opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate buttons(opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate button_pressed?(id, opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate pipeline_metrics(opts \\ []), to: SpaceMouse.Core.Api
+  defdelegate devices(), to: SpaceMouse.Core.Api
   defdelegate set_auto_reconnect(enabled), to: SpaceMouse.Core.Api
 end
\ No newline at end of file
@@ -21,6 +21,20 @@ defmodule SpaceMouse.Core.Api do
       # Check connection status
       SpaceMouse.connected?()
   
+  ## Multiple Devices
+  
+  Every attached SpaceMouse gets a stable device ID (1, 2, ...) and its own
+  `SpaceMouse.Core.Device` process. All event payloads carry `:device_id`.
+  
+      # Only events from device 2
+      SpaceMouse.subscribe(device: 2)
+      
+      # LED of one device (default: all of them)
+      SpaceMouse.set_led(:on, device: 2)
+      
+      # Connected devices
+      SpaceMouse.devices()
+  
   ## Event Messages
   
   When subscribed, your process will receive these messages:
@@ -28,28 +42,38 @@ defmodule SpaceMouse.Core.Api do
   - `{:spacemouse_connected, device_info}` - Device connected
   - `{:spacemouse_disconnected, device_info}` - Device disconnected  
   - `{:spacemouse_motion, motion_data}` - 6DOF motion data
-  - `{:spacemouse_button, button_data}` - Button press/release events
+  - `{:spacemouse_buttons, button_data}` - Button press/release events, one
+    per report (a chord arrives as one message)
   
   ## Motion Data Format
   
       %{
+        device_id: integer(),  # Device the frame came from
         x: integer(),   # Translation X axis
         y: integer(),   # Translation Y axis  
         z: integer(),   # Translation Z axis
         rx: integer(),  # Rotation X axis
         ry: integer(),  # Rotation Y axis
-        rz: integer()   # Rotation Z axis
+        rz: integer(),  # Rotation Z axis
+        device_timestamp: integer(),  # Report capture time, µs (reader clock)
+        received_at: integer(),       # BEAM receive time, µs (monotonic)
+        dropped: integer()            # Only after frames were dropped (delivery modes)
       }
   
   ## Button Data Format
   
       %{
-        id: integer(),              # Button ID (1, 2, etc.)
-        state: :pressed | :released # Button state
+        device_id: integer(),
+        buttons: integer(),         # Pressed buttons after the report, bit 0 = button 1
+        changed: integer(),         # Bits that changed with this report
+        pressed: [integer()],       # Button IDs pressed by this report
+        released: [integer()],      # Button IDs released by this report
+        device_timestamp: integer(),
+        received_at: integer()
       }
   """
 
-  alias SpaceMouse.Core.Device
+  alias SpaceMouse.Core.{DeviceManager, DeviceState, PoseIntegrator, Sampler}
 
   @doc """
   Start monitoring for SpaceMouse devices.
@@ -61,7 +85,7 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec start_monitoring() :: :ok | {:error, term()}
   def start_monitoring do
-    Device.start_monitoring()
+    DeviceManager.start_monitoring()
   end
 
   @doc """
@@ -72,7 +96,7 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec stop_monitoring() :: :ok
   def stop_monitoring do
-    Device.stop_monitoring()
+    DeviceManager.stop_monitoring()
   end
 
   @doc """
@@ -81,11 +105,122 @@ defmodule SpaceMouse.Core.Api do
   The calling process will receive event messages for device connections,
   motion data, and button events.
   
-  Optionally specify a different process PID to receive the events.
+  Optionally specify a different process PID to receive the events, and
+  `device: id` to receive events from that device only (default `:all`).
+
+  A subscriber that may fall behind the motion stream picks a `delivery:`
+  mode so its mailbox stays bounded, and calls `ack/0` once it has handled
+  what it received:
+
+      SpaceMouse.subscribe(delivery: :latest)         # newest frame, one at a time
+      SpaceMouse.subscribe(delivery: {:bounded, 32})  # up to 32 frames, then drop
+
+  Connection, button and LED events are never dropped. Motion payloads
+  that follow dropped frames carry their number as `:dropped`.
+
+  Filters restrict what is sent in the first place, evaluated before the
+  event is copied to the subscriber (see `SpaceMouse.Core.SubscriptionFilter`):
+
+      SpaceMouse.subscribe(events: [:buttons], buttons: [1])  # button 1 only
+      SpaceMouse.subscribe(axes: [:z], min_delta: 0.05)       # z moved by 0.05 or more
+
+  An invalid filter raises `ArgumentError`.
+  """
+  @spec subscribe(pid() | keyword(), keyword()) :: :ok
+  def subscribe(pid_or_opts \\ self(), opts \\ [])
+
+  def subscribe(opts, []) when is_list(opts) do
+    DeviceManager.subscribe(self(), opts)
+  end
+
+  def subscribe(pid, opts) do
+    DeviceManager.subscribe(pid, opts)
+  end
+
+  @doc """
+  Acknowledge the motion frames received so far.
+
+  With `delivery: :latest` this delivers the newest frame that arrived in
+  the meantime; with `{:bounded, n}` it makes room for `n` more frames.
   """
-  @spec subscribe(pid()) :: :ok
-  def subscribe(pid \\ self()) do
-    Device.subscribe(pid)
+  @spec ack(pid()) :: :ok
+  def ack(pid \\ self()) do
+    DeviceManager.ack(pid)
+  end
+
+  @doc """
+  Receive motion at a fixed rate instead of per report.
+
+  The calling process gets one `{:spacemouse_sample, sample}` per device
+  every `1/rate` seconds (1 to 1000 Hz), holding the latest frame, or with
+  `interpolate: true` a frame interpolated between the last two reports.
+  `device: id` limits samples to one device. Subscribers of the same rate
+  share one drift-free timer (see `SpaceMouse.Core.Sampler`).
+
+      SpaceMouse.subscribe_sampled(120)
+      SpaceMouse.subscribe_sampled(60, device: 2, interpolate: true)
+  """
+  @spec subscribe_sampled(pos_integer(), keyword()) :: :ok
+  def subscribe_sampled(rate, opts \\ []) do
+    Sampler.subscribe(self(), rate, opts)
+  end
+
+  @doc """
+  Stop the samples started with `subscribe_sampled/2`.
+  """
+  @spec unsubscribe_sampled(pid()) :: :ok
+  def unsubscribe_sampled(pid \\ self()) do
+    Sampler.unsubscribe(pid)
+  end
+
+  @doc """
+  Receive the integrated pose instead of velocities.
+
+  The calling process gets a `{:spacemouse_pose, pose}` with `:position`
+  `{x, y, z}` and `:orientation` as a unit quaternion `{w, x, y, z}` every
+  time a frame moves the pose of `device: id` (default: every device).
+  Motion is integrated once, in `SpaceMouse.Core.PoseIntegrator`, for all
+  subscribers.
+  """
+  @spec subscribe_pose(keyword()) :: :ok
+  def subscribe_pose(opts \\ []) do
+    PoseIntegrator.subscribe(self(), opts)
+  end
+
+  @doc """
+  Stop the poses started with `subscribe_pose/1`.
+  """
+  @spec unsubscribe_pose(pid()) :: :ok
+  def unsubscribe_pose(pid \\ self()) do
+    PoseIntegrator.unsubscribe(pid)
+  end
+
+  @doc """
+  Get the current pose of `device: id`, by default the connected device
+  with the lowest ID.
+
+  Returns `{:ok, pose}` or `:disconnected`.
+  """
+  @spec pose(keyword()) :: {:ok, map()} | :disconnected
+  def pose(opts \\ []) do
+    case Keyword.get(opts, :device) || DeviceState.default_device() do
+      nil -> :disconnected
+      device_id -> PoseIntegrator.pose(device_id)
+    end
+  end
+
+  @doc """
+  Move the pose of `device: id` (by default the connected device with the
+  lowest ID) back to the origin, or to `position:` and `orientation:`.
+  """
+  @spec reset_pose(keyword()) :: :ok | :disconnected
+  def reset_pose(opts \\ []) do
+    {device, opts} = Keyword.pop(opts, :device)
+
+    case device || DeviceState.default_device() do
+      nil -> :disconnected
+      device_id -> PoseIntegrator.reset(device_id, opts)
+    end
   end
 
   @doc """
@@ -95,7 +230,7 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec unsubscribe(pid()) :: :ok  
   def unsubscribe(pid \\ self()) do
-    Device.unsubscribe(pid)
+    DeviceManager.unsubscribe(pid)
   end
 
   @doc """
@@ -105,12 +240,31 @@ defmodule SpaceMouse.Core.Api do
   - `:on` - Turn LED on
   - `:off` - Turn LED off
   
+  Options:
+  - `device:` - Device ID, or `:all` (default) for every connected device
+  
   Returns `:ok` on success or `{:error, reason}` if the command fails.
   Note that LED control may not be supported on all platforms or device models.
   """
-  @spec set_led(:on | :off) :: :ok | {:error, term()}
-  def set_led(state) when state in [:on, :off] do
-    Device.set_led(state)
+  @spec set_led(:on | :off, keyword()) :: :ok | {:error, term()}
+  def set_led(state, opts \\ []) when state in [:on, :off] do
+    DeviceManager.set_led(state, opts)
+  end
+
+  @doc """
+  Zero the axes of `device: id`, or of every device (default).
+
+  The current frame becomes the device's zero point, for a cap that rests
+  off centre; the corrected frame follows as a motion event. The bias is
+  also tracked automatically while the cap is still (see
+  `SpaceMouse.Platform.AutoZero`), so this is only needed to correct at
+  once.
+
+  Returns `:ok` or `{:error, reason}`.
+  """
+  @spec calibrate(keyword()) :: :ok | {:error, term()}
+  def calibrate(opts \\ []) do
+    DeviceManager.calibrate(opts)
   end
 
   @doc """
@@ -120,7 +274,7 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec get_led_state() :: {:ok, :on | :off | :unknown}
   def get_led_state do
-    Device.get_led_state()
+    DeviceManager.get_led_state()
   end
 
   @doc """
@@ -130,7 +284,7 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec connected?() :: boolean()
   def connected? do
-    Device.connected?()
+    DeviceManager.connected?()
   end
 
   @doc """
@@ -144,7 +298,7 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec connection_state() :: :disconnected | :connecting | :connected | :error
   def connection_state do
-    Device.connection_state()
+    DeviceManager.connection_state()
   end
 
   @doc """
@@ -154,20 +308,66 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec platform_info() :: %{platform: atom(), method: atom(), version: String.t()}
   def platform_info do
-    Device.platform_info()
+    DeviceManager.platform_info()
   end
 
   @doc """
   Get the current motion state.
   
-  Returns the last received motion data, or zeros if no motion has been detected.
+  Returns the last received motion data of `device: id`, by default of the
+  connected device with the lowest ID, or zeros if no motion has been detected.
+  The state is read from an `:atomics` array without messaging any process,
+  so polling it costs the same at any event rate.
   """
-  @spec get_motion_state() :: %{x: integer(), y: integer(), z: integer(), rx: integer(), ry: integer(), rz: integer()}
-  def get_motion_state do
-    {:ok, motion} = Device.get_motion_state()
+  @spec get_motion_state(keyword()) :: %{x: float(), y: float(), z: float(), rx: float(), ry: float(), rz: float()}
+  def get_motion_state(opts \\ []) do
+    {:ok, motion} = DeviceManager.get_motion_state(opts)
     motion
   end
 
+  @doc """
+  Get the pressed buttons of `device: id` (by default the connected device
+  with the lowest ID) as a bitmask, bit 0 being button 1.
+  """
+  @spec buttons(keyword()) :: non_neg_integer()
+  def buttons(opts \\ []) do
+    DeviceManager.buttons(opts)
+  end
+
+  @doc """
+  Check whether button `id` (1-based) is pressed on `device: id`, by
+  default the connected device with the lowest ID.
+  """
+  @spec button_pressed?(pos_integer(), keyword()) :: boolean()
+  def button_pressed?(id, opts \\ []) do
+    DeviceManager.button_pressed?(id, opts)
+  end
+
+  @doc """
+  Get the cost of each stage of the configured motion pipeline on
+  `device: id` (by default the connected device with the lowest ID).
+
+  Returns one map per stage with `:stage`, `:frames`, `:total_ns` and
+  `:mean_ns`, or `[]` when no pipeline is configured or stage timing is
+  off (it is opt-in: `config :space_mouse, motion_pipeline_metrics: true`,
+  see `SpaceMouse.Core.MotionPipeline`).
+  """
+  @spec pipeline_metrics(keyword()) :: [map()]
+  def pipeline_metrics(opts \\ []) do
+    DeviceManager.pipeline_metrics(opts)
+  end
+
+  @doc """
+  List the connected devices, ordered by device ID.
+  
+  Each entry has `:device_id`, `:vendor_id`, `:product_id`, `:platform`,
+  `:method` and `:timestamp`.
+  """
+  @spec devices() :: [map()]
+  def devices do
+    DeviceManager.devices()
+  end
+
   @doc """
   Configure automatic reconnection behavior.
   
@@ -176,6 +376,6 @@ defmodule SpaceMouse.Core.Api do
   """
   @spec set_auto_reconnect(boolean()) :: :ok
   def set_auto_reconnect(enabled) when is_boolean(enabled) do
-    Device.set_auto_reconnect(enabled)
+    DeviceManager.set_auto_reconnect(enabled)
   end
 end
@@ -1,262 +1,188 @@
 defmodule SpaceMouse.Core.Device do
   @moduledoc """
-  Main SpaceMouse device abstraction.
-  
-  This module provides a unified interface for SpaceMouse interaction across
-  different platforms, automatically selecting the appropriate platform
-  implementation based on the runtime environment.
-  
-  Features:
-  - Cross-platform device detection and connection management
-  - Real-time motion and button event streaming
-  - LED control (when supported by platform)  
-  - Automatic reconnection handling
-  - Clean supervisor integration
+  One attached SpaceMouse.
+
+  `SpaceMouse.Core.DeviceManager` starts one of these under
+  `SpaceMouse.Core.DeviceSupervisor` for every device the platform reports,
+  registered in `SpaceMouse.Core.DeviceRegistry` under its device ID. The
+  platform sends that device's motion and button events here directly
+  (see `route/2`), without passing through the manager; this process keeps
+  its motion, button and LED state and hands every resulting event to
+  `SpaceMouse.Core.Dispatcher`, which delivers it to the subscribers of this
+  device and of all devices. Fan-out never runs in this process, so state
+  calls are not queued behind it. It also writes its device's slot of
+  `SpaceMouse.Core.DeviceState`, which the public state queries read
+  without calling any process.
+
+  Device IDs are small integers assigned by the reader. They are stable for
+  a given device (serial number, else USB/Bluetooth path) across unplug
+  and replug for the lifetime of the reader.
   """
 
-  use GenServer
+  use GenServer, restart: :temporary
+  import Bitwise
   require Logger
 
-
+  alias SpaceMouse.Core.{DeviceState, Dispatcher, MotionPipeline}
+  alias SpaceMouse.Platform.IdleFilter
 
   defmodule State do
     @moduledoc false
     defstruct [
+      :device_id,
+      :vendor_id,
+      :product_id,
+      :platform_info,
       :platform_module,
-      :platform_state,
-      :connection_state,
-      :subscribers,
       :led_state,
       :last_motion,
-      :last_button_state,
-      :auto_reconnect
+      :buttons,
+      :pipeline
     ]
   end
 
-  @type connection_state :: :disconnected | :connecting | :connected | :error
-  @type motion_data :: %{x: integer(), y: integer(), z: integer(), rx: integer(), ry: integer(), rz: integer()}
-  @type button_data :: %{id: integer(), state: :pressed | :released}
-
   # Client API
 
   @doc """
-  Start the SpaceMouse device manager.
+  Start a device process. Called by `SpaceMouse.Core.DeviceManager`.
   """
-  def start_link(opts \\ []) do
-    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+  def start_link(opts) do
+    device_id = Keyword.fetch!(opts, :device_id)
+    GenServer.start_link(__MODULE__, opts, name: via(device_id))
   end
 
   @doc """
-  Start monitoring for SpaceMouse devices.
+  Look up the process of a connected device.
   """
-  def start_monitoring do
-    GenServer.call(__MODULE__, :start_monitoring)
+  def whereis(device_id) do
+    case Registry.lookup(SpaceMouse.Core.DeviceRegistry, device_id) do
+      [{pid, _}] -> pid
+      [] -> nil
+    end
   end
 
   @doc """
-  Stop monitoring for SpaceMouse devices.
+  Get device details: ID, vendor/product ID and LED state.
   """
-  def stop_monitoring do
-    GenServer.call(__MODULE__, :stop_monitoring)
+  def info(device) do
+    GenServer.call(server(device), :info)
   end
 
   @doc """
-  Subscribe to SpaceMouse events.
-  
-  The subscriber will receive:
-  - `{:spacemouse_connected, device_info}`
-  - `{:spacemouse_disconnected, device_info}`
-  - `{:spacemouse_motion, motion_data}`
-  - `{:spacemouse_button, button_data}`
+  Get the last motion frame of this device.
   """
-  def subscribe(pid \\ self()) do
-    GenServer.call(__MODULE__, {:subscribe, pid})
+  def get_motion_state(device) do
+    GenServer.call(server(device), :get_motion_state)
   end
 
   @doc """
-  Unsubscribe from SpaceMouse events.
+  Get the per-stage cost of this device's motion pipeline (see
+  `SpaceMouse.Core.MotionPipeline.metrics/1`).
   """
-  def unsubscribe(pid \\ self()) do
-    GenServer.call(__MODULE__, {:unsubscribe, pid})
+  def pipeline_metrics(device) do
+    GenServer.call(server(device), :pipeline_metrics)
   end
 
   @doc """
-  Set LED state (on/off).
+  Get the pressed buttons of this device as a bitmask (bit 0 is button 1).
   """
-  def set_led(state) when state in [:on, :off] do
-    GenServer.call(__MODULE__, {:set_led, state})
+  def buttons(device) do
+    GenServer.call(server(device), :buttons)
   end
 
   @doc """
-  Get current LED state.
+  Check whether button `id` (1-based) of this device is pressed.
   """
-  def get_led_state do
-    GenServer.call(__MODULE__, :get_led_state)
+  def button_pressed?(device, id) when is_integer(id) and id >= 1 do
+    pressed?(buttons(device), id)
   end
 
   @doc """
-  Check if a SpaceMouse is currently connected.
+  Check whether button `id` is set in a button bitmask, as carried by
+  `:spacemouse_buttons` events and returned by `buttons/1`.
   """
-  def connected? do
-    GenServer.call(__MODULE__, :connected?)
+  def pressed?(buttons, id), do: (buttons >>> (id - 1) &&& 1) == 1
+
+  @doc false
+  def handle_event(pid, event) do
+    send(pid, {:hid_event, event})
   end
 
   @doc """
-  Get current connection state.
+  Hand a platform event to the process that handles it: motion, buttons
+  and LED changes go straight to the device's own process, status events
+  and events of a device whose process is not registered yet go to `owner`
+  (`SpaceMouse.Core.DeviceManager`) as `{:hid_event, event}`.
+
+  Called by the process that receives the reader's output, so the hot path
+  never queues in the manager's mailbox.
   """
-  def connection_state do
-    GenServer.call(__MODULE__, :connection_state)
+  def route(%{type: type, device_id: device_id} = event, owner) when type in [:motion, :buttons, :led_changed] do
+    case whereis(device_id) do
+      nil -> send(owner, {:hid_event, event})
+      pid -> handle_event(pid, event)
+    end
+
+    :ok
   end
 
-  @doc """
-  Get platform information.
-  """
-  def platform_info do
-    GenServer.call(__MODULE__, :platform_info)
+  def route(event, owner) do
+    send(owner, {:hid_event, event})
+    :ok
   end
 
-  @doc """
-  Get the current motion state.
-  
-  Returns the last received motion data, or zeros if no motion has been detected.
-  """
-  def get_motion_state do
-    GenServer.call(__MODULE__, :get_motion_state)
+  @doc false
+  def led_changed(pid, led_state) do
+    GenServer.cast(pid, {:led_changed, led_state})
   end
 
-  @doc """
-  Set auto-reconnect behavior.
-  """
-  def set_auto_reconnect(enabled) when is_boolean(enabled) do
-    GenServer.call(__MODULE__, {:set_auto_reconnect, enabled})
+  # Synchronous, so the announcement is sent before the manager stops the
+  # process and a reconnect under the same ID can start a new one
+  @doc false
+  def disconnect(pid) do
+    GenServer.call(pid, :disconnect)
+  catch
+    :exit, _reason -> :ok
   end
 
   # GenServer Implementation
 
   @impl true
   def init(opts) do
-    # Select platform implementation
-    platform_module = select_platform()
-    auto_reconnect = Keyword.get(opts, :auto_reconnect, true)
-    
-    # Initialize platform
-    {:ok, platform_state} = platform_module.platform_init(owner_pid: self())
-    
     state = %State{
-      platform_module: platform_module,
-      platform_state: platform_state,
-      connection_state: :disconnected,
-      subscribers: MapSet.new(),
+      device_id: Keyword.fetch!(opts, :device_id),
+      vendor_id: Keyword.get(opts, :vendor_id),
+      product_id: Keyword.get(opts, :product_id),
+      platform_info: Keyword.get(opts, :platform_info, %{}),
+      platform_module: Keyword.get(opts, :platform_module),
       led_state: :unknown,
       last_motion: %{x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0},
-      last_button_state: %{},
-      auto_reconnect: auto_reconnect
+      buttons: 0,
+      # Compiled per device: every device keeps its own filter state
+      pipeline:
+        MotionPipeline.compile(Application.get_env(:space_mouse, :motion_pipeline, []),
+          reset_at_rest: IdleFilter.enabled?(),
+          metrics: Application.get_env(:space_mouse, :motion_pipeline_metrics, false)
+        )
     }
-    
-    Logger.info("SpaceMouse device manager initialized (platform: #{platform_module})")
-    {:ok, state}
-  end
 
-  @impl true
-  def handle_call(:start_monitoring, _from, state) do
-    # Check if already monitoring
-    case state.connection_state do
-      :connecting ->
-        Logger.debug("SpaceMouse monitoring already starting")
-        {:reply, :ok, state}
-        
-      :connected ->
-        Logger.debug("SpaceMouse already connected and monitoring")
-        {:reply, :ok, state}
-        
-      _ ->
-        # Only start monitoring if not already connecting or connected
-        case state.platform_module.start_monitoring(state.platform_state) do
-          {:ok, new_platform_state} ->
-            new_state = %{state | connection_state: :connecting, platform_state: new_platform_state}
-            {:reply, :ok, new_state}
-            
-          {:error, reason} ->
-            new_state = %{state | connection_state: :error}
-            {:reply, {:error, reason}, new_state}
-        end
-    end
-  end
+    DeviceState.attach(state.device_id)
 
-  @impl true
-  def handle_call(:stop_monitoring, _from, state) do
-    case state.platform_module.stop_monitoring(state.platform_state) do
-      {:ok, new_platform_state} ->
-        new_state = %{state | connection_state: :disconnected, platform_state: new_platform_state}
-        {:reply, :ok, new_state}
-        
-      error ->
-        {:reply, error, state}
-    end
-  end
-
-  @impl true
-  def handle_call({:subscribe, pid}, _from, state) do
-    new_subscribers = MapSet.put(state.subscribers, pid)
-    new_state = %{state | subscribers: new_subscribers}
-    
-    # Send current state to new subscriber
-    if state.connection_state == :connected do
-      send(pid, {:spacemouse_connected, get_device_info(state)})
-    end
-    
-    {:reply, :ok, new_state}
-  end
-
-  @impl true
-  def handle_call({:unsubscribe, pid}, _from, state) do
-    new_subscribers = MapSet.delete(state.subscribers, pid)
-    new_state = %{state | subscribers: new_subscribers}
-    {:reply, :ok, new_state}
-  end
+    Logger.info("SpaceMouse #{state.device_id} connected")
+    broadcast(state, {:spacemouse_connected, device_info(state)})
 
-  @impl true
-  def handle_call({:set_led, led_state}, _from, state) do
-    case state.platform_module.send_led_command(state.platform_state, led_state) do
-      {:ok, new_platform_state} ->
-        # Check if LED state actually changed
-        if state.led_state != led_state do
-          # Emit LED state change event
-          led_event = {:spacemouse_led_changed, %{
-            from: state.led_state,
-            to: led_state,
-            timestamp: System.monotonic_time(:millisecond)
-          }}
-          broadcast_to_subscribers(state.subscribers, led_event)
-        end
-        
-        new_state = %{state | led_state: led_state, platform_state: new_platform_state}
-        {:reply, :ok, new_state}
-        
-      error ->
-        {:reply, error, state}
-    end
-  end
-
-  @impl true
-  def handle_call(:get_led_state, _from, state) do
-    {:reply, {:ok, state.led_state}, state}
-  end
-
-  @impl true
-  def handle_call(:connected?, _from, state) do
-    connected = state.connection_state == :connected
-    {:reply, connected, state}
+    {:ok, state}
   end
 
   @impl true
-  def handle_call(:connection_state, _from, state) do
-    {:reply, state.connection_state, state}
-  end
+  def handle_call(:info, _from, state) do
+    info = %{
+      device_id: state.device_id,
+      vendor_id: state.vendor_id,
+      product_id: state.product_id,
+      led_state: state.led_state
+    }
 
-  @impl true
-  def handle_call(:platform_info, _from, state) do
-    info = state.platform_module.platform_info()
     {:reply, info, state}
   end
 
@@ -266,84 +192,75 @@ defmodule SpaceMouse.Core.Device do
   end
 
   @impl true
-  def handle_call({:set_auto_reconnect, enabled}, _from, state) do
-    new_state = %{state | auto_reconnect: enabled}
-    {:reply, :ok, new_state}
+  def handle_call(:pipeline_metrics, _from, state) do
+    {:reply, MotionPipeline.metrics(state.pipeline), state}
   end
 
   @impl true
-  def handle_info({:hid_event, %{type: :status, message: "ready"}}, state) do
-    Logger.info("HID reader ready")
-    {:noreply, state}
+  def handle_call(:buttons, _from, state) do
+    {:reply, state.buttons, state}
   end
 
   @impl true
-  def handle_info({:hid_event, %{type: :status, message: "device_connected"}}, state) do
-    Logger.info("SpaceMouse device connected via HID")
-    
-    # Update platform state to reflect device connection
-    new_platform_state = %{state.platform_state | device_connected: true}
-    new_state = %{state | connection_state: :connected, platform_state: new_platform_state}
-    
-    # Notify subscribers
-    device_info = %{platform: :macos, method: :iokit_hid, timestamp: System.monotonic_time(:millisecond)}
-    message = {:spacemouse_connected, device_info}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    {:noreply, new_state}
+  def handle_call(:disconnect, _from, state) do
+    Logger.info("SpaceMouse #{state.device_id} disconnected")
+    broadcast(state, {:spacemouse_disconnected, device_info(state)})
+    {:reply, :ok, state}
   end
 
   @impl true
-  def handle_info({:hid_event, %{type: :status, message: "device_disconnected"}}, state) do
-    Logger.info("SpaceMouse device disconnected via HID")
-    
-    # Update platform state to reflect device disconnection
-    new_platform_state = %{state.platform_state | device_connected: false}
-    new_state = %{state | connection_state: :disconnected, led_state: :unknown, platform_state: new_platform_state}
-    
-    # Notify subscribers
-    device_info = %{platform: :macos, method: :iokit_hid, timestamp: System.monotonic_time(:millisecond)}
-    message = {:spacemouse_disconnected, device_info}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    # Auto-reconnect if enabled
-    if state.auto_reconnect do
-      Process.send_after(self(), :attempt_reconnect, 2000)
+  def handle_cast({:led_changed, led_state}, state) do
+    if state.led_state != led_state do
+      led_event = {:spacemouse_led_changed, %{
+        device_id: state.device_id,
+        from: state.led_state,
+        to: led_state,
+        timestamp: System.monotonic_time(:millisecond)
+      }}
+      broadcast(state, led_event)
     end
-    
-    {:noreply, new_state}
+
+    {:noreply, %{state | led_state: led_state}}
   end
 
   @impl true
-  def handle_info({:hid_event, %{type: :motion, data: motion_data}}, state) do
-    # Scale motion values from ±350 integer range to ±1.0 float range
-    scaled_motion_data = scale_motion_values(motion_data)
-    
-    # Update last motion state with scaled values
-    new_motion = Map.merge(state.last_motion, scaled_motion_data)
-    new_state = %{state | last_motion: new_motion}
-    
-    # Notify subscribers with scaled values
-    message = {:spacemouse_motion, new_motion}
-    broadcast_to_subscribers(state.subscribers, message)
-    
+  def handle_info({:hid_event, %{type: :motion, data: motion_data} = event}, state) do
+    # Readers emit one complete 6-axis frame per HID report, so the scaled
+    # frame replaces the last one outright instead of being merged into it
+    fields = event_fields(event, state)
+    timestamp = fields.device_timestamp || fields.received_at || System.monotonic_time(:microsecond)
+
+    # The configured pipeline runs here, once per frame, before fan-out
+    {new_motion, pipeline} = MotionPipeline.run(state.pipeline, scale_motion_values(motion_data), timestamp)
+    new_state = %{state | last_motion: new_motion, pipeline: pipeline}
+    DeviceState.put_motion(state.device_id, new_motion)
+
+    # Notify subscribers with processed values and the report timestamps
+    message = {:spacemouse_motion, Map.merge(new_motion, fields)}
+    broadcast(state, message)
+
     {:noreply, new_state}
   end
 
   @impl true
-  def handle_info({:hid_event, %{type: :button, data: button_data}}, state) do
-    # Update button state
-    button_id = Map.get(button_data, :id, 0)
-    button_state = Map.get(button_data, :state, :unknown)
-    
-    new_button_state = Map.put(state.last_button_state, button_id, button_state)
-    new_state = %{state | last_button_state: new_button_state}
-    
-    # Notify subscribers
-    message = {:spacemouse_button, button_data}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    {:noreply, new_state}
+  def handle_info({:hid_event, %{type: :buttons, data: %{buttons: buttons, changed: changed}} = event}, state) do
+    # One event per report: a chord arrives as a single message carrying
+    # the full bitmask, so the state is replaced, not patched per button
+    payload =
+      Map.merge(
+        %{
+          buttons: buttons,
+          changed: changed,
+          pressed: button_ids(changed &&& buttons),
+          released: button_ids(changed &&& bnot(buttons))
+        },
+        event_fields(event, state)
+      )
+
+    DeviceState.put_buttons(state.device_id, buttons)
+    broadcast(state, {:spacemouse_buttons, payload})
+
+    {:noreply, %{state | buttons: buttons}}
   end
 
   @impl true
@@ -353,140 +270,61 @@ defmodule SpaceMouse.Core.Device do
   end
 
   @impl true
-  def handle_info({:device_connected, device_info}, state) do
-    Logger.info("SpaceMouse connected: #{inspect(device_info)}")
-    
-    new_state = %{state | connection_state: :connected}
-    
-    # Notify subscribers
-    message = {:spacemouse_connected, device_info}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    {:noreply, new_state}
-  end
-
-  @impl true
-  def handle_info({:device_disconnected, device_info}, state) do
-    Logger.info("SpaceMouse disconnected: #{inspect(device_info)}")
-    
-    new_state = %{state | connection_state: :disconnected, led_state: :unknown}
-    
-    # Notify subscribers
-    message = {:spacemouse_disconnected, device_info}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    # Auto-reconnect if enabled
-    if state.auto_reconnect do
-      Process.send_after(self(), :attempt_reconnect, 2000)
-    end
-    
-    {:noreply, new_state}
+  def handle_info({:select, _resource, _ref, _ready} = message, state) do
+    # In-process backends (the Linux NIF) read this device's reports here
+    # once the manager has handed them over
+    state.platform_module.handle_device_message(message)
+    {:noreply, state}
   end
 
-  @impl true
-  def handle_info({:motion_event, event}, state) do
-    # Extract motion data
-    motion_data = Map.get(event, :data, %{})
-    
-    # Update last motion state
-    new_motion = Map.merge(state.last_motion, motion_data)
-    new_state = %{state | last_motion: new_motion}
-    
-    # Notify subscribers
-    message = {:spacemouse_motion, new_motion}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    {:noreply, new_state}
-  end
+  # Private Implementation
 
-  @impl true
-  def handle_info({:button_event, event}, state) do
-    # Extract button data
-    button_data = Map.get(event, :data, %{})
-    
-    # Update button state
-    button_id = Map.get(button_data, :id, 0)
-    button_state = Map.get(button_data, :state, :unknown)
-    
-    new_button_state = Map.put(state.last_button_state, button_id, button_state)
-    new_state = %{state | last_button_state: new_button_state}
-    
-    # Notify subscribers
-    message = {:spacemouse_button, button_data}
-    broadcast_to_subscribers(state.subscribers, message)
-    
-    {:noreply, new_state}
+  defp via(device_id) do
+    {:via, Registry, {SpaceMouse.Core.DeviceRegistry, device_id}}
   end
 
-  @impl true
-  def handle_info(:attempt_reconnect, state) do
-    case state.connection_state do
-      :disconnected ->
-        Logger.info("Attempting to reconnect SpaceMouse...")
-        
-        case state.platform_module.start_monitoring(state.platform_state) do
-          {:ok, new_platform_state} ->
-            new_state = %{state | connection_state: :connecting, platform_state: new_platform_state}
-            {:noreply, new_state}
-            
-          {:error, reason} ->
-            Logger.warning("Reconnection failed: #{inspect(reason)}")
-            
-            # Try again later if auto-reconnect is enabled
-            if state.auto_reconnect do
-              Process.send_after(self(), :attempt_reconnect, 5000)
-            end
-            
-            {:noreply, state}
-        end
-        
-      _ ->
-        # Already connecting or connected, don't attempt reconnection
-        Logger.debug("Skipping reconnection attempt - not in disconnected state")
-        {:noreply, state}
-    end
-  end
+  defp server(pid) when is_pid(pid), do: pid
+  defp server(device_id), do: via(device_id)
 
-  # Private Implementation
+  defp device_info(state) do
+    %{platform: platform, method: method} = state.platform_info
 
-  defp select_platform do
-    case :os.type() do
-      {:unix, :darwin} ->
-        SpaceMouse.Platform.MacOS.HidBridge
-        
-      {:unix, :linux} ->
-        # Future Linux implementation
-        raise "Linux support not yet implemented. Currently only macOS is supported."
-        
-      {:win32, _} ->
-        # Future Windows implementation  
-        raise "Windows support not yet implemented. Currently only macOS is supported."
-        
-      other ->
-        raise "Unsupported platform: #{inspect(other)}. Currently only macOS is supported."
-    end
+    %{
+      device_id: state.device_id,
+      vendor_id: state.vendor_id,
+      product_id: state.product_id,
+      platform: platform,
+      method: method,
+      timestamp: System.monotonic_time(:millisecond)
+    }
   end
 
-  defp get_device_info(state) do
-    base_info = state.platform_module.platform_info()
-    Map.merge(base_info, %{
-      led_state: state.led_state,
-      last_motion: state.last_motion,
-      timestamp: System.monotonic_time(:millisecond)
-    })
+  # Device ID, reader capture time (µs, reader's monotonic clock) and BEAM
+  # receive time (µs, System.monotonic_time/1) for motion and buttons events
+  defp event_fields(event, state) do
+    %{
+      device_id: state.device_id,
+      device_timestamp: Map.get(event, :device_timestamp),
+      received_at: Map.get(event, :received_at)
+    }
   end
 
-  defp broadcast_to_subscribers(subscribers, message) do
-    Enum.each(subscribers, fn pid ->
-      send(pid, message)
-    end)
+  # Button IDs (1-based) of the set bits, ascending
+  defp button_ids(mask), do: button_ids(mask, 1, [])
+
+  defp button_ids(0, _id, acc), do: Enum.reverse(acc)
+  defp button_ids(mask, id, acc) when (mask &&& 1) == 1, do: button_ids(mask >>> 1, id + 1, [id | acc])
+  defp button_ids(mask, id, acc), do: button_ids(mask >>> 1, id + 1, acc)
+
+  defp broadcast(state, message) do
+    Dispatcher.dispatch(state.device_id, message)
   end
 
   # Scale motion values from ±350 integer range to ±1.0 float range
   defp scale_motion_values(motion_data) do
     # Hardware range is ±350, scale to ±1.0
     scale_factor = 1.0 / 350.0
-    
+
     motion_data
     |> Enum.map(fn {axis, value} ->
       # Convert integer to float and scale
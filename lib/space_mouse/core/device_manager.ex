@@ -0,0 +1,624 @@
+defmodule SpaceMouse.Core.DeviceManager do
+  @moduledoc """
+  Main SpaceMouse device manager.
+
+  This module provides a unified interface for SpaceMouse interaction across
+  different platforms, automatically selecting the appropriate platform
+  implementation based on the runtime environment.
+
+  The platform reports every attached SpaceMouse under its own device ID.
+  For each one the manager starts a `SpaceMouse.Core.Device` process under
+  `SpaceMouse.Core.DeviceSupervisor`, so devices are handled independently
+  of each other. Motion and button events go from the platform straight to
+  that process (see `SpaceMouse.Core.Device.route/2`); the manager only
+  handles status and lifecycle events. Subscriptions are
+  kept by `SpaceMouse.Core.Dispatcher`, which also delivers the events.
+
+  Features:
+  - Cross-platform device detection and connection management
+  - Multiple devices at once, each under a stable device ID
+  - Real-time motion and button event streaming, per device or merged
+  - LED control (when supported by platform)
+  - Automatic reconnection handling
+  - Clean supervisor integration
+  """
+
+  use GenServer
+  require Logger
+
+  alias SpaceMouse.Core.{Device, DeviceState, Dispatcher, SubscriptionFilter}
+
+  defmodule State do
+    @moduledoc false
+    defstruct [
+      :platform_module,
+      :platform_state,
+      :connection_state,
+      :devices,
+      :led_state,
+      :auto_reconnect
+    ]
+  end
+
+  @type connection_state :: :disconnected | :connecting | :connected | :error
+  @type device_id :: pos_integer()
+  @type device_target :: device_id() | :all
+  @type motion_data :: %{x: integer(), y: integer(), z: integer(), rx: integer(), ry: integer(), rz: integer()}
+  @type button_data :: %{id: integer(), state: :pressed | :released}
+  @type event_timestamps :: %{device_timestamp: non_neg_integer() | nil, received_at: integer() | nil}
+
+  @zero_motion %{x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}
+
+  # Client API
+
+  @doc """
+  Start the SpaceMouse device manager.
+  """
+  def start_link(opts \\ []) do
+    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+  end
+
+  @doc """
+  Start monitoring for SpaceMouse devices.
+  """
+  def start_monitoring do
+    GenServer.call(__MODULE__, :start_monitoring)
+  end
+
+  @doc """
+  Stop monitoring for SpaceMouse devices.
+  """
+  def stop_monitoring do
+    GenServer.call(__MODULE__, :stop_monitoring)
+  end
+
+  @doc """
+  Subscribe to SpaceMouse events.
+
+  Options:
+  - `device:` a device ID to receive only that device's events, or `:all`
+    (default) for every device. Subscribing again adds devices; `:all`
+    covers everything.
+  - `delivery:` how motion reaches a subscriber that falls behind:
+    `:every` (default), `:latest` or `{:bounded, n}`, with `ack/1` from
+    the subscriber releasing the next frames (see
+    `SpaceMouse.Core.Dispatcher`). Other events are always delivered.
+  - `events:`, `axes:`, `min_delta:` and `buttons:` filter what is sent
+    at all: event types, motion axes, a minimum motion change and button
+    IDs (see `SpaceMouse.Core.SubscriptionFilter`). Evaluated in the
+    dispatcher, before anything is copied to the subscriber.
+
+  The subscriber will receive:
+  - `{:spacemouse_connected, device_info}`
+  - `{:spacemouse_disconnected, device_info}`
+  - `{:spacemouse_motion, motion_data}`
+  - `{:spacemouse_buttons, button_data}` - one per report that changed any
+    button: `:buttons` (bitmask after the report, bit 0 is button 1),
+    `:changed` (bits that changed) and the `:pressed` / `:released` IDs
+
+  Every payload carries the `:device_id` it came from. Motion and buttons
+  payloads also carry `:device_timestamp`, the report capture time in
+  microseconds on the native reader's monotonic clock, and `:received_at`,
+  the BEAM receive time from `System.monotonic_time(:microsecond)`.
+  The two clocks have different origins; compare deltas, not absolute values.
+  """
+  def subscribe(pid \\ self(), opts \\ []) do
+    delivery = Keyword.get(opts, :delivery, :every)
+
+    unless Dispatcher.valid_delivery?(delivery) do
+      raise ArgumentError, "invalid delivery mode: #{inspect(delivery)}"
+    end
+
+    # Compiled here so an invalid spec raises in the caller
+    filter = SubscriptionFilter.compile(opts)
+
+    GenServer.call(__MODULE__, {:subscribe, pid, Keyword.get(opts, :device, :all), delivery, filter})
+  end
+
+  @doc """
+  Acknowledge the motion frames delivered to `pid` so far, for the
+  `:latest` and `{:bounded, n}` delivery modes. Goes straight to the
+  dispatcher, not through this process.
+  """
+  def ack(pid \\ self()) do
+    Dispatcher.ack(pid)
+  end
+
+  @doc """
+  Unsubscribe from SpaceMouse events (every device).
+  """
+  def unsubscribe(pid \\ self()) do
+    GenServer.call(__MODULE__, {:unsubscribe, pid})
+  end
+
+  @doc """
+  Set LED state (on/off) of one device (`device: id`) or all of them
+  (default).
+  """
+  def set_led(state, opts \\ []) when state in [:on, :off] do
+    GenServer.call(__MODULE__, {:set_led, state, Keyword.get(opts, :device, :all)})
+  end
+
+  @doc """
+  Take the current frame of one device (`device: id`) or all of them
+  (default) as the zero point of its axes.
+  """
+  def calibrate(opts \\ []) do
+    GenServer.call(__MODULE__, {:calibrate, Keyword.get(opts, :device, :all)})
+  end
+
+  @doc """
+  Get current LED state (the last command sent).
+  """
+  def get_led_state do
+    GenServer.call(__MODULE__, :get_led_state)
+  end
+
+  @doc """
+  Check if a SpaceMouse is currently connected. Read from
+  `SpaceMouse.Core.DeviceState`, without a call to this process.
+  """
+  def connected? do
+    DeviceState.connection_state() == :connected
+  end
+
+  @doc """
+  Get current connection state, like `connected?/0` without a call.
+  """
+  def connection_state do
+    DeviceState.connection_state()
+  end
+
+  @doc """
+  Get platform information.
+  """
+  def platform_info do
+    GenServer.call(__MODULE__, :platform_info)
+  end
+
+  @doc """
+  List the connected devices, ordered by device ID.
+  """
+  def devices do
+    GenServer.call(__MODULE__, :devices)
+  end
+
+  @doc """
+  Get the current motion state of one device (`device: id`), by default the
+  connected device with the lowest ID.
+
+  Returns the last received motion data, or zeros if no motion has been detected.
+  Read from `SpaceMouse.Core.DeviceState`, without a call to any process.
+  """
+  def get_motion_state(opts \\ []) do
+    case DeviceState.motion(Keyword.get(opts, :device) || DeviceState.default_device()) do
+      {:ok, frame} -> {:ok, Map.delete(frame, :sequence)}
+      :disconnected -> {:ok, @zero_motion}
+    end
+  end
+
+  @doc """
+  Get the pressed buttons of one device (`device: id`, by default the
+  lowest ID) as a bitmask, bit 0 being button 1. 0 if no device is connected.
+  Read without a call, like `get_motion_state/1`.
+  """
+  def buttons(opts \\ []) do
+    DeviceState.buttons(Keyword.get(opts, :device) || DeviceState.default_device())
+  end
+
+  @doc """
+  Check whether button `id` (1-based) of one device (`device: id`, by
+  default the lowest ID) is pressed.
+  """
+  def button_pressed?(id, opts \\ []) when is_integer(id) and id >= 1 do
+    Device.pressed?(buttons(opts), id)
+  end
+
+  @doc """
+  Get the per-stage cost of the motion pipeline of one device (`device:
+  id`, by default the lowest ID). `[]` without a pipeline or device.
+  """
+  def pipeline_metrics(opts \\ []) do
+    case Keyword.get(opts, :device) || DeviceState.default_device() do
+      nil -> []
+      device_id -> Device.pipeline_metrics(device_id)
+    end
+  catch
+    :exit, _reason -> []
+  end
+
+  @doc """
+  Set auto-reconnect behavior.
+  """
+  def set_auto_reconnect(enabled) when is_boolean(enabled) do
+    GenServer.call(__MODULE__, {:set_auto_reconnect, enabled})
+  end
+
+  # GenServer Implementation
+
+  @impl true
+  def init(opts) do
+    # Select platform implementation
+    platform_module = select_platform()
+    auto_reconnect = Keyword.get(opts, :auto_reconnect, true)
+
+    # A restarted manager starts from a clean slate: the reader it spawns
+    # announces every attached device again
+    stop_orphaned_devices()
+
+    # Initialize platform
+    {:ok, platform_state} = platform_module.platform_init(owner_pid: self())
+
+    state =
+      put_connection_state(
+        %State{
+          platform_module: platform_module,
+          platform_state: platform_state,
+          devices: %{},
+          led_state: :unknown,
+          auto_reconnect: auto_reconnect
+        },
+        :disconnected
+      )
+
+    Logger.info("SpaceMouse device manager initialized (platform: #{platform_module})")
+    {:ok, state}
+  end
+
+  @impl true
+  def handle_call(:start_monitoring, _from, state) do
+    # Check if already monitoring
+    case state.connection_state do
+      :connecting ->
+        Logger.debug("SpaceMouse monitoring already starting")
+        {:reply, :ok, state}
+
+      :connected ->
+        Logger.debug("SpaceMouse already connected and monitoring")
+        {:reply, :ok, state}
+
+      _ ->
+        # Only start monitoring if not already connecting or connected
+        case state.platform_module.start_monitoring(state.platform_state) do
+          {:ok, new_platform_state} ->
+            new_state = put_connection_state(%{state | platform_state: new_platform_state}, :connecting)
+            {:reply, :ok, new_state}
+
+          {:error, reason} ->
+            new_state = put_connection_state(state, :error)
+            {:reply, {:error, reason}, new_state}
+        end
+    end
+  end
+
+  @impl true
+  def handle_call(:stop_monitoring, _from, state) do
+    case state.platform_module.stop_monitoring(state.platform_state) do
+      {:ok, new_platform_state} ->
+        new_state =
+          state.devices
+          |> Map.keys()
+          |> Enum.reduce(state, &remove_device(&2, &1))
+
+        {:reply, :ok, put_connection_state(%{new_state | platform_state: new_platform_state}, :disconnected)}
+
+      error ->
+        {:reply, error, state}
+    end
+  end
+
+  @impl true
+  def handle_call({:subscribe, pid, target, delivery, filter}, _from, state) do
+    # Subscribed inside the call so no device can connect in between
+    subscription = Dispatcher.subscribe(pid, target, delivery, filter)
+
+    # Send current state to new subscriber
+    Enum.each(state.devices, fn {device_id, device} ->
+      message = {:spacemouse_connected, device_info(state, device_id, device)}
+
+      if subscribed?(subscription, device_id) and SubscriptionFilter.evaluate(filter, message, nil) != :skip do
+        send(pid, message)
+      end
+    end)
+
+    {:reply, :ok, state}
+  end
+
+  @impl true
+  def handle_call({:unsubscribe, pid}, _from, state) do
+    {:reply, Dispatcher.unsubscribe(pid), state}
+  end
+
+  @impl true
+  def handle_call({:set_led, led_state, target}, _from, state) do
+    case state.platform_module.send_led_command(state.platform_state, target, led_state) do
+      {:ok, new_platform_state} ->
+        # Devices emit the LED state change event to their subscribers
+        state.devices
+        |> Enum.filter(fn {device_id, _device} -> target in [:all, device_id] end)
+        |> Enum.each(fn {_device_id, device} -> Device.led_changed(device.pid, led_state) end)
+
+        new_state = %{state | led_state: led_state, platform_state: new_platform_state}
+        {:reply, :ok, new_state}
+
+      error ->
+        {:reply, error, state}
+    end
+  end
+
+  @impl true
+  def handle_call({:calibrate, target}, _from, state) do
+    if function_exported?(state.platform_module, :calibrate, 2) do
+      case state.platform_module.calibrate(state.platform_state, target) do
+        {:ok, new_platform_state} -> {:reply, :ok, %{state | platform_state: new_platform_state}}
+        error -> {:reply, error, state}
+      end
+    else
+      {:reply, {:error, :not_supported}, state}
+    end
+  end
+
+  @impl true
+  def handle_call(:get_led_state, _from, state) do
+    {:reply, {:ok, state.led_state}, state}
+  end
+
+  @impl true
+  def handle_call(:platform_info, _from, state) do
+    info = state.platform_module.platform_info()
+    {:reply, info, state}
+  end
+
+  @impl true
+  def handle_call(:devices, _from, state) do
+    devices =
+      state.devices
+      |> Enum.sort()
+      |> Enum.map(fn {device_id, device} -> device_info(state, device_id, device) end)
+
+    {:reply, devices, state}
+  end
+
+  @impl true
+  def handle_call({:set_auto_reconnect, enabled}, _from, state) do
+    new_state = %{state | auto_reconnect: enabled}
+    {:reply, :ok, new_state}
+  end
+
+  @impl true
+  def handle_info({:hid_event, %{type: type, device_id: device_id} = event}, state)
+      when type in [:motion, :buttons, :led_changed] do
+    # Only events that raced the device process's start-up come this way
+    case Map.get(state.devices, device_id) do
+      nil -> :ok
+      device -> Device.handle_event(device.pid, event)
+    end
+
+    {:noreply, state}
+  end
+
+  @impl true
+  def handle_info({:hid_event, %{type: :status, message: "ready"}}, state) do
+    Logger.info("HID reader ready")
+    {:noreply, state}
+  end
+
+  @impl true
+  def handle_info({:hid_event, %{type: :status, message: "device_connected", device_id: device_id} = event}, state) do
+    Logger.info("SpaceMouse device #{device_id} connected via HID")
+
+    device = %{
+      vendor_id: Map.get(event, :vendor_id),
+      product_id: Map.get(event, :product_id)
+    }
+
+    new_state =
+      state
+      |> remove_device(device_id)
+      |> start_device(device_id, device)
+
+    {:noreply, update_connection(new_state)}
+  end
+
+  @impl true
+  def handle_info({:hid_event, %{type: :status, message: "device_disconnected", device_id: device_id}}, state) do
+    Logger.info("SpaceMouse device #{device_id} disconnected via HID")
+
+    new_state = update_connection(remove_device(state, device_id))
+
+    # Auto-reconnect once the last device is gone
+    if new_state.connection_state == :disconnected and state.auto_reconnect do
+      Process.send_after(self(), :attempt_reconnect, 2000)
+    end
+
+    {:noreply, new_state}
+  end
+
+  @impl true
+  def handle_info({:hid_event, _event}, state) do
+    # Ignore unknown HID events
+    {:noreply, state}
+  end
+
+  @impl true
+  def handle_info({:DOWN, ref, :process, _pid, reason}, state) do
+    # A device process crashed while its device is still attached: start a
+    # fresh one so events keep flowing
+    case Enum.find(state.devices, fn {_device_id, device} -> device.ref == ref end) do
+      {device_id, device} ->
+        Logger.warning("SpaceMouse device #{device_id} process exited: #{inspect(reason)}")
+        new_state = %{state | devices: Map.delete(state.devices, device_id)}
+        {:noreply, start_device(new_state, device_id, Map.take(device, [:vendor_id, :product_id]))}
+
+      nil ->
+        {:noreply, state}
+    end
+  end
+
+  @impl true
+  def handle_info(:attempt_reconnect, state) do
+    case state.connection_state do
+      :disconnected ->
+        Logger.info("Attempting to reconnect SpaceMouse...")
+
+        case state.platform_module.start_monitoring(state.platform_state) do
+          {:ok, new_platform_state} ->
+            new_state = put_connection_state(%{state | platform_state: new_platform_state}, :connecting)
+            {:noreply, new_state}
+
+          {:error, reason} ->
+            Logger.warning("Reconnection failed: #{inspect(reason)}")
+
+            # Try again later if auto-reconnect is enabled
+            if state.auto_reconnect do
+              Process.send_after(self(), :attempt_reconnect, 5000)
+            end
+
+            {:noreply, state}
+        end
+
+      _ ->
+        # Already connecting or connected, don't attempt reconnection
+        Logger.debug("Skipping reconnection attempt - not in disconnected state")
+        {:noreply, state}
+    end
+  end
+
+  @impl true
+  def handle_info({:select, _resource, _ref, _ready} = message, state) do
+    dispatch_platform_message(message, state)
+  end
+
+  @impl true
+  def handle_info({:platform, message}, state) do
+    dispatch_platform_message(message, state)
+  end
+
+  # Private Implementation
+
+  # config :space_mouse, platform: :simulator | :linux_nif (or any module
+  # implementing SpaceMouse.Platform.Behaviour) overrides the OS-based choice
+  defp select_platform do
+    case Application.get_env(:space_mouse, :platform) do
+      nil -> select_os_platform()
+      :simulator -> SpaceMouse.Platform.Simulator.HidBridge
+      :linux_nif -> SpaceMouse.Platform.Linux.NifBridge
+      platform_module when is_atom(platform_module) -> platform_module
+    end
+  end
+
+  defp select_os_platform do
+    case :os.type() do
+      {:unix, :darwin} ->
+        SpaceMouse.Platform.MacOS.HidBridge
+
+      {:unix, :linux} ->
+        SpaceMouse.Platform.Linux.HidBridge
+
+      {:win32, _} ->
+        # Future Windows implementation
+        raise "Windows support not yet implemented. Currently macOS and Linux are supported."
+
+      other ->
+        raise "Unsupported platform: #{inspect(other)}. Currently macOS and Linux are supported."
+    end
+  end
+
+  # In-process backends (the Linux NIF) get their notifications here
+  defp dispatch_platform_message(message, state) do
+    {:noreply, platform_message(state, message)}
+  end
+
+  defp platform_message(state, message) do
+    if function_exported?(state.platform_module, :handle_platform_message, 2) do
+      {:ok, new_platform_state} = state.platform_module.handle_platform_message(message, state.platform_state)
+      %{state | platform_state: new_platform_state}
+    else
+      state
+    end
+  end
+
+  defp stop_orphaned_devices do
+    SpaceMouse.Core.DeviceSupervisor
+    |> DynamicSupervisor.which_children()
+    |> Enum.each(fn {_, pid, _, _} ->
+      DynamicSupervisor.terminate_child(SpaceMouse.Core.DeviceSupervisor, pid)
+    end)
+
+    DeviceState.detach_all()
+  end
+
+  defp start_device(state, device_id, device) do
+    opts = [
+      device_id: device_id,
+      vendor_id: device.vendor_id,
+      product_id: device.product_id,
+      platform_info: state.platform_module.platform_info(),
+      platform_module: state.platform_module
+    ]
+
+    case DynamicSupervisor.start_child(SpaceMouse.Core.DeviceSupervisor, {Device, opts}) do
+      {:ok, pid} ->
+        device = Map.merge(device, %{pid: pid, ref: Process.monitor(pid)})
+        platform_message(%{state | devices: Map.put(state.devices, device_id, device)}, {:device_started, device_id, pid})
+
+      {:error, reason} ->
+        Logger.error("Failed to start SpaceMouse device #{device_id}: #{inspect(reason)}")
+        state
+    end
+  end
+
+  # The device process announces the disconnect to its subscribers and is
+  # stopped before returning, so its registered name is free again for a
+  # reconnect of the same ID
+  defp remove_device(state, device_id) do
+    case Map.pop(state.devices, device_id) do
+      {nil, _devices} ->
+        state
+
+      {device, devices} ->
+        Process.demonitor(device.ref, [:flush])
+        DeviceState.detach(device_id)
+        Device.disconnect(device.pid)
+        DynamicSupervisor.terminate_child(SpaceMouse.Core.DeviceSupervisor, device.pid)
+        platform_message(%{state | devices: devices}, {:device_stopped, device_id, device.pid})
+    end
+  end
+
+  # Connected while any device is; platform state mirrors it for LED commands
+  defp update_connection(state) do
+    connected = map_size(state.devices) > 0
+    new_platform_state = %{state.platform_state | device_connected: connected}
+
+    connection_state =
+      cond do
+        connected -> :connected
+        state.connection_state == :connected -> :disconnected
+        true -> state.connection_state
+      end
+
+    put_connection_state(%{state | platform_state: new_platform_state}, connection_state)
+  end
+
+  # The state struct and the lock-free copy read by connected?/0
+  defp put_connection_state(state, connection_state) do
+    DeviceState.put_connection_state(connection_state)
+    %{state | connection_state: connection_state}
+  end
+
+  defp subscribed?(:all, _device_id), do: true
+  defp subscribed?(device_ids, device_id), do: MapSet.member?(device_ids, device_id)
+
+  defp device_info(state, device_id, device) do
+    %{platform: platform, method: method} = state.platform_module.platform_info()
+
+    %{
+      device_id: device_id,
+      vendor_id: device.vendor_id,
+      product_id: device.product_id,
+      platform: platform,
+      method: method,
+      timestamp: System.monotonic_time(:millisecond)
+    }
+  end
+end
@@ -0,0 +1,202 @@
+defmodule SpaceMouse.Core.DeviceState do
+  @moduledoc """
+  Latest device state, readable from any process without a message.
+
+  `get_motion_state/1`, `buttons/1`, `connected?/0` and
+  `connection_state/0` used to be calls into the device and manager
+  processes, so under motion load they queued behind event handling. The
+  state they return now lives in one `:atomics` array, written by the
+  process that owns it and read directly by the caller. A read is a few
+  atomic loads and costs the same at any event rate.
+
+  Per device ID (1-8) the array holds a sequence number, the six axis
+  values of the last frame as sent to subscribers (scaled and through the
+  motion pipeline, stored in millionths), the button bitmask and whether
+  the device is attached. The `SpaceMouse.Core.Device` process of that ID
+  is the only writer of the frame and buttons and updates them as a
+  seqlock: the sequence is odd while a write is in progress, and a reader
+  retries until it sees the same even sequence before and after its loads.
+  The sequence therefore also counts updates (two per update), so a poller
+  can tell a new frame from a repeated one.
+
+  A reader yields between retries and gives up after 100 of them, reading
+  the device as `:disconnected`: a device process killed in the middle of a
+  write leaves the sequence odd until the next one attaches to the ID,
+  which makes it even again.
+
+  The attached flag and the connection state are single words, also
+  written by `SpaceMouse.Core.DeviceManager` when it removes a device.
+  """
+
+  import Bitwise
+
+  @max_devices 8
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+  # Axis values are stored as integers in millionths
+  @fixed_point 1_000_000
+
+  # Word 1 is the connection state, then one slot per device:
+  # sequence, x, y, z, rx, ry, rz, buttons, attached
+  @slot_size 9
+  @buttons_offset 7
+  @attached_offset 8
+
+  @connection_states [:disconnected, :connecting, :connected, :error]
+
+  # Reads of a slot that is being written before giving up
+  @max_retries 100
+
+  @doc """
+  Create the array. Called once by `SpaceMouse.Core.Supervisor`; the array
+  outlives restarts of the processes that write it.
+  """
+  def init do
+    unless :persistent_term.get(__MODULE__, nil) do
+      :persistent_term.put(__MODULE__, :atomics.new(1 + @max_devices * @slot_size, signed: true))
+    end
+
+    :ok
+  end
+
+  @doc """
+  Latest scaled frame of `device_id` with its `:sequence`, or
+  `:disconnected` if no device holds that ID.
+  """
+  def motion(device_id) do
+    with {:ok, [sequence | values]} <- read(device_id) do
+      frame = @axes |> Enum.zip(values) |> Map.new(fn {axis, value} -> {axis, value / @fixed_point} end)
+      {:ok, Map.put(frame, :sequence, sequence)}
+    end
+  end
+
+  @doc """
+  Button bitmask of `device_id` (bit 0 is button 1), 0 if it is not
+  attached.
+  """
+  def buttons(device_id) do
+    case read(device_id) do
+      {:ok, values} -> List.last(values)
+      :disconnected -> 0
+    end
+  end
+
+  @doc """
+  Lowest attached device ID, or `nil`.
+  """
+  def default_device do
+    Enum.find(1..@max_devices, &attached?/1)
+  end
+
+  @doc """
+  Check whether a device holds `device_id`.
+  """
+  def attached?(device_id) when device_id in 1..@max_devices do
+    :atomics.get(ref(), base(device_id) + @attached_offset) == 1
+  end
+
+  def attached?(_device_id), do: false
+
+  @doc """
+  Current connection state of the manager.
+  """
+  def connection_state do
+    Enum.at(@connection_states, :atomics.get(ref(), 1))
+  end
+
+  @doc false
+  def put_connection_state(connection_state) do
+    index = Enum.find_index(@connection_states, &(&1 == connection_state))
+    :atomics.put(ref(), 1, index)
+  end
+
+  @doc false
+  def attach(device_id) when device_id in 1..@max_devices do
+    atomics = ref()
+    base = base(device_id)
+
+    # The previous writer may have died mid-write and left the sequence odd:
+    # start from the next odd value instead of adding to it
+    :atomics.put(atomics, base, :atomics.get(atomics, base) ||| 1)
+    for offset <- 1..@buttons_offset, do: :atomics.put(atomics, base + offset, 0)
+    :atomics.put(atomics, base + @attached_offset, 1)
+    :atomics.add(atomics, base, 1)
+    :ok
+  end
+
+  def attach(_device_id), do: :ok
+
+  @doc false
+  def detach(device_id) when device_id in 1..@max_devices do
+    # One word, outside the seqlock: the device may still be writing
+    :atomics.put(ref(), base(device_id) + @attached_offset, 0)
+  end
+
+  def detach(_device_id), do: :ok
+
+  @doc false
+  def detach_all do
+    Enum.each(1..@max_devices, &detach/1)
+  end
+
+  @doc false
+  def put_motion(device_id, motion) do
+    write(device_id, fn atomics, base ->
+      @axes
+      |> Enum.with_index(1)
+      |> Enum.each(fn {axis, offset} -> :atomics.put(atomics, base + offset, round(Map.get(motion, axis, 0) * @fixed_point)) end)
+    end)
+  end
+
+  @doc false
+  def put_buttons(device_id, buttons) do
+    write(device_id, fn atomics, base -> :atomics.put(atomics, base + @buttons_offset, buttons) end)
+  end
+
+  defp ref, do: :persistent_term.get(__MODULE__)
+
+  defp base(device_id), do: 1 + (device_id - 1) * @slot_size + 1
+
+  # Single writer per slot: odd sequence while the words change
+  defp write(device_id, fun) when device_id in 1..@max_devices do
+    atomics = ref()
+    base = base(device_id)
+
+    :atomics.add(atomics, base, 1)
+    fun.(atomics, base)
+    :atomics.add(atomics, base, 1)
+    :ok
+  end
+
+  defp write(_device_id, _fun), do: :ok
+
+  # Sequence, the six axes and the buttons of one consistent update
+  defp read(device_id) when device_id in 1..@max_devices do
+    read(ref(), base(device_id), 0)
+  end
+
+  defp read(_device_id), do: :disconnected
+
+  defp read(_atomics, _base, @max_retries), do: :disconnected
+
+  defp read(atomics, base, retries) do
+    sequence = :atomics.get(atomics, base)
+
+    if (sequence &&& 1) == 1 do
+      retry(atomics, base, retries)
+    else
+      values = for offset <- 1..@attached_offset, do: :atomics.get(atomics, base + offset)
+
+      cond do
+        :atomics.get(atomics, base) != sequence -> retry(atomics, base, retries)
+        List.last(values) != 1 -> :disconnected
+        true -> {:ok, [sequence | List.delete_at(values, -1)]}
+      end
+    end
+  end
+
+  # Let the writer finish, it may share this scheduler
+  defp retry(atomics, base, retries) do
+    :erlang.yield()
+    read(atomics, base, retries + 1)
+  end
+end
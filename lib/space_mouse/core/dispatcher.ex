@@ -0,0 +1,331 @@
+defmodule SpaceMouse.Core.Dispatcher do
+  @moduledoc """
+  Fan-out of device events to subscribers.
+
+  Subscriptions live in a public ETS table, split into partitions by
+  subscriber pid. Every partition is its own process: a device hands an
+  event to each partition that has a subscriber for it (one message per
+  partition, not per subscriber), and the partitions deliver in parallel
+  across schedulers. `SpaceMouse.Core.Device` therefore only handles state
+  transitions, and a burst of motion to hundreds of subscribers never
+  queues in front of `set_led/2` or `connected?/0`.
+
+  A subscriber always lives in the same partition, which receives a
+  device's events in the order the device sent them, so per-device order is
+  preserved for every subscriber.
+
+  The number of partitions defaults to `System.schedulers_online/0` and can
+  be set with `config :space_mouse, dispatcher_partitions: n`.
+
+  The table is owned by this supervisor, so a crashed partition restarts
+  with its subscriptions intact. Subscribers are monitored and removed when
+  they exit.
+
+  ## Delivery modes
+
+  Motion arrives at up to a few hundred frames per second per device. A
+  subscriber that cannot keep up picks how its motion is delivered, so its
+  mailbox stays bounded:
+
+  - `:every` (default) - every frame, as fast as they come
+  - `:latest` - one frame in flight; until the subscriber calls `ack/1`,
+    only the newest frame of each device is kept, and `ack/1` delivers it
+  - `{:bounded, n}` - up to `n` frames in flight; further frames are
+    dropped until `ack/1`
+
+  `ack/1` means "I have handled everything you sent me" (it is also how a
+  `:latest` subscriber pulls the next frame). A motion payload that follows
+  dropped or superseded frames carries their number as `:dropped`.
+  Connection, button and LED events are never held or dropped, so in the
+  coalescing modes they can overtake a held frame; the `:device_timestamp`
+  of each payload still gives the true order.
+
+  ## Filters
+
+  A subscriber can also narrow what it receives to event types, axes, a
+  minimum motion delta and button IDs (see
+  `SpaceMouse.Core.SubscriptionFilter`). The filter is compiled once when
+  subscribing and evaluated by the partition before sending, so filtered
+  events never reach the subscriber's heap. Filters run before the delivery
+  mode: a frame the filter rejects does not count as dropped.
+  """
+
+  use Supervisor
+
+  alias SpaceMouse.Core.Dispatcher.Partition
+  alias SpaceMouse.Core.SubscriptionFilter
+
+  @table __MODULE__
+
+  @type subscription :: :all | MapSet.t(pos_integer())
+  @type delivery :: :every | :latest | {:bounded, pos_integer()}
+
+  @doc false
+  def start_link(opts) do
+    Supervisor.start_link(__MODULE__, opts, name: __MODULE__)
+  end
+
+  @doc """
+  Subscribe `pid` to the events of `target` (a device ID or `:all`), with
+  the given delivery mode and compiled filter (`nil` for none).
+
+  Subscribing again adds devices; `:all` covers everything. Delivery mode
+  and filter apply to all of the subscriber's devices, the latest call
+  wins. Returns the resulting subscription.
+  """
+  @spec subscribe(pid(), pos_integer() | :all, delivery(), SubscriptionFilter.t() | nil) :: subscription()
+  def subscribe(pid, target, delivery \\ :every, filter \\ nil) do
+    GenServer.call(partition_for(pid), {:subscribe, pid, target, delivery, filter})
+  end
+
+  @doc """
+  Acknowledge every motion frame delivered to `pid` so far, releasing the
+  next ones (see "Delivery modes"). A no-op for `:every` subscribers.
+  """
+  def ack(pid) do
+    send(partition_for(pid), {:ack, pid})
+    :ok
+  end
+
+  @doc """
+  Check a delivery mode given to `subscribe/3`.
+  """
+  def valid_delivery?(:every), do: true
+  def valid_delivery?(:latest), do: true
+  def valid_delivery?({:bounded, max}) when is_integer(max) and max > 0, do: true
+  def valid_delivery?(_delivery), do: false
+
+  @doc """
+  Remove every subscription of `pid`.
+  """
+  def unsubscribe(pid) do
+    GenServer.call(partition_for(pid), {:unsubscribe, pid})
+  end
+
+  @doc """
+  Deliver `message` to every subscriber of `device_id`.
+
+  Called from the device's own process; returns as soon as the message is
+  handed to the partitions that have a matching subscriber.
+  """
+  def dispatch(device_id, message) do
+    partitions = :persistent_term.get({__MODULE__, :partitions})
+
+    for index <- 0..(tuple_size(partitions) - 1),
+        :ets.member(@table, {index, device_id}) or :ets.member(@table, {index, :all}) do
+      send(elem(partitions, index), {:dispatch, device_id, message})
+    end
+
+    :ok
+  end
+
+  @impl true
+  def init(opts) do
+    count =
+      Keyword.get_lazy(opts, :partitions, fn ->
+        Application.get_env(:space_mouse, :dispatcher_partitions, System.schedulers_online())
+      end)
+
+    # {{partition, device_id | :all}, pid, delivery, filter}
+    :ets.new(@table, [:duplicate_bag, :public, :named_table, read_concurrency: true, write_concurrency: true])
+
+    names = for index <- 0..(count - 1), do: :"#{Partition}#{index}"
+    :persistent_term.put({__MODULE__, :partitions}, List.to_tuple(names))
+
+    children =
+      for {name, index} <- Enum.with_index(names) do
+        Supervisor.child_spec({Partition, index: index, name: name, table: @table}, id: {Partition, index})
+      end
+
+    Supervisor.init(children, strategy: :one_for_one)
+  end
+
+  defp partition_for(pid) do
+    partitions = :persistent_term.get({__MODULE__, :partitions})
+    elem(partitions, :erlang.phash2(pid, tuple_size(partitions)))
+  end
+
+  defmodule Partition do
+    @moduledoc false
+
+    # One slice of the subscribers. Writes its own rows of the table and
+    # delivers the events handed to it. State maps each subscriber to its
+    # monitor, subscription, the last frame sent per device (the min_delta
+    # baseline) and, for the coalescing modes, motion flow: frames in
+    # flight, frames held per device and frames dropped since the last one
+    # delivered. Unfiltered :every rows are served from the table alone.
+
+    use GenServer
+
+    alias SpaceMouse.Core.SubscriptionFilter
+
+    def start_link(opts) do
+      GenServer.start_link(__MODULE__, opts, name: Keyword.fetch!(opts, :name))
+    end
+
+    @impl true
+    def init(opts) do
+      index = Keyword.fetch!(opts, :index)
+      table = Keyword.fetch!(opts, :table)
+
+      # After a restart the rows are still there: monitor their owners again
+      subscribers =
+        table
+        |> :ets.match({{index, :"$1"}, :"$2", :"$3", :"$4"})
+        |> Enum.reduce(%{}, fn [target, pid, delivery, filter], acc ->
+          new = subscriber(Process.monitor(pid), add(nil, target), delivery, filter)
+
+          Map.update(acc, pid, new, fn subscriber ->
+            %{subscriber | subscription: add(subscriber.subscription, target)}
+          end)
+        end)
+
+      {:ok, %{index: index, table: table, subscribers: subscribers}}
+    end
+
+    @impl true
+    def handle_call({:subscribe, pid, target, delivery, filter}, _from, state) do
+      old =
+        case Map.get(state.subscribers, pid) do
+          nil -> subscriber(Process.monitor(pid), nil, delivery, filter)
+          subscriber -> subscriber
+        end
+
+      subscription = add(old.subscription, target)
+
+      # A pid holds either one :all row or one row per device, so delivery
+      # never has to deduplicate
+      if {subscription, delivery, filter} != {old.subscription, old.delivery, old.filter} do
+        delete_rows(state, pid)
+
+        rows = if subscription == :all, do: [:all], else: MapSet.to_list(subscription)
+        :ets.insert(state.table, for(key <- rows, do: {{state.index, key}, pid, delivery, filter}))
+      end
+
+      subscriber = %{old | subscription: subscription, delivery: delivery, filter: filter}
+      {:reply, subscription, put_in(state.subscribers[pid], subscriber)}
+    end
+
+    @impl true
+    def handle_call({:unsubscribe, pid}, _from, state) do
+      {:reply, :ok, remove(state, pid)}
+    end
+
+    @impl true
+    def handle_info({:dispatch, device_id, message}, state) do
+      rows = :ets.lookup(state.table, {state.index, device_id}) ++ :ets.lookup(state.table, {state.index, :all})
+      {:noreply, Enum.reduce(rows, state, &deliver(&2, &1, device_id, message))}
+    end
+
+    @impl true
+    def handle_info({:ack, pid}, state) do
+      case Map.get(state.subscribers, pid) do
+        nil ->
+          {:noreply, state}
+
+        subscriber ->
+          # Nothing in flight any more: release what was held, oldest device first
+          subscriber =
+            subscriber.held
+            |> Enum.sort()
+            |> Enum.reduce(%{subscriber | in_flight: 0, held: %{}}, fn {device_id, frame}, acc ->
+              send_motion(pid, device_id, frame, acc)
+            end)
+
+          {:noreply, put_in(state.subscribers[pid], subscriber)}
+      end
+    end
+
+    @impl true
+    def handle_info({:DOWN, _ref, :process, pid, _reason}, state) do
+      {:noreply, remove(state, pid)}
+    end
+
+    # Unfiltered and every frame: straight from the row
+    defp deliver(state, {_key, pid, :every, nil}, _device_id, message) do
+      send(pid, message)
+      state
+    end
+
+    defp deliver(state, {_key, pid, delivery, filter}, device_id, message) do
+      subscriber = Map.fetch!(state.subscribers, pid)
+
+      case SubscriptionFilter.evaluate(filter, message, Map.get(subscriber.last, device_id)) do
+        :skip ->
+          state
+
+        {:send, {:spacemouse_motion, payload}, last} when delivery != :every ->
+          put_in(state.subscribers[pid], offer(subscriber, pid, device_id, {payload, last}))
+
+        {:send, {:spacemouse_motion, _payload} = message, last} ->
+          send(pid, message)
+          put_in(state.subscribers[pid], %{subscriber | last: Map.put(subscriber.last, device_id, last)})
+
+        {:send, message, _last} ->
+          send(pid, message)
+          state
+      end
+    end
+
+    defp subscriber(ref, subscription, delivery, filter) do
+      %{
+        ref: ref,
+        subscription: subscription,
+        delivery: delivery,
+        filter: filter,
+        last: %{},
+        in_flight: 0,
+        held: %{},
+        dropped: 0
+      }
+    end
+
+    # One motion frame for a coalescing subscriber, as {payload, last}:
+    # send it if the window has room, else hold it (:latest) or drop it
+    # ({:bounded, n}). Only a frame actually sent becomes the min_delta
+    # baseline, so a dropped frame cannot hide the moves after it.
+    defp offer(subscriber, pid, device_id, frame) do
+      cond do
+        subscriber.in_flight < window(subscriber.delivery) ->
+          send_motion(pid, device_id, frame, subscriber)
+
+        subscriber.delivery == :latest ->
+          superseded = if Map.has_key?(subscriber.held, device_id), do: 1, else: 0
+          %{subscriber | held: Map.put(subscriber.held, device_id, frame), dropped: subscriber.dropped + superseded}
+
+        true ->
+          %{subscriber | dropped: subscriber.dropped + 1}
+      end
+    end
+
+    defp send_motion(pid, device_id, {payload, last}, subscriber) do
+      payload = if subscriber.dropped > 0, do: Map.put(payload, :dropped, subscriber.dropped), else: payload
+      send(pid, {:spacemouse_motion, payload})
+      %{subscriber | in_flight: subscriber.in_flight + 1, dropped: 0, last: Map.put(subscriber.last, device_id, last)}
+    end
+
+    defp window(:latest), do: 1
+    defp window({:bounded, max}), do: max
+
+    defp add(_subscription, :all), do: :all
+    defp add(:all, _device_id), do: :all
+    defp add(nil, device_id), do: MapSet.new([device_id])
+    defp add(device_ids, device_id), do: MapSet.put(device_ids, device_id)
+
+    defp remove(state, pid) do
+      case Map.pop(state.subscribers, pid) do
+        {nil, _subscribers} ->
+          state
+
+        {%{ref: ref}, subscribers} ->
+          Process.demonitor(ref, [:flush])
+          delete_rows(state, pid)
+          %{state | subscribers: subscribers}
+      end
+    end
+
+    defp delete_rows(state, pid) do
+      :ets.match_delete(state.table, {{state.index, :_}, pid, :_, :_})
+    end
+  end
+end
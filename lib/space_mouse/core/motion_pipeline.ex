@@ -0,0 +1,267 @@
+defmodule SpaceMouse.Core.MotionPipeline do
+  @moduledoc """
+  Motion processing stages, run once per frame before fan-out.
+
+  Deadzones and smoothing used to be reimplemented by every consumer, so
+  the same frame was filtered once per subscriber. A pipeline declared in
+  config instead runs in each `SpaceMouse.Core.Device` process on the
+  scaled frame, and subscribers, `get_motion_state/1` and the sampler all
+  see its output:
+
+      config :space_mouse,
+        motion_pipeline: [
+          {:deadzone, threshold: 0.05},
+          {:one_euro, min_cutoff: 1.0, beta: 0.01},
+          {:gain, x: 2.0, y: 2.0, rz: 0.5},
+          {:clamp, limit: 1.0}
+        ]
+
+  Stages, applied in order:
+
+  - `{:deadzone, threshold: t}` - values within ±t become 0.0, the rest is
+    rescaled so the output still starts at 0 and reaches ±1.0
+  - `{:ema, alpha: a}` - exponential moving average, `a` in (0, 1]
+  - `{:one_euro, min_cutoff: hz, beta: b, d_cutoff: hz}` - the One Euro
+    filter: smooth at rest, little lag on fast moves (defaults 1.0, 0.0,
+    1.0). Uses the report timestamps, not the arrival time
+  - `{:clamp, limit: l}` - limit every value to ±l
+  - `{:gain, x: g, ...}` - per-axis factors, unlisted axes keep 1.0
+
+  Every stage but `:gain` takes `axes:` to restrict it to some of `:x`,
+  `:y`, `:z`, `:rx`, `:ry` and `:rz`.
+
+  `compile/2` turns the list into one fused function per device; the
+  stage states (averages, previous frames) live with the device. An empty
+  pipeline compiles to `nil` and costs nothing.
+
+  Stage timing is opt-in, as it costs two clock reads per stage per frame:
+
+      config :space_mouse, motion_pipeline_metrics: true
+
+  Compiled with `metrics: true`, each stage adds its run time to a
+  `:counters` array, reported by `metrics/1`.
+
+  With the idle filter on (the default, see `SpaceMouse.Platform.IdleFilter`)
+  the readers send a cap coming to rest as one all-zero frame and then
+  nothing until it moves. Compiled with `reset_at_rest: true`, as
+  `SpaceMouse.Core.Device` does whenever the filter is on, an all-zero
+  input frame resets every stage state, so `:ema` and `:one_euro` output
+  exactly zero at rest instead of a value that would only decay with
+  frames that never come. With the filter off, zero frames keep arriving
+  and the stages decay as usual; an all-zero frame is then just a frame.
+  """
+
+  defstruct [:stages, :run, :states, :counters, reset_at_rest: false]
+
+  @type t :: %__MODULE__{}
+
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+
+  @doc """
+  Compile a list of stage specs. Returns `nil` for an empty list; raises
+  `ArgumentError` for an unknown stage or invalid options.
+
+  `reset_at_rest: true` treats an all-zero frame as the idle filter's rest
+  frame and starts every stage over from it. `metrics: true` times every
+  stage (see `metrics/1`).
+  """
+  @spec compile([{atom(), keyword()}], keyword()) :: t() | nil
+  def compile(specs, opts \\ [])
+
+  def compile([], _opts), do: nil
+
+  def compile(specs, opts) when is_list(specs) do
+    stages =
+      Enum.map(specs, fn
+        {name, stage_opts} = spec when is_atom(name) and is_list(stage_opts) -> stage(spec)
+        spec -> invalid_stage!(spec)
+      end)
+
+    # Counter 1 counts frames, counter i + 1 the native time of stage i
+    counters = if Keyword.get(opts, :metrics, false), do: :counters.new(length(stages) + 1, [:write_concurrency])
+
+    %__MODULE__{
+      stages: Enum.map(specs, &elem(&1, 0)),
+      run: fuse(Enum.with_index(stages, 2), counters),
+      states: Enum.map(stages, fn _stage -> nil end),
+      counters: counters,
+      reset_at_rest: Keyword.get(opts, :reset_at_rest, false)
+    }
+  end
+
+  @doc """
+  Run one scaled frame through the pipeline. `timestamp` is the frame's
+  time in microseconds.
+  """
+  @spec run(t() | nil, map(), integer()) :: {map(), t() | nil}
+  def run(nil, frame, _timestamp), do: {frame, nil}
+
+  def run(pipeline, frame, timestamp) do
+    states = if pipeline.reset_at_rest and rest?(frame), do: Enum.map(pipeline.states, fn _state -> nil end), else: pipeline.states
+    {frame, states} = pipeline.run.(frame, states, timestamp)
+    if pipeline.counters, do: :counters.add(pipeline.counters, 1, 1)
+    {frame, %{pipeline | states: states}}
+  end
+
+  @doc """
+  Cost of each stage so far: frames processed, total time and mean time
+  per frame. `[]` without a pipeline or unless compiled with `metrics: true`.
+  """
+  @spec metrics(t() | nil) :: [map()]
+  def metrics(nil), do: []
+  def metrics(%__MODULE__{counters: nil}), do: []
+
+  def metrics(pipeline) do
+    frames = :counters.get(pipeline.counters, 1)
+
+    pipeline.stages
+    |> Enum.with_index(2)
+    |> Enum.map(fn {stage, index} ->
+      total_ns = System.convert_time_unit(:counters.get(pipeline.counters, index), :native, :nanosecond)
+      %{stage: stage, frames: frames, total_ns: total_ns, mean_ns: if(frames > 0, do: div(total_ns, frames), else: 0)}
+    end)
+  end
+
+  # The explicit rest frame: stages start over from it
+  defp rest?(frame), do: Enum.all?(@axes, fn axis -> Map.get(frame, axis, 0) == 0 end)
+
+  # Nest the stages into one closure, timing each when there are counters
+  defp fuse([], _counters), do: fn frame, [], _timestamp -> {frame, []} end
+
+  defp fuse([{stage, _index} | rest], nil) do
+    next = fuse(rest, nil)
+
+    fn frame, [state | states], timestamp ->
+      {frame, state} = stage.(frame, state, timestamp)
+      {frame, states} = next.(frame, states, timestamp)
+      {frame, [state | states]}
+    end
+  end
+
+  defp fuse([{stage, index} | rest], counters) do
+    next = fuse(rest, counters)
+
+    fn frame, [state | states], timestamp ->
+      started = System.monotonic_time()
+      {frame, state} = stage.(frame, state, timestamp)
+      :counters.add(counters, index, System.monotonic_time() - started)
+
+      {frame, states} = next.(frame, states, timestamp)
+      {frame, [state | states]}
+    end
+  end
+
+  # Stage functions: (frame, state, timestamp) -> {frame, state}
+
+  defp stage({:deadzone, opts}) do
+    threshold = number!(opts, :threshold, nil, &(&1 >= 0 and &1 < 1))
+    axes = axes!(opts)
+
+    fn frame, state, _timestamp ->
+      {map_axes(frame, axes, fn _axis, value -> deadzone(value, threshold) end), state}
+    end
+  end
+
+  defp stage({:ema, opts}) do
+    alpha = number!(opts, :alpha, nil, &(&1 > 0 and &1 <= 1))
+    axes = axes!(opts)
+
+    fn
+      frame, nil, _timestamp ->
+        {frame, frame}
+
+      frame, previous, _timestamp ->
+        frame = map_axes(frame, axes, fn axis, value -> previous[axis] + alpha * (value - previous[axis]) end)
+        {frame, frame}
+    end
+  end
+
+  defp stage({:one_euro, opts}) do
+    min_cutoff = number!(opts, :min_cutoff, 1.0, &(&1 > 0))
+    beta = number!(opts, :beta, 0.0, &(&1 >= 0))
+    d_cutoff = number!(opts, :d_cutoff, 1.0, &(&1 > 0))
+    axes = axes!(opts)
+
+    fn
+      frame, nil, timestamp ->
+        {frame, %{timestamp: timestamp, frame: frame, derivative: Map.new(axes, &{&1, 0.0})}}
+
+      frame, state, timestamp ->
+        # Same timestamp twice (or a clock step back): assume 1 ms
+        dt = if timestamp > state.timestamp, do: (timestamp - state.timestamp) / 1_000_000, else: 0.001
+
+        derivative =
+          Map.new(axes, fn axis ->
+            raw = (frame[axis] - state.frame[axis]) / dt
+            {axis, smooth(raw, state.derivative[axis], smoothing(d_cutoff, dt))}
+          end)
+
+        frame =
+          map_axes(frame, axes, fn axis, value ->
+            cutoff = min_cutoff + beta * abs(derivative[axis])
+            smooth(value, state.frame[axis], smoothing(cutoff, dt))
+          end)
+
+        {frame, %{timestamp: timestamp, frame: frame, derivative: derivative}}
+    end
+  end
+
+  defp stage({:clamp, opts}) do
+    limit = number!(opts, :limit, 1.0, &(&1 > 0))
+    axes = axes!(opts)
+
+    fn frame, state, _timestamp ->
+      {map_axes(frame, axes, fn _axis, value -> value |> max(-limit) |> min(limit) end), state}
+    end
+  end
+
+  defp stage({:gain, opts}) do
+    gains =
+      Map.new(opts, fn
+        {axis, gain} when is_number(gain) -> {axis(axis), gain}
+        {_axis, gain} -> invalid!(:gain, gain)
+      end)
+
+    fn frame, state, _timestamp ->
+      {map_axes(frame, Map.keys(gains), fn axis, value -> value * gains[axis] end), state}
+    end
+  end
+
+  defp stage(spec), do: invalid_stage!(spec)
+
+  defp invalid_stage!(spec), do: raise(ArgumentError, "invalid motion pipeline stage: #{inspect(spec)}")
+
+  defp deadzone(value, threshold) when abs(value) <= threshold, do: 0.0
+  defp deadzone(value, threshold) when value > 0, do: (value - threshold) / (1 - threshold)
+  defp deadzone(value, threshold), do: (value + threshold) / (1 - threshold)
+
+  defp smoothing(cutoff, dt) do
+    r = 2 * :math.pi() * cutoff * dt
+    r / (r + 1)
+  end
+
+  defp smooth(value, previous, alpha), do: previous + alpha * (value - previous)
+
+  defp map_axes(frame, axes, fun) do
+    Enum.reduce(axes, frame, fn axis, acc ->
+      case acc do
+        %{^axis => value} -> %{acc | axis => fun.(axis, value)}
+        _missing -> acc
+      end
+    end)
+  end
+
+  defp axes!(opts), do: opts |> Keyword.get(:axes, @axes) |> Enum.map(&axis/1)
+
+  defp axis(axis) when axis in @axes, do: axis
+  defp axis(axis), do: raise(ArgumentError, "invalid motion pipeline axis: #{inspect(axis)}")
+
+  defp number!(opts, key, default, valid?) do
+    case Keyword.get(opts, key, default) do
+      value when is_number(value) -> if valid?.(value), do: value, else: invalid!(key, value)
+      value -> invalid!(key, value)
+    end
+  end
+
+  defp invalid!(key, value), do: raise(ArgumentError, "invalid motion pipeline #{key}: #{inspect(value)}")
+end
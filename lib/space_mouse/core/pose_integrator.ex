@@ -0,0 +1,332 @@
+defmodule SpaceMouse.Core.PoseIntegrator do
+  @moduledoc """
+  Integrates each device's 6DOF velocity stream into a pose, once.
+
+  Camera and robot consumers all want a pose, not velocities, and each
+  used to integrate the motion stream on its own. The integrator does it
+  once per device, from the native report timestamps, and keeps:
+
+      %{
+        device_id: integer(),
+        position: {x, y, z},            # In units, see :linear_speed
+        orientation: {w, x, y, z},      # Unit quaternion
+        timestamp: integer()            # µs, report clock, integrated up to
+      }
+
+  Subscribers get `{:spacemouse_pose, pose}` after every frame that moved
+  the pose forward; `pose/1` reads the current one.
+
+  Each frame is held until the next one and integrated in fixed steps of
+  `:timestep` µs, so the result does not depend on the report cadence;
+  the remainder carries over to the next frame. The readers only send
+  frames that change, so while a device moves the pose also advances
+  every 10 ms without a report, on the report clock as estimated from the
+  last frame's arrival. A gap of more than 100 ms (a stalled reader) is
+  integrated as 100 ms.
+
+      config :space_mouse,
+        pose: [
+          timestep: 1_000,              # µs per integration step
+          frame: :local,                # or :world
+          linear_speed: 1.0,            # units/s at full deflection
+          angular_speed: 3.14,          # rad/s at full deflection
+          max_linear_speed: 2.0,        # optional limits on |v| and |ω|
+          max_angular_speed: 6.28
+        ]
+
+  With `frame: :local` translation and rotation are in the device's own
+  frame, like flying a camera; with `frame: :world` they are along and
+  about the fixed world axes, like moving an object on a table.
+  """
+
+  use GenServer
+
+  alias SpaceMouse.Core.{Dispatcher, SubscriptionFilter}
+
+  @identity %{position: {0.0, 0.0, 0.0}, orientation: {1.0, 0.0, 0.0, 0.0}}
+  @max_gap 100_000
+  @advance_interval 10
+
+  @doc false
+  def start_link(opts) do
+    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+  end
+
+  @doc """
+  Send `pid` a `{:spacemouse_pose, pose}` after every update of `device:`
+  (default `:all`). Subscribing again replaces the device.
+  """
+  def subscribe(pid, opts \\ []) do
+    GenServer.call(__MODULE__, {:subscribe, pid, Keyword.get(opts, :device, :all)})
+  end
+
+  @doc """
+  Stop sending poses to `pid`.
+  """
+  def unsubscribe(pid) do
+    GenServer.call(__MODULE__, {:unsubscribe, pid})
+  end
+
+  @doc """
+  Current pose of `device_id`, or `:disconnected`.
+  """
+  def pose(device_id) do
+    GenServer.call(__MODULE__, {:pose, device_id})
+  end
+
+  @doc """
+  Move `device_id` back to the origin, or to `position:` and
+  `orientation:`.
+  """
+  def reset(device_id, opts \\ []) do
+    GenServer.call(__MODULE__, {:reset, device_id, opts})
+  end
+
+  # GenServer Implementation
+
+  @impl true
+  def init(_opts) do
+    config = config(Application.get_env(:space_mouse, :pose, []))
+
+    # devices: device_id => %{position, orientation, velocity, integrated_to, clock_offset}
+    # subscribers: pid => %{ref, device}
+    # timer: advances moving devices between reports, nil while all rest
+    {:ok, %{config: config, devices: %{}, subscribers: %{}, timer: nil}, {:continue, :subscribe}}
+  end
+
+  @impl true
+  def handle_continue(:subscribe, state) do
+    Dispatcher.subscribe(self(), :all, :every, SubscriptionFilter.compile(events: [:motion, :connection]))
+
+    # Devices connected before this process (re)started start at the origin
+    devices =
+      SpaceMouse.Core.DeviceRegistry
+      |> Registry.select([{{:"$1", :_, :_}, [], [:"$1"]}])
+      |> Map.new(&{&1, device(@identity)})
+
+    {:noreply, %{state | devices: devices}}
+  end
+
+  @impl true
+  def handle_call({:subscribe, pid, device}, _from, state) do
+    ref =
+      case Map.get(state.subscribers, pid) do
+        nil -> Process.monitor(pid)
+        subscriber -> subscriber.ref
+      end
+
+    {:reply, :ok, put_in(state.subscribers[pid], %{ref: ref, device: device})}
+  end
+
+  @impl true
+  def handle_call({:unsubscribe, pid}, _from, state) do
+    {:reply, :ok, remove(state, pid)}
+  end
+
+  @impl true
+  def handle_call({:pose, device_id}, _from, state) do
+    case Map.get(state.devices, device_id) do
+      nil -> {:reply, :disconnected, state}
+      device -> {:reply, {:ok, pose(device_id, device)}, state}
+    end
+  end
+
+  @impl true
+  def handle_call({:reset, device_id, opts}, _from, state) do
+    case Map.get(state.devices, device_id) do
+      nil ->
+        {:reply, :disconnected, state}
+
+      device ->
+        position = Keyword.get(opts, :position, @identity.position)
+        orientation = opts |> Keyword.get(:orientation, @identity.orientation) |> normalize()
+        device = %{device | position: position, orientation: orientation}
+        notify(state, device_id, device)
+        {:reply, :ok, put_in(state.devices[device_id], device)}
+    end
+  end
+
+  @impl true
+  def handle_info({:spacemouse_motion, payload}, state) do
+    device_id = payload.device_id
+    received_at = payload.received_at || System.monotonic_time(:microsecond)
+    timestamp = payload.device_timestamp || received_at
+    device = Map.get_lazy(state.devices, device_id, fn -> device(@identity) end)
+    {device, advanced?} = advance(device, timestamp, state.config)
+    device = %{device | velocity: velocity(payload, state.config), clock_offset: timestamp - received_at}
+
+    if advanced?, do: notify(state, device_id, device)
+    {:noreply, schedule(put_in(state.devices[device_id], device))}
+  end
+
+  @impl true
+  def handle_info(:advance, state) do
+    now = System.monotonic_time(:microsecond)
+
+    devices =
+      Map.new(state.devices, fn
+        {device_id, %{velocity: nil} = device} ->
+          {device_id, device}
+
+        {device_id, device} ->
+          {device, advanced?} = advance(device, now + device.clock_offset, state.config)
+          if advanced?, do: notify(state, device_id, device)
+          {device_id, device}
+      end)
+
+    {:noreply, schedule(%{state | devices: devices, timer: nil})}
+  end
+
+  @impl true
+  def handle_info({:spacemouse_connected, %{device_id: device_id}}, state) do
+    {:noreply, put_in(state.devices[device_id], device(@identity))}
+  end
+
+  @impl true
+  def handle_info({:spacemouse_disconnected, %{device_id: device_id}}, state) do
+    {:noreply, %{state | devices: Map.delete(state.devices, device_id)}}
+  end
+
+  @impl true
+  def handle_info({:DOWN, _ref, :process, pid, _reason}, state) do
+    {:noreply, remove(state, pid)}
+  end
+
+  # Integration
+
+  # Integrate the held velocity in whole steps up to timestamp; true if
+  # the pose moved
+  defp advance(%{integrated_to: nil} = device, timestamp, _config) do
+    {%{device | integrated_to: timestamp}, false}
+  end
+
+  defp advance(device, timestamp, config) do
+    from = max(device.integrated_to, timestamp - @max_gap)
+    steps = div(timestamp - from, config.timestep)
+    integrated_to = from + steps * config.timestep
+
+    cond do
+      steps <= 0 -> {device, false}
+      device.velocity == nil -> {%{device | integrated_to: integrated_to}, false}
+      true -> {%{step(device, steps, config) | integrated_to: integrated_to}, true}
+    end
+  end
+
+  defp step(device, 0, _config), do: device
+
+  defp step(device, steps, config) do
+    {linear, delta} = device.velocity
+
+    {position, orientation} =
+      case config.frame do
+        :local -> {add(device.position, rotate(device.orientation, linear)), multiply(device.orientation, delta)}
+        :world -> {add(device.position, linear), multiply(delta, device.orientation)}
+      end
+
+    step(%{device | position: position, orientation: normalize(orientation)}, steps - 1, config)
+  end
+
+  # Per-step translation and rotation quaternion for a frame; nil at rest
+  defp velocity(%{x: x, y: y, z: z, rx: rx, ry: ry, rz: rz}, config) do
+    if x == 0 and y == 0 and z == 0 and rx == 0 and ry == 0 and rz == 0 do
+      nil
+    else
+      dt = config.timestep / 1_000_000
+      {vx, vy, vz} = limit({x, y, z}, config.linear_speed, config.max_linear_speed)
+      omega = limit({rx, ry, rz}, config.angular_speed, config.max_angular_speed)
+      {{vx * dt, vy * dt, vz * dt}, rotation(omega, dt)}
+    end
+  end
+
+  defp limit({x, y, z}, speed, max_speed) do
+    vector = {x * speed, y * speed, z * speed}
+    norm = norm(vector)
+
+    if max_speed && norm > max_speed, do: scale(vector, max_speed / norm), else: vector
+  end
+
+  defp rotation(omega, dt) do
+    angle = norm(omega) * dt
+
+    if angle == 0 do
+      @identity.orientation
+    else
+      {ax, ay, az} = scale(omega, :math.sin(angle / 2) / norm(omega))
+      {:math.cos(angle / 2), ax, ay, az}
+    end
+  end
+
+  # Quaternion and vector helpers
+
+  defp multiply({w1, x1, y1, z1}, {w2, x2, y2, z2}) do
+    {w1 * w2 - x1 * x2 - y1 * y2 - z1 * z2, w1 * x2 + x1 * w2 + y1 * z2 - z1 * y2,
+     w1 * y2 - x1 * z2 + y1 * w2 + z1 * x2, w1 * z2 + x1 * y2 - y1 * x2 + z1 * w2}
+  end
+
+  # v + 2w(u × v) + 2u × (u × v), u the vector part of q
+  defp rotate({w, qx, qy, qz}, {x, y, z}) do
+    {tx, ty, tz} = {2 * (qy * z - qz * y), 2 * (qz * x - qx * z), 2 * (qx * y - qy * x)}
+    {x + w * tx + qy * tz - qz * ty, y + w * ty + qz * tx - qx * tz, z + w * tz + qx * ty - qy * tx}
+  end
+
+  defp normalize({w, x, y, z}) do
+    norm = :math.sqrt(w * w + x * x + y * y + z * z)
+    {w / norm, x / norm, y / norm, z / norm}
+  end
+
+  defp add({x1, y1, z1}, {x2, y2, z2}), do: {x1 + x2, y1 + y2, z1 + z2}
+  defp scale({x, y, z}, factor), do: {x * factor, y * factor, z * factor}
+  defp norm({x, y, z}), do: :math.sqrt(x * x + y * y + z * z)
+
+  # State
+
+  defp device(pose), do: Map.merge(pose, %{velocity: nil, integrated_to: nil, clock_offset: 0})
+
+  # Keep the advance timer running while any device moves
+  defp schedule(%{timer: nil} = state) do
+    if Enum.any?(state.devices, fn {_device_id, device} -> device.velocity != nil end) do
+      %{state | timer: Process.send_after(self(), :advance, @advance_interval)}
+    else
+      state
+    end
+  end
+
+  defp schedule(state), do: state
+
+  defp pose(device_id, device) do
+    %{device_id: device_id, position: device.position, orientation: device.orientation, timestamp: device.integrated_to}
+  end
+
+  defp notify(state, device_id, device) do
+    Enum.each(state.subscribers, fn {pid, subscriber} ->
+      if subscriber.device in [:all, device_id], do: send(pid, {:spacemouse_pose, pose(device_id, device)})
+    end)
+  end
+
+  defp remove(state, pid) do
+    case Map.get(state.subscribers, pid) do
+      nil ->
+        state
+
+      subscriber ->
+        Process.demonitor(subscriber.ref, [:flush])
+        %{state | subscribers: Map.delete(state.subscribers, pid)}
+    end
+  end
+
+  defp config(opts) do
+    %{
+      timestep: option!(opts, :timestep, 1_000, &(is_integer(&1) and &1 > 0)),
+      frame: option!(opts, :frame, :local, &(&1 in [:local, :world])),
+      linear_speed: option!(opts, :linear_speed, 1.0, &(is_number(&1) and &1 > 0)),
+      angular_speed: option!(opts, :angular_speed, :math.pi(), &(is_number(&1) and &1 > 0)),
+      max_linear_speed: option!(opts, :max_linear_speed, nil, &(is_nil(&1) or (is_number(&1) and &1 > 0))),
+      max_angular_speed: option!(opts, :max_angular_speed, nil, &(is_nil(&1) or (is_number(&1) and &1 > 0)))
+    }
+  end
+
+  defp option!(opts, key, default, valid?) do
+    value = Keyword.get(opts, key, default)
+    if valid?.(value), do: value, else: raise(ArgumentError, "invalid pose #{key}: #{inspect(value)}")
+  end
+end
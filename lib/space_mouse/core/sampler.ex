@@ -0,0 +1,266 @@
+defmodule SpaceMouse.Core.Sampler do
+  @moduledoc """
+  Motion at a fixed rate, for render and control loops.
+
+  Devices report motion at their own, irregular cadence. A subscriber of
+  the sampler instead receives one `{:spacemouse_sample, sample}` per
+  device on every tick of its rate (1 to 1000 Hz):
+
+      %{
+        device_id: integer(),
+        x: float(), y: float(), z: float(),     # Scaled like motion events
+        rx: float(), ry: float(), rz: float(),
+        rate: integer(),                        # Ticks per second
+        tick: integer(),                        # Tick number within the rate group
+        sampled_at: integer()                   # µs, System.monotonic_time/1
+      }
+
+  All subscribers of the same rate form one group and share one timer.
+  Tick `n` of a group is due at `start + n / rate` seconds, so rounding to
+  the millisecond timer never accumulates into drift; ticks missed under
+  load are skipped rather than sent late in a burst.
+
+  A sample holds the latest frame of the device, or with `interpolate:
+  true` a frame interpolated between the last two reports. The
+  interpolated sample trails the device by one report interval, in
+  exchange it moves smoothly when the tick rate and the report rate do not
+  divide evenly. The readers only send frames that change, so after a
+  pause the first report is interpolated over at most 50 ms instead of
+  the whole pause.
+
+  The sampler is a subscriber of `SpaceMouse.Core.Dispatcher` itself, so it
+  keeps the latest frames of every device without calling into the device
+  processes; after a restart it starts from `SpaceMouse.Core.DeviceState`.
+  """
+
+  use GenServer
+
+  alias SpaceMouse.Core.{DeviceState, Dispatcher, SubscriptionFilter}
+
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+  @zero_motion %{x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}
+  # Longest report interval interpolated over, µs
+  @max_interval 50_000
+
+  @doc false
+  def start_link(opts) do
+    GenServer.start_link(__MODULE__, opts, name: __MODULE__)
+  end
+
+  @doc """
+  Send `pid` samples at `rate` Hz.
+
+  Options:
+  - `device:` a device ID, or `:all` (default) for one sample per
+    connected device on every tick
+  - `interpolate:` interpolate between the last two reports instead of
+    repeating the latest one (default `false`)
+
+  Subscribing again replaces the previous rate and options. Raises
+  `ArgumentError` for a rate outside 1..1000.
+  """
+  def subscribe(pid, rate, opts \\ []) do
+    unless is_integer(rate) and rate in 1..1000 do
+      raise ArgumentError, "invalid sample rate: #{inspect(rate)}"
+    end
+
+    options = %{device: Keyword.get(opts, :device, :all), interpolate: Keyword.get(opts, :interpolate, false)}
+    GenServer.call(__MODULE__, {:subscribe, pid, rate, options})
+  end
+
+  @doc """
+  Stop sending samples to `pid`.
+  """
+  def unsubscribe(pid) do
+    GenServer.call(__MODULE__, {:unsubscribe, pid})
+  end
+
+  # GenServer Implementation
+
+  @impl true
+  def init(_opts) do
+    # devices: device_id => %{latest, latest_at, previous, previous_at}
+    # groups: rate => %{id, start, tick, members}
+    # subscribers: pid => %{ref, rate, device, interpolate}
+    {:ok, %{devices: %{}, groups: %{}, subscribers: %{}}, {:continue, :subscribe}}
+  end
+
+  @impl true
+  def handle_continue(:subscribe, state) do
+    Dispatcher.subscribe(self(), :all, :every, SubscriptionFilter.compile(events: [:motion, :connection]))
+
+    # Devices connected before this process (re)started
+    devices =
+      SpaceMouse.Core.DeviceRegistry
+      |> Registry.select([{{:"$1", :_, :_}, [], [:"$1"]}])
+      |> Map.new(fn device_id -> {device_id, frames(current_motion(device_id))} end)
+
+    {:noreply, %{state | devices: devices}}
+  end
+
+  @impl true
+  def handle_call({:subscribe, pid, rate, options}, _from, state) do
+    {ref, state} =
+      case Map.get(state.subscribers, pid) do
+        nil -> {Process.monitor(pid), state}
+        subscriber -> {subscriber.ref, leave(state, pid, subscriber.rate)}
+      end
+
+    state = put_in(state.subscribers[pid], Map.merge(options, %{ref: ref, rate: rate}))
+    {:reply, :ok, join(state, pid, rate)}
+  end
+
+  @impl true
+  def handle_call({:unsubscribe, pid}, _from, state) do
+    {:reply, :ok, remove(state, pid)}
+  end
+
+  @impl true
+  def handle_info({:spacemouse_motion, payload}, state) do
+    at = payload.received_at || System.monotonic_time(:microsecond)
+    frame = Map.take(payload, @axes)
+
+    devices =
+      Map.update(state.devices, payload.device_id, frames(frame, at), fn device ->
+        # After a pause, interpolate over at most @max_interval
+        previous_at = max(device.latest_at, at - @max_interval)
+        %{latest: frame, latest_at: at, previous: device.latest, previous_at: previous_at}
+      end)
+
+    {:noreply, %{state | devices: devices}}
+  end
+
+  @impl true
+  def handle_info({:spacemouse_connected, %{device_id: device_id}}, state) do
+    {:noreply, put_in(state.devices[device_id], frames(@zero_motion))}
+  end
+
+  @impl true
+  def handle_info({:spacemouse_disconnected, %{device_id: device_id}}, state) do
+    {:noreply, %{state | devices: Map.delete(state.devices, device_id)}}
+  end
+
+  @impl true
+  def handle_info({:tick, rate, id}, state) do
+    case Map.get(state.groups, rate) do
+      %{id: ^id} = group -> {:noreply, put_in(state.groups[rate], tick(state, rate, group))}
+      _stale -> {:noreply, state}
+    end
+  end
+
+  @impl true
+  def handle_info({:DOWN, _ref, :process, pid, _reason}, state) do
+    {:noreply, remove(state, pid)}
+  end
+
+  # Private Implementation
+
+  defp tick(state, rate, group) do
+    now = System.monotonic_time(:microsecond)
+    # Samples are computed once per device and tick, then shared
+    latest = Map.new(state.devices, fn {device_id, device} -> {device_id, sample(device_id, device.latest, rate, group.tick, now)} end)
+    interpolated = if interpolating?(state, group), do: interpolate_all(state.devices, rate, group.tick, now)
+
+    Enum.each(group.members, fn pid ->
+      subscriber = Map.fetch!(state.subscribers, pid)
+      samples = if subscriber.interpolate, do: interpolated, else: latest
+
+      case subscriber.device do
+        :all -> Enum.each(samples, fn {_device_id, sample} -> send(pid, {:spacemouse_sample, sample}) end)
+        device_id -> samples |> Map.take([device_id]) |> Enum.each(fn {_, sample} -> send(pid, {:spacemouse_sample, sample}) end)
+      end
+    end)
+
+    # Next tick not yet due; ticks missed while busy are skipped
+    next = max(group.tick + 1, div((now - group.start) * rate, 1_000_000) + 1)
+    schedule(rate, %{group | tick: next})
+  end
+
+  defp interpolating?(state, group) do
+    Enum.any?(group.members, fn pid -> state.subscribers[pid].interpolate end)
+  end
+
+  defp interpolate_all(devices, rate, tick, now) do
+    Map.new(devices, fn {device_id, device} ->
+      {device_id, sample(device_id, interpolate(device, now), rate, tick, now)}
+    end)
+  end
+
+  # Between the last two reports, one report interval behind
+  defp interpolate(%{previous: nil} = device, _now), do: device.latest
+
+  defp interpolate(device, now) do
+    interval = device.latest_at - device.previous_at
+
+    if interval > 0 do
+      alpha = min((now - device.latest_at) / interval, 1.0)
+      Map.new(@axes, fn axis -> {axis, device.previous[axis] + (device.latest[axis] - device.previous[axis]) * alpha} end)
+    else
+      device.latest
+    end
+  end
+
+  defp sample(device_id, frame, rate, tick, now) do
+    Map.merge(frame, %{device_id: device_id, rate: rate, tick: tick, sampled_at: now})
+  end
+
+  defp frames(frame, at \\ System.monotonic_time(:microsecond)) do
+    %{latest: frame, latest_at: at, previous: nil, previous_at: nil}
+  end
+
+  defp current_motion(device_id) do
+    case DeviceState.motion(device_id) do
+      {:ok, motion} -> Map.take(motion, @axes)
+      :disconnected -> @zero_motion
+    end
+  end
+
+  defp join(state, pid, rate) do
+    group =
+      case Map.get(state.groups, rate) do
+        nil -> schedule(rate, %{id: make_ref(), start: System.monotonic_time(:microsecond), tick: 1, members: MapSet.new()})
+        group -> group
+      end
+
+    put_in(state.groups[rate], %{group | members: MapSet.put(group.members, pid)})
+  end
+
+  # The last member takes the group (and its timer) with it
+  defp leave(state, pid, rate) do
+    case Map.get(state.groups, rate) do
+      nil ->
+        state
+
+      group ->
+        members = MapSet.delete(group.members, pid)
+
+        if MapSet.size(members) == 0 do
+          Process.cancel_timer(group.timer)
+          %{state | groups: Map.delete(state.groups, rate)}
+        else
+          put_in(state.groups[rate], %{group | members: members})
+        end
+    end
+  end
+
+  defp remove(state, pid) do
+    case Map.get(state.subscribers, pid) do
+      nil ->
+        state
+
+      subscriber ->
+        Process.demonitor(subscriber.ref, [:flush])
+        state = leave(state, pid, subscriber.rate)
+        %{state | subscribers: Map.delete(state.subscribers, pid)}
+    end
+  end
+
+  # Tick n is due start + n / rate seconds after the group started; the
+  # timer rounds up to the next millisecond of the same monotonic clock
+  defp schedule(rate, group) do
+    due = group.start + div(group.tick * 1_000_000, rate)
+    due_ms = -Integer.floor_div(-due, 1000)
+    timer = Process.send_after(self(), {:tick, rate, group.id}, due_ms, abs: true)
+    Map.put(group, :timer, timer)
+  end
+end
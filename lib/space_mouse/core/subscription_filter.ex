@@ -0,0 +1,118 @@
+defmodule SpaceMouse.Core.SubscriptionFilter do
+  @moduledoc """
+  Server-side event filter of one subscriber.
+
+  Built once from the `subscribe/2` options by `compile/1` and evaluated by
+  `SpaceMouse.Core.Dispatcher` before anything is sent, so events a
+  subscriber would throw away are never copied to its heap:
+
+  - `events:` event types to receive, any of `:motion`, `:buttons`,
+    `:connection` (connected and disconnected) and `:led` (default: all)
+  - `axes:` motion payloads carry only these axes (of `:x`, `:y`, `:z`,
+    `:rx`, `:ry`, `:rz`) next to the device ID and timestamps
+  - `min_delta:` a motion frame is only sent once one of the (selected)
+    axes has moved at least this far, in the scaled ±1.0 units, from the
+    last frame sent to this subscriber for that device
+  - `buttons:` button events are only sent when they change one of these
+    button IDs (1-based)
+
+  Without any of these options there is no filter and the dispatcher's
+  unfiltered path is used.
+  """
+
+  import Bitwise
+
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+  @event_types [:motion, :buttons, :connection, :led]
+
+  defstruct events: nil, axes: @axes, drop_axes: [], min_delta: nil, button_mask: nil
+
+  @type t :: %__MODULE__{}
+
+  @doc """
+  Compile the filter options out of `opts`. Returns `nil` when there are
+  none; raises `ArgumentError` for an invalid spec.
+  """
+  @spec compile(keyword()) :: t() | nil
+  def compile(opts) do
+    if Enum.any?([:events, :axes, :min_delta, :buttons], &Keyword.has_key?(opts, &1)) do
+      axes = validate!(Keyword.get(opts, :axes, @axes), :axes, &(&1 in @axes))
+
+      %__MODULE__{
+        events: compile_events(Keyword.get(opts, :events)),
+        axes: axes,
+        drop_axes: @axes -- axes,
+        min_delta: compile_min_delta(Keyword.get(opts, :min_delta)),
+        button_mask: compile_buttons(Keyword.get(opts, :buttons))
+      }
+    end
+  end
+
+  @doc """
+  Apply the filter to one event. `last` is the last frame sent to the
+  subscriber for the event's device (`nil` if none); the result carries
+  the one to remember once this event is sent.
+  """
+  @spec evaluate(t() | nil, tuple(), map() | nil) :: {:send, tuple(), map() | nil} | :skip
+  def evaluate(nil, message, last), do: {:send, message, last}
+
+  def evaluate(filter, {tag, payload} = message, last) do
+    type = event_type(tag)
+
+    cond do
+      filter.events != nil and not MapSet.member?(filter.events, type) -> :skip
+      type == :motion -> motion(filter, payload, last)
+      type == :buttons and not buttons?(filter, payload) -> :skip
+      true -> {:send, message, last}
+    end
+  end
+
+  defp motion(filter, payload, last) do
+    if moved?(filter, payload, last) do
+      frame = if filter.min_delta, do: Map.take(payload, filter.axes), else: last
+      {:send, {:spacemouse_motion, Map.drop(payload, filter.drop_axes)}, frame}
+    else
+      :skip
+    end
+  end
+
+  defp moved?(%{min_delta: nil}, _payload, _last), do: true
+  defp moved?(_filter, _payload, nil), do: true
+
+  defp moved?(filter, payload, last) do
+    Enum.any?(filter.axes, fn axis -> abs(Map.fetch!(payload, axis) - Map.fetch!(last, axis)) >= filter.min_delta end)
+  end
+
+  defp buttons?(%{button_mask: nil}, _payload), do: true
+  defp buttons?(filter, payload), do: (payload.changed &&& filter.button_mask) != 0
+
+  defp event_type(:spacemouse_motion), do: :motion
+  defp event_type(:spacemouse_buttons), do: :buttons
+  defp event_type(:spacemouse_connected), do: :connection
+  defp event_type(:spacemouse_disconnected), do: :connection
+  defp event_type(:spacemouse_led_changed), do: :led
+  defp event_type(_tag), do: :other
+
+  defp compile_events(nil), do: nil
+  defp compile_events(events), do: MapSet.new(validate!(events, :events, &(&1 in @event_types)))
+
+  defp compile_min_delta(nil), do: nil
+  defp compile_min_delta(delta) when is_number(delta) and delta >= 0, do: delta
+  defp compile_min_delta(delta), do: raise(ArgumentError, "invalid min_delta: #{inspect(delta)}")
+
+  defp compile_buttons(nil), do: nil
+
+  defp compile_buttons(ids) do
+    ids
+    |> validate!(:buttons, &(is_integer(&1) and &1 in 1..32))
+    |> Enum.reduce(0, fn id, mask -> mask ||| 1 <<< (id - 1) end)
+  end
+
+  defp validate!(values, key, valid?) do
+    if is_list(values) and values != [] and Enum.all?(values, valid?) do
+      values
+    else
+      raise ArgumentError, "invalid #{key} filter: #{inspect(values)}"
+    end
+  end
+end
@@ -2,8 +2,12 @@ defmodule SpaceMouse.Core.Supervisor do
   @moduledoc """
   Supervisor for the SpaceMouse core system.
   
-  This supervisor manages the main device GenServer and ensures proper
-  fault tolerance and recovery for the SpaceMouse communication system.
+  This supervisor manages the device manager and the per-device processes
+  it starts, and ensures proper fault tolerance and recovery for the
+  SpaceMouse communication system. Children are restarted
+  `:rest_for_one`, so losing the registry, the dispatcher or the device
+  supervisor restarts the manager too. The sampler and the pose
+  integrator come last and never take the devices down with them.
   """
 
   use Supervisor
@@ -14,11 +18,24 @@ defmodule SpaceMouse.Core.Supervisor do
 
   @impl true
   def init(opts) do
+    # Lock-free device state, written by the device processes and the manager
+    SpaceMouse.Core.DeviceState.init()
+
     children = [
+      # Device ID -> SpaceMouse.Core.Device process
+      {Registry, keys: :unique, name: SpaceMouse.Core.DeviceRegistry},
+      # Subscriptions and event fan-out, partitioned across schedulers
+      SpaceMouse.Core.Dispatcher,
+      # One SpaceMouse.Core.Device per attached device
+      {DynamicSupervisor, strategy: :one_for_one, name: SpaceMouse.Core.DeviceSupervisor},
       # Main device manager
-      {SpaceMouse.Core.Device, opts}
+      {SpaceMouse.Core.DeviceManager, opts},
+      # Fixed-rate motion samples, one timer per rate
+      SpaceMouse.Core.Sampler,
+      # Motion integrated into one pose per device
+      SpaceMouse.Core.PoseIntegrator
     ]
 
-    Supervisor.init(children, strategy: :one_for_one)
+    Supervisor.init(children, strategy: :rest_for_one)
   end
 end
@@ -103,7 +103,7 @@ defmodule SpaceMouse.Demo.ApiDemo do
         end
         demo_loop()
         
-      {:spacemouse_button, button} ->
+      {:spacemouse_buttons, button} ->
         Logger.info("🔘 Button: #{format_button(button)}")
         demo_loop()
         
@@ -179,7 +179,7 @@ defmodule SpaceMouse.Demo.ApiDemo do
         end
         motion_loop()
         
-      {:spacemouse_button, button} ->
+      {:spacemouse_buttons, button} ->
         IO.puts("🔘 #{format_button(button)}")
         motion_loop()
         
@@ -198,7 +198,7 @@ defmodule SpaceMouse.Demo.ApiDemo do
         if significant_motion?(motion) do
           IO.puts("📢 Motion: #{format_motion(motion)}")
         end
-      {:spacemouse_button, button} -> IO.puts("📢 Button: #{format_button(button)}")
+      {:spacemouse_buttons, button} -> IO.puts("📢 Button: #{format_button(button)}")
     after
       10 -> :ok
     end
@@ -228,9 +228,9 @@ defmodule SpaceMouse.Demo.ApiDemo do
   end
 
   defp format_button(button) do
-    id = button[:id] || 0
-    state = button[:state] || :unknown
+    pressed = Enum.map(button[:pressed] || [], &"Button #{&1} pressed")
+    released = Enum.map(button[:released] || [], &"Button #{&1} released")
     
-    "Button #{id} #{state}"
+    Enum.join(pressed ++ released, ", ")
   end
 end
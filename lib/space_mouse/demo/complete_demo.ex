@@ -46,7 +46,7 @@ defmodule SpaceMouse.Demo.CompleteDemo do
     # Start the main event loop
     event_loop(%{
       motion_count: 0,
-      button_states: %{},
+      buttons: 0,
       led_blink_count: 0,
       last_stats: System.monotonic_time(:second)
     })
@@ -96,7 +96,7 @@ defmodule SpaceMouse.Demo.CompleteDemo do
         event_loop(new_state)
 
       # Button events
-      {:spacemouse_button, button} ->
+      {:spacemouse_buttons, button} ->
         new_state = handle_button_event(button, state)
         event_loop(new_state)
 
@@ -126,25 +126,20 @@ defmodule SpaceMouse.Demo.CompleteDemo do
     %{state | motion_count: state.motion_count + 1}
   end
 
-  defp handle_button_event(%{id: id, state: button_state}, state) do
-    # Track button state changes
-    previous_state = Map.get(state.button_states, id, :released)
-    
-    if previous_state != button_state do
-      icon = if button_state == :pressed, do: "🔴", else: "⚪"
-      IO.puts "#{icon} Button #{id}: #{button_state}"
-      
-      # Demo: Toggle LED when button 1 is pressed
-      if id == 1 and button_state == :pressed do
-        {:ok, current_led} = SpaceMouse.get_led_state()
-        new_led = if current_led == :on, do: :off, else: :on
-        SpaceMouse.set_led(new_led)
-        IO.puts "   💡 Toggled LED to #{new_led}"
-      end
+  defp handle_button_event(%{buttons: buttons, pressed: pressed, released: released}, state) do
+    # One event per report: a chord shows up as several IDs at once
+    Enum.each(pressed, fn id -> IO.puts "🔴 Button #{id}: pressed" end)
+    Enum.each(released, fn id -> IO.puts "⚪ Button #{id}: released" end)
+
+    # Demo: Toggle LED when button 1 is pressed
+    if 1 in pressed do
+      {:ok, current_led} = SpaceMouse.get_led_state()
+      new_led = if current_led == :on, do: :off, else: :on
+      SpaceMouse.set_led(new_led)
+      IO.puts "   💡 Toggled LED to #{new_led}"
     end
 
-    new_button_states = Map.put(state.button_states, id, button_state)
-    %{state | button_states: new_button_states}
+    %{state | buttons: buttons}
   end
 
   defp handle_led_event(%{from: from, to: to, timestamp: timestamp}) do
@@ -183,7 +178,7 @@ defmodule SpaceMouse.Demo.CompleteDemo do
     
     📊 === Stats (last #{time_diff}s) ===
     Motion events: #{state.motion_count} (~#{:erlang.float_to_binary(motion_rate, decimals: 1)}/s)
-    Active buttons: #{format_active_buttons(state.button_states)}
+    Active buttons: #{format_active_buttons(state.buttons)}
     Device connected: #{SpaceMouse.connected?()}
     Platform: #{inspect(SpaceMouse.platform_info())}
     =====================================
@@ -214,12 +209,8 @@ defmodule SpaceMouse.Demo.CompleteDemo do
   end
   defp format_axis(value), do: String.pad_leading("#{value}", 7)
 
-  defp format_active_buttons(button_states) do
-    pressed_buttons = 
-      button_states
-      |> Enum.filter(fn {_id, state} -> state == :pressed end)
-      |> Enum.map(fn {id, _state} -> id end)
-      |> Enum.sort()
+  defp format_active_buttons(buttons) do
+    pressed_buttons = Enum.filter(1..32, &SpaceMouse.Core.Device.pressed?(buttons, &1))
     
     if Enum.empty?(pressed_buttons) do
       "none"
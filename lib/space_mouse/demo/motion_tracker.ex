@@ -42,9 +42,11 @@ defmodule SpaceMouse.Demo.MotionTracker do
     
     """
 
-    # Start system and subscribe
+    # Start system and subscribe: connection events as they happen,
+    # motion sampled at 10 Hz instead of at the report rate
     :ok = SpaceMouse.start_monitoring()
-    :ok = SpaceMouse.subscribe()
+    :ok = SpaceMouse.subscribe(events: [:connection])
+    :ok = SpaceMouse.subscribe_sampled(10)
     
     # Wait for connection
     wait_for_connection()
@@ -79,7 +81,7 @@ defmodule SpaceMouse.Demo.MotionTracker do
 
   defp track_motion(state) do
     receive do
-      {:spacemouse_motion, motion} ->
+      {:spacemouse_sample, motion} ->
         new_state = handle_motion(motion, state)
         track_motion(new_state)
 
@@ -94,10 +96,6 @@ defmodule SpaceMouse.Demo.MotionTracker do
 
       _other ->
         track_motion(state)
-        
-    after
-      100 ->
-        track_motion(state)
     end
   end
 
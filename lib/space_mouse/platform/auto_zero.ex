@@ -0,0 +1,45 @@
+defmodule SpaceMouse.Platform.AutoZero do
+  @moduledoc """
+  Settings of the native zero-drift calibration.
+
+  A cap at rest often settles a few counts off centre, and that offset
+  would stream out as phantom motion. The readers and the hidraw NIF keep
+  a per-axis bias for every device, learnt from windows of frames in which
+  the cap is still, and subtract it before the frame leaves native code;
+  small residual values become exactly zero. It is on by default:
+
+      config :space_mouse,
+        auto_zero: [
+          window: 64,       # frames per stillness window
+          noise: 2,         # max standard deviation at rest, raw counts
+          max_bias: 24      # larger steady offsets are a held cap, not drift
+        ]
+
+  `auto_zero: false` turns the tracking off. Either way
+  `SpaceMouse.calibrate/1` takes the current frame as the zero point
+  (see `priv/platform/common/calibration.h`).
+  """
+
+  @doc """
+  Native spec for `setting` (default: the `:auto_zero` application
+  environment): `"WINDOW:NOISE:MAX_BIAS"`, `"off"`, or `nil` when unset.
+  Missing options keep their defaults.
+  """
+  @spec spec(keyword() | boolean() | nil) :: String.t() | nil
+  def spec(setting \\ Application.get_env(:space_mouse, :auto_zero))
+
+  def spec(nil), do: nil
+  def spec(false), do: "off"
+  def spec(true), do: spec([])
+
+  def spec(opts) when is_list(opts) do
+    Enum.map_join([window: 64, noise: 2, max_bias: 24], ":", fn {key, default} ->
+      case Keyword.get(opts, key, default) do
+        value when is_integer(value) and value >= 0 -> Integer.to_string(value)
+        value -> raise ArgumentError, "invalid auto_zero #{key}: #{inspect(value)}"
+      end
+    end)
+  end
+
+  def spec(setting), do: raise(ArgumentError, "invalid auto_zero setting: #{inspect(setting)}")
+end
@@ -23,13 +23,15 @@ defmodule SpaceMouse.Platform.Behaviour do
   Start monitoring for SpaceMouse device connections.
   
   The implementation should begin watching for device connections and
-  disconnections, sending appropriate messages to the calling process.
+  disconnections, sending `{:hid_event, event}` messages to the owner
+  process. Every device gets a small, stable device ID, carried by each
+  event as `:device_id`:
   
-  Expected messages:
-  - `{:device_connected, device_info}`
-  - `{:device_disconnected, device_info}`
-  - `{:motion_event, motion_data}`
-  - `{:button_event, button_data}`
+  - `%{type: :status, message: "device_connected", device_id:, vendor_id:, product_id:}`
+  - `%{type: :status, message: "device_disconnected", device_id:}`
+  - `%{type: :motion, device_id:, data: motion_data, ...}`
+  - `%{type: :buttons, device_id:, data: %{buttons: mask, changed: mask}, ...}`
+    (one per report that changed any button; bit 0 is button 1)
   
   Returns:
   - `:ok` if monitoring started successfully
@@ -49,13 +51,15 @@ defmodule SpaceMouse.Platform.Behaviour do
   
   Args:
   - `state`: Platform state
+  - `target`: Device ID, or `:all` for every connected device
   - `command`: LED command (`:on`, `:off`)
   
   Returns:
   - `:ok` if command was sent successfully
   - `{:error, reason}` if command failed
   """
-  @callback send_led_command(state :: term(), command :: :on | :off) :: {:ok, term()} | {:error, term()}
+  @callback send_led_command(state :: term(), target :: pos_integer() | :all, command :: :on | :off) ::
+              {:ok, term()} | {:error, term()}
 
   @doc """
   Get the current LED state if supported by the platform.
@@ -70,12 +74,51 @@ defmodule SpaceMouse.Platform.Behaviour do
   Check if a SpaceMouse device is currently connected.
   
   Returns:
-  - `{:ok, true}` if a device is connected
+  - `{:ok, true}` if at least one device is connected
   - `{:ok, false}` if no device is connected
   - `{:error, reason}` if status cannot be determined
   """
   @callback device_connected?(state :: term()) :: {:ok, boolean()} | {:error, term()}
 
+  @doc """
+  Handle a message addressed to the platform rather than to the device.
+  
+  In-process backends receive notifications in the owner process, such as
+  `enif_select` readiness (`{:select, resource, ref, :ready_input}`) or
+  their own `{:platform, message}` timers. The owner hands those over here.
+  
+  Returns:
+  - `{:ok, state}` with the updated platform state
+  """
+  @callback handle_platform_message(message :: term(), state :: term()) :: {:ok, term()}
+
+  @doc """
+  Handle a platform notification that arrived in a device process.
+
+  The owner reports each device process with
+  `{:device_started, device_id, pid}` and `{:device_stopped, device_id, pid}`
+  through `handle_platform_message/2`. An in-process backend can then point
+  that device's notifications and events at its `SpaceMouse.Core.Device`
+  process, which hands the notifications over here, so motion never passes
+  through the owner.
+
+  Returns:
+  - `:ok`
+  """
+  @callback handle_device_message(message :: term()) :: :ok
+
+  @doc """
+  Take the current frame of one device (`target`) or all of them (`:all`)
+  as the zero point of its axes, for a cap that has drifted off centre.
+
+  Returns:
+  - `{:ok, state}` once the reader has been told
+  - `{:error, reason}` if the command could not be sent
+  """
+  @callback calibrate(state :: term(), target :: pos_integer() | :all) :: {:ok, term()} | {:error, term()}
+
+  @optional_callbacks handle_platform_message: 2, handle_device_message: 1, calibrate: 2
+
   @doc """
   Get platform-specific information.
   
@@ -0,0 +1,56 @@
+defmodule SpaceMouse.Platform.IdleFilter do
+  @moduledoc """
+  Settings of the native idle suppression.
+
+  A released cap keeps reporting zero or near-zero frames. The readers and
+  the hidraw NIF therefore emit a motion frame only when it differs from
+  the device's last emitted frame by more than `epsilon` raw counts on some
+  axis. A cap coming to rest sends one explicit all-zero frame and then
+  nothing until it moves, so a motion frame stays valid until the next one
+  arrives:
+
+      config :space_mouse,
+        idle_filter: [
+          epsilon: 2,         # raw counts, default 0 (exact repeats only)
+          keepalive: 1000     # ms, re-send the current frame while reports
+                              # keep arriving (default 0, never)
+        ]
+
+  `idle_filter: false` emits every frame, as before (see
+  `priv/platform/common/idle_filter.h`).
+
+  `SpaceMouse.Core.MotionPipeline` relies on the rest frame to reset its
+  smoothing stages, so each device checks `enabled?/0` when it compiles
+  its pipeline. Set the filter in the application environment rather than
+  as a `PortManager` option so both sides agree.
+  """
+
+  @doc """
+  Whether the readers send the rest frame once and then go quiet: true
+  unless `setting` is `false`.
+  """
+  @spec enabled?(keyword() | boolean() | nil) :: boolean()
+  def enabled?(setting \\ Application.get_env(:space_mouse, :idle_filter)), do: setting != false
+
+  @doc """
+  Native spec for `setting` (default: the `:idle_filter` application
+  environment): `"EPSILON:KEEPALIVE_MS"`, `"off"`, or `nil` when unset.
+  """
+  @spec spec(keyword() | boolean() | nil) :: String.t() | nil
+  def spec(setting \\ Application.get_env(:space_mouse, :idle_filter))
+
+  def spec(nil), do: nil
+  def spec(false), do: "off"
+  def spec(true), do: spec([])
+
+  def spec(opts) when is_list(opts) do
+    Enum.map_join([epsilon: 0, keepalive: 0], ":", fn {key, default} ->
+      case Keyword.get(opts, key, default) do
+        value when is_integer(value) and value >= 0 -> Integer.to_string(value)
+        value -> raise ArgumentError, "invalid idle_filter #{key}: #{inspect(value)}"
+      end
+    end)
+  end
+
+  def spec(setting), do: raise(ArgumentError, "invalid idle_filter setting: #{inspect(setting)}")
+end
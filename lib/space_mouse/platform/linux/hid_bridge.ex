@@ -0,0 +1,162 @@
+defmodule SpaceMouse.Platform.Linux.HidBridge do
+  @moduledoc """
+  Linux platform implementation using the kernel hidraw interface.
+  
+  This module bridges between Elixir and the Linux C HID reader program,
+  which reads SpaceMouse reports from `/dev/hidraw*` in an epoll loop and
+  speaks the same port protocol as the macOS reader.
+  
+  The device node must be readable by the VM user. A udev rule such as
+  
+      KERNEL=="hidraw*", ATTRS{idVendor}=="256f", MODE="0660", GROUP="plugdev"
+  
+  grants access without running as root.
+  """
+
+  @behaviour SpaceMouse.Platform.Behaviour
+  
+  require Logger
+
+  alias SpaceMouse.Platform.PortManager
+
+  defmodule State do
+    @moduledoc false
+    defstruct [
+      :port_manager,
+      :owner_pid,
+      :device_connected,
+      :led_state
+    ]
+  end
+
+  # Platform Behaviour Implementation
+
+  @impl SpaceMouse.Platform.Behaviour
+  def platform_init(opts) do
+    owner_pid = Keyword.get(opts, :owner_pid, self())
+    
+    state = %State{
+      port_manager: nil,
+      owner_pid: owner_pid,
+      device_connected: false,
+      led_state: :unknown
+    }
+    
+    {:ok, state}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def start_monitoring(state) do
+    case state.port_manager do
+      nil ->
+        # No port manager exists, start a new one
+        case PortManager.start_hid_reader(owner_pid: state.owner_pid, platform_dir: "linux") do
+          {:ok, port_manager} ->
+            new_state = %{state | port_manager: port_manager}
+            {:ok, new_state}
+            
+          {:error, reason} ->
+            {:error, reason}
+        end
+        
+      _existing_port_manager ->
+        # Port manager already exists, don't create a new one
+        Logger.debug("HID reader port manager already running")
+        {:ok, state}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def stop_monitoring(state) do
+    case state.port_manager do
+      nil -> 
+        {:ok, state}
+        
+      port_manager ->
+        PortManager.stop_hid_reader(port_manager)
+        new_state = %{state | port_manager: nil, device_connected: false}
+        {:ok, new_state}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def send_led_command(state, target, command) do
+    case send_led_command_impl(state, target, command) do
+      :ok -> {:ok, %{state | led_state: command}}
+      error -> error
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def calibrate(state, target) do
+    case {state.device_connected, state.port_manager} do
+      {false, _} ->
+        {:error, :device_not_connected}
+
+      {true, nil} ->
+        {:error, :port_manager_not_available}
+
+      {true, port_manager} ->
+        # "CALIBRATE" for every device, "CALIBRATE:2" for device 2
+        command = if target == :all, do: "CALIBRATE", else: "CALIBRATE:#{target}"
+
+        with :ok <- PortManager.send_command(port_manager, command) do
+          {:ok, state}
+        end
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def get_led_state(state) do
+    {:ok, state.led_state}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def device_connected?(state) do
+    {:ok, state.device_connected}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def platform_info do
+    %{
+      platform: :linux,
+      method: :hidraw,
+      version: "1.0.0"
+    }
+  end
+
+  # Private Implementation
+
+  defp send_led_command_impl(state, target, command) do
+    case {state.device_connected, state.port_manager} do
+      {false, _} ->
+        {:error, :device_not_connected}
+        
+      {true, nil} ->
+        {:error, :port_manager_not_available}
+        
+      {true, port_manager} ->
+        # Send LED command to the C HID reader program: "LED:on" for every
+        # device, "LED:2:on" for device 2
+        led_arg = case command do
+          :on -> "on"
+          _ -> "off"
+        end
+
+        led_cmd = case target do
+          :all -> "LED:#{led_arg}"
+          device_id -> "LED:#{device_id}:#{led_arg}"
+        end
+        
+        case PortManager.send_command(port_manager, led_cmd) do
+          :ok ->
+            Logger.debug("LED command sent: #{command} (device #{target})")
+            :ok
+            
+          {:error, reason} ->
+            Logger.error("Failed to send LED command: #{inspect(reason)}")
+            {:error, reason}
+        end
+    end
+  end
+end
@@ -0,0 +1,119 @@
+defmodule SpaceMouse.Platform.Linux.HidrawNif do
+  @moduledoc """
+  Bindings for the hidraw NIF (`priv/platform/linux/hidraw_nif.c`).
+  
+  The library is loaded on demand by `load/0` rather than `@on_load`, so
+  the module stays usable (and the port backend unaffected) on systems
+  where the NIF was not built.
+  """
+
+  @doc """
+  Load the NIF library. Safe to call repeatedly.
+  """
+  def load do
+    path = Path.join([:code.priv_dir(:space_mouse), "platform", "linux", "hidraw_nif"])
+    
+    case :erlang.load_nif(String.to_charlist(path), 0) do
+      :ok -> :ok
+      {:error, {:reload, _}} -> :ok
+      {:error, {:upgrade, _}} -> :ok
+      {:error, reason} -> {:error, reason}
+    end
+  end
+
+  @doc """
+  List the SpaceMouse hidraw nodes as `{path, identity}` tuples.
+  
+  The identity is `"uniq:<serial>"` when the device reports a serial
+  number, else `"phys:<path>"` (USB/Bluetooth topology).
+  """
+  def list_devices, do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Like `list_devices/0`, but only look at the given `/dev/hidraw*` paths.
+  """
+  def probe_devices(_paths), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Watch `/dev` for hidraw nodes that appear or get new permissions.
+
+  `owner` receives `{:select, watch, :undefined, :ready_input}` when
+  something changed, upon which it calls `read_watch/1`. The watch is
+  closed when `owner` exits.
+  """
+  def watch_devices(_owner), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Return the paths of the hidraw nodes created or changed since the last
+  call and re-arm the notification. Returns `:closed` after `close_watch/1`.
+  """
+  def read_watch(_watch), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Stop watching `/dev`.
+  """
+  def close_watch(_watch), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Open the hidraw node at `path` as device `device_id` and watch it for `owner`.
+  
+  `owner` receives `{:hid_event, %{type: :status, message: "device_connected"}}`
+  right away and, until `set_reader/2` names another process,
+  `{:select, resource, :undefined, :ready_input}` whenever reports are
+  waiting, upon which it calls `read_events/1`. Every event
+  carries `device_id`. The fd is released when `owner` exits, so a
+  restarted owner can open the node again.
+  """
+  def open_device(_owner, _path, _device_id), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Decode waiting reports and send them to the reader as `{:hid_event, event}`.
+  
+  Returns `:closed` once the device is gone.
+  """
+  def read_events(_device), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Make `pid` the reader: from now on it gets the `{:select, ...}`
+  notifications and the motion and buttons events, and calls
+  `read_events/1` itself. Status events still go to the owner.
+
+  Returns `:closed` once the device is gone.
+  """
+  def set_reader(_device, _pid), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Set the LED, trying each known method. Returns `{:ok, method}`.
+  """
+  def set_led(_device, _on), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Stop watching and close the device.
+  """
+  def close_device(_device), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Replace the response curves motion is mapped through, given as
+  `"AXES:KIND:PARAMS"` specs (see `SpaceMouse.Platform.ResponseCurves`).
+  Returns `{:error, spec}` for the first invalid one.
+  """
+  def set_curves(_specs), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Set the automatic zero-drift tracking from a `"WINDOW:NOISE:MAX_BIAS"`
+  or `"off"` spec (see `SpaceMouse.Platform.AutoZero`).
+  """
+  def set_auto_zero(_spec), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Set the idle suppression from an `"EPSILON:KEEPALIVE_MS"` or `"off"`
+  spec (see `SpaceMouse.Platform.IdleFilter`).
+  """
+  def set_idle_filter(_spec), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc """
+  Take the device's current frame as its zero point and send the
+  corrected frame.
+  """
+  def calibrate(_device), do: :erlang.nif_error(:nif_not_loaded)
+end
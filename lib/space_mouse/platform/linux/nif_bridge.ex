@@ -0,0 +1,325 @@
+defmodule SpaceMouse.Platform.Linux.NifBridge do
+  @moduledoc """
+  Optional Linux platform implementation that reads hidraw inside the VM.
+
+  Instead of the `hid_reader` port, this backend opens every SpaceMouse
+  hidraw node through `SpaceMouse.Platform.Linux.HidrawNif` and lets
+  `enif_select` notify the device's own `SpaceMouse.Core.Device` process
+  directly: the owner (`SpaceMouse.Core.DeviceManager`) reads a node only
+  until it reports that process with `{:device_started, device_id, pid}`,
+  and gets it back on `{:device_stopped, device_id, pid}`. Reports are
+  decoded in C and arrive as the same `{:hid_event, event}` terms the port
+  produces, skipping the reader process, the pipe, the `PortManager` hop
+  and the manager's mailbox.
+
+  The trade-off is crash isolation: a fault in the NIF takes the VM down,
+  which is why the port-based `SpaceMouse.Platform.Linux.HidBridge` stays
+  the default. Opt in with:
+
+      config :space_mouse, platform: :linux_nif
+
+  Response curves (`SpaceMouse.Platform.ResponseCurves`), the zero-drift
+  calibration (`SpaceMouse.Platform.AutoZero`) and idle suppression
+  (`SpaceMouse.Platform.IdleFilter`) are set up in the NIF when the bridge
+  starts, so they apply here as well.
+
+  Hotplug is watched like the reader does it: an inotify watch on `/dev`
+  (`HidrawNif.watch_devices/1`) reports new or re-permissioned hidraw
+  nodes, and only those that are not open yet are probed, so an idle
+  system sees no hidraw opens at all. Unplugging is noticed by the
+  device's own read. Device IDs are assigned here from each
+  node's identity (serial number, else physical path), the same way the
+  reader does, so a replugged device gets its old ID back.
+  """
+
+  @behaviour SpaceMouse.Platform.Behaviour
+
+  require Logger
+
+  alias SpaceMouse.Platform.Linux.HidrawNif
+  alias SpaceMouse.Platform.{AutoZero, IdleFilter, ResponseCurves}
+
+  @max_devices 8
+
+  defmodule State do
+    @moduledoc false
+    defstruct [
+      :owner_pid,
+      :monitoring,
+      :watch,
+      :device_connected,
+      :led_state,
+      devices: %{},
+      identities: %{}
+    ]
+  end
+
+  # Platform Behaviour Implementation
+
+  @impl SpaceMouse.Platform.Behaviour
+  def platform_init(opts) do
+    owner_pid = Keyword.get(opts, :owner_pid, self())
+
+    with {:load, :ok} <- {:load, HidrawNif.load()},
+         {:curves, :ok} <- {:curves, HidrawNif.set_curves(ResponseCurves.specs())},
+         {:auto_zero, :ok} <- {:auto_zero, set_auto_zero(AutoZero.spec())},
+         {:idle_filter, :ok} <- {:idle_filter, set_idle_filter(IdleFilter.spec())} do
+      state = %State{
+        owner_pid: owner_pid,
+        monitoring: false,
+        watch: nil,
+        device_connected: false,
+        led_state: :unknown
+      }
+
+      {:ok, state}
+    else
+      {:load, {:error, reason}} ->
+        Logger.error("hidraw NIF not available: #{inspect(reason)}")
+        {:error, {:nif_not_loaded, reason}}
+
+      {:curves, {:error, spec}} ->
+        Logger.error("Invalid response curve: #{spec}")
+        {:error, {:invalid_curve, spec}}
+
+      {:auto_zero, {:error, spec}} ->
+        Logger.error("Invalid auto-zero setting: #{spec}")
+        {:error, {:invalid_auto_zero, spec}}
+
+      {:idle_filter, {:error, spec}} ->
+        Logger.error("Invalid idle filter setting: #{spec}")
+        {:error, {:invalid_idle_filter, spec}}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def start_monitoring(%State{monitoring: true} = state) do
+    Logger.debug("hidraw monitoring already running")
+    {:ok, state}
+  end
+
+  def start_monitoring(state) do
+    # Watch first, so a node created during the initial scan is not missed
+    case HidrawNif.watch_devices(state.owner_pid) do
+      {:ok, watch} ->
+        {:ok, open_devices(%{state | monitoring: true, watch: watch}, HidrawNif.list_devices())}
+
+      {:error, reason} ->
+        Logger.error("Failed to watch /dev for hotplug: #{inspect(reason)}")
+        {:error, {:watch_failed, reason}}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def stop_monitoring(state) do
+    if state.watch, do: HidrawNif.close_watch(state.watch)
+
+    Enum.each(state.devices, fn {_device_id, device} -> HidrawNif.close_device(device.resource) end)
+
+    {:ok, %{state | devices: %{}, monitoring: false, watch: nil, device_connected: false}}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def send_led_command(state, target, command) do
+    targets =
+      case target do
+        :all -> Map.values(state.devices)
+        device_id -> state.devices |> Map.get(device_id) |> List.wrap()
+      end
+
+    case {state.device_connected, targets} do
+      {false, _} ->
+        {:error, :device_not_connected}
+
+      {true, []} ->
+        {:error, :device_not_available}
+
+      {true, devices} ->
+        devices
+        |> Enum.map(&HidrawNif.set_led(&1.resource, command == :on))
+        |> Enum.find(&match?({:error, _}, &1))
+        |> case do
+          nil ->
+            Logger.debug("LED command sent: #{command} (device #{target})")
+            {:ok, %{state | led_state: command}}
+
+          {:error, reason} ->
+            Logger.error("Failed to send LED command: #{inspect(reason)}")
+            {:error, reason}
+        end
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def calibrate(state, target) do
+    targets =
+      case target do
+        :all -> Map.values(state.devices)
+        device_id -> state.devices |> Map.get(device_id) |> List.wrap()
+      end
+
+    case {state.device_connected, targets} do
+      {false, _} ->
+        {:error, :device_not_connected}
+
+      {true, []} ->
+        {:error, :device_not_available}
+
+      {true, devices} ->
+        Enum.each(devices, &HidrawNif.calibrate(&1.resource))
+        {:ok, state}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def get_led_state(state) do
+    {:ok, state.led_state}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def device_connected?(state) do
+    {:ok, state.device_connected}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def platform_info do
+    %{
+      platform: :linux,
+      method: :hidraw_nif,
+      version: "1.0.0"
+    }
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def handle_platform_message({:select, watch, _ref, :ready_input}, %State{watch: watch} = state) do
+    case HidrawNif.read_watch(watch) do
+      :closed -> {:ok, state}
+      paths -> {:ok, scan_devices(state, paths)}
+    end
+  end
+
+  def handle_platform_message({:select, resource, _ref, :ready_input}, state) do
+    owner_pid = state.owner_pid
+
+    case Enum.find(state.devices, fn {_device_id, device} -> device.resource == resource end) do
+      nil ->
+        # Stale notification for a device closed in the meantime
+        {:ok, state}
+
+      {_device_id, %{reader: reader}} when reader != owner_pid ->
+        # Sent before the hand-over: set_reader/2 re-armed it for the reader
+        {:ok, state}
+
+      {device_id, device} ->
+        case HidrawNif.read_events(device.resource) do
+          :ok -> {:ok, state}
+          :closed -> {:ok, %{state | devices: Map.delete(state.devices, device_id)}}
+        end
+    end
+  end
+
+  def handle_platform_message({:device_started, device_id, pid}, state) do
+    case Map.fetch(state.devices, device_id) do
+      {:ok, device} -> {:ok, set_reader(state, device_id, device, pid)}
+      :error -> {:ok, state}
+    end
+  end
+
+  def handle_platform_message({:device_stopped, device_id, pid}, state) do
+    # Only if it is still the stopped process that reads: a replugged
+    # device under the same ID is already a new node
+    case Map.fetch(state.devices, device_id) do
+      {:ok, %{reader: ^pid} = device} -> {:ok, set_reader(state, device_id, device, state.owner_pid)}
+      _ -> {:ok, state}
+    end
+  end
+
+  def handle_platform_message(_message, state) do
+    {:ok, state}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def handle_device_message({:select, resource, _ref, :ready_input}) do
+    # In the device process; a closed node was announced to the owner
+    HidrawNif.read_events(resource)
+    :ok
+  end
+
+  # Private Implementation
+
+  # Probe the nodes the watch reported, skipping those already open: a
+  # permission change on an open node is no reason to open it again
+  defp scan_devices(state, paths) do
+    open_paths = MapSet.new(state.devices, fn {_device_id, device} -> device.path end)
+
+    paths =
+      paths
+      |> Enum.uniq()
+      |> Enum.reject(&MapSet.member?(open_paths, &1))
+
+    case paths do
+      [] -> state
+      paths -> open_devices(state, HidrawNif.probe_devices(paths))
+    end
+  end
+
+  defp open_devices(state, found) do
+    Enum.reduce(found, state, fn {path, identity}, acc -> open_device(acc, path, identity) end)
+  end
+
+  defp open_device(state, path, identity) do
+    case assign_device_id(state, identity) do
+      nil ->
+        Logger.warning("Ignoring #{path}: more than #{@max_devices} SpaceMice attached")
+        state
+
+      device_id ->
+        case HidrawNif.open_device(state.owner_pid, path, device_id) do
+          {:ok, resource} ->
+            identities =
+              state.identities
+              |> Map.reject(fn {_identity, id} -> id == device_id end)
+              |> Map.put(identity, device_id)
+
+            devices = Map.put(state.devices, device_id, %{resource: resource, path: path, reader: state.owner_pid})
+            %{state | devices: devices, identities: identities}
+
+          {:error, reason} ->
+            # Unplugged since listing, or permissions; udev fixing those
+            # shows up as another watch event
+            Logger.debug("hidraw open of #{path} failed: #{inspect(reason)}")
+            state
+        end
+    end
+  end
+
+  # Same preference as the reader (priv/platform/common/device_ids.c): the
+  # identity's previous ID, else a never-used ID, else a detached one's
+  defp assign_device_id(state, identity) do
+    ids = 1..@max_devices
+    known_ids = Map.values(state.identities)
+
+    case Map.fetch(state.identities, identity) do
+      {:ok, device_id} ->
+        if Map.has_key?(state.devices, device_id), do: nil, else: device_id
+
+      :error ->
+        Enum.find(ids, &(&1 not in known_ids)) ||
+          Enum.find(ids, &(not Map.has_key?(state.devices, &1)))
+    end
+  end
+
+  defp set_reader(state, device_id, device, pid) do
+    case HidrawNif.set_reader(device.resource, pid) do
+      :ok -> put_in(state.devices[device_id].reader, pid)
+      :closed -> %{state | devices: Map.delete(state.devices, device_id)}
+    end
+  end
+
+  # Unset: keep the NIF's defaults
+  defp set_auto_zero(nil), do: :ok
+  defp set_auto_zero(spec), do: HidrawNif.set_auto_zero(spec)
+
+  defp set_idle_filter(nil), do: :ok
+  defp set_idle_filter(spec), do: HidrawNif.set_idle_filter(spec)
+end
@@ -14,7 +14,7 @@ defmodule SpaceMouse.Platform.MacOS.HidBridge do
   
   require Logger
 
-  alias SpaceMouse.Platform.MacOS.PortManager
+  alias SpaceMouse.Platform.PortManager
 
   defmodule State do
     @moduledoc false
@@ -47,7 +47,7 @@ defmodule SpaceMouse.Platform.MacOS.HidBridge do
     case state.port_manager do
       nil ->
         # No port manager exists, start a new one
-        case PortManager.start_hid_reader(owner_pid: state.owner_pid) do
+        case PortManager.start_hid_reader(owner_pid: state.owner_pid, platform_dir: "macos") do
           {:ok, port_manager} ->
             new_state = %{state | port_manager: port_manager}
             {:ok, new_state}
@@ -77,13 +77,32 @@ defmodule SpaceMouse.Platform.MacOS.HidBridge do
   end
 
   @impl SpaceMouse.Platform.Behaviour
-  def send_led_command(state, command) do
-    case send_led_command_impl(state, command) do
+  def send_led_command(state, target, command) do
+    case send_led_command_impl(state, target, command) do
       :ok -> {:ok, %{state | led_state: command}}
       error -> error
     end
   end
 
+  @impl SpaceMouse.Platform.Behaviour
+  def calibrate(state, target) do
+    case {state.device_connected, state.port_manager} do
+      {false, _} ->
+        {:error, :device_not_connected}
+
+      {true, nil} ->
+        {:error, :port_manager_not_available}
+
+      {true, port_manager} ->
+        # "CALIBRATE" for every device, "CALIBRATE:2" for device 2
+        command = if target == :all, do: "CALIBRATE", else: "CALIBRATE:#{target}"
+
+        with :ok <- PortManager.send_command(port_manager, command) do
+          {:ok, state}
+        end
+    end
+  end
+
   @impl SpaceMouse.Platform.Behaviour
   def get_led_state(state) do
     {:ok, state.led_state}
@@ -105,7 +124,7 @@ defmodule SpaceMouse.Platform.MacOS.HidBridge do
 
   # Private Implementation
 
-  defp send_led_command_impl(state, command) do
+  defp send_led_command_impl(state, target, command) do
     case {state.device_connected, state.port_manager} do
       {false, _} ->
         {:error, :device_not_connected}
@@ -114,16 +133,21 @@ defmodule SpaceMouse.Platform.MacOS.HidBridge do
         {:error, :port_manager_not_available}
         
       {true, port_manager} ->
-        # Send LED command to the C HID reader program
-        led_cmd = case command do
-          :on -> "LED:on"
-          :off -> "LED:off"
-          _ -> "LED:off"
+        # Send LED command to the C HID reader program: "LED:on" for every
+        # device, "LED:2:on" for device 2
+        led_arg = case command do
+          :on -> "on"
+          _ -> "off"
+        end
+
+        led_cmd = case target do
+          :all -> "LED:#{led_arg}"
+          device_id -> "LED:#{device_id}:#{led_arg}"
         end
         
         case PortManager.send_command(port_manager, led_cmd) do
           :ok ->
-            Logger.debug("LED command sent: #{command}")
+            Logger.debug("LED command sent: #{command} (device #{target})")
             :ok
             
           {:error, reason} ->
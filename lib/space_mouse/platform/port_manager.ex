@@ -0,0 +1,529 @@
+defmodule SpaceMouse.Platform.PortManager do
+  @moduledoc """
+  Manages the external C HID reader process via Erlang ports.
+  
+  Every native reader (IOKit on macOS, hidraw on Linux) speaks the same
+  port protocol, so one port manager serves all of them. The reader binary
+  is picked with the `:platform_dir` option, which names the directory
+  under `priv/platform/` the build script placed it in.
+  
+  ## Port protocol
+  
+  By default the reader is started with `--protocol=binary` and the port is
+  opened with `{:packet, 2}` framing. Every record is a fixed-layout binary
+  (see `priv/platform/common/port_protocol.h`) decoded by a single pattern
+  match, with no intermediate strings or atoms. Passing `protocol: :text`
+  (or setting `config :space_mouse, port_protocol: :text`) falls back to the
+  human-readable `TYPE:key=value` lines, which is handy for debugging.
+  
+  ## Capture and replay
+  
+  - `capture: path` records every raw HID report the reader sees, with its
+    timestamp, to `path` while running normally
+  - `replay: path` opens no device at all and feeds a capture back through
+    the reader's normal decode path instead
+  - `replay_speed:` `1` (default) replays in real time, `n` n times faster,
+    `:max` as fast as the VM consumes events
+  
+  Each option falls back to the `:space_mouse` application environment
+  (`config :space_mouse, replay: "session.smcap", replay_speed: :max`).
+  
+  ## LED method cache
+  
+  The reader remembers which LED method works for each device model, so
+  only the first LED command after start-up probes. `led_cache: path` (or
+  `config :space_mouse, led_cache: path`) persists that table across
+  restarts as well.
+  
+  ## Shared-memory snapshot
+  
+  `shm: "/space_mouse"` (or `config :space_mouse, shm: "/space_mouse"`)
+  makes the reader publish every device's latest frame and button bitmask
+  in a POSIX shared-memory segment of that name, next to the port output.
+  `SpaceMouse.Snapshot` reads it without any message passing.
+  
+  ## Socket fan-out
+
+  `socket: path` (or `config :space_mouse, socket: path`) makes the reader
+  serve the binary record stream on a Unix domain socket at `path` as well,
+  so local tools can follow the devices while this port owns them. Each
+  report is decoded once for every consumer; clients get the same
+  `{:packet, 2}` records as the port, each from its own bounded queue (see
+  `priv/platform/common/event_server.h`).
+
+  ## Zero-drift calibration
+
+  The reader subtracts a per-axis bias, learnt while the cap is still,
+  from every frame. `auto_zero:` (or `config :space_mouse, auto_zero:`)
+  tunes it or turns it off (see `SpaceMouse.Platform.AutoZero`);
+  `"CALIBRATE"` / `"CALIBRATE:2"` take the current frame as the zero point.
+
+  ## Response curves
+
+  `response_curves:` (or `config :space_mouse, response_curves: [...]`)
+  is passed to the reader as `--curve=` flags; the reader bakes each curve
+  into a per-axis lookup table and reports curved raw values (see
+  `SpaceMouse.Platform.ResponseCurves`).
+
+  ## Idle suppression
+
+  The reader emits a motion frame only when it changes, and a cap coming
+  to rest sends one all-zero frame; a frame stays valid until the next.
+  `idle_filter:` (or `config :space_mouse, idle_filter:`) sets the change
+  threshold and a keepalive, or turns it off (see
+  `SpaceMouse.Platform.IdleFilter`).
+
+  ## Multiple devices
+
+  The reader tracks every attached SpaceMouse under a small, stable device
+  ID (1-8) and tags each record with it. Parsed events carry that ID as
+  `:device_id`; `"device_connected"` status events also carry
+  `:vendor_id` and `:product_id`. `"LED:on"` addresses every device,
+  `"LED:2:on"` only device 2.
+
+  Motion and button events go straight to the device's
+  `SpaceMouse.Core.Device` process, looked up in
+  `SpaceMouse.Core.DeviceRegistry` (see `SpaceMouse.Core.Device.route/2`);
+  only status and lifecycle events reach the owner.
+
+  Backend-specific reader flags (such as the simulator's `--rate=`) are
+  passed as a list of strings with `args:`.
+  
+  This module handles:
+  - Starting/stopping the C HID reader program  
+  - Parsing structured output from the C program
+  - Converting C output to Elixir messages
+  - Managing process lifecycle and error handling
+  """
+
+  use GenServer
+  require Logger
+
+  alias SpaceMouse.Core.Device
+  alias SpaceMouse.Platform.{AutoZero, IdleFilter, ResponseCurves}
+
+  defmodule State do
+    @moduledoc false
+    defstruct [
+      :port,
+      :owner_pid,
+      :hid_reader_path,
+      :protocol,
+      args: []
+    ]
+  end
+
+  # Binary record types (first payload byte)
+  @record_status 0x01
+  @record_motion 0x02
+  @record_buttons 0x03
+  @record_led 0x04
+
+  # Binary status codes
+  @status_ready 1
+  @status_device_connected 2
+  @status_device_disconnected 3
+  @status_info 255
+
+  # Client API
+
+  @doc """
+  Start the HID reader port manager.
+  """
+  def start_hid_reader(opts \\ []) do
+    GenServer.start(__MODULE__, opts)
+  end
+
+  @doc """
+  Stop the HID reader port manager.
+  """
+  def stop_hid_reader(pid) do
+    GenServer.stop(pid, :normal)
+  end
+
+  @doc """
+  Send a command to the HID reader process.
+  """
+  def send_command(pid, command) do
+    GenServer.call(pid, {:send_command, command})
+  end
+
+  # GenServer Implementation
+
+  @impl true
+  def init(opts) do
+    owner_pid = Keyword.get(opts, :owner_pid, self())
+    platform_dir = Keyword.get(opts, :platform_dir, "macos")
+    protocol = Keyword.get(opts, :protocol, Application.get_env(:space_mouse, :port_protocol, :binary))
+    
+    # Build path to the HID reader executable
+    priv_dir = :code.priv_dir(:space_mouse)
+    hid_reader_path = Path.join([priv_dir, "platform", platform_dir, "hid_reader"])
+    
+    # Verify the executable exists
+    case File.exists?(hid_reader_path) do
+      true ->
+        state = %State{
+          port: nil,
+          owner_pid: owner_pid,
+          hid_reader_path: hid_reader_path,
+          protocol: protocol,
+          args: Keyword.get(opts, :args, []) ++ option_args(opts)
+        }
+        
+        # Start the HID reader process
+        case start_hid_reader_port(state) do
+          {:ok, new_state} ->
+            {:ok, new_state}
+            
+          {:error, reason} ->
+            {:stop, reason}
+        end
+        
+      false ->
+        {:stop, {:error, {:hid_reader_not_found, hid_reader_path}}}
+    end
+  end
+
+  @impl true
+  def handle_info({port, {:data, data}}, %State{port: port} = state) do
+    # Parse data from the C program
+    case parse_hid_output(data, state.protocol) do
+      {:ok, event} ->
+        # Motion and buttons straight to the device process, the rest to the owner
+        Device.route(event, state.owner_pid)
+        
+      {:error, reason} ->
+        Logger.warning("Failed to parse HID output: #{inspect(reason)}, data: #{inspect(data)}")
+    end
+    
+    {:noreply, state}
+  end
+
+  @impl true
+  def handle_info({port, {:exit_status, status}}, %State{port: port} = state) do
+    Logger.warning("HID reader process exited with status: #{status}")
+    
+    # Notify owner of port exit
+    send(state.owner_pid, {:port_exit, status})
+    
+    {:stop, :normal, %{state | port: nil}}
+  end
+
+  @impl true
+  def handle_info({:EXIT, port, reason}, %State{port: port} = state) do
+    Logger.warning("HID reader port process died: #{inspect(reason)}")
+    
+    # Notify owner of port exit  
+    send(state.owner_pid, {:port_exit, reason})
+    
+    {:stop, :normal, %{state | port: nil}}
+  end
+
+  @impl true
+  def handle_call({:send_command, command}, _from, state) do
+    case state.port do
+      nil ->
+        {:reply, {:error, :port_not_available}, state}
+        
+      port ->
+        try do
+          Port.command(port, encode_command(command, state.protocol))
+          {:reply, :ok, state}
+        rescue
+          error ->
+            Logger.error("Failed to send command to HID reader: #{inspect(error)}")
+            {:reply, {:error, {:send_failed, error}}, state}
+        end
+    end
+  end
+
+  @impl true
+  def terminate(_reason, state) do
+    if state.port do
+      Port.close(state.port)
+    end
+    :ok
+  end
+
+  # Private Implementation
+
+  defp start_hid_reader_port(state) do
+    Logger.info("Starting HID reader: #{state.hid_reader_path}")
+    
+    try do
+      port = Port.open({:spawn_executable, state.hid_reader_path}, [
+        :binary,
+        :exit_status,
+        framing_option(state.protocol),
+        {:args, ["--protocol=#{state.protocol}" | state.args]},
+        {:cd, Path.dirname(state.hid_reader_path)}
+      ])
+      
+      # Link to the port process for automatic cleanup
+      Process.link(port)
+      
+      new_state = %{state | port: port}
+      {:ok, new_state}
+      
+    rescue
+      error ->
+        Logger.error("Failed to start HID reader: #{inspect(error)}")
+        {:error, {:spawn_failed, error}}
+    end
+  end
+
+  # Reader arguments for the capture/replay, LED cache, snapshot, socket,
+  # auto-zero, idle filter and response curve options (see moduledoc). Paths are
+  # expanded here because the reader runs in its own priv directory.
+  defp option_args(opts) do
+    curves = Keyword.get(opts, :response_curves, Application.get_env(:space_mouse, :response_curves))
+
+    [
+      {:capture, "--capture=", &Path.expand/1},
+      {:replay, "--replay=", &Path.expand/1},
+      {:replay_speed, "--replay-speed=", &to_string/1},
+      {:led_cache, "--led-cache=", &Path.expand/1},
+      {:shm, "--shm=", &to_string/1},
+      {:socket, "--socket=", &Path.expand/1},
+      {:auto_zero, "--auto-zero=", &AutoZero.spec/1},
+      {:idle_filter, "--idle-filter=", &IdleFilter.spec/1}
+    ]
+    |> Enum.flat_map(fn {key, flag, format} ->
+      case Keyword.get(opts, key, Application.get_env(:space_mouse, key)) do
+        nil -> []
+        value -> [flag <> format.(value)]
+      end
+    end)
+    |> Kernel.++(Enum.map(ResponseCurves.specs(curves), &("--curve=" <> &1)))
+  end
+
+  # Length-prefixed records for the binary protocol, lines for text
+  defp framing_option(:binary), do: {:packet, 2}
+  defp framing_option(:text), do: {:line, 1024}
+
+  # {:packet, 2} adds the length prefix on the way out as well
+  defp encode_command(command, :binary), do: command
+  defp encode_command(command, :text), do: "#{command}\n"
+
+  defp parse_hid_output(data, :binary), do: parse_packet(data)
+  defp parse_hid_output(data, :text), do: parse_text_line(data)
+
+  defp parse_packet(<<@record_motion, device_id, t::little-unsigned-64,
+                      x::little-signed-16, y::little-signed-16, z::little-signed-16,
+                      rx::little-signed-16, ry::little-signed-16, rz::little-signed-16>>) do
+    {:ok, %{
+      type: :motion,
+      device_id: device_id,
+      data: %{x: x, y: y, z: z, rx: rx, ry: ry, rz: rz},
+      device_timestamp: t,
+      received_at: System.monotonic_time(:microsecond)
+    }}
+  end
+
+  defp parse_packet(<<@record_buttons, device_id, t::little-unsigned-64,
+                      buttons::little-unsigned-32, changed::little-unsigned-32>>) do
+    {:ok, %{
+      type: :buttons,
+      device_id: device_id,
+      data: %{buttons: buttons, changed: changed},
+      device_timestamp: t,
+      received_at: System.monotonic_time(:microsecond)
+    }}
+  end
+
+  defp parse_packet(<<@record_status, @status_ready>>), do: status_event("ready")
+  defp parse_packet(<<@record_status, @status_info, detail::binary>>), do: status_event(detail)
+
+  defp parse_packet(<<@record_status, @status_device_connected, device_id,
+                      vendor_id::little-unsigned-16, product_id::little-unsigned-16>>) do
+    device_status_event("device_connected", %{device_id: device_id, vendor_id: vendor_id, product_id: product_id})
+  end
+
+  defp parse_packet(<<@record_status, @status_device_disconnected, device_id>>) do
+    device_status_event("device_disconnected", %{device_id: device_id})
+  end
+  defp parse_packet(<<@record_led, device_id, on, method>>) do
+    {:ok, %{
+      type: :led_changed,
+      device_id: device_id,
+      data: %{state: if(on == 1, do: :on, else: :off), method: method},
+      timestamp: System.monotonic_time(:millisecond)
+    }}
+  end
+
+  defp parse_packet(packet) do
+    {:error, {:unknown_record, packet}}
+  end
+
+  defp status_event(message) do
+    {:ok, %{type: :status, message: message, timestamp: System.monotonic_time(:millisecond)}}
+  end
+
+  defp device_status_event(message, fields) do
+    {:ok, event} = status_event(message)
+    {:ok, Map.merge(event, fields)}
+  end
+
+  defp parse_text_line(data) do
+    line = case data do
+      {:eol, text} -> String.trim(text)
+      binary when is_binary(binary) -> String.trim(binary)
+      other -> inspect(other)
+    end
+    
+    case String.split(line, ":", parts: 2) do
+      ["STATUS", "device_connected," <> params] ->
+        parse_device_status("device_connected", params)
+
+      ["STATUS", "device_disconnected," <> params] ->
+        parse_device_status("device_disconnected", params)
+
+      ["STATUS", message] ->
+        status_event(message)
+        
+      ["MOTION", params] ->
+        parse_motion_event(params)
+        
+      ["BUTTONS", params] ->
+        parse_buttons_event(params)
+        
+      ["LED", params] ->
+        parse_led_event(params)
+        
+      _ ->
+        {:error, {:unknown_format, line}}
+    end
+  end
+
+  defp parse_device_status(message, params) do
+    try do
+      # Parse "device=1,vid=256f,pid=c635" (vid/pid only when connected)
+      fields =
+        params
+        |> String.split(",")
+        |> Enum.reduce(%{}, fn param, acc ->
+          case String.split(param, "=", parts: 2) do
+            ["device", value] -> Map.put(acc, :device_id, String.to_integer(value))
+            ["vid", value] -> Map.put(acc, :vendor_id, String.to_integer(value, 16))
+            ["pid", value] -> Map.put(acc, :product_id, String.to_integer(value, 16))
+            _ -> acc
+          end
+        end)
+
+      device_status_event(message, fields)
+    rescue
+      error ->
+        {:error, {:status_parse_error, error, params}}
+    end
+  end
+
+  defp parse_motion_event(params) do
+    try do
+      # Parse "device=1,t=1234567,x=123,y=456,z=789,rx=12,ry=34,rz=56" format
+      {device_id, fields} =
+        params
+        |> String.split(",")
+        |> Enum.reduce(%{}, fn param, acc ->
+          case String.split(param, "=", parts: 2) do
+            [key, value] ->
+              Map.put(acc, String.to_atom(key), String.to_integer(value))
+            _ ->
+              acc
+          end
+        end)
+        |> Map.pop(:device)
+
+      {device_timestamp, axis_data} = Map.pop(fields, :t)
+      
+      event = %{
+        type: :motion,
+        device_id: device_id,
+        data: axis_data,
+        device_timestamp: device_timestamp,
+        received_at: System.monotonic_time(:microsecond)
+      }
+      
+      {:ok, event}
+      
+    rescue
+      error ->
+        {:error, {:motion_parse_error, error, params}}
+    end
+  end
+
+  defp parse_buttons_event(params) do
+    try do
+      # Parse "device=1,t=1234567,buttons=3,changed=1" format (hex bitmasks)
+      {device_id, fields} =
+        params
+        |> String.split(",")
+        |> Enum.reduce(%{}, fn param, acc ->
+          case String.split(param, "=", parts: 2) do
+            ["device", value] ->
+              Map.put(acc, :device, String.to_integer(value))
+            ["t", value] ->
+              Map.put(acc, :t, String.to_integer(value))
+            ["buttons", value] ->
+              Map.put(acc, :buttons, String.to_integer(value, 16))
+            ["changed", value] ->
+              Map.put(acc, :changed, String.to_integer(value, 16))
+            _ ->
+              acc
+          end
+        end)
+        |> Map.pop(:device)
+
+      {device_timestamp, button_data} = Map.pop(fields, :t)
+      
+      event = %{
+        type: :buttons,
+        device_id: device_id,
+        data: button_data,
+        device_timestamp: device_timestamp,
+        received_at: System.monotonic_time(:microsecond)
+      }
+      
+      {:ok, event}
+      
+    rescue
+      error ->
+        {:error, {:button_parse_error, error, params}}
+    end
+  end
+
+  defp parse_led_event(params) do
+    try do
+      # Parse "device=1,state=on,method=1" format
+      {device_id, led_data} =
+        params
+        |> String.split(",")
+        |> Enum.reduce(%{}, fn param, acc ->
+          case String.split(param, "=", parts: 2) do
+            ["device", value] ->
+              Map.put(acc, :device, String.to_integer(value))
+            ["state", value] ->
+              Map.put(acc, :state, String.to_atom(value))
+            ["method", value] ->
+              Map.put(acc, :method, String.to_integer(value))
+            _ ->
+              acc
+          end
+        end)
+        |> Map.pop(:device)
+      
+      event = %{
+        type: :led_changed,
+        device_id: device_id,
+        data: led_data,
+        timestamp: System.monotonic_time(:millisecond)
+      }
+      
+      {:ok, event}
+      
+    rescue
+      error ->
+        {:error, {:led_parse_error, error, params}}
+    end
+  end
+end
@@ -0,0 +1,57 @@
+defmodule SpaceMouse.Platform.ResponseCurves do
+  @moduledoc """
+  Per-axis response curves, applied natively before motion reaches Elixir.
+
+  Curves are declared in config and handed to the reader (as `--curve=`
+  flags) or to the hidraw NIF, which bake each one into a lookup table
+  indexed by the raw axis value:
+
+      config :space_mouse,
+        response_curves: [
+          x: {:expo, 0.4},
+          y: {:expo, 0.4},
+          rz: {:scurve, 2.5},
+          z: {:linear, [{100, 40}, {350, 350}]}
+        ]
+
+  - `{:expo, k}` - `(1 - k) * u + k * u³`, `k` in 0..1: fine control near
+    rest, full speed at full deflection
+  - `{:scurve, p}` - `uᵖ / (uᵖ + (1 - u)ᵖ)`, `p >= 1`: flat at rest and at
+    full deflection
+  - `{:linear, points}` - piecewise linear through `{in, out}` points in
+    raw units, ascending; `{0, 0}` is implied
+
+  `u` is the raw value divided by 350, the full deflection of current
+  devices; the sign is kept and values past the last point continue with
+  slope 1. Curves map raw values to raw values, so the scaling and the
+  motion pipeline downstream are unchanged.
+  """
+
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+
+  @doc """
+  `"AXES:KIND:PARAMS"` specs for `curves` (default: the `:response_curves`
+  application environment). Raises `ArgumentError` for an unknown axis or
+  curve.
+  """
+  @spec specs(keyword() | nil) :: [String.t()]
+  def specs(curves \\ Application.get_env(:space_mouse, :response_curves, [])) do
+    Enum.map(curves || [], fn {axis, curve} -> "#{axis!(axis)}:#{curve!(curve)}" end)
+  end
+
+  defp axis!(axis) when axis in @axes, do: axis
+  defp axis!(axis), do: raise(ArgumentError, "invalid response curve axis: #{inspect(axis)}")
+
+  defp curve!({:expo, k}) when is_number(k) and k >= 0 and k <= 1, do: "expo:#{k}"
+  defp curve!({:scurve, p}) when is_number(p) and p >= 1, do: "scurve:#{p}"
+
+  defp curve!({:linear, [_ | _] = points}) do
+    "linear:" <>
+      Enum.map_join(points, ",", fn
+        {input, output} when is_number(input) and is_number(output) -> "#{input}:#{output}"
+        point -> raise ArgumentError, "invalid response curve point: #{inspect(point)}"
+      end)
+  end
+
+  defp curve!(curve), do: raise(ArgumentError, "invalid response curve: #{inspect(curve)}")
+end
@@ -0,0 +1,203 @@
+defmodule SpaceMouse.Platform.Simulator.HidBridge do
+  @moduledoc """
+  Hardware-free platform implementation backed by a synthetic reader.
+  
+  The simulator binary (`priv/platform/simulator/hid_reader`) generates raw
+  SpaceMouse reports at a fixed rate, decodes them with the same code as the
+  hardware readers and speaks the same port protocol. Everything above the
+  port - `Core.DeviceManager`, subscribers, the API - runs exactly as it
+  would with a real device, which makes this backend suitable for CI and load tests.
+  
+  Select it with:
+  
+      config :space_mouse, platform: :simulator
+  
+  and tune the generator with:
+  
+      config :space_mouse, :simulator,
+        rate: 1000,          # reports per second, 10..10_000 (default 100)
+        pattern: :noise,     # :sine | :step | :noise | :idle | :drift (default :sine)
+        amplitude: 350,      # peak axis value (default 350)
+        button_rate: 0.5,    # button press cycles per second, 0 disables
+        seed: 1,             # seed for :noise, :idle and :drift
+        devices: 2           # simulated devices, 1..8 (default 1)
+  
+  The same keys can be passed to `platform_init/1` under `:simulator`.
+  """
+  @behaviour SpaceMouse.Platform.Behaviour
+  
+  require Logger
+
+  alias SpaceMouse.Platform.PortManager
+
+  defmodule State do
+    @moduledoc false
+    defstruct [
+      :port_manager,
+      :owner_pid,
+      :simulator_opts,
+      :device_connected,
+      :led_state
+    ]
+  end
+
+  # Platform Behaviour Implementation
+
+  @impl SpaceMouse.Platform.Behaviour
+  def platform_init(opts) do
+    owner_pid = Keyword.get(opts, :owner_pid, self())
+    
+    simulator_opts =
+      Keyword.merge(
+        Application.get_env(:space_mouse, :simulator, []),
+        Keyword.get(opts, :simulator, [])
+      )
+    
+    state = %State{
+      port_manager: nil,
+      owner_pid: owner_pid,
+      simulator_opts: simulator_opts,
+      device_connected: false,
+      led_state: :unknown
+    }
+    
+    {:ok, state}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def start_monitoring(state) do
+    case state.port_manager do
+      nil ->
+        # No port manager exists, start a new one
+        case PortManager.start_hid_reader(
+               owner_pid: state.owner_pid,
+               platform_dir: "simulator",
+               args: simulator_args(state.simulator_opts)
+             ) do
+          {:ok, port_manager} ->
+            new_state = %{state | port_manager: port_manager}
+            {:ok, new_state}
+            
+          {:error, reason} ->
+            {:error, reason}
+        end
+        
+      _existing_port_manager ->
+        # Port manager already exists, don't create a new one
+        Logger.debug("HID reader port manager already running")
+        {:ok, state}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def stop_monitoring(state) do
+    case state.port_manager do
+      nil -> 
+        {:ok, state}
+        
+      port_manager ->
+        PortManager.stop_hid_reader(port_manager)
+        new_state = %{state | port_manager: nil, device_connected: false}
+        {:ok, new_state}
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def send_led_command(state, target, command) do
+    case send_led_command_impl(state, target, command) do
+      :ok -> {:ok, %{state | led_state: command}}
+      error -> error
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def calibrate(state, target) do
+    case {state.device_connected, state.port_manager} do
+      {false, _} ->
+        {:error, :device_not_connected}
+
+      {true, nil} ->
+        {:error, :port_manager_not_available}
+
+      {true, port_manager} ->
+        # "CALIBRATE" for every device, "CALIBRATE:2" for device 2
+        command = if target == :all, do: "CALIBRATE", else: "CALIBRATE:#{target}"
+
+        with :ok <- PortManager.send_command(port_manager, command) do
+          {:ok, state}
+        end
+    end
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def get_led_state(state) do
+    {:ok, state.led_state}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def device_connected?(state) do
+    {:ok, state.device_connected}
+  end
+
+  @impl SpaceMouse.Platform.Behaviour
+  def platform_info do
+    %{
+      platform: :simulator,
+      method: :synthetic,
+      version: "1.0.0"
+    }
+  end
+
+  # Private Implementation
+
+  @simulator_flags [
+    rate: "--rate=",
+    pattern: "--pattern=",
+    amplitude: "--amplitude=",
+    button_rate: "--button-rate=",
+    seed: "--seed=",
+    devices: "--devices="
+  ]
+
+  defp simulator_args(simulator_opts) do
+    Enum.flat_map(@simulator_flags, fn {key, flag} ->
+      case Keyword.get(simulator_opts, key) do
+        nil -> []
+        value -> [flag <> to_string(value)]
+      end
+    end)
+  end
+
+  defp send_led_command_impl(state, target, command) do
+    case {state.device_connected, state.port_manager} do
+      {false, _} ->
+        {:error, :device_not_connected}
+        
+      {true, nil} ->
+        {:error, :port_manager_not_available}
+        
+      {true, port_manager} ->
+        # Send LED command to the C HID reader program: "LED:on" for every
+        # device, "LED:2:on" for device 2
+        led_arg = case command do
+          :on -> "on"
+          _ -> "off"
+        end
+
+        led_cmd = case target do
+          :all -> "LED:#{led_arg}"
+          device_id -> "LED:#{device_id}:#{led_arg}"
+        end
+        
+        case PortManager.send_command(port_manager, led_cmd) do
+          :ok ->
+            Logger.debug("LED command sent: #{command} (device #{target})")
+            :ok
+            
+          {:error, reason} ->
+            Logger.error("Failed to send LED command: #{inspect(reason)}")
+            {:error, reason}
+        end
+    end
+  end
+end
@@ -0,0 +1,77 @@
+defmodule SpaceMouse.Snapshot do
+  @moduledoc """
+  Wait-free reads of the latest device state from shared memory.
+
+  Consumers that only sample the current pose, such as a render loop at
+  144 Hz, do not need every motion event. With the `:shm` option (see
+  `SpaceMouse.Platform.PortManager`) the native reader publishes each
+  device's newest frame and button bitmask into a POSIX shared-memory
+  segment guarded by a seqlock; this module maps it and reads it from any
+  process, with no subscription and no call to the `DeviceManager`.
+
+      # config :space_mouse, shm: "/space_mouse"
+      {:ok, snapshot} = SpaceMouse.Snapshot.attach()
+      {:ok, %{x: x, rz: rz, buttons: buttons}} = SpaceMouse.Snapshot.read(snapshot, 1)
+
+  Axis values are the reader's frame (zero-corrected and through the
+  response curves) divided by 350, so ±1.0 at full deflection. They have
+  not been through the Elixir `SpaceMouse.Core.MotionPipeline`, so with a
+  pipeline configured they differ from `SpaceMouse.get_motion_state/1`,
+  which returns the pipeline's output. `:sequence` changes whenever the device's slot does, so a sampler can
+  tell a new frame from a repeated one.
+
+  The NIF (`priv/platform/common/snapshot_nif.c`) is loaded on demand by
+  `attach/1`, so the module costs nothing when it is not used. C programs
+  can read the same segment with `priv/platform/common/state_shm_client.h`.
+  """
+
+  @scale_factor 1.0 / 350.0
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+
+  @doc """
+  Map the snapshot segment `name` (default: the `:shm` application
+  setting). Returns `{:error, :not_found}` until a reader has created it.
+  """
+  def attach(name \\ Application.get_env(:space_mouse, :shm, "/space_mouse")) do
+    with :ok <- load() do
+      attach_nif(to_string(name))
+    end
+  end
+
+  @doc """
+  Read the latest state of `device_id`.
+
+  Returns `{:ok, state}`, `:disconnected` if no device holds that ID, or
+  `{:error, :busy}` in the unlikely case that every copy overlapped a write.
+  """
+  def read(snapshot, device_id \\ 1) when is_integer(device_id) do
+    case read_nif(snapshot, device_id) do
+      {:ok, state} -> {:ok, scale(state)}
+      other -> other
+    end
+  end
+
+  @doc false
+  def load do
+    path = Path.join([:code.priv_dir(:space_mouse), "platform", "common", "snapshot_nif"])
+
+    case :erlang.load_nif(String.to_charlist(path), 0) do
+      :ok -> :ok
+      {:error, {:reload, _}} -> :ok
+      {:error, {:upgrade, _}} -> :ok
+      {:error, reason} -> {:error, reason}
+    end
+  end
+
+  defp scale(state) do
+    Enum.reduce(@axes, state, fn axis, acc -> Map.update!(acc, axis, &(&1 * @scale_factor)) end)
+  end
+
+  # NIF entry points, replaced when the library loads
+
+  @doc false
+  def attach_nif(_name), do: :erlang.nif_error(:nif_not_loaded)
+
+  @doc false
+  def read_nif(_snapshot, _device_id), do: :erlang.nif_error(:nif_not_loaded)
+end
@@ -53,12 +53,84 @@ defmodule SpaceMouse.MixProject do
         end
         
       {:unix, :linux} ->
-        # Future Linux support
-        IO.puts("Linux native compilation not yet implemented")
+        case System.cmd("bash", ["priv/platform/linux/build.sh"], 
+                       env: [{"MIX_APP_PATH", app_path}, {"ERTS_INCLUDE_DIR", erts_include_dir()}],
+                       into: IO.stream(:stdio, :line)) do
+          {_, 0} -> 
+            IO.puts("Native compilation successful")
+          {_, exit_code} -> 
+            raise("Native compilation failed with exit code #{exit_code}")
+        end
         
       _ ->
         IO.puts("Native compilation not supported on this platform")
     end
+    
+    compile_simulator(app_path)
+    compile_shared_nifs(app_path)
+
+    if Mix.env() == :test do
+      compile_native_tests(app_path)
+    end
+  end
+  
+  # Headers for the optional NIFs (Linux hidraw, shared snapshot)
+  defp erts_include_dir do
+    Path.join([to_string(:code.root_dir()), "erts-#{:erlang.system_info(:version)}", "include"])
+  end
+  
+  # The simulator reader is plain POSIX C and is built on every Unix host
+  defp compile_simulator(app_path) do
+    case :os.type() do
+      {:unix, _} ->
+        case System.cmd("bash", ["priv/platform/simulator/build.sh"], 
+                       env: [{"MIX_APP_PATH", app_path}],
+                       into: IO.stream(:stdio, :line)) do
+          {_, 0} -> 
+            IO.puts("Simulator compilation successful")
+          {_, exit_code} -> 
+            raise("Simulator compilation failed with exit code #{exit_code}")
+        end
+        
+      _ ->
+        :ok
+    end
+  end
+  
+  # Optional NIFs used on every platform (shared-memory snapshot client)
+  defp compile_shared_nifs(app_path) do
+    case :os.type() do
+      {:unix, _} ->
+        case System.cmd("bash", ["priv/platform/common/build.sh"], 
+                       env: [{"MIX_APP_PATH", app_path}, {"ERTS_INCLUDE_DIR", erts_include_dir()}],
+                       into: IO.stream(:stdio, :line)) do
+          {_, 0} -> 
+            IO.puts("Shared NIF compilation successful")
+          {_, exit_code} -> 
+            raise("Shared NIF compilation failed with exit code #{exit_code}")
+        end
+        
+      _ ->
+        :ok
+    end
+  end
+  
+  # Unit tests of the shared C code, run by test/space_mouse/native_test.exs
+  defp compile_native_tests(app_path) do
+    case :os.type() do
+      {:unix, _} ->
+        case System.cmd("bash", ["priv/platform/common/tests/build.sh"], 
+                       env: [{"MIX_APP_PATH", app_path}],
+                       into: IO.stream(:stdio, :line)) do
+          {_, 0} -> 
+            IO.puts("Native test compilation successful")
+          {_, exit_code} -> 
+            raise("Native test compilation failed with exit code #{exit_code}")
+        end
+        
+      _ ->
+        :ok
+    end
   end
   
   defp clean_native(_) do
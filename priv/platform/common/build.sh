@@ -0,0 +1,47 @@
+#!/bin/bash
+#
+# Build script for the NIFs shared by every platform (any POSIX system)
+#
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+# When used as a dependency, Mix sets MIX_APP_PATH to the dependency's build directory
+# When building standalone, we need to find the project root
+if [ -n "$MIX_APP_PATH" ]; then
+    # Building as a dependency - use MIX_APP_PATH/priv
+    BUILD_DIR="$MIX_APP_PATH/priv/platform/common"
+    echo "🔧 Building as dependency: $BUILD_DIR"
+else
+    # Building standalone - use project _build directory
+    PROJECT_ROOT="$(cd "$SCRIPT_DIR/../../.." && pwd)"
+    BUILD_DIR="$PROJECT_ROOT/_build/dev/lib/space_mouse/priv/platform/common"
+    echo "🔧 Building standalone: $BUILD_DIR"
+fi
+
+# Create build directory if it doesn't exist
+mkdir -p "$BUILD_DIR"
+
+# Mix passes ERTS_INCLUDE_DIR; standalone builds ask erl for it
+if [ -z "$ERTS_INCLUDE_DIR" ] && command -v erl >/dev/null 2>&1; then
+    ERTS_INCLUDE_DIR="$(erl -noshell -eval 'io:format("~s/erts-~s/include", [code:root_dir(), erlang:system_info(version)]), halt().')"
+fi
+
+if [ ! -f "$ERTS_INCLUDE_DIR/erl_nif.h" ]; then
+    echo "⚠️  erl_nif.h not found, skipping shared NIFs"
+    exit 0
+fi
+
+# macOS resolves the NIF API when the VM loads the library
+case "$(uname -s)" in
+    Darwin) NIF_LDFLAGS="-undefined dynamic_lookup" ;;
+    *) NIF_LDFLAGS="" ;;
+esac
+
+echo "🔨 Building snapshot NIF..."
+${CC:-cc} -O2 -Wall -Wextra -fPIC -shared $NIF_LDFLAGS \
+      -I"$ERTS_INCLUDE_DIR" \
+      -o "$BUILD_DIR/snapshot_nif.so" \
+      "$SCRIPT_DIR/snapshot_nif.c"
+echo "✅ Build complete: $BUILD_DIR/snapshot_nif.so"
@@ -0,0 +1,137 @@
+/*
+ * Zero-drift calibration with a running per-axis bias estimate (see
+ * calibration.h)
+ */
+
+#include "calibration.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// Automatic tracking; window 0 turns it off
+static int32_t window = 64;
+static int32_t noise = 2;
+static int32_t max_bias = 24;
+
+static int16_t saturate(int32_t value)
+{
+    if (value > INT16_MAX)
+        return INT16_MAX;
+    if (value < INT16_MIN)
+        return INT16_MIN;
+    return (int16_t)value;
+}
+
+static void restart_window(struct calibration *calibration)
+{
+    calibration->count = 0;
+    memset(calibration->sum, 0, sizeof(calibration->sum));
+    memset(calibration->sum_squares, 0, sizeof(calibration->sum_squares));
+}
+
+static void set_bias(struct calibration *calibration, int axis, int32_t bias_q4)
+{
+    calibration->bias_q4[axis] = bias_q4;
+    // Round half away from zero
+    calibration->bias[axis] = saturate((bias_q4 + (bias_q4 < 0 ? -8 : 8)) / 16);
+}
+
+// Check whether a full window was the cap at rest: low variance and a
+// mean within MAX_BIAS on every axis
+static bool window_at_rest(const struct calibration *calibration)
+{
+    int64_t n = calibration->count;
+
+    for (int axis = 0; axis < 6; axis++)
+    {
+        int64_t sum = calibration->sum[axis];
+        // n^2 * variance = n * sum(x^2) - sum(x)^2, compared without dividing
+        if (n * calibration->sum_squares[axis] - sum * sum > n * n * noise * noise)
+            return false;
+        if (llabs(sum) > n * max_bias)
+            return false;
+    }
+    return true;
+}
+
+// Move the bias a quarter of the way towards the window mean
+static void close_window(struct calibration *calibration)
+{
+    if (window_at_rest(calibration))
+    {
+        for (int axis = 0; axis < 6; axis++)
+        {
+            int32_t mean_q4 = (int32_t)(calibration->sum[axis] * 16 / calibration->count);
+            set_bias(calibration, axis, calibration->bias_q4[axis] + (mean_q4 - calibration->bias_q4[axis]) / 4);
+        }
+    }
+    restart_window(calibration);
+}
+
+bool calibration_configure(const char *spec)
+{
+    if (strcmp(spec, "off") == 0)
+    {
+        window = 0;
+        return true;
+    }
+
+    int parsed_window, parsed_noise, parsed_max_bias;
+    char trailing;
+    if (sscanf(spec, "%d:%d:%d%c", &parsed_window, &parsed_noise, &parsed_max_bias, &trailing) != 3)
+        return false;
+    if (parsed_window < 2 || parsed_window > 100000 || parsed_noise < 0 || parsed_noise > 1000 ||
+        parsed_max_bias < 0 || parsed_max_bias > 1000)
+        return false;
+
+    window = parsed_window;
+    noise = parsed_noise;
+    max_bias = parsed_max_bias;
+    return true;
+}
+
+bool calibration_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--auto-zero=", 12) == 0 && !calibration_configure(argv[i] + 12))
+        {
+            fprintf(stderr, "ERROR: Invalid auto-zero setting %s\n", argv[i] + 12);
+            return false;
+        }
+    }
+    return true;
+}
+
+void calibration_reset(struct calibration *calibration)
+{
+    memset(calibration, 0, sizeof(*calibration));
+}
+
+void calibration_apply(struct calibration *calibration, const int16_t raw[6], int16_t corrected[6])
+{
+    if (window > 0)
+    {
+        for (int axis = 0; axis < 6; axis++)
+        {
+            calibration->sum[axis] += raw[axis];
+            calibration->sum_squares[axis] += (int64_t)raw[axis] * raw[axis];
+        }
+        if (++calibration->count >= window)
+            close_window(calibration);
+    }
+
+    for (int axis = 0; axis < 6; axis++)
+    {
+        int32_t value = (int32_t)raw[axis] - calibration->bias[axis];
+        corrected[axis] = (window > 0 && value >= -noise && value <= noise) ? 0 : saturate(value);
+    }
+}
+
+void calibration_zero(struct calibration *calibration, const int16_t raw[6])
+{
+    for (int axis = 0; axis < 6; axis++)
+        set_bias(calibration, axis, (int32_t)raw[axis] * 16);
+    restart_window(calibration);
+}
@@ -0,0 +1,60 @@
+/*
+ * Zero-drift calibration with a running per-axis bias estimate
+ *
+ * A SpaceMouse cap at rest rarely reports exact zeros: worn or warm
+ * sensors settle a few counts off centre and jitter around that offset.
+ * Uncorrected, the offset streams out as phantom motion. Each device
+ * therefore keeps a bias per axis, subtracted from every frame in the
+ * decode path before curves, port records and the shared-memory snapshot.
+ *
+ * The bias is learnt from stillness. Raw frames are collected in windows
+ * of WINDOW frames; a window in which every axis has a variance of at most
+ * NOISE^2 and a mean within +/-MAX_BIAS counts is taken to be the cap at
+ * rest, and the bias moves a quarter of the way towards its mean. A cap
+ * held still but deflected further than MAX_BIAS never counts as rest.
+ * After correction, values within +/-NOISE of zero become exactly zero,
+ * so a calibrated cap at rest reports a steady all-zero frame.
+ *
+ *   --auto-zero=64:2:24     WINDOW:NOISE:MAX_BIAS (the default)
+ *   --auto-zero=off         no tracking and no zeroing of small values;
+ *                           only calibration_zero() (the CALIBRATE
+ *                           command) sets a bias
+ *
+ * calibration_zero() takes the current raw frame as the bias outright, for
+ * the readers' "CALIBRATE" / "CALIBRATE:<dev>" command.
+ */
+
+#ifndef CALIBRATION_H
+#define CALIBRATION_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-device state; all zero is a valid, uncalibrated start
+struct calibration
+{
+    int32_t bias_q4[6]; // bias in 1/16 counts
+    int16_t bias[6];    // bias_q4 rounded, as subtracted
+    int32_t count;
+    int64_t sum[6];
+    int64_t sum_squares[6];
+};
+
+// Parse --auto-zero= (if present). Returns false (after printing to
+// stderr) for an invalid value.
+bool calibration_init(int argc, char *argv[]);
+
+// Set the automatic tracking from a "WINDOW:NOISE:MAX_BIAS" or "off" spec
+bool calibration_configure(const char *spec);
+
+// Forget the bias and the current window, e.g. when a device attaches
+void calibration_reset(struct calibration *calibration);
+
+// Track raw for stillness and write it minus the bias to corrected
+// (raw and corrected may be the same array)
+void calibration_apply(struct calibration *calibration, const int16_t raw[6], int16_t corrected[6]);
+
+// Take raw as the bias now and restart the window
+void calibration_zero(struct calibration *calibration, const int16_t raw[6]);
+
+#endif /* CALIBRATION_H */
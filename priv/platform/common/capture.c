@@ -0,0 +1,302 @@
+/*
+ * Raw HID report capture and replay (see capture.h)
+ */
+
+#include "capture.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CAPTURE_VERSION 2
+#define RECORD_HEADER_SIZE 11
+#define RECORD_HEADER_SIZE_V1 10
+
+enum capture_kind
+{
+    CAPTURE_ATTACHED = 1,
+    CAPTURE_DETACHED = 2,
+    CAPTURE_REPORT = 3
+};
+
+static const uint8_t capture_magic[6] = {'S', 'M', 'C', 'A', 'P', 0};
+
+static FILE *capture_file = NULL;
+static FILE *replay_file = NULL;
+static uint16_t replay_version = CAPTURE_VERSION;
+
+// Replay state: the next record is read ahead so its due time is known
+static double replay_speed = 1.0; // <= 0 means as fast as possible
+static bool replay_started = false;
+static bool replay_pending = false;
+static uint64_t replay_origin_recorded = 0;
+static uint64_t replay_origin_now = 0;
+static uint8_t pending_kind;
+static uint8_t pending_device;
+static uint8_t pending_length;
+static uint64_t pending_timestamp;
+static uint8_t pending_payload[255];
+
+static void put_le16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)value;
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+static uint16_t get_le16(const uint8_t *bytes)
+{
+    return (uint16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static void put_le64(uint8_t *bytes, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (uint8_t)(value >> (i * 8));
+}
+
+static uint64_t get_le64(const uint8_t *bytes)
+{
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++)
+        value |= (uint64_t)bytes[i] << (i * 8);
+    return value;
+}
+
+static bool open_capture(const char *path)
+{
+    capture_file = fopen(path, "wb");
+    if (!capture_file)
+        return false;
+
+    uint8_t header[8];
+    memcpy(header, capture_magic, sizeof(capture_magic));
+    put_le16(header + 6, CAPTURE_VERSION);
+    return fwrite(header, 1, sizeof(header), capture_file) == sizeof(header);
+}
+
+static bool open_replay(const char *path)
+{
+    replay_file = fopen(path, "rb");
+    if (!replay_file)
+        return false;
+
+    uint8_t header[8];
+    if (fread(header, 1, sizeof(header), replay_file) != sizeof(header) ||
+        memcmp(header, capture_magic, sizeof(capture_magic)) != 0)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    replay_version = get_le16(header + 6);
+    if (replay_version < 1 || replay_version > CAPTURE_VERSION)
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    return true;
+}
+
+// "max" or a factor above 0; anything else is rejected rather than read as
+// 0.0, which would mean "max"
+static bool parse_replay_speed(const char *spec)
+{
+    char *end;
+    double speed;
+
+    if (strcmp(spec, "max") == 0)
+    {
+        replay_speed = 0.0;
+        return true;
+    }
+
+    speed = strtod(spec, &end);
+    if (end == spec || *end != '\0' || !(speed > 0.0))
+        return false;
+
+    replay_speed = speed;
+    return true;
+}
+
+bool capture_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+
+        if (strncmp(arg, "--capture=", 10) == 0)
+        {
+            if (!open_capture(arg + 10))
+            {
+                fprintf(stderr, "ERROR: Failed to open capture file %s (%s)\n", arg + 10, strerror(errno));
+                return false;
+            }
+        }
+        else if (strncmp(arg, "--replay=", 9) == 0)
+        {
+            if (!open_replay(arg + 9))
+            {
+                fprintf(stderr, "ERROR: Failed to open replay file %s (%s)\n", arg + 9, strerror(errno));
+                return false;
+            }
+        }
+        else if (strncmp(arg, "--replay-speed=", 15) == 0)
+        {
+            if (!parse_replay_speed(arg + 15))
+            {
+                fprintf(stderr, "ERROR: Invalid replay speed %s\n", arg + 15);
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void capture_close(void)
+{
+    if (capture_file)
+    {
+        fclose(capture_file);
+        capture_file = NULL;
+    }
+
+    if (replay_file)
+    {
+        fclose(replay_file);
+        replay_file = NULL;
+    }
+}
+
+bool capture_enabled(void)
+{
+    return capture_file != NULL;
+}
+
+static void write_capture_record(uint8_t kind, uint8_t device, uint64_t timestamp_us, const uint8_t *payload, size_t length)
+{
+    uint8_t header[RECORD_HEADER_SIZE];
+
+    if (length > 255)
+        length = 255;
+
+    header[0] = kind;
+    header[1] = device;
+    header[2] = (uint8_t)length;
+    put_le64(header + 3, timestamp_us);
+
+    fwrite(header, 1, sizeof(header), capture_file);
+    if (length > 0)
+        fwrite(payload, 1, length, capture_file);
+}
+
+void capture_device(uint8_t device, uint64_t timestamp_us, uint16_t vendor_id, uint16_t product_id, bool attached)
+{
+    if (!capture_file)
+        return;
+
+    if (attached)
+    {
+        uint8_t payload[4];
+        put_le16(payload, vendor_id);
+        put_le16(payload + 2, product_id);
+        write_capture_record(CAPTURE_ATTACHED, device, timestamp_us, payload, sizeof(payload));
+    }
+    else
+    {
+        write_capture_record(CAPTURE_DETACHED, device, timestamp_us, NULL, 0);
+        // Keep the file usable if the reader is killed while idle
+        fflush(capture_file);
+    }
+}
+
+void capture_report(uint8_t device, uint64_t timestamp_us, const uint8_t *report, size_t length)
+{
+    if (capture_file)
+        write_capture_record(CAPTURE_REPORT, device, timestamp_us, report, length);
+}
+
+bool replay_enabled(void)
+{
+    return replay_file != NULL;
+}
+
+// Read the next record into the pending slot
+static bool read_ahead(void)
+{
+    uint8_t header[RECORD_HEADER_SIZE];
+    size_t header_size = (replay_version == 1) ? RECORD_HEADER_SIZE_V1 : RECORD_HEADER_SIZE;
+
+    if (!replay_file || fread(header, 1, header_size, replay_file) != header_size)
+        return false;
+
+    // Version 1 has no device byte: everything belongs to device 1
+    if (replay_version == 1)
+    {
+        memmove(header + 2, header + 1, RECORD_HEADER_SIZE_V1 - 1);
+        header[1] = 1;
+    }
+
+    pending_kind = header[0];
+    pending_device = header[1];
+    pending_length = header[2];
+    pending_timestamp = get_le64(header + 3);
+
+    if (pending_length > 0 && fread(pending_payload, 1, pending_length, replay_file) != pending_length)
+        return false;
+
+    return true;
+}
+
+int64_t replay_next_delay_us(uint64_t now_us)
+{
+    if (!replay_pending)
+    {
+        replay_pending = read_ahead();
+        if (!replay_pending)
+            return -1;
+
+        if (!replay_started)
+        {
+            replay_started = true;
+            replay_origin_recorded = pending_timestamp;
+            replay_origin_now = now_us;
+        }
+    }
+
+    if (replay_speed <= 0.0)
+        return 0;
+
+    uint64_t offset = pending_timestamp - replay_origin_recorded;
+    uint64_t due = replay_origin_now + (uint64_t)((double)offset / replay_speed);
+
+    return (due > now_us) ? (int64_t)(due - now_us) : 0;
+}
+
+bool replay_step(const struct replay_handlers *handlers)
+{
+    if (!replay_pending && !(replay_pending = read_ahead()))
+        return false;
+
+    replay_pending = false;
+
+    switch (pending_kind)
+    {
+    case CAPTURE_ATTACHED:
+        if (pending_length >= 4)
+            handlers->device(pending_device, pending_timestamp, get_le16(pending_payload), get_le16(pending_payload + 2), true);
+        break;
+    case CAPTURE_DETACHED:
+        handlers->device(pending_device, pending_timestamp, 0, 0, false);
+        break;
+    case CAPTURE_REPORT:
+        handlers->report(pending_device, pending_timestamp, pending_payload, pending_length);
+        break;
+    default:
+        break; // Unknown record kinds from newer writers are skipped
+    }
+
+    return true;
+}
@@ -0,0 +1,59 @@
+/*
+ * Raw HID report capture and replay shared by the native readers
+ *
+ * --capture=PATH          record every raw input report, with its µs
+ *                         timestamp, plus device attach/detach (VID/PID)
+ * --replay=PATH           read no device at all; feed PATH back through the
+ *                         normal decode path instead
+ * --replay-speed=N|max    1 (default) replays in real time, N (> 0) replays
+ *                         N times faster, max as fast as the port drains;
+ *                         anything else is an error
+ *
+ * Replayed events keep their recorded timestamps, so a replay is
+ * byte-for-byte reproducible regardless of speed.
+ *
+ * File format (little-endian):
+ *
+ *   header  "SMCAP" 0x00 version:u16(=2)
+ *   record  kind:u8 device:u8 length:u8 t:u64 payload[length]
+ *
+ * device is the reader's device ID (see device_ids.h). Version 1 files,
+ * which have no device byte, replay as device 1.
+ *
+ *   kind 1  device attached   payload vid:u16 pid:u16
+ *   kind 2  device detached   payload empty
+ *   kind 3  input report      payload raw report, report ID first
+ */
+
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+struct replay_handlers
+{
+    void (*device)(uint8_t device, uint64_t timestamp_us, uint16_t vendor_id, uint16_t product_id, bool attached);
+    void (*report)(uint8_t device, uint64_t timestamp_us, const uint8_t *report, size_t length);
+};
+
+// Parse --capture/--replay options and open the file. Returns false (after
+// printing to stderr) if a requested file cannot be opened.
+bool capture_init(int argc, char *argv[]);
+void capture_close(void);
+
+bool capture_enabled(void);
+void capture_device(uint8_t device, uint64_t timestamp_us, uint16_t vendor_id, uint16_t product_id, bool attached);
+void capture_report(uint8_t device, uint64_t timestamp_us, const uint8_t *report, size_t length);
+
+bool replay_enabled(void);
+
+// Microseconds from now_us until the next record is due (0 when it is due
+// already), or -1 once the capture is exhausted
+int64_t replay_next_delay_us(uint64_t now_us);
+
+// Deliver the next record. Returns false at the end of the capture.
+bool replay_step(const struct replay_handlers *handlers);
+
+#endif /* CAPTURE_H */
@@ -0,0 +1,66 @@
+/*
+ * Stable device IDs (see device_ids.h)
+ */
+
+#include "device_ids.h"
+
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+
+#define IDENTITY_SIZE 128
+
+struct device_id_entry
+{
+    char identity[IDENTITY_SIZE]; // Empty: ID never used
+    bool attached;
+};
+
+// Index 0 is unused so the index is the ID
+static struct device_id_entry entries[MAX_DEVICES + 1];
+
+uint8_t device_ids_acquire(const char *identity)
+{
+    int free_id = 0;
+    int detached_id = 0;
+
+    for (int id = 1; id <= MAX_DEVICES; id++)
+    {
+        struct device_id_entry *entry = &entries[id];
+
+        if (entry->identity[0] == '\0')
+        {
+            if (!free_id)
+                free_id = id;
+        }
+        else if (strncmp(entry->identity, identity, IDENTITY_SIZE - 1) == 0)
+        {
+            if (!entry->attached)
+            {
+                entry->attached = true;
+                return (uint8_t)id;
+            }
+            // Identity already attached (identical devices without serial
+            // numbers): this one gets an ID of its own
+        }
+        else if (!entry->attached && !detached_id)
+        {
+            detached_id = id;
+        }
+    }
+
+    // Prefer a never-used ID so detached devices keep theirs
+    int id = free_id ? free_id : detached_id;
+    if (!id)
+        return 0;
+
+    snprintf(entries[id].identity, IDENTITY_SIZE, "%s", identity);
+    entries[id].attached = true;
+    return (uint8_t)id;
+}
+
+void device_ids_release(uint8_t device)
+{
+    if (device >= 1 && device <= MAX_DEVICES)
+        entries[device].attached = false;
+}
@@ -0,0 +1,25 @@
+/*
+ * Stable device IDs shared by the native readers
+ *
+ * Every attached SpaceMouse gets a small ID (1..MAX_DEVICES) that tags all
+ * of its port records. IDs are keyed by an identity string the reader
+ * derives from the device (serial number when the device has one, else its
+ * physical port), so unplugging and replugging the same device, or the
+ * same port, gives back the same ID for the lifetime of the reader.
+ */
+
+#ifndef DEVICE_IDS_H
+#define DEVICE_IDS_H
+
+#include <stdint.h>
+
+#include "port_protocol.h"
+
+// ID for identity, marking it attached. 0 if MAX_DEVICES are attached.
+uint8_t device_ids_acquire(const char *identity);
+
+// Mark the ID detached; it stays reserved for its identity while there
+// are never-used IDs left
+void device_ids_release(uint8_t device);
+
+#endif /* DEVICE_IDS_H */
@@ -0,0 +1,396 @@
+/*
+ * Unix-domain-socket fan-out of the binary event stream (see event_server.h)
+ *
+ * The port protocol hands every encoded device record to publish() once;
+ * it is copied into each client's ring and written out by
+ * event_server_flush(), one writev() per client and batch. Rings use the
+ * same slot discipline as the port's output queue (port_protocol.c), only
+ * smaller: the records fanned out are at most a MOTION record long.
+ */
+
+#include "event_server.h"
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+// Per-client ring: must be a power of two
+#define CLIENT_SLOTS 256
+#define MAX_IOV 64
+
+// Length prefix plus the longest fanned-out record (MOTION, 22 bytes)
+#define SLOT_SIZE 24
+
+#ifndef MSG_NOSIGNAL
+#define MSG_NOSIGNAL 0 // macOS: SO_NOSIGPIPE is set on the socket instead
+#endif
+
+enum slot_kind
+{
+    SLOT_EVENT = 0,  // Must be delivered
+    SLOT_MOTION = 1, // May be superseded by a newer frame
+    SLOT_DROPPED = 2 // Superseded; skipped by the flush
+};
+
+struct client_slot
+{
+    uint8_t length;
+    uint8_t kind;
+    uint8_t device; // Owner of a SLOT_MOTION frame
+    uint8_t bytes[SLOT_SIZE];
+};
+
+struct client
+{
+    int fd;       // -1 for an unused slot
+    bool blocked; // Last write hit a full socket
+    size_t head;
+    size_t tail;
+    size_t head_offset;                 // Bytes of the head slot already written
+    size_t last_motion[MAX_DEVICES + 1]; // Queued motion slot per device
+    bool event_behind[MAX_DEVICES + 1];  // Device event queued after that slot
+    struct client_slot ring[CLIENT_SLOTS];
+};
+
+static int listen_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)0)->sun_path)];
+static struct client clients[MAX_CLIENTS];
+
+// device_connected record of every attached device, replayed to new clients
+static uint8_t connected_records[MAX_DEVICES + 1][7];
+
+static size_t queued_slots(const struct client *client)
+{
+    return (client->tail - client->head) & (CLIENT_SLOTS - 1);
+}
+
+static void close_client(struct client *client)
+{
+    close(client->fd);
+    client->fd = -1;
+}
+
+// Queue one record for one client. False if the ring is full of records
+// that must be delivered.
+static bool enqueue(struct client *client, enum slot_kind kind, uint8_t device, const uint8_t *record, size_t length)
+{
+    size_t index = client->tail;
+    size_t *last = &client->last_motion[device];
+
+    // For a client that is behind, a frame it has not started reading is
+    // replaced by the newer one; the head slot only while none of it has
+    // been written. Other devices' records may pass it, this device's
+    // events may not.
+    if (kind == SLOT_MOTION && client->blocked && *last != CLIENT_SLOTS &&
+        (*last != client->head || client->head_offset == 0))
+    {
+        if (!client->event_behind[device])
+            index = *last; // Overwrite in place
+        else
+            client->ring[*last].kind = SLOT_DROPPED;
+    }
+
+    if (index == client->tail && queued_slots(client) == CLIENT_SLOTS - 1)
+        return false;
+
+    struct client_slot *slot = &client->ring[index];
+    slot->bytes[0] = (uint8_t)(length >> 8);
+    slot->bytes[1] = (uint8_t)length;
+    memcpy(slot->bytes + 2, record, length);
+    slot->length = (uint8_t)(length + 2);
+    slot->kind = (uint8_t)kind;
+    slot->device = device;
+
+    if (kind == SLOT_MOTION)
+    {
+        *last = index;
+        client->event_behind[device] = false;
+    }
+    else if (*last != CLIENT_SLOTS)
+    {
+        client->event_behind[device] = true;
+    }
+
+    if (index == client->tail)
+        client->tail = (client->tail + 1) & (CLIENT_SLOTS - 1);
+    return true;
+}
+
+// Record sink of the port protocol: one encoded record, every client
+static void publish(uint8_t device, bool motion, const uint8_t *record, size_t length)
+{
+    if (device > MAX_DEVICES || length > SLOT_SIZE - 2)
+        return;
+
+    if (record[0] == RECORD_STATUS && length == sizeof(connected_records[0]))
+        memcpy(connected_records[device], record, length);
+    else if (record[0] == RECORD_STATUS)
+        connected_records[device][0] = 0;
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        struct client *client = &clients[i];
+        if (client->fd < 0)
+            continue;
+
+        if (!enqueue(client, motion ? SLOT_MOTION : SLOT_EVENT, device, record, length))
+        {
+            // Too far behind even with coalesced motion
+            close_client(client);
+            protocol_info("socket_client_dropped=%d", i);
+        }
+    }
+}
+
+static bool open_socket(const char *path)
+{
+    struct sockaddr_un address = {.sun_family = AF_UNIX};
+    struct stat info;
+
+    if (strlen(path) >= sizeof(address.sun_path))
+    {
+        errno = ENAMETOOLONG;
+        return false;
+    }
+    snprintf(address.sun_path, sizeof(address.sun_path), "%s", path);
+
+    // Replace a socket left behind by a previous reader, nothing else
+    if (lstat(path, &info) == 0 && S_ISSOCK(info.st_mode))
+        unlink(path);
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0)
+        return false;
+
+    fcntl(listen_fd, F_SETFD, FD_CLOEXEC);
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL) | O_NONBLOCK);
+
+    if (bind(listen_fd, (struct sockaddr *)&address, sizeof(address)) < 0 || listen(listen_fd, MAX_CLIENTS) < 0)
+    {
+        int error = errno;
+        close(listen_fd);
+        listen_fd = -1;
+        errno = error;
+        return false;
+    }
+
+    snprintf(socket_path, sizeof(socket_path), "%s", path);
+    return true;
+}
+
+bool event_server_init(int argc, char *argv[])
+{
+    for (int i = 0; i < MAX_CLIENTS; i++)
+        clients[i].fd = -1;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--socket=", 9) != 0)
+            continue;
+
+        if (!open_socket(argv[i] + 9))
+        {
+            fprintf(stderr, "ERROR: Failed to listen on %s (%s)\n", argv[i] + 9, strerror(errno));
+            return false;
+        }
+        protocol_set_record_sink(publish);
+    }
+    return true;
+}
+
+void event_server_close(void)
+{
+    if (listen_fd < 0)
+        return;
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (clients[i].fd >= 0)
+            close_client(&clients[i]);
+    }
+
+    protocol_set_record_sink(NULL);
+    close(listen_fd);
+    unlink(socket_path);
+    listen_fd = -1;
+}
+
+int event_server_listen_fd(void)
+{
+    return listen_fd;
+}
+
+int event_server_accept(void)
+{
+    if (listen_fd < 0)
+        return -1;
+
+    int fd;
+    do
+        fd = accept(listen_fd, NULL, NULL);
+    while (fd < 0 && errno == EINTR);
+
+    if (fd < 0)
+        return -1;
+
+    int index = 0;
+    while (index < MAX_CLIENTS && clients[index].fd >= 0)
+        index++;
+
+    if (index == MAX_CLIENTS)
+    {
+        close(fd);
+        protocol_info("socket_client_rejected=max_clients");
+        // Keep draining the backlog; the caller stops at -1
+        return event_server_accept();
+    }
+
+    fcntl(fd, F_SETFD, FD_CLOEXEC);
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+#ifdef SO_NOSIGPIPE
+    int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+
+    struct client *client = &clients[index];
+    client->fd = fd;
+    client->blocked = false;
+    client->head = client->tail = client->head_offset = 0;
+    for (int device = 0; device <= MAX_DEVICES; device++)
+    {
+        client->last_motion[device] = CLIENT_SLOTS;
+        client->event_behind[device] = false;
+    }
+
+    for (uint8_t device = 1; device <= MAX_DEVICES; device++)
+    {
+        if (connected_records[device][0] == RECORD_STATUS)
+            enqueue(client, SLOT_EVENT, device, connected_records[device], sizeof(connected_records[device]));
+    }
+
+    return index;
+}
+
+int event_server_client_fd(int client)
+{
+    return client >= 0 && client < MAX_CLIENTS ? clients[client].fd : -1;
+}
+
+void event_server_client_readable(int index)
+{
+    struct client *client = &clients[index];
+    uint8_t discard[256];
+
+    while (client->fd >= 0)
+    {
+        ssize_t length = read(client->fd, discard, sizeof(discard));
+        if (length > 0)
+            continue;
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            return;
+
+        // EOF or a broken connection
+        close_client(client);
+    }
+}
+
+bool event_server_client_pending(int client)
+{
+    return event_server_client_fd(client) >= 0 && clients[client].head != clients[client].tail;
+}
+
+// Advance the head past fully written and dropped slots
+static void consume_output(struct client *client, size_t written)
+{
+    while (client->head != client->tail)
+    {
+        struct client_slot *slot = &client->ring[client->head];
+
+        if (slot->kind != SLOT_DROPPED)
+        {
+            size_t remaining = slot->length - client->head_offset;
+            if (written < remaining)
+            {
+                client->head_offset += written;
+                return;
+            }
+            written -= remaining;
+        }
+
+        if (client->head == client->last_motion[slot->device])
+            client->last_motion[slot->device] = CLIENT_SLOTS;
+
+        client->head_offset = 0;
+        client->head = (client->head + 1) & (CLIENT_SLOTS - 1);
+    }
+}
+
+// Returns true once the client's queue is empty (or the client is gone)
+static bool flush_client(struct client *client)
+{
+    while (client->fd >= 0 && client->head != client->tail)
+    {
+        struct iovec iov[MAX_IOV];
+        int count = 0;
+        size_t offset = client->head_offset;
+
+        for (size_t i = client->head; i != client->tail && count < MAX_IOV; i = (i + 1) & (CLIENT_SLOTS - 1))
+        {
+            struct client_slot *slot = &client->ring[i];
+            if (slot->kind == SLOT_DROPPED)
+                continue;
+
+            iov[count].iov_base = slot->bytes + offset;
+            iov[count].iov_len = slot->length - offset;
+            count++;
+            offset = 0;
+        }
+
+        if (count == 0)
+        {
+            // Only dropped slots were left
+            consume_output(client, 0);
+            break;
+        }
+
+        struct msghdr message = {.msg_iov = iov, .msg_iovlen = count};
+        ssize_t written = sendmsg(client->fd, &message, MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                client->blocked = true;
+                return false;
+            }
+            close_client(client);
+            break;
+        }
+
+        consume_output(client, (size_t)written);
+    }
+
+    client->blocked = false;
+    return true;
+}
+
+bool event_server_flush(void)
+{
+    bool drained = true;
+
+    for (int i = 0; i < MAX_CLIENTS; i++)
+    {
+        if (clients[i].fd >= 0 && !flush_client(&clients[i]))
+            drained = false;
+    }
+    return drained;
+}
@@ -0,0 +1,67 @@
+/*
+ * Unix-domain-socket fan-out of the binary event stream
+ *
+ * With --socket=PATH the reader also serves its device records to any
+ * number of local clients (up to MAX_CLIENTS) over a stream socket, next
+ * to the port. A tool, a second VM or a game engine can follow the device
+ * without owning it: each report is read and decoded once, encoded once by
+ * the port protocol, and the same bytes are queued for every client.
+ *
+ * Clients receive the binary records of port_protocol.h with the same
+ * 2-byte big-endian length prefix as {:packet, 2}, whatever --protocol the
+ * port uses: STATUS device_connected/device_disconnected, MOTION, BUTTONS
+ * and LED. A new client first gets a device_connected record for every
+ * device attached at that moment. Bytes sent by clients are ignored.
+ *
+ * Every client has its own bounded queue and is written without blocking,
+ * so a slow client never delays the port or the other clients:
+ *
+ * - latest wins: while a client's socket is full, each device's queued
+ *   frame is replaced by the newer one (the older one is superseded anyway)
+ * - status, buttons and LED records are kept, in order
+ * - a client whose queue still fills up is disconnected, rather than
+ *   silently missing a button edge; it can reconnect and start over
+ *
+ * The socket is created when the reader starts (a stale socket at PATH is
+ * replaced) and unlinked when it exits. Access is governed by the file
+ * permissions of PATH.
+ *
+ * The reader's event loop owns the file descriptors: it watches the
+ * listening socket and every client for input, and a client for output
+ * while event_server_client_pending() says it has queued records.
+ */
+
+#ifndef EVENT_SERVER_H
+#define EVENT_SERVER_H
+
+#include <stdbool.h>
+
+#include "port_protocol.h"
+
+#define MAX_CLIENTS 16
+
+// Parse --socket=PATH and start listening. Returns false (after printing
+// to stderr) if it was requested but cannot be set up. Without --socket
+// everything below does nothing.
+bool event_server_init(int argc, char *argv[]);
+void event_server_close(void);
+
+// Listening socket, -1 when the server is disabled
+int event_server_listen_fd(void);
+
+// Accept one pending connection. Returns the new client's index, or -1
+// when there is nothing (more) to accept.
+int event_server_accept(void);
+
+// Socket of client index, -1 if that slot is unused. A client is closed by
+// the functions below when it hangs up or falls too far behind, so the
+// loop should look its socket up again instead of keeping a copy.
+int event_server_client_fd(int client);
+void event_server_client_readable(int client);
+bool event_server_client_pending(int client);
+
+// Write as much queued output to every client as its socket takes without
+// blocking. Returns true once every queue is empty.
+bool event_server_flush(void);
+
+#endif /* EVENT_SERVER_H */
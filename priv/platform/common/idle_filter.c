@@ -0,0 +1,85 @@
+/*
+ * Idle suppression: emit motion only when it changes (see idle_filter.h)
+ */
+
+#include "idle_filter.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static bool enabled = true;
+static int32_t epsilon = 0;
+static uint64_t keepalive_us = 0;
+
+bool idle_filter_configure(const char *spec)
+{
+    if (strcmp(spec, "off") == 0)
+    {
+        enabled = false;
+        return true;
+    }
+
+    char *end;
+    long parsed_epsilon = strtol(spec, &end, 10);
+    long parsed_keepalive = 0;
+    if (end == spec || parsed_epsilon < 0 || parsed_epsilon > 1000)
+        return false;
+    if (*end == ':')
+    {
+        const char *keepalive = end + 1;
+        parsed_keepalive = strtol(keepalive, &end, 10);
+        if (end == keepalive || parsed_keepalive < 0 || parsed_keepalive > 3600000)
+            return false;
+    }
+    if (*end != '\0')
+        return false;
+
+    enabled = true;
+    epsilon = (int32_t)parsed_epsilon;
+    keepalive_us = (uint64_t)parsed_keepalive * 1000u;
+    return true;
+}
+
+bool idle_filter_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--idle-filter=", 14) == 0 && !idle_filter_configure(argv[i] + 14))
+        {
+            fprintf(stderr, "ERROR: Invalid idle filter setting %s\n", argv[i] + 14);
+            return false;
+        }
+    }
+    return true;
+}
+
+void idle_filter_reset(struct idle_filter *filter)
+{
+    memset(filter, 0, sizeof(*filter));
+}
+
+bool idle_filter_pass(struct idle_filter *filter, int16_t frame[6], uint64_t timestamp_us)
+{
+    if (!enabled)
+        return true;
+
+    bool at_rest = true;
+    for (int axis = 0; axis < 6; axis++)
+        at_rest = at_rest && abs(frame[axis]) <= epsilon;
+    if (at_rest)
+        memset(frame, 0, 6 * sizeof(int16_t));
+
+    bool changed = !filter->emitted;
+    for (int axis = 0; axis < 6 && !changed; axis++)
+        changed = at_rest ? filter->last[axis] != 0 : abs(frame[axis] - filter->last[axis]) > epsilon;
+
+    bool keepalive = keepalive_us > 0 && timestamp_us - filter->last_emit_us >= keepalive_us;
+    if (!changed && !keepalive)
+        return false;
+
+    filter->emitted = true;
+    memcpy(filter->last, frame, 6 * sizeof(int16_t));
+    filter->last_emit_us = timestamp_us;
+    return true;
+}
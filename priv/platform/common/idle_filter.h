@@ -0,0 +1,53 @@
+/*
+ * Idle suppression: emit motion only when it changes
+ *
+ * A released cap keeps reporting zero or near-zero frames, and each one
+ * used to travel through the port, the Elixir device process and every
+ * subscriber. The filter sits at the end of the decode path (after
+ * calibration and curves) and passes a frame only when it differs from the
+ * last emitted frame of that device by more than EPSILON counts on some
+ * axis. A frame within EPSILON of zero on every axis is the cap at rest: it
+ * is sent once, as an explicit all-zero frame, and then suppressed until
+ * the cap moves again. Consumers may therefore treat the last frame as
+ * valid until the next one arrives.
+ *
+ *   --idle-filter=0           EPSILON[:KEEPALIVE_MS]; the default drops
+ *                             exact repeats and repeated rest frames
+ *   --idle-filter=2:1000      also ignore changes of up to 2 counts, and
+ *                             re-send the current frame at least every
+ *                             second while reports keep arriving
+ *   --idle-filter=off         emit every frame
+ *
+ * The keepalive is driven by incoming reports, not by a timer: a device
+ * that stops reporting altogether stays silent.
+ */
+
+#ifndef IDLE_FILTER_H
+#define IDLE_FILTER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Per-device state; all zero is a valid start (nothing emitted yet)
+struct idle_filter
+{
+    bool emitted;
+    int16_t last[6];
+    uint64_t last_emit_us;
+};
+
+// Parse --idle-filter= (if present). Returns false (after printing to
+// stderr) for an invalid value.
+bool idle_filter_init(int argc, char *argv[]);
+
+// Set the filter from an "EPSILON[:KEEPALIVE_MS]" or "off" spec
+bool idle_filter_configure(const char *spec);
+
+// Forget the last emitted frame, e.g. when a device attaches
+void idle_filter_reset(struct idle_filter *filter);
+
+// Decide whether frame is emitted. A rest frame is zeroed in place; on
+// true the frame becomes the last emitted one.
+bool idle_filter_pass(struct idle_filter *filter, int16_t frame[6], uint64_t timestamp_us);
+
+#endif /* IDLE_FILTER_H */
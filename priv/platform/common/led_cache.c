@@ -0,0 +1,134 @@
+/*
+ * LED method cache (see led_cache.h)
+ */
+
+#include "led_cache.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Distinct SpaceMouse models one reader will realistically see
+#define CACHE_SLOTS 16
+
+struct led_cache_entry
+{
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint8_t method; // 0: slot unused
+};
+
+static struct led_cache_entry cache[CACHE_SLOTS];
+static const char *cache_path = NULL;
+
+static struct led_cache_entry *find_entry(uint16_t vendor_id, uint16_t product_id)
+{
+    for (int i = 0; i < CACHE_SLOTS; i++)
+    {
+        if (cache[i].method && cache[i].vendor_id == vendor_id && cache[i].product_id == product_id)
+            return &cache[i];
+    }
+    return NULL;
+}
+
+static void save_cache(void)
+{
+    if (!cache_path)
+        return;
+
+    FILE *file = fopen(cache_path, "w");
+    if (!file)
+        return; // Best effort: the in-memory cache still works
+
+    for (int i = 0; i < CACHE_SLOTS; i++)
+    {
+        if (cache[i].method)
+            fprintf(file, "%04x:%04x=%d\n", cache[i].vendor_id, cache[i].product_id, cache[i].method);
+    }
+
+    fclose(file);
+}
+
+// Remember (method > 0) or forget (method == 0) the model's method
+static void store(uint16_t vendor_id, uint16_t product_id, int method)
+{
+    struct led_cache_entry *entry = find_entry(vendor_id, product_id);
+
+    if (!entry && method)
+    {
+        for (int i = 0; i < CACHE_SLOTS && !entry; i++)
+        {
+            if (!cache[i].method)
+                entry = &cache[i];
+        }
+        if (!entry)
+            entry = &cache[0]; // Full: recycle; a probe re-learns it
+    }
+
+    if (!entry || entry->method == method)
+        return;
+
+    entry->vendor_id = vendor_id;
+    entry->product_id = product_id;
+    entry->method = (uint8_t)method;
+    save_cache();
+}
+
+void led_cache_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--led-cache=", 12) == 0)
+            cache_path = argv[i] + 12;
+    }
+
+    if (!cache_path)
+        return;
+
+    FILE *file = fopen(cache_path, "r");
+    if (!file)
+        return; // First run: created on the first successful probe
+
+    unsigned int vendor_id, product_id;
+    int method;
+    int slot = 0;
+
+    while (slot < CACHE_SLOTS && fscanf(file, "%x:%x=%d", &vendor_id, &product_id, &method) == 3)
+    {
+        if (method >= 1 && method <= LED_METHOD_COUNT)
+        {
+            cache[slot].vendor_id = (uint16_t)vendor_id;
+            cache[slot].product_id = (uint16_t)product_id;
+            cache[slot].method = (uint8_t)method;
+            slot++;
+        }
+    }
+
+    fclose(file);
+}
+
+int led_cache_lookup(uint16_t vendor_id, uint16_t product_id)
+{
+    struct led_cache_entry *entry = find_entry(vendor_id, product_id);
+    return entry ? entry->method : 0;
+}
+
+int led_cache_send(uint16_t vendor_id, uint16_t product_id,
+                   led_method_fn try_method, void *device, bool on)
+{
+    int cached = led_cache_lookup(vendor_id, product_id);
+
+    if (cached && try_method(device, cached, on))
+        return cached;
+
+    for (int method = 1; method <= LED_METHOD_COUNT; method++)
+    {
+        if (method != cached && try_method(device, method, on))
+        {
+            store(vendor_id, product_id, method);
+            return method;
+        }
+    }
+
+    store(vendor_id, product_id, 0);
+    return 0;
+}
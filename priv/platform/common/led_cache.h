@@ -0,0 +1,37 @@
+/*
+ * LED method cache shared by the native readers
+ *
+ * SpaceMouse models disagree on which report switches the LED, so each
+ * reader knows several methods (try_led_method()). Probing them costs one
+ * synchronous transfer per failed method. The first method that works is
+ * remembered per VID/PID; from then on an LED toggle is a single transfer,
+ * falling back to a full probe only if the cached method stops working.
+ *
+ * The table lives as long as the reader, so it survives reconnects. With
+ * --led-cache=PATH it is also loaded at start and rewritten whenever it
+ * changes, one "vvvv:pppp=N" line per model, so it survives restarts.
+ */
+
+#ifndef LED_CACHE_H
+#define LED_CACHE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define LED_METHOD_COUNT 4
+
+// Try one LED method on device; true if the transfer succeeded
+typedef bool (*led_method_fn)(void *device, int method, bool on);
+
+// Parse --led-cache=PATH and load the file if it exists
+void led_cache_init(int argc, char *argv[]);
+
+// Cached method for the model, 0 if unknown
+int led_cache_lookup(uint16_t vendor_id, uint16_t product_id);
+
+// Set the LED: cached method first, full probe only when that fails.
+// Returns the method that worked (and is now cached), or 0.
+int led_cache_send(uint16_t vendor_id, uint16_t product_id,
+                   led_method_fn try_method, void *device, bool on);
+
+#endif /* LED_CACHE_H */
@@ -0,0 +1,527 @@
+/*
+ * Port protocol shared by the native readers (see port_protocol.h)
+ *
+ * Output is never written from the event callbacks. Every record is queued
+ * in a fixed ring of slots and the event loop calls protocol_flush() once
+ * per iteration, which hands everything queued to a single writev() on the
+ * non-blocking stdout. If the VM falls behind and the pipe fills up:
+ *
+ * - the reader keeps running; nothing ever blocks on stdout
+ * - each device's queued motion collapses into its newest frame (older
+ *   frames are superseded anyway)
+ * - status, buttons and LED records are always kept, in order
+ */
+
+#include "port_protocol.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#define MAX_RECORD_SIZE 256
+#define MAX_COMMAND_SIZE 256
+
+// Output ring: must be a power of two
+#define OUTPUT_SLOTS 1024
+#define MAX_IOV 64
+
+enum slot_kind
+{
+    SLOT_EVENT = 0,  // Must be delivered
+    SLOT_MOTION = 1, // May be superseded by a newer frame
+    SLOT_DROPPED = 2 // Superseded; skipped by the flush
+};
+
+struct output_slot
+{
+    uint16_t length;
+    uint8_t kind;
+    uint8_t device; // Owner of a SLOT_MOTION frame
+    uint8_t bytes[MAX_RECORD_SIZE + 2];
+};
+
+static bool binary_mode = true;
+
+// Output ring state. head is the next slot to write, tail the next free one.
+static struct output_slot output_ring[OUTPUT_SLOTS];
+static size_t output_head = 0;
+static size_t output_tail = 0;
+static size_t head_offset = 0; // Bytes of the head slot already written
+static size_t last_motion[MAX_DEVICES + 1]; // Pending motion slot per device
+static bool output_blocked = false;
+static unsigned long overflow_count = 0;
+
+// Extra consumer of device records (see protocol_set_record_sink)
+static record_sink sink = NULL;
+
+// Pending command bytes that do not yet form a complete command
+static uint8_t command_buffer[MAX_COMMAND_SIZE];
+static size_t command_length = 0;
+// Bytes of an oversized binary packet still to be discarded
+static size_t command_skip = 0;
+// Rest of an overlong text line still to be discarded, up to its newline
+static bool command_skip_line = false;
+
+static const char *status_names[] = {
+    [STATUS_READY] = "ready",
+    [STATUS_DEVICE_CONNECTED] = "device_connected",
+    [STATUS_DEVICE_DISCONNECTED] = "device_disconnected",
+};
+
+static size_t *pending_motion(uint8_t device)
+{
+    return &last_motion[device <= MAX_DEVICES ? device : 0];
+}
+
+void protocol_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--protocol=binary") == 0)
+            binary_mode = true;
+        else if (strcmp(argv[i], "--protocol=text") == 0)
+            binary_mode = false;
+    }
+
+    for (size_t i = 0; i <= MAX_DEVICES; i++)
+        last_motion[i] = OUTPUT_SLOTS;
+
+    // The reader must never block on a slow VM
+    int flags = fcntl(STDOUT_FILENO, F_GETFL);
+    if (flags >= 0)
+        fcntl(STDOUT_FILENO, F_SETFL, flags | O_NONBLOCK);
+}
+
+void protocol_set_record_sink(record_sink new_sink)
+{
+    sink = new_sink;
+}
+
+static size_t queued_slots(void)
+{
+    return (output_tail - output_head) & (OUTPUT_SLOTS - 1);
+}
+
+// Queue one record; binary payloads get their length prefix here. device
+// only matters for SLOT_MOTION.
+static void enqueue(enum slot_kind kind, uint8_t device, const void *bytes, size_t length)
+{
+    if (length > MAX_RECORD_SIZE)
+        length = MAX_RECORD_SIZE;
+
+    size_t index = output_tail;
+    size_t *last = pending_motion(device);
+
+    // Under backpressure a new frame replaces the same device's queued one.
+    // The head slot is only replaceable while none of it has been written.
+    if (kind == SLOT_MOTION && output_blocked && *last != OUTPUT_SLOTS &&
+        (*last != output_head || head_offset == 0))
+    {
+        if (*last == ((output_tail - 1) & (OUTPUT_SLOTS - 1)))
+            index = *last; // Nothing queued since: overwrite in place
+        else
+            output_ring[*last].kind = SLOT_DROPPED;
+    }
+
+    if (index == output_tail && queued_slots() == OUTPUT_SLOTS - 1)
+    {
+        // Ring full of undeliverable records: drop this one and say so later
+        overflow_count++;
+        return;
+    }
+
+    struct output_slot *slot = &output_ring[index];
+    size_t offset = 0;
+
+    if (binary_mode)
+    {
+        slot->bytes[0] = (uint8_t)(length >> 8);
+        slot->bytes[1] = (uint8_t)length;
+        offset = 2;
+    }
+
+    memcpy(slot->bytes + offset, bytes, length);
+    slot->length = (uint16_t)(offset + length);
+    slot->kind = (uint8_t)kind;
+    slot->device = device;
+
+    if (kind == SLOT_MOTION)
+        *last = index;
+
+    if (index == output_tail)
+        output_tail = (output_tail + 1) & (OUTPUT_SLOTS - 1);
+}
+
+// Queue one text-mode line
+static void enqueue_line(enum slot_kind kind, uint8_t device, const char *format, ...) __attribute__((format(printf, 3, 4)));
+
+static void enqueue_line(enum slot_kind kind, uint8_t device, const char *format, ...)
+{
+    char line[MAX_RECORD_SIZE];
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf(line, sizeof(line) - 1, format, args);
+    va_end(args);
+
+    if (length < 0)
+        return;
+    if ((size_t)length > sizeof(line) - 2)
+        length = (int)(sizeof(line) - 2);
+
+    line[length++] = '\n';
+    enqueue(kind, device, line, (size_t)length);
+}
+
+static void put_le16(uint8_t *bytes, uint16_t value)
+{
+    bytes[0] = (uint8_t)(value & 0xFF);
+    bytes[1] = (uint8_t)(value >> 8);
+}
+
+static void put_le32(uint8_t *bytes, uint32_t value)
+{
+    for (int i = 0; i < 4; i++)
+        bytes[i] = (uint8_t)(value >> (i * 8));
+}
+
+static void put_le64(uint8_t *bytes, uint64_t value)
+{
+    for (int i = 0; i < 8; i++)
+        bytes[i] = (uint8_t)(value >> (i * 8));
+}
+
+void protocol_status(enum status_code code)
+{
+    if (binary_mode)
+    {
+        uint8_t record[2] = {RECORD_STATUS, (uint8_t)code};
+        enqueue(SLOT_EVENT, 0, record, sizeof(record));
+    }
+    else
+    {
+        enqueue_line(SLOT_EVENT, 0, "STATUS:%s", status_names[code]);
+    }
+}
+
+void protocol_info(const char *format, ...)
+{
+    uint8_t record[MAX_RECORD_SIZE] = {RECORD_STATUS, STATUS_INFO};
+    va_list args;
+
+    va_start(args, format);
+    int length = vsnprintf((char *)record + 2, sizeof(record) - 2, format, args);
+    va_end(args);
+
+    if (length < 0)
+        return;
+    if ((size_t)length > sizeof(record) - 3)
+        length = (int)(sizeof(record) - 3);
+
+    if (binary_mode)
+        enqueue(SLOT_EVENT, 0, record, (size_t)length + 2);
+    else
+        enqueue_line(SLOT_EVENT, 0, "STATUS:%s", (char *)record + 2);
+}
+
+// Binary records of device events also go to the record sink, encoded once
+// whatever the port's mode
+static void emit(enum slot_kind kind, uint8_t device, const uint8_t *record, size_t length)
+{
+    if (binary_mode)
+        enqueue(kind, device, record, length);
+    if (sink)
+        sink(device, kind == SLOT_MOTION, record, length);
+}
+
+void protocol_device_connected(uint8_t device, uint16_t vendor_id, uint16_t product_id)
+{
+    uint8_t record[7] = {RECORD_STATUS, STATUS_DEVICE_CONNECTED, device};
+    put_le16(record + 3, vendor_id);
+    put_le16(record + 5, product_id);
+    emit(SLOT_EVENT, device, record, sizeof(record));
+
+    if (!binary_mode)
+    {
+        enqueue_line(SLOT_EVENT, device, "STATUS:%s,device=%d,vid=%04x,pid=%04x",
+                     status_names[STATUS_DEVICE_CONNECTED], device, vendor_id, product_id);
+    }
+}
+
+void protocol_device_disconnected(uint8_t device)
+{
+    // A disconnected device's pending frame must not outlive it in the queue
+    *pending_motion(device) = OUTPUT_SLOTS;
+
+    uint8_t record[3] = {RECORD_STATUS, STATUS_DEVICE_DISCONNECTED, device};
+    emit(SLOT_EVENT, device, record, sizeof(record));
+
+    if (!binary_mode)
+        enqueue_line(SLOT_EVENT, device, "STATUS:%s,device=%d", status_names[STATUS_DEVICE_DISCONNECTED], device);
+}
+
+void protocol_motion(uint8_t device, uint64_t timestamp_us, const int16_t frame[6])
+{
+    uint8_t record[22] = {RECORD_MOTION, device};
+    put_le64(record + 2, timestamp_us);
+    for (int i = 0; i < 6; i++)
+        put_le16(record + 10 + i * 2, (uint16_t)frame[i]);
+    emit(SLOT_MOTION, device, record, sizeof(record));
+
+    if (!binary_mode)
+    {
+        enqueue_line(SLOT_MOTION, device, "MOTION:device=%d,t=%llu,x=%d,y=%d,z=%d,rx=%d,ry=%d,rz=%d",
+                     device, (unsigned long long)timestamp_us,
+                     frame[0], frame[1], frame[2], frame[3], frame[4], frame[5]);
+    }
+}
+
+void protocol_buttons(uint8_t device, uint64_t timestamp_us, uint32_t buttons, uint32_t changed)
+{
+    uint8_t record[18] = {RECORD_BUTTONS, device};
+    put_le64(record + 2, timestamp_us);
+    put_le32(record + 10, buttons);
+    put_le32(record + 14, changed);
+    emit(SLOT_EVENT, device, record, sizeof(record));
+
+    if (!binary_mode)
+    {
+        enqueue_line(SLOT_EVENT, device, "BUTTONS:device=%d,t=%llu,buttons=%x,changed=%x",
+                     device, (unsigned long long)timestamp_us, buttons, changed);
+    }
+}
+
+void protocol_led(uint8_t device, bool on, int method)
+{
+    uint8_t record[4] = {RECORD_LED, device, on ? 1 : 0, (uint8_t)method};
+    emit(SLOT_EVENT, device, record, sizeof(record));
+
+    if (!binary_mode)
+        enqueue_line(SLOT_EVENT, device, "LED:device=%d,state=%s,method=%d", device, on ? "on" : "off", method);
+}
+
+bool protocol_parse_led_args(const char *args, uint8_t *device, bool *on)
+{
+    const char *state = args;
+    char *end;
+
+    *device = 0;
+
+    long id = strtol(args, &end, 10);
+    if (end != args && *end == ':')
+    {
+        if (id < 1 || id > MAX_DEVICES)
+            return false;
+        *device = (uint8_t)id;
+        state = end + 1;
+    }
+
+    if (strcmp(state, "on") == 0)
+        *on = true;
+    else if (strcmp(state, "off") == 0)
+        *on = false;
+    else
+        return false;
+
+    return true;
+}
+
+bool protocol_parse_calibrate(const char *command, uint8_t *device)
+{
+    char *end;
+
+    *device = 0;
+    if (strcmp(command, "CALIBRATE") == 0)
+        return true;
+    if (strncmp(command, "CALIBRATE:", 10) != 0)
+        return false;
+
+    long id = strtol(command + 10, &end, 10);
+    if (end == command + 10 || *end != '\0' || id < 1 || id > MAX_DEVICES)
+        return false;
+    *device = (uint8_t)id;
+    return true;
+}
+
+// Advance the head past fully written and dropped slots
+static void consume_output(size_t written)
+{
+    while (output_head != output_tail)
+    {
+        struct output_slot *slot = &output_ring[output_head];
+
+        if (slot->kind != SLOT_DROPPED)
+        {
+            size_t remaining = slot->length - head_offset;
+            if (written < remaining)
+            {
+                head_offset += written;
+                return;
+            }
+            written -= remaining;
+        }
+
+        size_t *last = pending_motion(slot->device);
+        if (output_head == *last)
+            *last = OUTPUT_SLOTS;
+
+        head_offset = 0;
+        output_head = (output_head + 1) & (OUTPUT_SLOTS - 1);
+    }
+}
+
+bool protocol_flush(void)
+{
+    if (overflow_count > 0 && queued_slots() < OUTPUT_SLOTS / 2)
+    {
+        unsigned long dropped = overflow_count;
+        overflow_count = 0;
+        protocol_info("output_overflow=%lu", dropped);
+    }
+
+    while (output_head != output_tail)
+    {
+        struct iovec iov[MAX_IOV];
+        int count = 0;
+        size_t offset = head_offset;
+
+        for (size_t i = output_head; i != output_tail && count < MAX_IOV; i = (i + 1) & (OUTPUT_SLOTS - 1))
+        {
+            struct output_slot *slot = &output_ring[i];
+            if (slot->kind == SLOT_DROPPED)
+                continue;
+
+            iov[count].iov_base = slot->bytes + offset;
+            iov[count].iov_len = slot->length - offset;
+            count++;
+            offset = 0;
+        }
+
+        if (count == 0)
+        {
+            // Only dropped slots were left
+            consume_output(0);
+            break;
+        }
+
+        ssize_t written = writev(STDOUT_FILENO, iov, count);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            // EAGAIN: pipe full. Anything else: the port is gone and the
+            // stdin EOF will end the loop shortly.
+            output_blocked = true;
+            return false;
+        }
+
+        consume_output((size_t)written);
+    }
+
+    output_blocked = false;
+    return true;
+}
+
+bool protocol_output_pending(void)
+{
+    return output_head != output_tail;
+}
+
+// Split buffered bytes into commands; returns bytes consumed
+static size_t dispatch_commands(command_handler handler)
+{
+    size_t offset = 0;
+    char command[MAX_COMMAND_SIZE];
+
+    while (offset < command_length)
+    {
+        const uint8_t *start = command_buffer + offset;
+        size_t available = command_length - offset;
+        size_t length;
+        size_t consumed;
+
+        if (command_skip > 0)
+        {
+            size_t skipped = available < command_skip ? available : command_skip;
+            command_skip -= skipped;
+            offset += skipped;
+            continue;
+        }
+
+        if (command_skip_line)
+        {
+            const uint8_t *newline = memchr(start, '\n', available);
+            command_skip_line = newline == NULL;
+            offset += newline ? (size_t)(newline - start) + 1 : available;
+            continue;
+        }
+
+        if (binary_mode)
+        {
+            if (available < 2)
+                break;
+            length = ((size_t)start[0] << 8) | start[1];
+            // Can never complete in the buffer: drop exactly this packet,
+            // across reads if need be, so the next header is read in frame
+            if (length > sizeof(command_buffer) - 2)
+            {
+                command_skip = 2 + length;
+                continue;
+            }
+            if (available < 2 + length)
+                break;
+            start += 2;
+            consumed = 2 + length;
+        }
+        else
+        {
+            const uint8_t *newline = memchr(start, '\n', available);
+            if (!newline)
+                break;
+            length = (size_t)(newline - start);
+            consumed = length + 1;
+        }
+
+        if (length >= sizeof(command))
+            length = sizeof(command) - 1;
+        memcpy(command, start, length);
+        command[length] = '\0';
+
+        handler(command);
+        offset += consumed;
+    }
+
+    return offset;
+}
+
+bool protocol_read_commands(int fd, command_handler handler)
+{
+    ssize_t count = read(fd, command_buffer + command_length, sizeof(command_buffer) - command_length);
+
+    if (count == 0)
+        return false; // Port closed by the VM
+    if (count < 0)
+        return errno == EINTR || errno == EAGAIN;
+
+    command_length += (size_t)count;
+
+    size_t consumed = dispatch_commands(handler);
+    command_length -= consumed;
+    memmove(command_buffer, command_buffer + consumed, command_length);
+
+    // A full buffer with no complete command is an overlong text line
+    // (binary packets that cannot fit are skipped above); drop it, and
+    // whatever of it is still to come
+    if (command_length == sizeof(command_buffer))
+    {
+        command_length = 0;
+        command_skip_line = true;
+    }
+
+    return true;
+}
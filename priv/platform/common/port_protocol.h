@@ -0,0 +1,108 @@
+/*
+ * Port protocol shared by the native readers
+ *
+ * The reader talks to SpaceMouse.Platform.PortManager in one of two modes,
+ * chosen by the port on the command line:
+ *
+ *   --protocol=binary   {:packet, 2} framing, fixed-layout records (the
+ *                       default, and what PortManager uses)
+ *   --protocol=text     "TYPE:key=value" lines, kept for debugging by hand
+ *
+ * Binary records (payload after the 2-byte big-endian length prefix,
+ * multi-byte fields little-endian). dev is the reader's device ID (1-based,
+ * stable for a physical device while the reader runs, see device_ids.h).
+ * t is the report's capture time in microseconds on the reader's monotonic
+ * clock (IOHID timestamp on macOS, CLOCK_MONOTONIC at read() on Linux):
+ *
+ *   STATUS  0x01 code:u8 detail:bytes     code 1 ready, 255 info (detail
+ *                                         holds the text)
+ *           0x01 0x02 dev:u8 vid:u16 pid:u16   device_connected
+ *           0x01 0x03 dev:u8                   device_disconnected
+ *   MOTION  0x02 dev:u8 t:u64 x y z rx ry rz:i16
+ *   BUTTONS 0x03 dev:u8 t:u64 buttons:u32 changed:u32
+ *   LED     0x04 dev:u8 on:u8 method:u8
+ *
+ * BUTTONS carries the full button bitmask after a report (bit 0 is button
+ * 1) and the bits that report changed, so a chord arrives as one record.
+ * It is only sent when changed is non-zero.
+ *
+ * Output is queued, not written: the reader's event loop calls
+ * protocol_flush() once per iteration, and stdout is non-blocking. When the
+ * pipe is full, each device's queued motion collapses into its latest frame
+ * while status, buttons and LED records are kept.
+ *
+ * Commands from the port use the same framing as the output: newline
+ * terminated lines in text mode, length-prefixed packets in binary mode.
+ * A command too long for the buffer is dropped whole: a text line up to
+ * its newline, a packet up to the length its header gives.
+ * The command payload is text in both modes: "LED:on" / "LED:off" address
+ * every device, "LED:<dev>:on" / "LED:<dev>:off" a single one.
+ * "CALIBRATE" / "CALIBRATE:<dev>" take the current frame as the zero point
+ * (see calibration.h).
+ */
+
+#ifndef PORT_PROTOCOL_H
+#define PORT_PROTOCOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define RECORD_STATUS 0x01
+#define RECORD_MOTION 0x02
+#define RECORD_BUTTONS 0x03
+#define RECORD_LED 0x04
+
+// Device IDs are 1..MAX_DEVICES
+#define MAX_DEVICES 8
+
+enum status_code
+{
+    STATUS_READY = 1,
+    STATUS_DEVICE_CONNECTED = 2,
+    STATUS_DEVICE_DISCONNECTED = 3,
+    STATUS_INFO = 255
+};
+
+typedef void (*command_handler)(const char *command);
+
+// Receives the binary record (without length prefix) of every device
+// event: device_connected, device_disconnected, MOTION, BUTTONS and LED.
+// Called in either mode, so a second consumer (see event_server.h) shares
+// the encoding instead of repeating it.
+typedef void (*record_sink)(uint8_t device, bool motion, const uint8_t *record, size_t length);
+
+// Select the protocol from argv (--protocol=binary|text, binary by default)
+void protocol_init(int argc, char *argv[]);
+
+void protocol_status(enum status_code code);
+void protocol_info(const char *format, ...) __attribute__((format(printf, 1, 2)));
+void protocol_device_connected(uint8_t device, uint16_t vendor_id, uint16_t product_id);
+void protocol_device_disconnected(uint8_t device);
+void protocol_motion(uint8_t device, uint64_t timestamp_us, const int16_t frame[6]);
+void protocol_buttons(uint8_t device, uint64_t timestamp_us, uint32_t buttons, uint32_t changed);
+void protocol_led(uint8_t device, bool on, int method);
+
+// Install (or with NULL remove) the record sink
+void protocol_set_record_sink(record_sink sink);
+
+// Parse the arguments of an LED command ("on", "off", "<dev>:on" or
+// "<dev>:off"). device is 0 when every device is addressed. Returns false
+// for anything else.
+bool protocol_parse_led_args(const char *args, uint8_t *device, bool *on);
+
+// Parse a calibrate command ("CALIBRATE" or "CALIBRATE:<dev>"). device is
+// 0 when every device is addressed. Returns false for anything else.
+bool protocol_parse_calibrate(const char *command, uint8_t *device);
+
+// Write as much queued output as the pipe takes without blocking, in a
+// single writev() per batch. Returns true once the queue is empty; when it
+// returns false the caller should wait for stdout to become writable.
+bool protocol_flush(void);
+bool protocol_output_pending(void);
+
+// Read pending command bytes from fd and dispatch every complete command.
+// Returns false once the port has closed the pipe.
+bool protocol_read_commands(int fd, command_handler handler);
+
+#endif /* PORT_PROTOCOL_H */
@@ -0,0 +1,319 @@
+/*
+ * HID report descriptor parser (see report_descriptor.h)
+ *
+ * Follows the item model of the HID 1.11 specification (section 6.2.2):
+ * global items persist until changed (Push/Pop save and restore them),
+ * local items apply to the next main item only. Only Input main items
+ * produce fields.
+ */
+
+#include "report_descriptor.h"
+
+#include <string.h>
+
+#define MAX_USAGES 64
+#define MAX_GLOBAL_STACK 4
+
+// Item types and tags
+#define ITEM_MAIN 0
+#define ITEM_GLOBAL 1
+#define ITEM_LOCAL 2
+#define ITEM_LONG 0xFE
+
+#define MAIN_INPUT 0x8
+
+#define GLOBAL_USAGE_PAGE 0x0
+#define GLOBAL_LOGICAL_MINIMUM 0x1
+#define GLOBAL_REPORT_SIZE 0x7
+#define GLOBAL_REPORT_ID 0x8
+#define GLOBAL_REPORT_COUNT 0x9
+#define GLOBAL_PUSH 0xA
+#define GLOBAL_POP 0xB
+
+#define LOCAL_USAGE 0x0
+#define LOCAL_USAGE_MINIMUM 0x1
+#define LOCAL_USAGE_MAXIMUM 0x2
+
+// Input item flags
+#define INPUT_CONSTANT 0x01
+#define INPUT_VARIABLE 0x02
+
+#define USAGE_PAGE_GENERIC_DESKTOP 0x01
+#define USAGE_PAGE_BUTTON 0x09
+#define USAGE_X 0x30
+#define USAGE_RZ 0x35
+
+struct global_state
+{
+    uint16_t usage_page;
+    int32_t logical_minimum;
+    uint32_t report_size;
+    uint32_t report_count;
+    uint8_t report_id;
+};
+
+struct local_state
+{
+    uint32_t usages[MAX_USAGES]; // page << 16 | usage
+    int usage_count;
+    uint32_t usage_minimum;
+    uint32_t usage_maximum;
+    bool has_range;
+};
+
+// A field before grouping by report ID
+struct pending_field
+{
+    uint8_t report_id;
+    struct report_field field;
+};
+
+struct parser
+{
+    struct pending_field fields[REPORT_MAX_FIELDS];
+    int field_count;
+    uint16_t bit_offsets[256]; // next free input bit per report ID
+};
+
+// Usage of the index-th value of an Input item: explicit usages first,
+// then the Usage Minimum..Maximum range; the last usage repeats
+static uint32_t value_usage(const struct local_state *local, uint32_t index)
+{
+    if (index < (uint32_t)local->usage_count)
+        return local->usages[index];
+
+    if (local->has_range)
+    {
+        uint32_t usage = local->usage_minimum + (index - (uint32_t)local->usage_count);
+        return usage <= local->usage_maximum ? usage : local->usage_maximum;
+    }
+
+    return local->usage_count ? local->usages[local->usage_count - 1] : 0;
+}
+
+// Record one value if it is an axis or a button; runs of 1-bit buttons
+// are merged into a single field
+static void add_field(struct parser *parser, uint8_t report_id, uint32_t usage,
+                      uint32_t bit_offset, uint32_t bit_size, bool is_signed)
+{
+    uint16_t page = (uint16_t)(usage >> 16);
+    uint16_t id = (uint16_t)usage;
+    struct report_field field = {
+        .bit_offset = (uint16_t)bit_offset,
+        .bit_size = (uint8_t)bit_size,
+        .count = 1,
+        .is_signed = is_signed,
+    };
+
+    if (bit_size == 0 || bit_size > 32 || bit_offset > UINT16_MAX)
+        return;
+
+    if (page == USAGE_PAGE_GENERIC_DESKTOP && id >= USAGE_X && id <= USAGE_RZ)
+    {
+        field.kind = FIELD_AXIS;
+        field.index = (uint8_t)(id - USAGE_X);
+    }
+    else if (page == USAGE_PAGE_BUTTON && id >= 1 && id <= 32)
+    {
+        field.kind = FIELD_BUTTONS;
+        field.index = (uint8_t)(id - 1);
+    }
+    else
+    {
+        return;
+    }
+
+    if (parser->field_count > 0 && field.kind == FIELD_BUTTONS && bit_size == 1)
+    {
+        struct pending_field *last = &parser->fields[parser->field_count - 1];
+        struct report_field *previous = &last->field;
+
+        if (last->report_id == report_id && previous->kind == FIELD_BUTTONS && previous->bit_size == 1 &&
+            previous->bit_offset + previous->count == field.bit_offset &&
+            previous->index + previous->count == field.index)
+        {
+            previous->count++;
+            return;
+        }
+    }
+
+    if (parser->field_count < REPORT_MAX_FIELDS)
+    {
+        parser->fields[parser->field_count].report_id = report_id;
+        parser->fields[parser->field_count].field = field;
+        parser->field_count++;
+    }
+}
+
+static void parse_input(struct parser *parser, const struct global_state *global,
+                        const struct local_state *local, uint32_t flags)
+{
+    uint32_t offset = parser->bit_offsets[global->report_id];
+
+    // Constant items are padding; array items (selectors) never carry
+    // SpaceMouse axes or buttons
+    if (!(flags & INPUT_CONSTANT) && (flags & INPUT_VARIABLE))
+    {
+        for (uint32_t i = 0; i < global->report_count && i < 256; i++)
+        {
+            add_field(parser, global->report_id, value_usage(local, i),
+                      offset + i * global->report_size, global->report_size,
+                      global->logical_minimum < 0);
+        }
+    }
+
+    uint32_t end = offset + global->report_size * global->report_count;
+    parser->bit_offsets[global->report_id] = (uint16_t)(end > UINT16_MAX ? UINT16_MAX : end);
+}
+
+// Group the pending fields by report ID into layouts
+static void build_layouts(struct report_table *table, const struct parser *parser)
+{
+    for (int i = 0; i < parser->field_count; i++)
+    {
+        uint8_t report_id = parser->fields[i].report_id;
+
+        if (table->layout_index[report_id] >= 0)
+            continue;
+        if (table->layout_count == REPORT_MAX_LAYOUTS)
+            break;
+
+        struct report_layout *layout = &table->layouts[table->layout_count];
+        layout->first_field = table->field_count;
+
+        for (int j = i; j < parser->field_count; j++)
+        {
+            const struct report_field *field = &parser->fields[j].field;
+
+            if (parser->fields[j].report_id != report_id)
+                continue;
+
+            table->fields[table->field_count++] = *field;
+            layout->field_count++;
+
+            if (field->kind == FIELD_AXIS)
+                layout->axes |= (uint8_t)(1u << field->index);
+            else
+                for (int k = 0; k < field->count && field->index + k < 32; k++)
+                    layout->button_mask |= 1u << (field->index + k);
+        }
+
+        table->axes |= layout->axes;
+        table->layout_index[report_id] = (int8_t)table->layout_count++;
+    }
+}
+
+bool report_table_build(struct report_table *table, const uint8_t *descriptor, size_t length)
+{
+    struct parser parser;
+    struct global_state global = {0};
+    struct global_state global_stack[MAX_GLOBAL_STACK];
+    struct local_state local = {0};
+    int stack_depth = 0;
+    size_t pos = 0;
+
+    memset(table, 0, sizeof(*table));
+    memset(table->layout_index, -1, sizeof(table->layout_index));
+    memset(&parser, 0, sizeof(parser));
+
+    while (descriptor && pos < length)
+    {
+        uint8_t prefix = descriptor[pos++];
+
+        if (prefix == ITEM_LONG)
+        {
+            // Long items are reserved; skip size, tag and data
+            if (pos + 2 > length)
+                break;
+            pos += 2 + descriptor[pos];
+            continue;
+        }
+
+        size_t size = prefix & 0x3;
+        if (size == 3)
+            size = 4;
+        if (pos + size > length)
+            break;
+
+        uint32_t data = 0;
+        for (size_t i = 0; i < size; i++)
+            data |= (uint32_t)descriptor[pos + i] << (i * 8);
+
+        // Signed view for logical limits (1, 2 or 4 bytes, two's complement)
+        int32_t signed_data = (int32_t)data;
+        if (size == 1)
+            signed_data = (int8_t)data;
+        else if (size == 2)
+            signed_data = (int16_t)data;
+
+        pos += size;
+
+        uint8_t type = (prefix >> 2) & 0x3;
+        uint8_t tag = prefix >> 4;
+
+        if (type == ITEM_MAIN)
+        {
+            if (tag == MAIN_INPUT)
+                parse_input(&parser, &global, &local, data);
+
+            // Every main item (Input, Output, Feature, Collection) consumes
+            // the local items before it
+            memset(&local, 0, sizeof(local));
+        }
+        else if (type == ITEM_GLOBAL)
+        {
+            switch (tag)
+            {
+            case GLOBAL_USAGE_PAGE:
+                global.usage_page = (uint16_t)data;
+                break;
+            case GLOBAL_LOGICAL_MINIMUM:
+                global.logical_minimum = signed_data;
+                break;
+            case GLOBAL_REPORT_SIZE:
+                global.report_size = data;
+                break;
+            case GLOBAL_REPORT_ID:
+                global.report_id = (uint8_t)data;
+                table->report_ids = true;
+                break;
+            case GLOBAL_REPORT_COUNT:
+                global.report_count = data;
+                break;
+            case GLOBAL_PUSH:
+                if (stack_depth < MAX_GLOBAL_STACK)
+                    global_stack[stack_depth++] = global;
+                break;
+            case GLOBAL_POP:
+                if (stack_depth > 0)
+                    global = global_stack[--stack_depth];
+                break;
+            }
+        }
+        else if (type == ITEM_LOCAL)
+        {
+            // 4-byte usages carry their own page in the high half
+            uint32_t usage = (size == 4) ? data : ((uint32_t)global.usage_page << 16 | data);
+
+            switch (tag)
+            {
+            case LOCAL_USAGE:
+                if (local.usage_count < MAX_USAGES)
+                    local.usages[local.usage_count++] = usage;
+                break;
+            case LOCAL_USAGE_MINIMUM:
+                local.usage_minimum = usage;
+                local.has_range = true;
+                break;
+            case LOCAL_USAGE_MAXIMUM:
+                local.usage_maximum = usage;
+                local.has_range = true;
+                break;
+            }
+        }
+    }
+
+    build_layouts(table, &parser);
+    table->valid = (table->axes != 0);
+    return table->valid;
+}
@@ -0,0 +1,70 @@
+/*
+ * HID report descriptor parser shared by the native readers
+ *
+ * SpaceMouse models lay out their input reports differently: the Compact
+ * sends all six axes in report 1, older models split translation and
+ * rotation over reports 1 and 2, the Pro and Enterprise pack 30+ buttons
+ * into bitmask reports. Instead of hard-coding each layout, the reader
+ * reads the device's report descriptor once at attach time and compiles
+ * it into a decode table: for every input report ID, the bit offset and
+ * size of each axis (Generic Desktop X..RZ) and button (Button page).
+ *
+ * Decoding a report is then a loop over that report's fields (see
+ * decode_report() in spacemouse_report.h). Anything the table does not
+ * cover - vendor pages, padding, output and feature reports - is skipped
+ * at build time, not per report.
+ */
+
+#ifndef REPORT_DESCRIPTOR_H
+#define REPORT_DESCRIPTOR_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define REPORT_MAX_FIELDS 64
+#define REPORT_MAX_LAYOUTS 16
+
+enum report_field_kind
+{
+    FIELD_AXIS = 1,   // index: axis 0-5 (X, Y, Z, RX, RY, RZ)
+    FIELD_BUTTONS = 2 // index: bit of the first button; count buttons in a row
+};
+
+// One decoded value, or a run of 1-bit buttons
+struct report_field
+{
+    uint16_t bit_offset; // from the first data byte, after the report ID
+    uint8_t bit_size;    // per value, at most 32
+    uint8_t count;       // consecutive values (1 for axes)
+    uint8_t kind;
+    uint8_t index;
+    bool is_signed;      // logical minimum < 0
+};
+
+// Fields of one input report ID
+struct report_layout
+{
+    uint8_t first_field;
+    uint8_t field_count;
+    uint8_t axes;         // bitmask of the axes this report carries
+    uint32_t button_mask; // bitmask of the buttons this report carries
+};
+
+struct report_table
+{
+    bool valid;           // descriptor parsed and describes at least one axis
+    bool report_ids;      // reports start with a report ID byte
+    uint8_t axes;         // every axis the device reports
+    uint8_t layout_count;
+    uint8_t field_count;
+    int8_t layout_index[256]; // report ID -> layout, -1 if not decoded
+    struct report_layout layouts[REPORT_MAX_LAYOUTS];
+    struct report_field fields[REPORT_MAX_FIELDS];
+};
+
+// Compile a raw report descriptor into table. Returns table->valid; on
+// false the caller falls back to the built-in layouts.
+bool report_table_build(struct report_table *table, const uint8_t *descriptor, size_t length);
+
+#endif /* REPORT_DESCRIPTOR_H */
@@ -0,0 +1,216 @@
+/*
+ * Per-axis response curves baked into lookup tables (see response_curve.h)
+ */
+
+#include "response_curve.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define TABLE_SIZE 65536
+#define FULL_SCALE 350.0
+#define MAX_POINTS 16
+
+enum curve_kind
+{
+    CURVE_EXPO,
+    CURVE_SCURVE,
+    CURVE_LINEAR
+};
+
+struct curve
+{
+    enum curve_kind kind;
+    double parameter;
+    int point_count;
+    double in[MAX_POINTS + 1];
+    double out[MAX_POINTS + 1];
+};
+
+static const char *axis_names[6] = {"x", "y", "z", "rx", "ry", "rz"};
+
+// Indexed by the raw value reinterpreted as uint16; NULL for a straight
+// axis. Storage is allocated once per axis and never freed, so the NIF
+// can swap curves while a scheduler thread is applying them.
+static int16_t *tables[6];
+static int16_t *storage[6];
+
+// Output magnitude for input magnitude m (raw units)
+static double evaluate(const struct curve *curve, double m)
+{
+    if (curve->kind == CURVE_LINEAR)
+    {
+        int last = curve->point_count - 1;
+        if (m >= curve->in[last])
+            return curve->out[last] + (m - curve->in[last]);
+
+        int i = 1;
+        while (m > curve->in[i])
+            i++;
+        double span = curve->in[i] - curve->in[i - 1];
+        return curve->out[i - 1] + (curve->out[i] - curve->out[i - 1]) * (m - curve->in[i - 1]) / span;
+    }
+
+    // Both normalized curves end at f(1) = 1: slope 1 beyond full scale
+    if (m >= FULL_SCALE)
+        return m;
+
+    double u = m / FULL_SCALE;
+    if (curve->kind == CURVE_EXPO)
+        return FULL_SCALE * ((1.0 - curve->parameter) * u + curve->parameter * u * u * u);
+
+    double rising = pow(u, curve->parameter);
+    return FULL_SCALE * rising / (rising + pow(1.0 - u, curve->parameter));
+}
+
+static void bake(int axis, const struct curve *curve)
+{
+    if (!storage[axis])
+        storage[axis] = malloc(TABLE_SIZE * sizeof(int16_t));
+    if (!storage[axis])
+        return;
+
+    for (int raw = INT16_MIN; raw <= INT16_MAX; raw++)
+    {
+        double out = evaluate(curve, fabs((double)raw));
+        out = lround(raw < 0 ? -out : out);
+        if (out > INT16_MAX)
+            out = INT16_MAX;
+        if (out < INT16_MIN)
+            out = INT16_MIN;
+        storage[axis][(uint16_t)raw] = (int16_t)out;
+    }
+    tables[axis] = storage[axis];
+}
+
+// "0:0,100:40,350:350", ascending; (0, 0) is implied before the first point
+static bool parse_points(const char *params, struct curve *curve)
+{
+    curve->in[0] = 0.0;
+    curve->out[0] = 0.0;
+    curve->point_count = 1;
+
+    const char *cursor = params;
+    while (*cursor)
+    {
+        char *end;
+        double in = strtod(cursor, &end);
+        if (end == cursor || *end != ':')
+            return false;
+        cursor = end + 1;
+
+        double out = strtod(cursor, &end);
+        if (end == cursor || (*end != ',' && *end != '\0'))
+            return false;
+        cursor = *end == ',' ? end + 1 : end;
+
+        if (in < 0 || in < curve->in[curve->point_count - 1])
+            return false;
+        if (in == 0)
+        {
+            curve->out[0] = out;
+            continue;
+        }
+        if (in == curve->in[curve->point_count - 1] || curve->point_count > MAX_POINTS)
+            return false;
+
+        curve->in[curve->point_count] = in;
+        curve->out[curve->point_count] = out;
+        curve->point_count++;
+    }
+    return curve->point_count > 1;
+}
+
+static bool parse_parameter(const char *params, double minimum, double maximum, double *value)
+{
+    char *end;
+    *value = strtod(params, &end);
+    return end != params && *end == '\0' && *value >= minimum && *value <= maximum;
+}
+
+bool response_curve_parse(const char *spec)
+{
+    char axes[32];
+    const char *kind = strchr(spec, ':');
+    if (!kind || (size_t)(kind - spec) >= sizeof(axes))
+        return false;
+    memcpy(axes, spec, (size_t)(kind - spec));
+    axes[kind - spec] = '\0';
+    kind++;
+
+    const char *params = strchr(kind, ':');
+    if (!params)
+        return false;
+    size_t kind_length = (size_t)(params - kind);
+    params++;
+
+    struct curve curve = {0};
+    bool valid;
+    if (kind_length == 4 && strncmp(kind, "expo", 4) == 0)
+    {
+        curve.kind = CURVE_EXPO;
+        valid = parse_parameter(params, 0.0, 1.0, &curve.parameter);
+    }
+    else if (kind_length == 6 && strncmp(kind, "scurve", 6) == 0)
+    {
+        curve.kind = CURVE_SCURVE;
+        valid = parse_parameter(params, 1.0, 100.0, &curve.parameter);
+    }
+    else if (kind_length == 6 && strncmp(kind, "linear", 6) == 0)
+    {
+        curve.kind = CURVE_LINEAR;
+        valid = parse_points(params, &curve);
+    }
+    else
+    {
+        valid = false;
+    }
+    if (!valid)
+        return false;
+
+    // Resolve every axis name before baking any table
+    int selected[6];
+    int count = 0;
+    for (char *name = strtok(axes, ","); name; name = strtok(NULL, ","))
+    {
+        int axis = 0;
+        while (axis < 6 && strcmp(name, axis_names[axis]) != 0)
+            axis++;
+        if (axis == 6 || count == 6)
+            return false;
+        selected[count++] = axis;
+    }
+    if (count == 0)
+        return false;
+
+    for (int i = 0; i < count; i++)
+        bake(selected[i], &curve);
+    return true;
+}
+
+bool response_curve_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--curve=", 8) == 0 && !response_curve_parse(argv[i] + 8))
+        {
+            fprintf(stderr, "ERROR: Invalid response curve %s\n", argv[i] + 8);
+            return false;
+        }
+    }
+    return true;
+}
+
+void response_curve_reset(void)
+{
+    for (int axis = 0; axis < 6; axis++)
+        tables[axis] = NULL;
+}
+
+void response_curve_apply(const int16_t raw[6], int16_t curved[6])
+{
+    for (int axis = 0; axis < 6; axis++)
+        curved[axis] = tables[axis] ? tables[axis][(uint16_t)raw[axis]] : raw[axis];
+}
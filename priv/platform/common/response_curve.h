@@ -0,0 +1,49 @@
+/*
+ * Per-axis response curves baked into lookup tables
+ *
+ * Operators tune sensitivity with nonlinear curves. Instead of evaluating
+ * the curve per axis per event (and per subscriber), each curve is baked
+ * once, at start-up, into a 65536-entry table indexed by the raw int16
+ * axis value. Applying it to a frame is one table load per curved axis;
+ * axes without a curve are left alone.
+ *
+ * Curves are given as --curve=AXES:KIND:PARAMS, repeatable, where AXES is
+ * a comma-separated list of x, y, z, rx, ry, rz:
+ *
+ *   --curve=x,y:expo:0.4          (1 - k) * u + k * u^3, k in [0, 1]
+ *   --curve=rz:scurve:2.5         u^p / (u^p + (1 - u)^p), p >= 1: flat at
+ *                                 rest and at full deflection
+ *   --curve=z:linear:0:0,100:40,350:350
+ *                                 piecewise linear through IN:OUT points
+ *                                 in raw units, ascending IN
+ *
+ * expo and scurve work on u = |value| / 350 (the full deflection of
+ * current devices) and keep the sign. Past full deflection, and past the
+ * last point of a linear curve, the output continues with slope 1. Results
+ * are clamped to int16 and stay in raw units, so everything downstream
+ * (port records, shared memory, socket clients, the Elixir scaling) is
+ * unchanged; a later --curve for the same axis replaces the earlier one.
+ */
+
+#ifndef RESPONSE_CURVE_H
+#define RESPONSE_CURVE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Parse every --curve= argument and build its tables. Returns false (after
+// printing to stderr) for an invalid curve.
+bool response_curve_init(int argc, char *argv[]);
+
+// Build the tables for one AXES:KIND:PARAMS spec (no --curve= prefix)
+bool response_curve_parse(const char *spec);
+
+// Drop every curve
+void response_curve_reset(void);
+
+// Map the six raw axis values of a frame through their tables. The
+// decoder's frame is not touched: devices that split translation and
+// rotation into two reports keep the other half in it.
+void response_curve_apply(const int16_t raw[6], int16_t curved[6]);
+
+#endif /* RESPONSE_CURVE_H */
@@ -0,0 +1,153 @@
+/*
+ * Latest-state snapshot NIF
+ *
+ * Purpose: Let any Erlang process sample the reader's shared-memory
+ *          snapshot (see state_shm.h) without going through the
+ *          DeviceManager: one seqlock-guarded copy per read, no messages.
+ *
+ * - attach_nif/1 maps the named segment read-only and returns a resource;
+ *   the mapping is released when the resource is garbage collected
+ * - read_nif/2 copies one device slot (see state_shm_client.h) and returns
+ *   its raw axis values, button bitmask, capture timestamp and sequence
+ *
+ * Both are plain (non-dirty) NIFs: read_nif/2 is a bounded copy of one
+ * cache line and never waits on the writer.
+ *
+ * Compile: cc -O2 -fPIC -shared -I$ERTS_INCLUDE_DIR -o snapshot_nif.so snapshot_nif.c
+ */
+
+#include <erl_nif.h>
+
+#include "state_shm_client.h"
+
+#define AXIS_COUNT 6
+
+struct snapshot
+{
+    const struct state_shm *shm;
+};
+
+static ErlNifResourceType *snapshot_resource_type = NULL;
+
+static ERL_NIF_TERM atom_ok;
+static ERL_NIF_TERM atom_error;
+static ERL_NIF_TERM atom_not_found;
+static ERL_NIF_TERM atom_busy;
+static ERL_NIF_TERM atom_disconnected;
+static ERL_NIF_TERM atom_buttons;
+static ERL_NIF_TERM atom_sequence;
+static ERL_NIF_TERM atom_frame_count;
+static ERL_NIF_TERM atom_device_timestamp;
+static ERL_NIF_TERM atom_vendor_id;
+static ERL_NIF_TERM atom_product_id;
+static ERL_NIF_TERM axis_atoms[AXIS_COUNT];
+
+static void snapshot_dtor(ErlNifEnv *env __attribute__((unused)), void *obj)
+{
+    struct snapshot *snapshot = obj;
+
+    state_shm_detach(snapshot->shm);
+    snapshot->shm = NULL;
+}
+
+// attach_nif(name) -> {:ok, resource} | {:error, :not_found}
+static ERL_NIF_TERM attach(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ErlNifBinary name_binary;
+    char name[64];
+
+    if (!enif_inspect_binary(env, argv[0], &name_binary) || name_binary.size >= sizeof(name))
+        return enif_make_badarg(env);
+
+    memcpy(name, name_binary.data, name_binary.size);
+    name[name_binary.size] = '\0';
+
+    const struct state_shm *shm = state_shm_attach(name);
+    if (!shm)
+        return enif_make_tuple2(env, atom_error, atom_not_found);
+
+    struct snapshot *snapshot = enif_alloc_resource(snapshot_resource_type, sizeof(*snapshot));
+    snapshot->shm = shm;
+
+    ERL_NIF_TERM resource = enif_make_resource(env, snapshot);
+    enif_release_resource(snapshot);
+    return enif_make_tuple2(env, atom_ok, resource);
+}
+
+// read_nif(resource, device_id) -> {:ok, map} | :disconnected | {:error, :busy}
+static ERL_NIF_TERM read_snapshot(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct snapshot *snapshot;
+    struct state_snapshot state;
+    int device_id;
+
+    if (!enif_get_resource(env, argv[0], snapshot_resource_type, (void **)&snapshot) ||
+        !enif_get_int(env, argv[1], &device_id) || device_id < 1 || device_id > MAX_DEVICES)
+        return enif_make_badarg(env);
+
+    if (!state_shm_read(snapshot->shm, (uint8_t)device_id, &state))
+        return enif_make_tuple2(env, atom_error, atom_busy);
+
+    if (!state.connected)
+        return atom_disconnected;
+
+    ERL_NIF_TERM keys[AXIS_COUNT + 6];
+    ERL_NIF_TERM values[AXIS_COUNT + 6];
+
+    for (int i = 0; i < AXIS_COUNT; i++)
+    {
+        keys[i] = axis_atoms[i];
+        values[i] = enif_make_int(env, state.frame[i]);
+    }
+
+    keys[AXIS_COUNT] = atom_buttons;
+    values[AXIS_COUNT] = enif_make_uint(env, state.buttons);
+    keys[AXIS_COUNT + 1] = atom_sequence;
+    values[AXIS_COUNT + 1] = enif_make_uint(env, state.sequence);
+    keys[AXIS_COUNT + 2] = atom_frame_count;
+    values[AXIS_COUNT + 2] = enif_make_uint64(env, state.frame_count);
+    keys[AXIS_COUNT + 3] = atom_device_timestamp;
+    values[AXIS_COUNT + 3] = enif_make_uint64(env, state.timestamp_us);
+    keys[AXIS_COUNT + 4] = atom_vendor_id;
+    values[AXIS_COUNT + 4] = enif_make_int(env, state.vendor_id);
+    keys[AXIS_COUNT + 5] = atom_product_id;
+    values[AXIS_COUNT + 5] = enif_make_int(env, state.product_id);
+
+    ERL_NIF_TERM map;
+    enif_make_map_from_arrays(env, keys, values, AXIS_COUNT + 6, &map);
+    return enif_make_tuple2(env, atom_ok, map);
+}
+
+static int load(ErlNifEnv *env, void **priv_data __attribute__((unused)), ERL_NIF_TERM load_info __attribute__((unused)))
+{
+    static const char *axis_names[AXIS_COUNT] = {"x", "y", "z", "rx", "ry", "rz"};
+
+    snapshot_resource_type = enif_open_resource_type(env, NULL, "state_snapshot", snapshot_dtor,
+                                                     ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER, NULL);
+    if (!snapshot_resource_type)
+        return 1;
+
+    atom_ok = enif_make_atom(env, "ok");
+    atom_error = enif_make_atom(env, "error");
+    atom_not_found = enif_make_atom(env, "not_found");
+    atom_busy = enif_make_atom(env, "busy");
+    atom_disconnected = enif_make_atom(env, "disconnected");
+    atom_buttons = enif_make_atom(env, "buttons");
+    atom_sequence = enif_make_atom(env, "sequence");
+    atom_frame_count = enif_make_atom(env, "frame_count");
+    atom_device_timestamp = enif_make_atom(env, "device_timestamp");
+    atom_vendor_id = enif_make_atom(env, "vendor_id");
+    atom_product_id = enif_make_atom(env, "product_id");
+
+    for (int i = 0; i < AXIS_COUNT; i++)
+        axis_atoms[i] = enif_make_atom(env, axis_names[i]);
+
+    return 0;
+}
+
+static ErlNifFunc nif_funcs[] = {
+    {"attach_nif", 1, attach, 0},
+    {"read_nif", 2, read_snapshot, 0},
+};
+
+ERL_NIF_INIT(Elixir.SpaceMouse.Snapshot, nif_funcs, load, NULL, NULL, NULL)
@@ -0,0 +1,221 @@
+/*
+ * SpaceMouse HID report decoding shared by the native readers
+ *
+ * Both readers receive whole input reports (IOKit report callback on
+ * macOS, read() on hidraw on Linux) and hand them to this decoder. Motion
+ * is decoded one report at a time into a complete 6-axis frame, so the
+ * port only ever sees atomic frames, never a half-updated one.
+ *
+ * When the reader could compile the device's report descriptor (see
+ * report_descriptor.h), the decoder is table-driven: each report is a loop
+ * over the fields the descriptor declares for its report ID, and a frame
+ * is complete once every axis the device reports has been seen. Without a
+ * table (no descriptor, replayed captures) the built-in layouts apply.
+ *
+ * Built-in layouts:
+ * - Report ID 1, 13 bytes: X, Y, Z, RX, RY, RZ (int16 little-endian)
+ * - Report ID 1, 7 bytes:  X, Y, Z        (older models, rotation follows)
+ * - Report ID 2, 7 bytes:  RX, RY, RZ     (completes the frame above)
+ * - Report ID 2, <7 bytes: button bitmask (Compact)
+ * - Report ID 3:           button bitmask (up to 32 buttons)
+ */
+
+#ifndef SPACEMOUSE_REPORT_H
+#define SPACEMOUSE_REPORT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "report_descriptor.h"
+
+#define REPORT_ID_TRANSLATION 1
+#define REPORT_ID_ROTATION 2
+#define REPORT_ID_BUTTONS 3
+
+#define AXIS_COUNT 6
+
+// Decoder result for one input report; a descriptor-driven report can
+// carry both, so callers test the bits
+enum report_kind
+{
+    REPORT_NONE = 0,   // Ignored, or first half of a split frame
+    REPORT_MOTION = 1, // frame holds a complete 6-axis frame
+    REPORT_BUTTONS = 2 // buttons holds the new button bitmask
+};
+
+struct report_decoder
+{
+    int16_t frame[AXIS_COUNT];
+    uint32_t buttons;
+    const struct report_table *table; // NULL: built-in layouts
+    uint8_t axes_seen;                // axes updated since the last frame
+};
+
+static inline int16_t read_le16(const uint8_t *bytes)
+{
+    return (int16_t)(bytes[0] | (bytes[1] << 8));
+}
+
+static inline void report_decoder_reset(struct report_decoder *decoder)
+{
+    memset(decoder, 0, sizeof(*decoder));
+}
+
+// Reset and decode with table from now on, if it is valid
+static inline void report_decoder_init(struct report_decoder *decoder,
+                                       const struct report_table *table)
+{
+    report_decoder_reset(decoder);
+    if (table && table->valid)
+        decoder->table = table;
+}
+
+// Little-endian bit field of up to 32 bits; bits past the end read as 0
+static inline int32_t read_bits(const uint8_t *data, size_t length, uint32_t offset,
+                                uint8_t size, bool is_signed)
+{
+    uint32_t value = 0;
+
+    if (offset % 8 == 0 && size % 8 == 0)
+    {
+        for (uint8_t i = 0; i < size / 8 && offset / 8 + i < length; i++)
+            value |= (uint32_t)data[offset / 8 + i] << (i * 8);
+    }
+    else
+    {
+        for (uint8_t i = 0; i < size; i++)
+        {
+            uint32_t bit = offset + i;
+            if (bit / 8 < length && (data[bit / 8] >> (bit % 8)) & 1)
+                value |= 1u << i;
+        }
+    }
+
+    if (is_signed && size < 32 && (value & (1u << (size - 1))))
+        value |= ~0u << size;
+    return (int32_t)value;
+}
+
+// Table-driven decode: one pass over the fields of the report's layout
+static inline int decode_with_table(struct report_decoder *decoder,
+                                    const uint8_t *report, size_t length)
+{
+    const struct report_table *table = decoder->table;
+    uint8_t report_id = 0;
+    int kind = REPORT_NONE;
+
+    if (table->report_ids)
+    {
+        if (length < 1)
+            return REPORT_NONE;
+        report_id = report[0];
+        report++;
+        length--;
+    }
+
+    int index = table->layout_index[report_id];
+    if (index < 0)
+        return REPORT_NONE;
+
+    const struct report_layout *layout = &table->layouts[index];
+    uint32_t buttons = 0;
+
+    for (uint8_t i = 0; i < layout->field_count; i++)
+    {
+        const struct report_field *field = &table->fields[layout->first_field + i];
+
+        if (field->kind == FIELD_AXIS)
+        {
+            int32_t value = read_bits(report, length, field->bit_offset, field->bit_size,
+                                      field->is_signed);
+            if (value > INT16_MAX)
+                value = INT16_MAX;
+            else if (value < INT16_MIN)
+                value = INT16_MIN;
+            decoder->frame[field->index] = (int16_t)value;
+        }
+        else
+        {
+            for (uint8_t b = 0; b < field->count; b++)
+            {
+                if (read_bits(report, length, field->bit_offset + (uint32_t)b * field->bit_size,
+                              field->bit_size, false))
+                    buttons |= 1u << (field->index + b);
+            }
+        }
+    }
+
+    if (layout->axes)
+    {
+        decoder->axes_seen |= layout->axes;
+        if ((decoder->axes_seen & table->axes) == table->axes)
+        {
+            decoder->axes_seen = 0;
+            kind |= REPORT_MOTION;
+        }
+    }
+
+    if (layout->button_mask)
+    {
+        decoder->buttons = (decoder->buttons & ~layout->button_mask) | buttons;
+        kind |= REPORT_BUTTONS;
+    }
+
+    return kind;
+}
+
+// Decode one raw input report (report ID in byte 0 for the built-in
+// layouts). Returns a combination of report_kind bits.
+static inline int decode_report(struct report_decoder *decoder,
+                                const uint8_t *report, size_t length)
+{
+    if (decoder->table)
+        return decode_with_table(decoder, report, length);
+
+    if (length < 2)
+        return REPORT_NONE;
+
+    switch (report[0])
+    {
+    case REPORT_ID_TRANSLATION:
+        if (length >= 13)
+        {
+            for (int i = 0; i < AXIS_COUNT; i++)
+                decoder->frame[i] = read_le16(report + 1 + i * 2);
+            return REPORT_MOTION;
+        }
+        if (length >= 7)
+        {
+            // Hold translation until the matching rotation report arrives
+            for (int i = 0; i < 3; i++)
+                decoder->frame[i] = read_le16(report + 1 + i * 2);
+        }
+        return REPORT_NONE;
+
+    case REPORT_ID_ROTATION:
+        if (length >= 7)
+        {
+            for (int i = 0; i < 3; i++)
+                decoder->frame[3 + i] = read_le16(report + 1 + i * 2);
+            return REPORT_MOTION;
+        }
+        decoder->buttons = report[1];
+        return REPORT_BUTTONS;
+
+    case REPORT_ID_BUTTONS:
+    {
+        uint32_t mask = 0;
+        for (size_t i = 1; i < length && i <= 4; i++)
+            mask |= (uint32_t)report[i] << ((i - 1) * 8);
+        decoder->buttons = mask;
+        return REPORT_BUTTONS;
+    }
+
+    default:
+        return REPORT_NONE;
+    }
+}
+
+#endif /* SPACEMOUSE_REPORT_H */
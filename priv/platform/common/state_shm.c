@@ -0,0 +1,136 @@
+/*
+ * Latest-state snapshot in POSIX shared memory (see state_shm.h)
+ */
+
+#include "state_shm.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+static struct state_shm *shm = NULL;
+static char shm_name[64];
+
+static bool open_segment(const char *name)
+{
+    if (name[0] != '/' || strlen(name) >= sizeof(shm_name) || strchr(name + 1, '/'))
+    {
+        errno = EINVAL;
+        return false;
+    }
+
+    int fd = shm_open(name, O_RDWR | O_CREAT, 0644);
+    if (fd < 0)
+        return false;
+
+    if (ftruncate(fd, sizeof(struct state_shm)) < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    void *mapping = mmap(NULL, sizeof(struct state_shm), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return false;
+
+    shm = mapping;
+    snprintf(shm_name, sizeof(shm_name), "%s", name);
+
+    // A segment left behind by a previous reader starts over: every slot
+    // disconnected, sequences kept so clients never see one go backwards
+    for (int id = 0; id <= MAX_DEVICES; id++)
+        state_shm_device((uint8_t)id, false, 0, 0);
+
+    shm->version = STATE_SHM_VERSION;
+    shm->max_devices = MAX_DEVICES;
+    shm->writer_pid = (uint32_t)getpid();
+    atomic_thread_fence(memory_order_release);
+    shm->magic = STATE_SHM_MAGIC;
+    return true;
+}
+
+bool state_shm_init(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strncmp(argv[i], "--shm=", 6) == 0 && !open_segment(argv[i] + 6))
+        {
+            fprintf(stderr, "ERROR: Failed to create shared memory %s (%s)\n", argv[i] + 6, strerror(errno));
+            return false;
+        }
+    }
+    return true;
+}
+
+void state_shm_close(void)
+{
+    if (!shm)
+        return;
+
+    munmap(shm, sizeof(struct state_shm));
+    shm_unlink(shm_name);
+    shm = NULL;
+}
+
+// Seqlock write side: odd sequence while the slot is inconsistent. The
+// release fence keeps the slot stores after the odd sequence; the release
+// store publishes them before the even one.
+static struct state_shm_device *begin_write(uint8_t device)
+{
+    struct state_shm_device *slot = &shm->devices[device];
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+
+    atomic_store_explicit(&slot->sequence, sequence | 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    return slot;
+}
+
+static void end_write(struct state_shm_device *slot)
+{
+    uint32_t sequence = atomic_load_explicit(&slot->sequence, memory_order_relaxed);
+    atomic_store_explicit(&slot->sequence, sequence + 1, memory_order_release);
+}
+
+void state_shm_device(uint8_t device, bool connected, uint16_t vendor_id, uint16_t product_id)
+{
+    if (!shm || device > MAX_DEVICES)
+        return;
+
+    struct state_shm_device *slot = begin_write(device);
+    slot->connected = connected;
+    slot->vendor_id = vendor_id;
+    slot->product_id = product_id;
+    slot->buttons = 0;
+    slot->timestamp_us = 0;
+    slot->frame_count = 0;
+    memset(slot->frame, 0, sizeof(slot->frame));
+    end_write(slot);
+}
+
+void state_shm_motion(uint8_t device, uint64_t timestamp_us, const int16_t frame[6])
+{
+    if (!shm || device > MAX_DEVICES)
+        return;
+
+    struct state_shm_device *slot = begin_write(device);
+    memcpy(slot->frame, frame, sizeof(slot->frame));
+    slot->timestamp_us = timestamp_us;
+    slot->frame_count++;
+    end_write(slot);
+}
+
+void state_shm_buttons(uint8_t device, uint64_t timestamp_us, uint32_t buttons)
+{
+    if (!shm || device > MAX_DEVICES)
+        return;
+
+    struct state_shm_device *slot = begin_write(device);
+    slot->buttons = buttons;
+    slot->timestamp_us = timestamp_us;
+    end_write(slot);
+}
@@ -0,0 +1,65 @@
+/*
+ * Latest-state snapshot in POSIX shared memory
+ *
+ * With --shm=NAME (e.g. --shm=/space_mouse) the reader publishes the newest
+ * 6-axis frame, button bitmask and VID/PID of every device into a shared
+ * memory segment, next to the port output. Consumers that only sample the
+ * current pose (a render loop at 144 Hz) map the segment and read it
+ * directly: no subscription, no GenServer call, no message per frame.
+ *
+ * Every device slot is guarded by a seqlock. The reader (the only writer)
+ * makes the sequence odd, updates the slot, and makes it even again.
+ * Clients copy the slot between two reads of the sequence and retry only
+ * if a write overlapped the copy, so they never block the writer and
+ * never wait on each other. See state_shm_client.h for the read side.
+ *
+ * The segment is created when the reader starts (an existing one with the
+ * same name is reused) and unlinked when it exits. Slots are indexed by
+ * device ID (see device_ids.h); slot 0 is unused.
+ */
+
+#ifndef STATE_SHM_H
+#define STATE_SHM_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "port_protocol.h"
+
+#define STATE_SHM_MAGIC 0x48534D53 // "SMSH"
+#define STATE_SHM_VERSION 1
+
+// One device, padded to a cache line so slots never share one
+struct state_shm_device
+{
+    _Atomic uint32_t sequence; // odd while the writer updates the slot
+    uint32_t connected;
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t buttons;      // bit 0 is button 1
+    uint64_t timestamp_us; // capture time of the last report (reader clock)
+    uint64_t frame_count;  // frames published since the device attached
+    int16_t frame[6];      // X, Y, Z, RX, RY, RZ, raw device units
+} __attribute__((aligned(64)));
+
+struct state_shm
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t max_devices;
+    uint32_t writer_pid;
+    struct state_shm_device devices[MAX_DEVICES + 1];
+};
+
+// Parse --shm=NAME and create the segment. Returns false (after printing
+// to stderr) if it was requested but cannot be created. Without --shm the
+// publish calls below do nothing.
+bool state_shm_init(int argc, char *argv[]);
+void state_shm_close(void);
+
+void state_shm_device(uint8_t device, bool connected, uint16_t vendor_id, uint16_t product_id);
+void state_shm_motion(uint8_t device, uint64_t timestamp_us, const int16_t frame[6]);
+void state_shm_buttons(uint8_t device, uint64_t timestamp_us, uint32_t buttons);
+
+#endif /* STATE_SHM_H */
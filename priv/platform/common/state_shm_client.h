@@ -0,0 +1,112 @@
+/*
+ * Client side of the latest-state snapshot (see state_shm.h)
+ *
+ * Header-only, so any C program (or NIF) can sample the reader's state
+ * without linking against anything but libc:
+ *
+ *   const struct state_shm *shm = state_shm_attach("/space_mouse");
+ *   struct state_snapshot snapshot;
+ *
+ *   if (shm && state_shm_read(shm, 1, &snapshot) && snapshot.connected)
+ *       use(snapshot.frame, snapshot.buttons);
+ *
+ *   state_shm_detach(shm);
+ *
+ * state_shm_read() never blocks: it copies the slot and retries only if
+ * the writer updated it during the copy. The mapping is read-only, so a
+ * client cannot disturb the reader or other clients.
+ */
+
+#ifndef STATE_SHM_CLIENT_H
+#define STATE_SHM_CLIENT_H
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "state_shm.h"
+
+// Copies tried before state_shm_read() gives up. A retry means a write
+// overlapped the copy; at report rates two in a row are already rare.
+#define STATE_SHM_READ_ATTEMPTS 64
+
+struct state_snapshot
+{
+    uint32_t sequence; // even; changes whenever the slot does
+    bool connected;
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t buttons;
+    uint64_t timestamp_us;
+    uint64_t frame_count;
+    int16_t frame[6];
+};
+
+// Map the segment read-only. NULL if it does not exist (yet) or is not a
+// snapshot segment of this version.
+static inline const struct state_shm *state_shm_attach(const char *name)
+{
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd < 0)
+        return NULL;
+
+    void *mapping = mmap(NULL, sizeof(struct state_shm), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (mapping == MAP_FAILED)
+        return NULL;
+
+    const struct state_shm *shm = mapping;
+    if (shm->magic != STATE_SHM_MAGIC || shm->version != STATE_SHM_VERSION)
+    {
+        munmap(mapping, sizeof(struct state_shm));
+        return NULL;
+    }
+
+    atomic_thread_fence(memory_order_acquire);
+    return shm;
+}
+
+static inline void state_shm_detach(const struct state_shm *shm)
+{
+    if (shm)
+        munmap((void *)shm, sizeof(struct state_shm));
+}
+
+// Consistent copy of one device slot. False for an invalid device ID or
+// if every attempt overlapped a write.
+static inline bool state_shm_read(const struct state_shm *shm, uint8_t device, struct state_snapshot *snapshot)
+{
+    if (device < 1 || device > MAX_DEVICES)
+        return false;
+
+    struct state_shm_device *slot = (struct state_shm_device *)&shm->devices[device];
+
+    for (int attempt = 0; attempt < STATE_SHM_READ_ATTEMPTS; attempt++)
+    {
+        uint32_t before = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+        if (before & 1u)
+            continue;
+
+        snapshot->connected = slot->connected != 0;
+        snapshot->vendor_id = slot->vendor_id;
+        snapshot->product_id = slot->product_id;
+        snapshot->buttons = slot->buttons;
+        snapshot->timestamp_us = slot->timestamp_us;
+        snapshot->frame_count = slot->frame_count;
+        memcpy(snapshot->frame, slot->frame, sizeof(snapshot->frame));
+
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&slot->sequence, memory_order_relaxed) == before)
+        {
+            snapshot->sequence = before;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+#endif /* STATE_SHM_CLIENT_H */
@@ -0,0 +1,46 @@
+#!/bin/bash
+#
+# Build script for the native unit tests (any POSIX system)
+#
+# Built by mix compile.native in the test environment only; run by
+# test/space_mouse/native_test.exs, or by hand from the build directory.
+#
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+COMMON_DIR="$SCRIPT_DIR/.."
+
+# When used as a dependency, Mix sets MIX_APP_PATH to the dependency's build directory
+# When building standalone, we need to find the project root
+if [ -n "$MIX_APP_PATH" ]; then
+    # Building as a dependency - use MIX_APP_PATH/priv
+    BUILD_DIR="$MIX_APP_PATH/priv/platform/common/tests"
+    echo "🔧 Building as dependency: $BUILD_DIR"
+else
+    # Building standalone - use project _build directory
+    PROJECT_ROOT="$(cd "$SCRIPT_DIR/../../../.." && pwd)"
+    BUILD_DIR="$PROJECT_ROOT/_build/test/lib/space_mouse/priv/platform/common/tests"
+    echo "🔧 Building standalone: $BUILD_DIR"
+fi
+
+# Create build directory if it doesn't exist
+mkdir -p "$BUILD_DIR"
+
+# build_test NAME SOURCES...: one program per test file
+build_test() {
+    local name="$1"
+    shift
+    ${CC:-cc} -O2 -Wall -Wextra -o "$BUILD_DIR/$name" "$SCRIPT_DIR/$name.c" "$@" -lm
+}
+
+echo "🔨 Building native unit tests..."
+
+build_test test_report_descriptor "$COMMON_DIR/report_descriptor.c"
+build_test test_spacemouse_report "$COMMON_DIR/report_descriptor.c" "$COMMON_DIR/port_protocol.c"
+build_test test_port_protocol "$COMMON_DIR/port_protocol.c"
+build_test test_response_curve "$COMMON_DIR/response_curve.c"
+build_test test_calibration "$COMMON_DIR/calibration.c"
+build_test test_idle_filter "$COMMON_DIR/idle_filter.c"
+
+echo "✅ Build complete: $BUILD_DIR"
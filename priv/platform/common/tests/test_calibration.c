@@ -0,0 +1,192 @@
+/*
+ * Unit tests for the zero-drift calibration (../calibration.c)
+ *
+ * Covers the stillness windows (bias steps and rounding, noisy or
+ * deflected windows left out, the MAX_BIAS limit), zeroing of small
+ * values, calibration_zero(), --auto-zero=off and parsing of the spec.
+ *
+ * Compile: cc -Wall -Wextra -o test_calibration test_calibration.c ../calibration.c
+ */
+
+#include "../calibration.h"
+#include "unit_test.h"
+
+#define WINDOW 8
+
+// Feed count frames with value on every axis; returns the last corrected X
+static int16_t feed(struct calibration *calibration, int16_t value, int count)
+{
+    int16_t frame[6];
+
+    for (int i = 0; i < count; i++)
+    {
+        for (int axis = 0; axis < 6; axis++)
+            frame[axis] = value;
+        calibration_apply(calibration, frame, frame);
+    }
+    return frame[0];
+}
+
+static void test_window_steps(void)
+{
+    struct calibration calibration;
+
+    CHECK(calibration_configure("8:2:24"));
+    calibration_reset(&calibration);
+
+    // Nothing moves before the window is full
+    CHECK_EQ(feed(&calibration, 10, WINDOW - 1), 10);
+    CHECK_EQ(calibration.bias[0], 0);
+
+    // A quarter of the way to 10: 2.5 counts, rounded up; the closing
+    // frame is already corrected with the new bias
+    CHECK_EQ(feed(&calibration, 10, 1), 7);
+    CHECK_EQ(calibration.bias_q4[0], 40);
+    CHECK_EQ(calibration.bias[0], 3);
+    CHECK_EQ(calibration.bias[5], 3);
+    CHECK_EQ(calibration.count, 0);
+
+    feed(&calibration, 10, WINDOW);
+    CHECK_EQ(calibration.bias_q4[0], 70);
+    CHECK_EQ(calibration.bias[0], 4);
+
+    // Converges on the mean; what is left of the offset is zeroed as noise
+    CHECK_EQ(feed(&calibration, 10, 50 * WINDOW), 0);
+    CHECK_EQ(calibration.bias[0], 10);
+
+    // Negative means round away from zero too
+    calibration_reset(&calibration);
+    feed(&calibration, -10, WINDOW);
+    CHECK_EQ(calibration.bias_q4[0], -40);
+    CHECK_EQ(calibration.bias[0], -3);
+}
+
+static void test_windows_not_at_rest(void)
+{
+    struct calibration calibration;
+
+    CHECK(calibration_configure("8:2:24"));
+
+    // Held still at MAX_BIAS still counts as rest, one count further does not
+    calibration_reset(&calibration);
+    feed(&calibration, 24, WINDOW);
+    CHECK_EQ(calibration.bias[0], 6);
+
+    calibration_reset(&calibration);
+    CHECK_EQ(feed(&calibration, 25, 20 * WINDOW), 25);
+    CHECK_EQ(calibration.bias_q4[0], 0);
+
+    // Jitter of +/-5 around 10 is more than NOISE: the cap is being touched
+    calibration_reset(&calibration);
+    int16_t frame[6];
+    for (int i = 0; i < 20 * WINDOW; i++)
+    {
+        for (int axis = 0; axis < 6; axis++)
+            frame[axis] = i % 2 ? 15 : 5;
+        calibration_apply(&calibration, frame, frame);
+    }
+    CHECK_EQ(calibration.bias_q4[0], 0);
+
+    // One axis out of range keeps every axis from moving
+    calibration_reset(&calibration);
+    for (int i = 0; i < WINDOW; i++)
+    {
+        int16_t deflected[6] = {10, 10, 10, 10, 10, 100};
+        calibration_apply(&calibration, deflected, deflected);
+    }
+    CHECK_EQ(calibration.bias_q4[0], 0);
+}
+
+static void test_noise_zeroing(void)
+{
+    struct calibration calibration;
+
+    CHECK(calibration_configure("8:2:24"));
+    calibration_reset(&calibration);
+
+    int16_t raw[6] = {2, -2, 3, -3, 0, 1000};
+    int16_t corrected[6];
+    calibration_apply(&calibration, raw, corrected);
+    CHECK_EQ(corrected[0], 0);
+    CHECK_EQ(corrected[1], 0);
+    CHECK_EQ(corrected[2], 3);
+    CHECK_EQ(corrected[3], -3);
+    CHECK_EQ(corrected[4], 0);
+    CHECK_EQ(corrected[5], 1000);
+
+    // raw itself is left alone
+    CHECK_EQ(raw[0], 2);
+}
+
+static void test_zero(void)
+{
+    struct calibration calibration;
+
+    CHECK(calibration_configure("8:2:24"));
+    calibration_reset(&calibration);
+    feed(&calibration, 10, 3);
+
+    // Takes the frame as the bias outright, beyond MAX_BIAS too, and
+    // starts a new window
+    int16_t raw[6] = {100, -50, 0, 0, 0, 0};
+    calibration_zero(&calibration, raw);
+    CHECK_EQ(calibration.bias[0], 100);
+    CHECK_EQ(calibration.bias[1], -50);
+    CHECK_EQ(calibration.count, 0);
+
+    int16_t corrected[6];
+    calibration_apply(&calibration, raw, corrected);
+    CHECK_EQ(corrected[0], 0);
+    CHECK_EQ(corrected[1], 0);
+
+    // Corrected values saturate at the int16 range
+    int16_t extreme[6] = {INT16_MIN, INT16_MAX, 0, 0, 0, 0};
+    calibration_apply(&calibration, extreme, corrected);
+    CHECK_EQ(corrected[0], INT16_MIN);
+    CHECK_EQ(corrected[1], INT16_MAX);
+}
+
+static void test_off(void)
+{
+    struct calibration calibration;
+
+    CHECK(calibration_configure("off"));
+    calibration_reset(&calibration);
+
+    // No tracking and no zeroing of small values
+    CHECK_EQ(feed(&calibration, 2, 20 * WINDOW), 2);
+    CHECK_EQ(calibration.bias_q4[0], 0);
+    CHECK_EQ(calibration.count, 0);
+
+    int16_t raw[6] = {5, 5, 5, 5, 5, 5};
+    calibration_zero(&calibration, raw);
+    CHECK_EQ(feed(&calibration, 6, 1), 1);
+}
+
+static void test_configure(void)
+{
+    const char *invalid[] = {"1:2:24", "8:2", "8:2:24x", "8:-1:24", "8:2:-1", "100001:2:24", "on", ""};
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        if (calibration_configure(invalid[i]))
+        {
+            fprintf(stderr, "%s:%d: accepted \"%s\"\n", __FILE__, __LINE__, invalid[i]);
+            unit_test_failures++;
+        }
+    }
+
+    char *argv[] = {"hid_reader", "--protocol=binary", "--auto-zero=64:2:24"};
+    CHECK(calibration_init(3, argv));
+}
+
+int main(void)
+{
+    test_window_steps();
+    test_windows_not_at_rest();
+    test_noise_zeroing();
+    test_zero();
+    test_off();
+    test_configure();
+    return UNIT_TEST_RESULT();
+}
@@ -0,0 +1,153 @@
+/*
+ * Unit tests for the idle suppression (../idle_filter.c)
+ *
+ * Covers exact repeats, the EPSILON dead band around the last emitted
+ * frame and around zero, the single rest frame, the report-driven
+ * keepalive, --idle-filter=off and parsing of the spec.
+ *
+ * Compile: cc -Wall -Wextra -o test_idle_filter test_idle_filter.c ../idle_filter.c
+ */
+
+#include "../idle_filter.h"
+#include "unit_test.h"
+
+// Pass a frame with x on X and zero elsewhere; *out gets the X as passed
+static bool pass_x(struct idle_filter *filter, int16_t x, uint64_t timestamp_us, int16_t *out)
+{
+    int16_t frame[6] = {x, 0, 0, 0, 0, 0};
+    bool passed = idle_filter_pass(filter, frame, timestamp_us);
+
+    if (out)
+        *out = frame[0];
+    return passed;
+}
+
+static void test_default(void)
+{
+    struct idle_filter filter;
+
+    CHECK(idle_filter_configure("0"));
+    idle_filter_reset(&filter);
+
+    // The first frame always goes out, rest or not
+    CHECK(pass_x(&filter, 0, 0, NULL));
+    CHECK(!pass_x(&filter, 0, 1000, NULL));
+
+    // Exact repeats are dropped, any change is sent
+    CHECK(pass_x(&filter, 5, 2000, NULL));
+    CHECK(!pass_x(&filter, 5, 3000, NULL));
+    CHECK(pass_x(&filter, 6, 4000, NULL));
+
+    // Back to rest: one all-zero frame, then silence
+    CHECK(pass_x(&filter, 0, 5000, NULL));
+    CHECK(!pass_x(&filter, 0, 6000, NULL));
+    CHECK(!pass_x(&filter, 0, 60000000, NULL));
+
+    // A reset device sends its first frame again
+    idle_filter_reset(&filter);
+    CHECK(pass_x(&filter, 0, 7000, NULL));
+}
+
+static void test_epsilon(void)
+{
+    struct idle_filter filter;
+    int16_t x;
+
+    CHECK(idle_filter_configure("2"));
+    idle_filter_reset(&filter);
+
+    CHECK(pass_x(&filter, 10, 0, NULL));
+    CHECK(!pass_x(&filter, 12, 1000, NULL));
+    CHECK(!pass_x(&filter, 8, 2000, NULL));
+
+    // Small steps do not creep past the last emitted frame
+    CHECK(!pass_x(&filter, 11, 3000, NULL));
+    CHECK(pass_x(&filter, 13, 4000, &x));
+    CHECK_EQ(x, 13);
+
+    // Within EPSILON of zero on every axis is rest: zeroed and sent once
+    CHECK(pass_x(&filter, 2, 5000, &x));
+    CHECK_EQ(x, 0);
+    CHECK(!pass_x(&filter, -2, 6000, &x));
+    CHECK_EQ(x, 0);
+    CHECK(!pass_x(&filter, 1, 7000, NULL));
+    CHECK(pass_x(&filter, 3, 8000, &x));
+    CHECK_EQ(x, 3);
+
+    // Rest is judged on every axis: near-zero on X alone is not rest
+    int16_t frame[6] = {1, 0, 0, 0, 0, 50};
+    idle_filter_reset(&filter);
+    CHECK(idle_filter_pass(&filter, frame, 9000));
+    CHECK_EQ(frame[0], 1);
+}
+
+static void test_keepalive(void)
+{
+    struct idle_filter filter;
+
+    CHECK(idle_filter_configure("0:1000"));
+    idle_filter_reset(&filter);
+
+    CHECK(pass_x(&filter, 5, 0, NULL));
+    CHECK(!pass_x(&filter, 5, 999999, NULL));
+    CHECK(pass_x(&filter, 5, 1000000, NULL));
+
+    // Counted from the last frame sent, whatever the reason it was sent
+    CHECK(pass_x(&filter, 6, 1500000, NULL));
+    CHECK(!pass_x(&filter, 6, 2400000, NULL));
+    CHECK(pass_x(&filter, 6, 2500000, NULL));
+
+    // Rest frames are re-sent too
+    CHECK(pass_x(&filter, 0, 2600000, NULL));
+    CHECK(!pass_x(&filter, 0, 3000000, NULL));
+    CHECK(pass_x(&filter, 0, 3600000, NULL));
+}
+
+static void test_off(void)
+{
+    struct idle_filter filter;
+    int16_t x;
+
+    CHECK(idle_filter_configure("off"));
+    idle_filter_reset(&filter);
+
+    CHECK(pass_x(&filter, 0, 0, NULL));
+    CHECK(pass_x(&filter, 0, 0, NULL));
+    CHECK(pass_x(&filter, 1, 0, &x));
+    CHECK_EQ(x, 1);
+
+    // A later spec turns it back on
+    CHECK(idle_filter_configure("0"));
+    CHECK(pass_x(&filter, 1, 0, NULL));
+    CHECK(!pass_x(&filter, 1, 0, NULL));
+}
+
+static void test_configure(void)
+{
+    const char *invalid[] = {"", "-1", "1001", "2:", "2:-5", "2:1000x", "2x", "on"};
+
+    for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++)
+    {
+        if (idle_filter_configure(invalid[i]))
+        {
+            fprintf(stderr, "%s:%d: accepted \"%s\"\n", __FILE__, __LINE__, invalid[i]);
+            unit_test_failures++;
+        }
+    }
+
+    char *argv[] = {"hid_reader", "--idle-filter=2:1000"};
+    CHECK(idle_filter_init(2, argv));
+
+    char *bad_argv[] = {"hid_reader", "--idle-filter=fast"};
+    CHECK(!idle_filter_init(2, bad_argv));
+}
+
+int main(void)
+{
+    test_default();
+    test_epsilon();
+    test_keepalive();
+    test_off();
+    test_configure();
+    return UNIT_TEST_RESULT();
+}
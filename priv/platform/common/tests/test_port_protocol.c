@@ -0,0 +1,141 @@
+/*
+ * Unit tests for the command framing of the port protocol (../port_protocol.c)
+ *
+ * Feeds commands through a pipe in both modes: text lines and binary
+ * packets split across reads, and commands too long for the buffer, which
+ * must be dropped whole without losing the commands after them.
+ *
+ * Compile: cc -Wall -Wextra -o test_port_protocol test_port_protocol.c ../port_protocol.c
+ */
+
+#include "../port_protocol.h"
+#include "unit_test.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+#define MAX_SEEN 8
+
+static char seen[MAX_SEEN][300];
+static int seen_count = 0;
+
+static void record_command(const char *command)
+{
+    if (seen_count < MAX_SEEN)
+        snprintf(seen[seen_count], sizeof(seen[0]), "%s", command);
+    seen_count++;
+}
+
+static int pipe_fds[2];
+
+// Write bytes to the pipe and let the protocol read until it is empty
+static void feed(const void *bytes, size_t length)
+{
+    CHECK_EQ(write(pipe_fds[1], bytes, length), (long long)length);
+
+    // One read per call, at most a buffer's worth
+    for (int i = 0; i < 8; i++)
+        CHECK(protocol_read_commands(pipe_fds[0], record_command));
+}
+
+static void feed_text(const char *text)
+{
+    feed(text, strlen(text));
+}
+
+static void select_protocol(const char *flag)
+{
+    char *argv[] = {"test_port_protocol", (char *)flag};
+    protocol_init(2, argv);
+    seen_count = 0;
+}
+
+static void test_text_lines(void)
+{
+    select_protocol("--protocol=text");
+
+    feed_text("LED:on\nCALIBRATE:2\n");
+    CHECK_EQ(seen_count, 2);
+    CHECK(strcmp(seen[0], "LED:on") == 0);
+    CHECK(strcmp(seen[1], "CALIBRATE:2") == 0);
+
+    // A line split across reads
+    feed_text("LED:o");
+    CHECK_EQ(seen_count, 2);
+    feed_text("ff\n");
+    CHECK_EQ(seen_count, 3);
+    CHECK(strcmp(seen[2], "LED:off") == 0);
+}
+
+static void test_overlong_text_line(void)
+{
+    char line[600];
+
+    select_protocol("--protocol=text");
+
+    // Longer than the buffer: dropped up to its newline, the next line is
+    // read whole
+    memset(line, 'A', sizeof(line));
+    feed(line, 300);
+    feed_text("\nLED:on\n");
+    CHECK_EQ(seen_count, 1);
+    CHECK(strcmp(seen[0], "LED:on") == 0);
+
+    // More than two buffers before the newline
+    feed(line, sizeof(line));
+    feed_text("LED:off\nCALIBRATE\n");
+    CHECK_EQ(seen_count, 2);
+    CHECK(strcmp(seen[1], "CALIBRATE") == 0);
+}
+
+static void test_binary_packets(void)
+{
+    select_protocol("--protocol=binary");
+
+    const uint8_t packets[] = {0x00, 0x06, 'L', 'E', 'D', ':', 'o', 'n', 0x00, 0x09, 'C', 'A', 'L', 'I', 'B',
+                               'R', 'A', 'T', 'E'};
+    feed(packets, sizeof(packets));
+    CHECK_EQ(seen_count, 2);
+    CHECK(strcmp(seen[0], "LED:on") == 0);
+    CHECK(strcmp(seen[1], "CALIBRATE") == 0);
+
+    // Header and payload split across reads
+    feed(packets, 1);
+    feed(packets + 1, 4);
+    CHECK_EQ(seen_count, 2);
+    feed(packets + 5, 3);
+    CHECK_EQ(seen_count, 3);
+    CHECK(strcmp(seen[2], "LED:on") == 0);
+}
+
+static void test_oversized_packet(void)
+{
+    uint8_t packet[2 + 400];
+
+    select_protocol("--protocol=binary");
+
+    // 400 bytes can never fit: skipped exactly, across reads
+    memset(packet, 'A', sizeof(packet));
+    packet[0] = 400 >> 8;
+    packet[1] = 400 & 0xFF;
+    feed(packet, sizeof(packet));
+
+    const uint8_t next[] = {0x00, 0x07, 'L', 'E', 'D', ':', 'o', 'f', 'f'};
+    feed(next, sizeof(next));
+    CHECK_EQ(seen_count, 1);
+    CHECK(strcmp(seen[0], "LED:off") == 0);
+}
+
+int main(void)
+{
+    if (pipe(pipe_fds) != 0)
+        return EXIT_FAILURE;
+    fcntl(pipe_fds[0], F_SETFL, fcntl(pipe_fds[0], F_GETFL) | O_NONBLOCK);
+
+    test_text_lines();
+    test_overlong_text_line();
+    test_binary_packets();
+    test_oversized_packet();
+    return UNIT_TEST_RESULT();
+}
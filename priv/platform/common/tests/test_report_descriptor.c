@@ -0,0 +1,211 @@
+/*
+ * Unit tests for the report descriptor compiler (../report_descriptor.c)
+ *
+ * Covers Push/Pop of the global items, usage lists and Usage Minimum..
+ * Maximum ranges, button runs merged into one field, and decoding
+ * through the compiled table (../spacemouse_report.h).
+ *
+ * Compile: cc -Wall -Wextra -o test_report_descriptor test_report_descriptor.c ../report_descriptor.c
+ */
+
+#include "../report_descriptor.h"
+#include "../spacemouse_report.h"
+#include "unit_test.h"
+
+// Report 1: X, Y, Z, a vendor byte, RX, RY, RZ; the rotation axes reuse
+// the pushed Generic Desktop, signed 16-bit globals. Report 3: buttons 1-12
+// from a usage range, then 4 bits of padding.
+static const uint8_t pushed_descriptor[] = {
+    0x05, 0x01,                               // Usage Page (Generic Desktop)
+    0x09, 0x08,                               // Usage (Multi-axis Controller)
+    0xA1, 0x01,                               // Collection (Application)
+    0x85, 0x01,                               //   Report ID (1)
+    0x16, 0xA2, 0xFE,                         //   Logical Minimum (-350)
+    0x26, 0x5E, 0x01,                         //   Logical Maximum (350)
+    0x75, 0x10,                               //   Report Size (16)
+    0x95, 0x03,                               //   Report Count (3)
+    0xA4,                                     //   Push
+    0x09, 0x30, 0x09, 0x31, 0x09, 0x32,       //   Usage (X), (Y), (Z)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0x06, 0x00, 0xFF,                         //   Usage Page (Vendor 0xFF00)
+    0x15, 0x00,                               //   Logical Minimum (0)
+    0x75, 0x08,                               //   Report Size (8)
+    0x95, 0x01,                               //   Report Count (1)
+    0x09, 0x01,                               //   Usage (Vendor 1)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0xB4,                                     //   Pop
+    0x09, 0x33, 0x09, 0x34, 0x09, 0x35,       //   Usage (RX), (RY), (RZ)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0x85, 0x03,                               //   Report ID (3)
+    0x05, 0x09,                               //   Usage Page (Button)
+    0x19, 0x01,                               //   Usage Minimum (1)
+    0x29, 0x0C,                               //   Usage Maximum (12)
+    0x15, 0x00,                               //   Logical Minimum (0)
+    0x25, 0x01,                               //   Logical Maximum (1)
+    0x75, 0x01,                               //   Report Size (1)
+    0x95, 0x0C,                               //   Report Count (12)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0x75, 0x04,                               //   Report Size (4)
+    0x95, 0x01,                               //   Report Count (1)
+    0x81, 0x01,                               //   Input (Constant)
+    0xC0,                                     // End Collection
+};
+
+// No report IDs: button 5 from a usage, buttons 9-10 from the range after
+// it, then X..Z from a range, unaligned after the 3 button bits
+static const uint8_t mixed_descriptor[] = {
+    0x05, 0x09,                               // Usage Page (Button)
+    0x09, 0x05,                               // Usage (Button 5)
+    0x19, 0x09,                               // Usage Minimum (9)
+    0x29, 0x0A,                               // Usage Maximum (10)
+    0x75, 0x01,                               // Report Size (1)
+    0x95, 0x03,                               // Report Count (3)
+    0x81, 0x02,                               // Input (Data, Variable)
+    0x05, 0x01,                               // Usage Page (Generic Desktop)
+    0x19, 0x30,                               // Usage Minimum (X)
+    0x29, 0x32,                               // Usage Maximum (Z)
+    0x16, 0xA2, 0xFE,                         // Logical Minimum (-350)
+    0x75, 0x10,                               // Report Size (16)
+    0x95, 0x03,                               // Report Count (3)
+    0x81, 0x02,                               // Input (Data, Variable)
+};
+
+static void check_axis(const struct report_field *field, int index, int bit_offset)
+{
+    CHECK_EQ(field->kind, FIELD_AXIS);
+    CHECK_EQ(field->index, index);
+    CHECK_EQ(field->bit_offset, bit_offset);
+    CHECK_EQ(field->bit_size, 16);
+    CHECK(field->is_signed);
+}
+
+static void test_push_pop(void)
+{
+    struct report_table table;
+
+    CHECK(report_table_build(&table, pushed_descriptor, sizeof(pushed_descriptor)));
+    CHECK(table.report_ids);
+    CHECK_EQ(table.axes, 0x3F);
+    CHECK_EQ(table.layout_count, 2);
+    CHECK_EQ(table.layout_index[1], 0);
+    CHECK_EQ(table.layout_index[2], -1);
+    CHECK_EQ(table.layout_index[3], 1);
+
+    const struct report_layout *motion = &table.layouts[0];
+    CHECK_EQ(motion->field_count, 6);
+    CHECK_EQ(motion->axes, 0x3F);
+    CHECK_EQ(motion->button_mask, 0);
+
+    // The vendor byte is skipped but still takes its 8 bits
+    const int offsets[6] = {0, 16, 32, 56, 72, 88};
+    for (int i = 0; i < 6; i++)
+        check_axis(&table.fields[motion->first_field + i], i, offsets[i]);
+}
+
+static void test_usage_range(void)
+{
+    struct report_table table;
+
+    report_table_build(&table, pushed_descriptor, sizeof(pushed_descriptor));
+
+    // Twelve 1-bit buttons from one range are one field
+    const struct report_layout *buttons = &table.layouts[1];
+    const struct report_field *field = &table.fields[buttons->first_field];
+    CHECK_EQ(buttons->field_count, 1);
+    CHECK_EQ(buttons->axes, 0);
+    CHECK_EQ(buttons->button_mask, 0xFFF);
+    CHECK_EQ(field->kind, FIELD_BUTTONS);
+    CHECK_EQ(field->index, 0);
+    CHECK_EQ(field->count, 12);
+    CHECK_EQ(field->bit_offset, 0);
+    CHECK_EQ(field->bit_size, 1);
+    CHECK(!field->is_signed);
+}
+
+static void test_usages_before_range(void)
+{
+    struct report_table table;
+
+    CHECK(report_table_build(&table, mixed_descriptor, sizeof(mixed_descriptor)));
+    CHECK(!table.report_ids);
+    CHECK_EQ(table.axes, 0x07);
+    CHECK_EQ(table.layout_index[0], 0);
+
+    const struct report_layout *layout = &table.layouts[0];
+    CHECK_EQ(layout->field_count, 5);
+    CHECK_EQ(layout->button_mask, (1u << 4) | (1u << 8) | (1u << 9));
+
+    // Button 5 alone, then 9 and 10 merged: their IDs do not follow on from 5
+    CHECK_EQ(table.fields[0].index, 4);
+    CHECK_EQ(table.fields[0].count, 1);
+    CHECK_EQ(table.fields[1].index, 8);
+    CHECK_EQ(table.fields[1].count, 2);
+    CHECK_EQ(table.fields[1].bit_offset, 1);
+
+    for (int i = 0; i < 3; i++)
+        check_axis(&table.fields[2 + i], i, 3 + 16 * i);
+}
+
+static void test_decode(void)
+{
+    struct report_table table;
+    struct report_decoder decoder;
+
+    report_table_build(&table, pushed_descriptor, sizeof(pushed_descriptor));
+    report_decoder_init(&decoder, &table);
+
+    // X -350, Y 1, Z 350, vendor 0x7F, RX -1, RY 0, RZ 100
+    const uint8_t motion[] = {0x01, 0xA2, 0xFE, 0x01, 0x00, 0x5E, 0x01, 0x7F,
+                              0xFF, 0xFF, 0x00, 0x00, 0x64, 0x00};
+    CHECK_EQ(decode_report(&decoder, motion, sizeof(motion)), REPORT_MOTION);
+    CHECK_EQ(decoder.frame[0], -350);
+    CHECK_EQ(decoder.frame[1], 1);
+    CHECK_EQ(decoder.frame[2], 350);
+    CHECK_EQ(decoder.frame[3], -1);
+    CHECK_EQ(decoder.frame[4], 0);
+    CHECK_EQ(decoder.frame[5], 100);
+
+    // Unaligned fields: X -2 at bit 3 after buttons 5 and 10
+    struct report_table mixed;
+    report_table_build(&mixed, mixed_descriptor, sizeof(mixed_descriptor));
+    report_decoder_init(&decoder, &mixed);
+
+    uint8_t report[7] = {0};
+    uint16_t x = (uint16_t)-2;
+    report[0] = (uint8_t)(0x05 | (x << 3));
+    report[1] = (uint8_t)(x >> 5);
+    report[2] = (uint8_t)(x >> 13);
+    int kind = decode_report(&decoder, report, sizeof(report));
+    CHECK_EQ(kind, REPORT_MOTION | REPORT_BUTTONS);
+    CHECK_EQ(decoder.frame[0], -2);
+    CHECK_EQ(decoder.frame[1], 0);
+    CHECK_EQ(decoder.buttons, (1u << 4) | (1u << 9));
+}
+
+static void test_invalid(void)
+{
+    struct report_table table;
+
+    // Buttons only: no axes, so the built-in layouts apply
+    const uint8_t buttons_only[] = {0x05, 0x09, 0x19, 0x01, 0x29, 0x02, 0x75, 0x01, 0x95, 0x02, 0x81, 0x02};
+    CHECK(!report_table_build(&table, buttons_only, sizeof(buttons_only)));
+
+    // An item running past the end stops the parse without reading beyond it
+    CHECK(!report_table_build(&table, pushed_descriptor, 10));
+    CHECK(!report_table_build(&table, NULL, 0));
+
+    // Pop without Push is ignored
+    const uint8_t pop_first[] = {0xB4, 0x05, 0x01, 0x09, 0x30, 0x75, 0x08, 0x95, 0x01, 0x81, 0x02};
+    CHECK(report_table_build(&table, pop_first, sizeof(pop_first)));
+    CHECK_EQ(table.axes, 0x01);
+}
+
+int main(void)
+{
+    test_push_pop();
+    test_usage_range();
+    test_usages_before_range();
+    test_decode();
+    test_invalid();
+    return UNIT_TEST_RESULT();
+}
@@ -0,0 +1,136 @@
+/*
+ * Unit tests for the response curve tables (../response_curve.c)
+ *
+ * Checks the baked expo, scurve and piecewise linear values, sign
+ * symmetry, slope 1 past full deflection, the int16 clamp, replacement
+ * and reset, and rejection of invalid specs.
+ *
+ * Compile: cc -Wall -Wextra -o test_response_curve test_response_curve.c ../response_curve.c -lm
+ */
+
+#include "../response_curve.h"
+#include "unit_test.h"
+
+// Output of axis for a frame with value on every axis
+static int16_t curved(int axis, int16_t value)
+{
+    int16_t raw[6] = {value, value, value, value, value, value};
+    int16_t out[6];
+
+    response_curve_apply(raw, out);
+    return out[axis];
+}
+
+static void test_expo(void)
+{
+    response_curve_reset();
+    CHECK(response_curve_parse("x,y:expo:0.4"));
+
+    // u = 0.2: 350 * (0.6 * 0.2 + 0.4 * 0.008) = 43.12
+    CHECK_EQ(curved(0, 70), 43);
+    CHECK_EQ(curved(1, 70), 43);
+    CHECK_EQ(curved(0, -70), -43);
+    CHECK_EQ(curved(0, 0), 0);
+    CHECK_EQ(curved(0, 350), 350);
+    CHECK_EQ(curved(0, -350), -350);
+
+    // Slope 1 past full deflection, up to the int16 range
+    CHECK_EQ(curved(0, 400), 400);
+    CHECK_EQ(curved(0, INT16_MAX), INT16_MAX);
+    CHECK_EQ(curved(0, INT16_MIN), INT16_MIN);
+
+    // Axes without a curve are left alone
+    CHECK_EQ(curved(2, 70), 70);
+    CHECK_EQ(curved(5, -70), -70);
+}
+
+static void test_scurve(void)
+{
+    response_curve_reset();
+    CHECK(response_curve_parse("rz:scurve:2"));
+
+    // u = 0.2: 0.04 / (0.04 + 0.64) * 350 = 20.59
+    CHECK_EQ(curved(5, 70), 21);
+    CHECK_EQ(curved(5, -70), -21);
+    CHECK_EQ(curved(5, 175), 175);
+    CHECK_EQ(curved(5, 350), 350);
+    CHECK_EQ(curved(5, 0), 0);
+    CHECK_EQ(curved(5, 1000), 1000);
+}
+
+static void test_linear(void)
+{
+    response_curve_reset();
+    CHECK(response_curve_parse("z:linear:0:0,100:40,350:350"));
+
+    CHECK_EQ(curved(2, 50), 20);
+    CHECK_EQ(curved(2, 100), 40);
+    CHECK_EQ(curved(2, 225), 195);
+    CHECK_EQ(curved(2, -225), -195);
+    CHECK_EQ(curved(2, 1000), 1000);
+
+    // Continuing with slope 1 from a high last point runs into the clamp
+    CHECK(response_curve_parse("z:linear:100:32000"));
+    CHECK_EQ(curved(2, 50), 16000);
+    CHECK_EQ(curved(2, 200), 32100);
+    CHECK_EQ(curved(2, INT16_MAX), INT16_MAX);
+    CHECK_EQ(curved(2, INT16_MIN), INT16_MIN);
+}
+
+static void test_replace_and_reset(void)
+{
+    response_curve_reset();
+    CHECK(response_curve_parse("x:expo:1"));
+    CHECK(response_curve_parse("x:linear:350:175"));
+    CHECK_EQ(curved(0, 70), 35);
+
+    // The input frame is not touched
+    int16_t raw[6] = {70, 0, 0, 0, 0, 0};
+    int16_t out[6];
+    response_curve_apply(raw, out);
+    CHECK_EQ(raw[0], 70);
+    CHECK_EQ(out[0], 35);
+
+    response_curve_reset();
+    CHECK_EQ(curved(0, 70), 70);
+}
+
+static void test_invalid(void)
+{
+    const char *specs[] = {
+        "w:expo:0.4",             // unknown axis
+        ":expo:0.4",              // no axis
+        "x:expo:1.5",             // k out of range
+        "x:expo:",                // no parameter
+        "x:expo:0.4x",            // trailing garbage
+        "x:scurve:0.5",           // p below 1
+        "x:linear:100:40,50:20",  // descending points
+        "x:linear:100:40,100:50", // repeated point
+        "x:linear:0:10",          // no point past 0
+        "x:cubic:1",              // unknown kind
+        "x",                      // no kind
+    };
+
+    response_curve_reset();
+    for (size_t i = 0; i < sizeof(specs) / sizeof(specs[0]); i++)
+    {
+        if (response_curve_parse(specs[i]))
+        {
+            fprintf(stderr, "%s:%d: accepted \"%s\"\n", __FILE__, __LINE__, specs[i]);
+            unit_test_failures++;
+        }
+    }
+
+    // A rejected spec leaves every axis straight
+    CHECK_EQ(curved(0, 70), 70);
+}
+
+int main(void)
+{
+    test_expo();
+    test_scurve();
+    test_linear();
+    test_replace_and_reset();
+    test_invalid();
+    return UNIT_TEST_RESULT();
+}
@@ -0,0 +1,159 @@
+/*
+ * Unit tests for the button bitmask decoding (../spacemouse_report.h)
+ *
+ * Covers the built-in button reports (32-bit report 3, Compact report 2),
+ * descriptor-driven reports that each carry some of the buttons, and the
+ * BUTTONS record the readers emit for a changed bitmask
+ * (../port_protocol.c).
+ *
+ * Compile: cc -Wall -Wextra -o test_spacemouse_report test_spacemouse_report.c ../report_descriptor.c ../port_protocol.c
+ */
+
+#include "../port_protocol.h"
+#include "../report_descriptor.h"
+#include "../spacemouse_report.h"
+#include "unit_test.h"
+
+// Report 1: X..RZ, then buttons 1-2 and 6 bits of padding. Report 3:
+// buttons 3-10.
+static const uint8_t split_descriptor[] = {
+    0x05, 0x01,                               // Usage Page (Generic Desktop)
+    0x09, 0x08,                               // Usage (Multi-axis Controller)
+    0xA1, 0x01,                               // Collection (Application)
+    0x85, 0x01,                               //   Report ID (1)
+    0x16, 0xA2, 0xFE,                         //   Logical Minimum (-350)
+    0x26, 0x5E, 0x01,                         //   Logical Maximum (350)
+    0x75, 0x10,                               //   Report Size (16)
+    0x95, 0x06,                               //   Report Count (6)
+    0x19, 0x30,                               //   Usage Minimum (X)
+    0x29, 0x35,                               //   Usage Maximum (RZ)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0x05, 0x09,                               //   Usage Page (Button)
+    0x19, 0x01,                               //   Usage Minimum (1)
+    0x29, 0x02,                               //   Usage Maximum (2)
+    0x15, 0x00,                               //   Logical Minimum (0)
+    0x25, 0x01,                               //   Logical Maximum (1)
+    0x75, 0x01,                               //   Report Size (1)
+    0x95, 0x02,                               //   Report Count (2)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0x75, 0x06,                               //   Report Size (6)
+    0x95, 0x01,                               //   Report Count (1)
+    0x81, 0x01,                               //   Input (Constant)
+    0x85, 0x03,                               //   Report ID (3)
+    0x19, 0x03,                               //   Usage Minimum (3)
+    0x29, 0x0A,                               //   Usage Maximum (10)
+    0x75, 0x01,                               //   Report Size (1)
+    0x95, 0x08,                               //   Report Count (8)
+    0x81, 0x02,                               //   Input (Data, Variable)
+    0xC0,                                     // End Collection
+};
+
+// Last record passed to the sink
+static uint8_t sink_record[32];
+static size_t sink_length = 0;
+
+static void capture_record(uint8_t device, bool motion, const uint8_t *record, size_t length)
+{
+    (void)device;
+    (void)motion;
+    if (length > sizeof(sink_record))
+        length = sizeof(sink_record);
+    memcpy(sink_record, record, length);
+    sink_length = length;
+}
+
+static uint32_t le32(const uint8_t *bytes)
+{
+    return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 |
+           (uint32_t)bytes[3] << 24;
+}
+
+static void test_builtin_buttons(void)
+{
+    struct report_decoder decoder;
+    report_decoder_init(&decoder, NULL);
+
+    // Report 3: up to four bytes, button 1 in bit 0
+    const uint8_t all[] = {REPORT_ID_BUTTONS, 0x01, 0x80, 0x00, 0x80};
+    CHECK_EQ(decode_report(&decoder, all, sizeof(all)), REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, 0x80008001u);
+
+    // A shorter report releases the buttons it does not cover
+    const uint8_t short_report[] = {REPORT_ID_BUTTONS, 0x02};
+    CHECK_EQ(decode_report(&decoder, short_report, sizeof(short_report)), REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, 0x02);
+
+    // Bytes past the fourth are ignored
+    const uint8_t long_report[] = {REPORT_ID_BUTTONS, 0x00, 0x00, 0x00, 0x00, 0xFF};
+    CHECK_EQ(decode_report(&decoder, long_report, sizeof(long_report)), REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, 0);
+
+    // Compact: buttons in a short report 2
+    const uint8_t compact[] = {REPORT_ID_ROTATION, 0x03};
+    CHECK_EQ(decode_report(&decoder, compact, sizeof(compact)), REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, 0x03);
+
+    // A full report 2 is rotation and leaves the buttons alone
+    const uint8_t rotation[] = {REPORT_ID_ROTATION, 0x01, 0x00, 0x02, 0x00, 0x03, 0x00};
+    CHECK_EQ(decode_report(&decoder, rotation, sizeof(rotation)), REPORT_MOTION);
+    CHECK_EQ(decoder.buttons, 0x03);
+
+    // Too short to carry anything
+    const uint8_t empty[] = {REPORT_ID_BUTTONS};
+    CHECK_EQ(decode_report(&decoder, empty, sizeof(empty)), REPORT_NONE);
+    CHECK_EQ(decoder.buttons, 0x03);
+}
+
+static void test_table_buttons(void)
+{
+    struct report_table table;
+    struct report_decoder decoder;
+
+    CHECK(report_table_build(&table, split_descriptor, sizeof(split_descriptor)));
+    report_decoder_init(&decoder, &table);
+
+    // Report 3 sets buttons 3 and 10
+    const uint8_t high[] = {0x03, 0x81};
+    CHECK_EQ(decode_report(&decoder, high, sizeof(high)), REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, (1u << 2) | (1u << 9));
+
+    // Report 1 sets button 1 and keeps the buttons report 3 owns
+    uint8_t motion[14] = {0x01};
+    motion[13] = 0x01;
+    CHECK_EQ(decode_report(&decoder, motion, sizeof(motion)), REPORT_MOTION | REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, (1u << 0) | (1u << 2) | (1u << 9));
+
+    // Releasing report 3's buttons keeps button 1; padding bits are not buttons
+    const uint8_t released[] = {0x03, 0x00};
+    CHECK_EQ(decode_report(&decoder, released, sizeof(released)), REPORT_BUTTONS);
+    CHECK_EQ(decoder.buttons, 1u << 0);
+
+    motion[13] = 0xFE;
+    decode_report(&decoder, motion, sizeof(motion));
+    CHECK_EQ(decoder.buttons, 1u << 1);
+}
+
+static void test_buttons_record(void)
+{
+    protocol_set_record_sink(capture_record);
+
+    // One record for a chord: the full bitmask and every bit that changed
+    protocol_buttons(2, 0x0102030405060708ull, 0x80000005u, 0x80000004u);
+    CHECK_EQ(sink_length, 18);
+    CHECK_EQ(sink_record[0], RECORD_BUTTONS);
+    CHECK_EQ(sink_record[1], 2);
+    CHECK_EQ(le32(sink_record + 2), 0x05060708u);
+    CHECK_EQ(le32(sink_record + 6), 0x01020304u);
+    CHECK_EQ(le32(sink_record + 10), 0x80000005u);
+    CHECK_EQ(le32(sink_record + 14), 0x80000004u);
+
+    protocol_set_record_sink(NULL);
+}
+
+int main(void)
+{
+    test_builtin_buttons();
+    test_table_buttons();
+    test_buttons_record();
+    return UNIT_TEST_RESULT();
+}
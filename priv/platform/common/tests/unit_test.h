@@ -0,0 +1,44 @@
+/*
+ * Minimal check macros for the native unit tests
+ *
+ * Each test_*.c is its own program: it runs its checks, prints every
+ * failed one with its line to stderr and exits non-zero if any failed.
+ * build.sh compiles them next to the readers in the test environment, and
+ * test/space_mouse/native_test.exs runs them under mix test.
+ */
+
+#ifndef UNIT_TEST_H
+#define UNIT_TEST_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+static int unit_test_failures = 0;
+
+#define CHECK(condition)                                                                      \
+    do                                                                                        \
+    {                                                                                         \
+        if (!(condition))                                                                     \
+        {                                                                                     \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition);     \
+            unit_test_failures++;                                                             \
+        }                                                                                     \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                            \
+    do                                                                                        \
+    {                                                                                         \
+        long long unit_test_actual = (long long)(actual);                                     \
+        long long unit_test_expected = (long long)(expected);                                 \
+        if (unit_test_actual != unit_test_expected)                                           \
+        {                                                                                     \
+            fprintf(stderr, "%s:%d: %s is %lld, expected %lld\n", __FILE__, __LINE__,         \
+                    #actual, unit_test_actual, unit_test_expected);                           \
+            unit_test_failures++;                                                             \
+        }                                                                                     \
+    } while (0)
+
+// Last statement of main()
+#define UNIT_TEST_RESULT() (unit_test_failures == 0 ? EXIT_SUCCESS : EXIT_FAILURE)
+
+#endif /* UNIT_TEST_H */
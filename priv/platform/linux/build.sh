@@ -0,0 +1,68 @@
+#!/bin/bash
+#
+# Build script for Linux hidraw reader
+#
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
+
+# When used as a dependency, Mix sets MIX_APP_PATH to the dependency's build directory
+# When building standalone, we need to find the project root
+if [ -n "$MIX_APP_PATH" ]; then
+    # Building as a dependency - use MIX_APP_PATH/priv
+    BUILD_DIR="$MIX_APP_PATH/priv/platform/linux"
+    echo "🔧 Building as dependency: $BUILD_DIR"
+else
+    # Building standalone - use project _build directory
+    PROJECT_ROOT="$(cd "$SCRIPT_DIR/../../.." && pwd)"
+    BUILD_DIR="$PROJECT_ROOT/_build/dev/lib/space_mouse/priv/platform/linux"
+    echo "🔧 Building standalone: $BUILD_DIR"
+fi
+
+# Create build directory if it doesn't exist
+mkdir -p "$BUILD_DIR"
+
+echo "🔨 Building Linux hidraw reader..."
+
+# Compile the C program to the build directory
+${CC:-cc} -O2 -Wall -Wextra \
+      -o "$BUILD_DIR/hid_reader" \
+      "$SCRIPT_DIR/hid_reader.c" \
+      "$SCRIPT_DIR/../common/port_protocol.c" \
+      "$SCRIPT_DIR/../common/capture.c" \
+      "$SCRIPT_DIR/../common/device_ids.c" \
+      "$SCRIPT_DIR/../common/led_cache.c" \
+      "$SCRIPT_DIR/../common/report_descriptor.c" \
+      "$SCRIPT_DIR/../common/calibration.c" \
+      "$SCRIPT_DIR/../common/response_curve.c" \
+      "$SCRIPT_DIR/../common/idle_filter.c" \
+      "$SCRIPT_DIR/../common/state_shm.c" \
+      "$SCRIPT_DIR/../common/event_server.c" \
+      -lm
+
+echo "✅ Build complete: $BUILD_DIR/hid_reader"
+echo "🧪 Test with: $BUILD_DIR/hid_reader --protocol=text"
+
+# Optional in-VM backend (config :space_mouse, platform: :linux_nif). Mix
+# passes ERTS_INCLUDE_DIR; standalone builds ask erl for it.
+if [ -z "$ERTS_INCLUDE_DIR" ] && command -v erl >/dev/null 2>&1; then
+    ERTS_INCLUDE_DIR="$(erl -noshell -eval 'io:format("~s/erts-~s/include", [code:root_dir(), erlang:system_info(version)]), halt().')"
+fi
+
+if [ -f "$ERTS_INCLUDE_DIR/erl_nif.h" ]; then
+    echo "🔨 Building hidraw NIF..."
+    ${CC:-cc} -O2 -Wall -Wextra -fPIC -shared \
+          -I"$ERTS_INCLUDE_DIR" \
+          -o "$BUILD_DIR/hidraw_nif.so" \
+          "$SCRIPT_DIR/hidraw_nif.c" \
+          "$SCRIPT_DIR/../common/led_cache.c" \
+          "$SCRIPT_DIR/../common/report_descriptor.c" \
+          "$SCRIPT_DIR/../common/calibration.c" \
+          "$SCRIPT_DIR/../common/response_curve.c" \
+          "$SCRIPT_DIR/../common/idle_filter.c" \
+          -lm
+    echo "✅ Build complete: $BUILD_DIR/hidraw_nif.so"
+else
+    echo "⚠️  erl_nif.h not found, skipping hidraw NIF"
+fi
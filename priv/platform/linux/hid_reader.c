@@ -0,0 +1,862 @@
+/*
+ * SpaceMouse HID Reader with LED Control for Linux
+ *
+ * Purpose: Linux counterpart of the macOS IOKit reader. Reads SpaceMouse
+ *          reports straight from /dev/hidraw* and speaks the same port
+ *          protocol, so the Elixir side does not care which reader runs.
+ *
+ * Responsibilities:
+ * - Detect SpaceMouse device connection/disconnection (inotify on /dev)
+ * - Track every attached SpaceMouse under a stable device ID (see
+ *   ../common/device_ids.h): serial number, else physical path
+ * - Read raw HID input reports (motion, buttons) from hidraw and decode
+ *   each one as a unit (see ../common/spacemouse_report.h), driven by a
+ *   table compiled from the device's report descriptor at attach time
+ *   (see ../common/report_descriptor.h)
+ * - Send HID output/feature reports (LED control)
+ * - Handle commands from stdin (Elixir port communication)
+ * - Output structured data to stdout for Elixir port communication
+ *
+ * Event Loop:
+ * A single epoll instance blocks on stdin, the inotify watch on /dev and
+ * every hidraw fd together. There is no polling interval: a report or a
+ * command is handled as soon as the kernel hands it over. Output queued
+ * during an iteration is flushed in one writev() before the next wait;
+ * stdout joins the epoll set only while the pipe is full.
+ *
+ * LED Control (see ../common/led_cache.h):
+ * The working LED method is cached per VID/PID, so after the first probe
+ * a toggle is one transfer. --led-cache=PATH keeps the cache across runs.
+ *
+ * Capture and Replay (see ../common/capture.h):
+ * --capture=PATH records every raw report while running normally.
+ * --replay=PATH skips /dev entirely and feeds the capture through the same
+ * decode path, paced by a timerfd (--replay-speed=1, N or max).
+ *
+ * Shared-Memory Snapshot (see ../common/state_shm.h):
+ * --shm=NAME publishes every device's latest frame and button bitmask in
+ * a seqlock-guarded POSIX shared-memory segment for wait-free sampling.
+ *
+ * Zero-Drift Calibration (see ../common/calibration.h):
+ * A running per-axis bias, learnt while the cap is still, is subtracted
+ * from every frame before anything else sees it (--auto-zero=). The
+ * CALIBRATE command takes the current frame as the zero point.
+ *
+ * Response Curves (see ../common/response_curve.h):
+ * --curve=AXES:KIND:PARAMS maps axes through expo, S-curve or piecewise
+ * linear curves, baked into 65536-entry tables at start-up.
+ *
+ * Idle Suppression (see ../common/idle_filter.h):
+ * After calibration and curves, a frame is emitted only when it differs
+ * from the device's last emitted frame by more than --idle-filter=EPSILON;
+ * a cap coming to rest sends one all-zero frame, then nothing until it
+ * moves (optionally re-sent every KEEPALIVE_MS while reports arrive).
+ *
+ * Socket Fan-Out (see ../common/event_server.h):
+ * --socket=PATH serves the binary record stream to local clients over a
+ * Unix domain socket. The listening socket and every client join the same
+ * epoll set; a slow client gets the latest frame, never a blocked reader.
+ *
+ * Communication Protocol (see ../common/port_protocol.h):
+ * The port selects the framing with --protocol=binary ({:packet, 2} records,
+ * the default used by PortManager) or --protocol=text (debug fallback).
+ *
+ * INPUT (from Elixir via stdin):
+ * - LED commands: "LED:on" or "LED:off" (every device), "LED:2:on" (device 2)
+ * - Calibration: "CALIBRATE" (every device), "CALIBRATE:2" (device 2)
+ *
+ * OUTPUT (to Elixir via stdout), shown in text form:
+ * - Output format: "TYPE:key1=value1,key2=value2"
+ * - STATUS messages: "STATUS:ready",
+ *   "STATUS:device_connected,device=1,vid=256f,pid=c635", "STATUS:device_disconnected,device=1"
+ * - MOTION events: "MOTION:device=1,t=1234567,x=123,y=456,z=789,rx=12,ry=34,rz=56"
+ * - BUTTONS events: "BUTTONS:device=1,t=1234567,buttons=3,changed=1" (hex bitmasks,
+ *   bit 0 = button 1; t: CLOCK_MONOTONIC µs at read)
+ * - LED confirmations: "LED:device=1,state=on,method=1"
+ * - Calibration confirmations: "STATUS:calibrated,device=1"
+ *
+ * Compile: cc -O2 -o hid_reader hid_reader.c ../common/port_protocol.c ../common/capture.c ../common/device_ids.c \
+ *          ../common/led_cache.c ../common/report_descriptor.c ../common/calibration.c ../common/response_curve.c \
+ *          ../common/idle_filter.c ../common/state_shm.c ../common/event_server.c -lm
+ */
+
+#define _GNU_SOURCE
+
+#include <linux/hidraw.h>
+#include <sys/epoll.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/calibration.h"
+#include "../common/capture.h"
+#include "../common/device_ids.h"
+#include "../common/event_server.h"
+#include "../common/idle_filter.h"
+#include "../common/led_cache.h"
+#include "../common/port_protocol.h"
+#include "../common/report_descriptor.h"
+#include "../common/response_curve.h"
+#include "../common/spacemouse_report.h"
+#include "../common/state_shm.h"
+
+// 3Dconnexion SpaceMouse vendor ID
+#define SPACEMOUSE_VENDOR_ID 0x256F
+
+#define MAX_EVENTS 8
+#define REPLAY_BATCH 256
+#define MAX_REPORT_SIZE 64
+
+// epoll tags so the loop knows which source fired
+enum event_source
+{
+    SOURCE_STDIN = 1,
+    SOURCE_INOTIFY = 2,
+    SOURCE_STDOUT = 4,
+    SOURCE_REPLAY = 5,
+    SOURCE_SOCKET = 6,
+    SOURCE_HIDRAW = 16, // + device ID
+    SOURCE_CLIENT = 32  // + socket client index
+};
+
+// One attached SpaceMouse, indexed by its device ID (see device_ids.h)
+struct hid_device
+{
+    bool connected;
+    int fd;             // -1 for replayed devices
+    char node[32];      // hidraw node name, matched against IN_DELETE
+    uint16_t vendor_id;
+    uint16_t product_id;
+    struct report_table table; // compiled report descriptor
+    struct report_decoder decoder;
+    struct calibration calibration;
+    struct idle_filter idle_filter;
+    uint32_t button_mask;
+};
+
+// Global state
+static int epoll_fd = -1;
+static int inotify_fd = -1;
+static struct hid_device devices[MAX_DEVICES + 1];
+static bool stdout_watched = false;
+static bool client_watched[MAX_CLIENTS]; // client in the set for EPOLLOUT
+static int replay_timer_fd = -1;
+static bool replay_due = false;
+
+// Report capture time: CLOCK_MONOTONIC in microseconds, taken right after
+// read() returns the report
+static uint64_t monotonic_us(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000u + (uint64_t)now.tv_nsec / 1000u;
+}
+
+// Emit one BUTTONS record (full bitmask plus changed bits) if any button
+// changed since the previous report
+static void emit_button_changes(uint8_t id, uint64_t timestamp_us, uint32_t new_mask)
+{
+    struct hid_device *device = &devices[id];
+    uint32_t changed = new_mask ^ device->button_mask;
+
+    if (changed)
+    {
+        protocol_buttons(id, timestamp_us, new_mask, changed);
+        state_shm_buttons(id, timestamp_us, new_mask);
+    }
+
+    device->button_mask = new_mask;
+}
+
+// Emit the decoder's frame, zero-corrected and through the curves, unless
+// the idle filter suppresses it
+static void emit_motion(uint8_t id, uint64_t timestamp_us)
+{
+    struct hid_device *device = &devices[id];
+    int16_t frame[6];
+
+    calibration_apply(&device->calibration, device->decoder.frame, frame);
+    response_curve_apply(frame, frame);
+    if (!idle_filter_pass(&device->idle_filter, frame, timestamp_us))
+        return;
+    protocol_motion(id, timestamp_us, frame);
+    state_shm_motion(id, timestamp_us, frame);
+}
+
+// Decode one raw input report and emit the resulting event
+static void handle_report(uint8_t id, uint64_t timestamp_us, const uint8_t *report, ssize_t length)
+{
+    struct report_decoder *decoder = &devices[id].decoder;
+    int kind = decode_report(decoder, report, (size_t)length);
+
+    if (kind & REPORT_MOTION)
+        emit_motion(id, timestamp_us);
+    if (kind & REPORT_BUTTONS)
+        emit_button_changes(id, timestamp_us, decoder->buttons);
+}
+
+// Try one LED control method (see ../common/led_cache.h for the order).
+// Only failures are reported; a cached method that works stays silent.
+static bool try_led_method(void *device, int method, bool on)
+{
+    int fd = *(int *)device;
+    int result = -1;
+
+    switch (method)
+    {
+    case 1: // Method 1: Output report ID 4 (interrupt OUT / SET_REPORT)
+    {
+        uint8_t report_data[2] = {0x04, on ? 1 : 0};
+        result = (write(fd, report_data, sizeof(report_data)) == sizeof(report_data)) ? 0 : -errno;
+        break;
+    }
+
+    case 2: // Method 2: Feature report ID 4 (backup method)
+    {
+        uint8_t report_data[2] = {0x04, on ? 1 : 0};
+        result = (ioctl(fd, HIDIOCSFEATURE(sizeof(report_data)), report_data) < 0) ? -errno : 0;
+        break;
+    }
+
+    case 3: // Method 3: Feature report ID 7
+    {
+        uint8_t report_data[2] = {0x07, on ? 1 : 0};
+        result = (ioctl(fd, HIDIOCSFEATURE(sizeof(report_data)), report_data) < 0) ? -errno : 0;
+        break;
+    }
+
+    case 4: // Method 4: Extended feature report
+    {
+        uint8_t report_data[3] = {0x04, on ? 1 : 0, 0x00};
+        result = (ioctl(fd, HIDIOCSFEATURE(sizeof(report_data)), report_data) < 0) ? -errno : 0;
+        break;
+    }
+    }
+
+    if (result != 0)
+        protocol_info("led_method=%d,result=%d", method, result);
+
+    return (result == 0);
+}
+
+// Send LED control command to one SpaceMouse: one transfer once the
+// model's method is cached
+static bool send_led_command(uint8_t id, bool on)
+{
+    struct hid_device *device = &devices[id];
+
+    if (!device->connected || device->fd < 0)
+    {
+        protocol_info("led_failed=device_not_available,device=%d", id);
+        return false;
+    }
+
+    int method = led_cache_send(device->vendor_id, device->product_id, try_led_method, &device->fd, on);
+    if (!method)
+    {
+        protocol_info("led_failed=all_methods_failed,device=%d", id);
+        return false;
+    }
+
+    protocol_led(id, on, method);
+    return true;
+}
+
+// Take the current frame as the zero point and emit the corrected frame
+static void calibrate_device(uint8_t id)
+{
+    calibration_zero(&devices[id].calibration, devices[id].decoder.frame);
+    protocol_info("calibrated,device=%u", id);
+    emit_motion(id, monotonic_us());
+}
+
+// Handle command from stdin
+static void handle_stdin_command(const char *line)
+{
+    uint8_t id;
+
+    if (strncmp(line, "LED:", 4) == 0)
+    {
+        bool on;
+
+        if (!protocol_parse_led_args(line + 4, &id, &on))
+        {
+            protocol_info("unknown_led_command=%s", line + 4);
+        }
+        else if (id != 0)
+        {
+            send_led_command(id, on);
+        }
+        else
+        {
+            // Every attached device
+            bool any = false;
+            for (uint8_t i = 1; i <= MAX_DEVICES; i++)
+            {
+                if (devices[i].connected)
+                {
+                    send_led_command(i, on);
+                    any = true;
+                }
+            }
+            if (!any)
+                protocol_info("led_failed=device_not_available");
+        }
+    }
+    else if (protocol_parse_calibrate(line, &id))
+    {
+        bool any = false;
+        for (uint8_t i = 1; i <= MAX_DEVICES; i++)
+        {
+            if (devices[i].connected && (id == 0 || id == i))
+            {
+                calibrate_device(i);
+                any = true;
+            }
+        }
+        if (!any)
+            protocol_info("calibrate_failed=device_not_available");
+    }
+    else
+    {
+        protocol_info("unknown_command=%s", line);
+    }
+}
+
+// Check whether a hidraw node belongs to a SpaceMouse and open it
+static int open_spacemouse(const char *path, struct hidraw_devinfo *info)
+{
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        fd = open(path, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (ioctl(fd, HIDIOCGRAWINFO, info) < 0 || (uint16_t)info->vendor != SPACEMOUSE_VENDOR_ID)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Identity for a stable device ID: serial number if the device reports
+// one, else the physical USB/Bluetooth path, else the node name
+static void device_identity(int fd, const char *node, char *identity, size_t size)
+{
+    char buffer[96] = "";
+
+#ifdef HIDIOCGRAWUNIQ
+    if (ioctl(fd, HIDIOCGRAWUNIQ(sizeof(buffer)), buffer) > 0 && buffer[0])
+    {
+        snprintf(identity, size, "uniq:%s", buffer);
+        return;
+    }
+#endif
+
+    if (ioctl(fd, HIDIOCGRAWPHYS(sizeof(buffer)), buffer) > 0 && buffer[0])
+        snprintf(identity, size, "phys:%s", buffer);
+    else
+        snprintf(identity, size, "node:%.64s", node);
+}
+
+// Compile the device's report descriptor; table->valid stays false if the
+// kernel does not hand it out or it describes no axes
+static void read_report_table(int fd, struct report_table *table)
+{
+    struct hidraw_report_descriptor descriptor;
+    int size = 0;
+
+    table->valid = false;
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &size) < 0 || size <= 0 || size > HID_MAX_DESCRIPTOR_SIZE)
+        return;
+
+    descriptor.size = (uint32_t)size;
+    if (ioctl(fd, HIDIOCGRDESC, &descriptor) < 0)
+        return;
+
+    report_table_build(table, descriptor.value, descriptor.size);
+}
+
+static bool node_attached(const char *node)
+{
+    for (int id = 1; id <= MAX_DEVICES; id++)
+    {
+        if (devices[id].connected && strcmp(devices[id].node, node) == 0)
+            return true;
+    }
+    return false;
+}
+
+// Mark a device attached and announce it
+static void attach_device(uint8_t id, int fd, const char *node, uint16_t vendor_id, uint16_t product_id)
+{
+    struct hid_device *device = &devices[id];
+
+    device->connected = true;
+    device->fd = fd;
+    snprintf(device->node, sizeof(device->node), "%s", node);
+    device->vendor_id = vendor_id;
+    device->product_id = product_id;
+    device->button_mask = 0;
+
+    // Replayed captures carry no descriptor and use the built-in layouts
+    if (fd >= 0)
+        read_report_table(fd, &device->table);
+    else
+        device->table.valid = false;
+    report_decoder_init(&device->decoder, &device->table);
+    calibration_reset(&device->calibration);
+    idle_filter_reset(&device->idle_filter);
+
+    protocol_device_connected(id, vendor_id, product_id);
+    state_shm_device(id, true, vendor_id, product_id);
+    if (!device->table.valid)
+        protocol_info("report_layout=builtin,device=%u", id);
+}
+
+// Attach to a hidraw node if it is a SpaceMouse not attached yet
+static void try_attach(const char *name)
+{
+    if (strncmp(name, "hidraw", 6) != 0 || node_attached(name))
+        return;
+
+    char path[64];
+    snprintf(path, sizeof(path), "/dev/%s", name);
+
+    struct hidraw_devinfo info;
+    int fd = open_spacemouse(path, &info);
+    if (fd < 0)
+        return;
+
+    char identity[128];
+    device_identity(fd, name, identity, sizeof(identity));
+
+    uint8_t id = device_ids_acquire(identity);
+    if (!id)
+    {
+        protocol_info("device_ignored=%s,reason=too_many_devices", name);
+        close(fd);
+        return;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = SOURCE_HIDRAW + id};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+    {
+        device_ids_release(id);
+        close(fd);
+        return;
+    }
+
+    capture_device(id, monotonic_us(), (uint16_t)info.vendor, (uint16_t)info.product, true);
+    attach_device(id, fd, name, (uint16_t)info.vendor, (uint16_t)info.product);
+}
+
+// Detach one device
+static void detach_device(uint8_t id)
+{
+    struct hid_device *device = &devices[id];
+
+    if (!device->connected)
+        return;
+
+    if (device->fd >= 0)
+    {
+        epoll_ctl(epoll_fd, EPOLL_CTL_DEL, device->fd, NULL);
+        close(device->fd);
+        capture_device(id, monotonic_us(), 0, 0, false);
+    }
+
+    device->fd = -1;
+    device->node[0] = '\0';
+    device->connected = false;
+    device_ids_release(id);
+
+    protocol_device_disconnected(id);
+    state_shm_device(id, false, 0, 0);
+}
+
+// Scan /dev for SpaceMice that are already present
+static void scan_devices(void)
+{
+    DIR *dir = opendir("/dev");
+    if (!dir)
+        return;
+
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL)
+    {
+        try_attach(entry->d_name);
+    }
+
+    closedir(dir);
+}
+
+// Process hotplug notifications for /dev
+static void handle_inotify(void)
+{
+    char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    ssize_t length = read(inotify_fd, buffer, sizeof(buffer));
+
+    for (char *ptr = buffer; length > 0 && ptr < buffer + length;)
+    {
+        const struct inotify_event *event = (const struct inotify_event *)ptr;
+
+        if (event->len > 0)
+        {
+            if (event->mask & (IN_CREATE | IN_ATTRIB))
+            {
+                // IN_ATTRIB covers udev fixing permissions after creation
+                try_attach(event->name);
+            }
+            else if (event->mask & IN_DELETE)
+            {
+                for (uint8_t id = 1; id <= MAX_DEVICES; id++)
+                {
+                    if (devices[id].connected && strcmp(devices[id].node, event->name) == 0)
+                        detach_device(id);
+                }
+            }
+        }
+
+        ptr += sizeof(struct inotify_event) + event->len;
+    }
+}
+
+// Read every pending report from one device
+static void handle_hidraw(uint8_t id, uint32_t events)
+{
+    struct hid_device *device = &devices[id];
+    uint8_t report[MAX_REPORT_SIZE];
+
+    while (true)
+    {
+        ssize_t length = read(device->fd, report, sizeof(report));
+        if (length > 0)
+        {
+            uint64_t timestamp_us = monotonic_us();
+            capture_report(id, timestamp_us, report, (size_t)length);
+            handle_report(id, timestamp_us, report, length);
+            continue;
+        }
+
+        if (length < 0 && (errno == EAGAIN || errno == EINTR))
+            break;
+
+        // EOF or hard error: device went away
+        detach_device(id);
+        return;
+    }
+
+    if (events & (EPOLLHUP | EPOLLERR))
+        detach_device(id);
+}
+
+// Replayed attach/detach: same status events as a live device, no fd
+static void replay_device(uint8_t id, uint64_t timestamp_us __attribute__((unused)),
+                          uint16_t vendor_id, uint16_t product_id, bool attached)
+{
+    if (id < 1 || id > MAX_DEVICES)
+        return;
+
+    if (attached && !devices[id].connected)
+        attach_device(id, -1, "replay", vendor_id, product_id);
+    else if (!attached)
+        detach_device(id);
+}
+
+// Replayed reports go through the same decode path as live ones
+static void replay_report(uint8_t id, uint64_t timestamp_us, const uint8_t *report, size_t length)
+{
+    if (id >= 1 && id <= MAX_DEVICES && devices[id].connected)
+        handle_report(id, timestamp_us, report, (ssize_t)length);
+}
+
+static const struct replay_handlers replay_handlers = {
+    .device = replay_device,
+    .report = replay_report,
+};
+
+// Deliver every replay record that is due, a batch at a time so stdin and
+// output keep flowing; then sleep on the timer until the next one
+static void pump_replay(void)
+{
+    for (int i = 0; i < REPLAY_BATCH; i++)
+    {
+        int64_t delay = replay_next_delay_us(monotonic_us());
+
+        if (delay < 0)
+        {
+            for (uint8_t id = 1; id <= MAX_DEVICES; id++)
+                detach_device(id);
+            protocol_info("replay_complete");
+            replay_due = false;
+            return;
+        }
+
+        if (delay > 0)
+        {
+            struct itimerspec timer = {
+                .it_value = {.tv_sec = delay / 1000000, .tv_nsec = (delay % 1000000) * 1000},
+            };
+            timerfd_settime(replay_timer_fd, 0, &timer, NULL);
+            replay_due = false;
+            return;
+        }
+
+        replay_step(&replay_handlers);
+    }
+
+    replay_due = true;
+}
+
+// Flush queued output; watch stdout for EPOLLOUT only while the pipe is full
+static void flush_output(void)
+{
+    bool drained = protocol_flush();
+
+    if (drained == !stdout_watched)
+        return;
+
+    struct epoll_event ev = {.events = EPOLLOUT, .data.u32 = SOURCE_STDOUT};
+    if (epoll_ctl(epoll_fd, drained ? EPOLL_CTL_DEL : EPOLL_CTL_ADD, STDOUT_FILENO, &ev) == 0)
+        stdout_watched = !drained;
+}
+
+// Accept every pending socket client and add it to the epoll set
+static void accept_clients(void)
+{
+    int client;
+    while ((client = event_server_accept()) >= 0)
+    {
+        struct epoll_event ev = {.events = EPOLLIN, .data.u32 = SOURCE_CLIENT + client};
+        epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_server_client_fd(client), &ev);
+        client_watched[client] = false;
+    }
+}
+
+// Flush socket clients; a client is watched for EPOLLOUT only while its
+// socket is full. Closed clients left the set with their fd.
+static void flush_clients(void)
+{
+    if (event_server_listen_fd() < 0)
+        return;
+
+    event_server_flush();
+
+    for (int client = 0; client < MAX_CLIENTS; client++)
+    {
+        int fd = event_server_client_fd(client);
+        bool pending = event_server_client_pending(client);
+
+        if (fd < 0 || pending == client_watched[client])
+            continue;
+
+        struct epoll_event ev = {.events = EPOLLIN | (pending ? EPOLLOUT : 0), .data.u32 = SOURCE_CLIENT + client};
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) == 0)
+            client_watched[client] = pending;
+    }
+}
+
+// Replace device discovery with a timer that paces the capture
+static bool initialize_replay(void)
+{
+    replay_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (replay_timer_fd < 0)
+    {
+        fprintf(stderr, "ERROR: Failed to create replay timer (%s)\n", strerror(errno));
+        return false;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = SOURCE_REPLAY};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, replay_timer_fd, &ev) < 0)
+    {
+        fprintf(stderr, "ERROR: Failed to watch replay timer (%s)\n", strerror(errno));
+        return false;
+    }
+
+    replay_due = true;
+    return true;
+}
+
+// Initialize epoll, inotify and the initial device scan
+static bool initialize_hid_system(void)
+{
+    epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd < 0)
+    {
+        fprintf(stderr, "ERROR: Failed to create epoll instance (%s)\n", strerror(errno));
+        return false;
+    }
+
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = SOURCE_STDIN};
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, STDIN_FILENO, &ev) < 0)
+    {
+        fprintf(stderr, "ERROR: Failed to watch stdin (%s)\n", strerror(errno));
+        return false;
+    }
+
+    if (event_server_listen_fd() >= 0)
+    {
+        ev.data.u32 = SOURCE_SOCKET;
+        if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, event_server_listen_fd(), &ev) < 0)
+        {
+            fprintf(stderr, "ERROR: Failed to watch socket (%s)\n", strerror(errno));
+            return false;
+        }
+    }
+
+    if (replay_enabled())
+        return initialize_replay();
+
+    inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotify_fd < 0 || inotify_add_watch(inotify_fd, "/dev", IN_CREATE | IN_DELETE | IN_ATTRIB) < 0)
+    {
+        fprintf(stderr, "ERROR: Failed to watch /dev for hotplug (%s)\n", strerror(errno));
+        return false;
+    }
+
+    ev.data.u32 = SOURCE_INOTIFY;
+    if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, inotify_fd, &ev) < 0)
+    {
+        fprintf(stderr, "ERROR: Failed to watch inotify fd (%s)\n", strerror(errno));
+        return false;
+    }
+
+    return true;
+}
+
+// Cleanup HID system
+static void cleanup_hid_system(void)
+{
+    for (int id = 1; id <= MAX_DEVICES; id++)
+    {
+        if (devices[id].connected && devices[id].fd >= 0)
+            close(devices[id].fd);
+    }
+    if (replay_timer_fd >= 0)
+        close(replay_timer_fd);
+    if (inotify_fd >= 0)
+        close(inotify_fd);
+    if (epoll_fd >= 0)
+        close(epoll_fd);
+}
+
+// Main entry point
+int main(int argc, char *argv[])
+{
+    protocol_init(argc, argv);
+
+    if (!capture_init(argc, argv) || !calibration_init(argc, argv) || !response_curve_init(argc, argv) ||
+        !idle_filter_init(argc, argv) || !state_shm_init(argc, argv) || !event_server_init(argc, argv))
+    {
+        state_shm_close();
+        return 1;
+    }
+
+    led_cache_init(argc, argv);
+
+    // Initialize HID system
+    if (!initialize_hid_system())
+    {
+        cleanup_hid_system();
+        state_shm_close();
+        event_server_close();
+        return 1;
+    }
+
+    // Signal ready state
+    protocol_status(STATUS_READY);
+
+    if (!replay_enabled())
+        scan_devices();
+
+    // Block until the device, hotplug or stdin has something for us. All
+    // output produced by one iteration goes out in one flush.
+    bool running = true;
+    while (running)
+    {
+        flush_output();
+        flush_clients();
+
+        // Replay batches keep going without sleeping while the port keeps
+        // up; a full pipe pauses them, so even max speed is lossless
+        bool replay_ready = replay_due && !stdout_watched;
+
+        struct epoll_event events[MAX_EVENTS];
+        int count = epoll_wait(epoll_fd, events, MAX_EVENTS, replay_ready ? 0 : -1);
+
+        if (count < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (int i = 0; i < count; i++)
+        {
+            switch (events[i].data.u32)
+            {
+            case SOURCE_STDIN:
+                running = protocol_read_commands(STDIN_FILENO, handle_stdin_command);
+                break;
+            case SOURCE_INOTIFY:
+                handle_inotify();
+                break;
+            case SOURCE_STDOUT:
+                // Pipe drained; the flush at the top of the loop resumes output
+                break;
+            case SOURCE_SOCKET:
+                accept_clients();
+                break;
+            case SOURCE_REPLAY:
+            {
+                uint64_t expirations;
+                if (read(replay_timer_fd, &expirations, sizeof(expirations)) > 0)
+                    replay_due = true;
+                break;
+            }
+            default:
+            {
+                if (events[i].data.u32 >= SOURCE_CLIENT)
+                {
+                    // Queued output goes out with the flush at the top
+                    int client = (int)(events[i].data.u32 - SOURCE_CLIENT);
+                    if ((events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && event_server_client_fd(client) >= 0)
+                        event_server_client_readable(client);
+                    break;
+                }
+
+                uint32_t id = events[i].data.u32 - SOURCE_HIDRAW;
+                if (id >= 1 && id <= MAX_DEVICES && devices[id].connected)
+                    handle_hidraw((uint8_t)id, events[i].events);
+                break;
+            }
+            }
+        }
+
+        if (replay_due && !stdout_watched)
+            pump_replay();
+    }
+
+    // Best effort: hand over whatever is still queued
+    protocol_flush();
+    event_server_flush();
+
+    capture_close();
+    state_shm_close();
+    event_server_close();
+    cleanup_hid_system();
+    return 0;
+}
@@ -0,0 +1,885 @@
+/*
+ * SpaceMouse hidraw NIF for Linux
+ *
+ * Purpose: In-VM alternative to hid_reader for SpaceMouse.Platform.Linux.NifBridge.
+ *          The hidraw fd is opened inside the VM and watched with
+ *          enif_select(), so a report goes kernel -> owner process with no
+ *          reader process, pipe, port or PortManager in between.
+ *
+ * Flow:
+ * - list_devices/0 returns every SpaceMouse hidraw node with its identity
+ *   (serial number, else physical path); the bridge maps identities to
+ *   stable device IDs
+ * - watch_devices/1 watches /dev with inotify for the owner, like the
+ *   reader: on {:select, watch, :undefined, :ready_input} it calls
+ *   read_watch/1 for the hidraw nodes created (or given their permissions)
+ *   since, and probe_devices/1 opens only those, so no node is opened
+ *   while nothing is plugged in
+ * - open_device/3 opens one node non-blocking under a device ID and arms
+ *   enif_select() for the owner process; every event it produces carries
+ *   that ID
+ * - The reader (the owner at first) receives
+ *   {:select, resource, :undefined, :ready_input} and calls read_events/1,
+ *   which drains the fd, decodes every report with the shared decoder
+ *   (../common/spacemouse_report.h), driven by the report descriptor
+ *   compiled in open_device/3, and sends the reader the same
+ *   {:hid_event, event} terms PortManager would have produced
+ * - set_reader/2 moves the notifications and the motion and buttons events
+ *   to another process (the device's own process); status events always go
+ *   to the owner. read_events/1 then runs in the reader while the owner
+ *   still sets the LED or calibrates, so every call on a device takes its
+ *   lock
+ * - On ENODEV the fd is released and "device_disconnected" is sent
+ * - The owner is monitored: if it exits (a crashed or restarted manager)
+ *   the fd is released, so the next owner can open the node again
+ * - set_curves/1 installs the response curves (../common/response_curve.h)
+ *   that motion frames are mapped through, as the readers do for --curve=
+ * - Frames are zero-corrected first (../common/calibration.h): set_auto_zero/1
+ *   takes the readers' --auto-zero= value, calibrate/1 stands in for their
+ *   CALIBRATE command
+ * - The idle filter (../common/idle_filter.h) drops unchanged frames and
+ *   repeated rest frames; set_idle_filter/1 takes the readers'
+ *   --idle-filter= value
+ *
+ * A crash in here takes the VM down with it; hid_reader stays the default.
+ *
+ * Compile: cc -O2 -fPIC -shared -I$ERTS_INCLUDE_DIR -o hidraw_nif.so hidraw_nif.c ../common/led_cache.c \
+ *          ../common/report_descriptor.c ../common/calibration.c ../common/response_curve.c \
+ *          ../common/idle_filter.c -lm
+ */
+
+#define _GNU_SOURCE
+
+#include <linux/hidraw.h>
+#include <sys/inotify.h>
+#include <sys/ioctl.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <erl_nif.h>
+
+#include "../common/calibration.h"
+#include "../common/idle_filter.h"
+#include "../common/led_cache.h"
+#include "../common/report_descriptor.h"
+#include "../common/response_curve.h"
+#include "../common/spacemouse_report.h"
+
+// 3Dconnexion SpaceMouse vendor ID
+#define SPACEMOUSE_VENDOR_ID 0x256F
+
+// Reports handled per read_events/1 call, to keep each NIF call short
+#define MAX_REPORTS_PER_CALL 64
+#define MAX_REPORT_SIZE 64
+
+struct hidraw_device
+{
+    int fd;
+    int device_id;
+    bool selected; // enif_select() owns the fd until its stop callback
+    ErlNifPid owner;  // status events; monitored
+    ErlNifPid reader; // select notifications, motion and buttons events
+    ErlNifMutex *lock;
+    uint16_t vendor_id;
+    uint16_t product_id;
+    struct report_table table; // compiled report descriptor
+    struct report_decoder decoder;
+    struct calibration calibration;
+    struct idle_filter idle_filter;
+    uint32_t button_mask;
+};
+
+// inotify watch on /dev, selected for its owner
+struct hidraw_watch
+{
+    int fd;
+    bool selected;
+    ErlNifPid owner; // monitored
+};
+
+static ErlNifResourceType *device_resource_type = NULL;
+static ErlNifResourceType *watch_resource_type = NULL;
+
+static ERL_NIF_TERM atom_ok;
+static ERL_NIF_TERM atom_error;
+static ERL_NIF_TERM atom_closed;
+static ERL_NIF_TERM atom_undefined;
+static ERL_NIF_TERM atom_true;
+static ERL_NIF_TERM atom_hid_event;
+static ERL_NIF_TERM atom_type;
+static ERL_NIF_TERM atom_motion;
+static ERL_NIF_TERM atom_buttons;
+static ERL_NIF_TERM atom_status;
+static ERL_NIF_TERM atom_message;
+static ERL_NIF_TERM atom_device_id;
+static ERL_NIF_TERM atom_vendor_id;
+static ERL_NIF_TERM atom_product_id;
+static ERL_NIF_TERM atom_timestamp;
+static ERL_NIF_TERM atom_data;
+static ERL_NIF_TERM atom_device_timestamp;
+static ERL_NIF_TERM atom_received_at;
+static ERL_NIF_TERM atom_changed;
+static ERL_NIF_TERM atom_no_device;
+static ERL_NIF_TERM atom_all_methods_failed;
+static ERL_NIF_TERM axis_atoms[AXIS_COUNT];
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+static ERL_NIF_TERM error_tuple(ErlNifEnv *env, ERL_NIF_TERM reason)
+{
+    return enif_make_tuple2(env, atom_error, reason);
+}
+
+static ERL_NIF_TERM make_binary(ErlNifEnv *env, const char *text)
+{
+    ErlNifBinary binary;
+
+    enif_alloc_binary(strlen(text), &binary);
+    memcpy(binary.data, text, binary.size);
+    return enif_make_binary(env, &binary);
+}
+
+// Send {:hid_event, %{type: :status, message: ..., device_id: ..., timestamp: ms}},
+// plus vendor_id/product_id for "device_connected"
+static void send_status(ErlNifEnv *env, struct hidraw_device *device, const char *message)
+{
+    bool connected = (strcmp(message, "device_connected") == 0);
+    ERL_NIF_TERM keys[6] = {atom_type, atom_message, atom_device_id, atom_timestamp, atom_vendor_id, atom_product_id};
+    ERL_NIF_TERM values[6] = {
+        atom_status,
+        make_binary(env, message),
+        enif_make_int(env, device->device_id),
+        enif_make_int64(env, enif_monotonic_time(ERL_NIF_MSEC)),
+        enif_make_int(env, device->vendor_id),
+        enif_make_int(env, device->product_id),
+    };
+    ERL_NIF_TERM event;
+
+    enif_make_map_from_arrays(env, keys, values, connected ? 6 : 4, &event);
+    enif_send(env, &device->owner, NULL, enif_make_tuple2(env, atom_hid_event, event));
+}
+
+// Send {:hid_event, %{type: type, device_id:, data: data, device_timestamp:, received_at:}}
+static void send_event(ErlNifEnv *env, struct hidraw_device *device, ERL_NIF_TERM type, ERL_NIF_TERM data, uint64_t timestamp_us)
+{
+    ERL_NIF_TERM keys[5] = {atom_type, atom_device_id, atom_data, atom_device_timestamp, atom_received_at};
+    ERL_NIF_TERM values[5] = {
+        type,
+        enif_make_int(env, device->device_id),
+        data,
+        enif_make_uint64(env, timestamp_us),
+        enif_make_int64(env, enif_monotonic_time(ERL_NIF_USEC)),
+    };
+    ERL_NIF_TERM event;
+
+    enif_make_map_from_arrays(env, keys, values, 5, &event);
+    enif_send(env, &device->reader, NULL, enif_make_tuple2(env, atom_hid_event, event));
+}
+
+static void send_motion(ErlNifEnv *env, struct hidraw_device *device, uint64_t timestamp_us)
+{
+    ERL_NIF_TERM values[AXIS_COUNT];
+    ERL_NIF_TERM data;
+    int16_t frame[AXIS_COUNT];
+
+    calibration_apply(&device->calibration, device->decoder.frame, frame);
+    response_curve_apply(frame, frame);
+    if (!idle_filter_pass(&device->idle_filter, frame, timestamp_us))
+        return;
+
+    for (int i = 0; i < AXIS_COUNT; i++)
+        values[i] = enif_make_int(env, frame[i]);
+
+    enif_make_map_from_arrays(env, axis_atoms, values, AXIS_COUNT, &data);
+    send_event(env, device, atom_motion, data, timestamp_us);
+}
+
+// One buttons event (full bitmask plus changed bits) per report that
+// changed any button, like the readers
+static void send_button_changes(ErlNifEnv *env, struct hidraw_device *device, uint64_t timestamp_us)
+{
+    uint32_t new_mask = device->decoder.buttons;
+    uint32_t changed = new_mask ^ device->button_mask;
+
+    if (changed)
+    {
+        ERL_NIF_TERM keys[2] = {atom_buttons, atom_changed};
+        ERL_NIF_TERM values[2] = {enif_make_uint(env, new_mask), enif_make_uint(env, changed)};
+        ERL_NIF_TERM data;
+
+        enif_make_map_from_arrays(env, keys, values, 2, &data);
+        send_event(env, device, atom_buttons, data, timestamp_us);
+    }
+
+    device->button_mask = new_mask;
+}
+
+// Hand the fd back: closed right away, or by the stop callback once
+// enif_select() has let go of it
+static void release_fd(ErlNifEnv *env, struct hidraw_device *device)
+{
+    int fd = device->fd;
+
+    if (fd < 0)
+        return;
+
+    device->fd = -1;
+
+    if (device->selected)
+        enif_select(env, (ErlNifEvent)fd, ERL_NIF_SELECT_STOP, device, NULL, atom_undefined);
+    else
+        close(fd);
+}
+
+static void device_stop(ErlNifEnv *env __attribute__((unused)), void *obj, ErlNifEvent event,
+                        int is_direct_call __attribute__((unused)))
+{
+    struct hidraw_device *device = obj;
+
+    close((int)event);
+    device->selected = false;
+}
+
+// The owner exited without close_device/1: nothing reads this fd any more,
+// and while selected it would keep the resource (and the node) open
+static void device_down(ErlNifEnv *env, void *obj, ErlNifPid *pid __attribute__((unused)),
+                        ErlNifMonitor *monitor __attribute__((unused)))
+{
+    struct hidraw_device *device = obj;
+
+    enif_mutex_lock(device->lock);
+    release_fd(env, device);
+    enif_mutex_unlock(device->lock);
+}
+
+static void device_dtor(ErlNifEnv *env __attribute__((unused)), void *obj)
+{
+    struct hidraw_device *device = obj;
+
+    // Only reachable while unselected: a selected fd keeps the resource alive
+    if (device->fd >= 0)
+        close(device->fd);
+    if (device->lock)
+        enif_mutex_destroy(device->lock);
+}
+
+// Open a hidraw node if it belongs to a SpaceMouse; -1 otherwise
+static int open_spacemouse(const char *path, struct hidraw_devinfo *info)
+{
+    int fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0)
+        return -1;
+
+    if (ioctl(fd, HIDIOCGRAWINFO, info) < 0 || (uint16_t)info->vendor != SPACEMOUSE_VENDOR_ID)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+// Same identity as the hidraw reader: serial number, else physical path
+static void device_identity(int fd, const char *node, char *identity, size_t size)
+{
+    char buffer[96] = "";
+
+#ifdef HIDIOCGRAWUNIQ
+    if (ioctl(fd, HIDIOCGRAWUNIQ(sizeof(buffer)), buffer) > 0 && buffer[0])
+    {
+        snprintf(identity, size, "uniq:%s", buffer);
+        return;
+    }
+#endif
+
+    if (ioctl(fd, HIDIOCGRAWPHYS(sizeof(buffer)), buffer) > 0 && buffer[0])
+        snprintf(identity, size, "phys:%s", buffer);
+    else
+        snprintf(identity, size, "node:%.64s", node);
+}
+
+// Same as the hidraw reader: compile the report descriptor, table->valid
+// stays false if it is unavailable
+static void read_report_table(int fd, struct report_table *table)
+{
+    struct hidraw_report_descriptor descriptor;
+    int size = 0;
+
+    table->valid = false;
+    if (ioctl(fd, HIDIOCGRDESCSIZE, &size) < 0 || size <= 0 || size > HID_MAX_DESCRIPTOR_SIZE)
+        return;
+
+    descriptor.size = (uint32_t)size;
+    if (ioctl(fd, HIDIOCGRDESC, &descriptor) < 0)
+        return;
+
+    report_table_build(table, descriptor.value, descriptor.size);
+}
+
+// Prepend {path, identity} to list if path is a SpaceMouse node
+static ERL_NIF_TERM probe_path(ErlNifEnv *env, const char *path, ERL_NIF_TERM list)
+{
+    struct hidraw_devinfo info;
+    int fd = open_spacemouse(path, &info);
+    if (fd < 0)
+        return list;
+
+    const char *node = strrchr(path, '/');
+    char identity[128];
+    device_identity(fd, node ? node + 1 : path, identity, sizeof(identity));
+    close(fd);
+
+    ERL_NIF_TERM item = enif_make_tuple2(env, make_binary(env, path), make_binary(env, identity));
+    return enif_make_list_cell(env, item, list);
+}
+
+// list_devices() -> [{path, identity}]
+static ERL_NIF_TERM list_devices(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[] __attribute__((unused)))
+{
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+    DIR *dir = opendir("/dev");
+    struct dirent *entry;
+
+    if (!dir)
+        return list;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        if (strncmp(entry->d_name, "hidraw", 6) != 0)
+            continue;
+
+        char path[300];
+        snprintf(path, sizeof(path), "/dev/%s", entry->d_name);
+        list = probe_path(env, path, list);
+    }
+
+    closedir(dir);
+    return list;
+}
+
+// probe_devices(paths) -> [{path, identity}] for the SpaceMouse nodes among paths
+static ERL_NIF_TERM probe_devices(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+    ERL_NIF_TERM paths = argv[0];
+    ERL_NIF_TERM head;
+    ErlNifBinary path_binary;
+
+    if (!enif_is_list(env, paths))
+        return enif_make_badarg(env);
+
+    while (enif_get_list_cell(env, paths, &head, &paths))
+    {
+        char path[300];
+
+        if (!enif_inspect_binary(env, head, &path_binary) || path_binary.size >= sizeof(path))
+            return enif_make_badarg(env);
+
+        memcpy(path, path_binary.data, path_binary.size);
+        path[path_binary.size] = '\0';
+        list = probe_path(env, path, list);
+    }
+
+    return list;
+}
+
+// open_device(owner_pid, path, device_id) -> {:ok, resource} | {:error, reason}
+static ERL_NIF_TERM open_device(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ErlNifPid owner;
+    ErlNifBinary path_binary;
+    int device_id;
+    char path[300];
+
+    if (!enif_get_local_pid(env, argv[0], &owner) ||
+        !enif_inspect_binary(env, argv[1], &path_binary) || path_binary.size >= sizeof(path) ||
+        !enif_get_int(env, argv[2], &device_id))
+        return enif_make_badarg(env);
+
+    memcpy(path, path_binary.data, path_binary.size);
+    path[path_binary.size] = '\0';
+
+    struct hidraw_devinfo info;
+    int fd = open_spacemouse(path, &info);
+    if (fd < 0)
+        return error_tuple(env, atom_no_device);
+
+    struct hidraw_device *device = enif_alloc_resource(device_resource_type, sizeof(*device));
+    device->fd = fd;
+    device->device_id = device_id;
+    device->selected = false;
+    device->owner = owner;
+    device->reader = owner;
+    device->lock = enif_mutex_create("hidraw_device");
+    device->vendor_id = (uint16_t)info.vendor;
+    device->product_id = (uint16_t)info.product;
+    device->button_mask = 0;
+    read_report_table(fd, &device->table);
+    report_decoder_init(&device->decoder, &device->table);
+    calibration_reset(&device->calibration);
+    idle_filter_reset(&device->idle_filter);
+
+    ERL_NIF_TERM resource = enif_make_resource(env, device);
+    enif_release_resource(device);
+
+    if (!device->lock)
+    {
+        release_fd(env, device);
+        return error_tuple(env, enif_make_atom(env, "no_memory"));
+    }
+
+    // From the monitor on, device_down/4 may run on another thread
+    enif_mutex_lock(device->lock);
+
+    if (enif_monitor_process(env, device, &owner, NULL) != 0)
+    {
+        release_fd(env, device);
+        enif_mutex_unlock(device->lock);
+        return error_tuple(env, enif_make_atom(env, "owner_down"));
+    }
+
+    if (enif_select(env, (ErlNifEvent)fd, ERL_NIF_SELECT_READ, device, &owner, atom_undefined) < 0)
+    {
+        release_fd(env, device);
+        enif_mutex_unlock(device->lock);
+        return error_tuple(env, enif_make_atom(env, "select_failed"));
+    }
+    device->selected = true;
+
+    send_status(env, device, "device_connected");
+    enif_mutex_unlock(device->lock);
+    return enif_make_tuple2(env, atom_ok, resource);
+}
+
+// Body of read_events/1, called with the lock held
+static ERL_NIF_TERM drain_reports(ErlNifEnv *env, struct hidraw_device *device)
+{
+    if (device->fd < 0)
+        return atom_closed;
+
+    for (int i = 0; i < MAX_REPORTS_PER_CALL; i++)
+    {
+        uint8_t report[MAX_REPORT_SIZE];
+        ssize_t length = read(device->fd, report, sizeof(report));
+
+        if (length < 0 && errno == EINTR)
+            continue;
+
+        if (length < 0 && errno == EAGAIN)
+            break;
+
+        if (length <= 0)
+        {
+            // ENODEV/EIO: unplugged
+            release_fd(env, device);
+            send_status(env, device, "device_disconnected");
+            return atom_closed;
+        }
+
+        uint64_t timestamp_us = monotonic_us();
+
+        int kind = decode_report(&device->decoder, report, (size_t)length);
+
+        if (kind & REPORT_MOTION)
+            send_motion(env, device, timestamp_us);
+        if (kind & REPORT_BUTTONS)
+            send_button_changes(env, device, timestamp_us);
+    }
+
+    // Re-arm: select notifications are one-shot. If reports are still
+    // queued (batch limit hit) the next notification arrives immediately.
+    enif_select(env, (ErlNifEvent)device->fd, ERL_NIF_SELECT_READ, device, &device->reader, atom_undefined);
+    return atom_ok;
+}
+
+// read_events(resource) -> :ok | :closed
+static ERL_NIF_TERM read_events(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_device *device;
+    ERL_NIF_TERM result;
+
+    if (!enif_get_resource(env, argv[0], device_resource_type, (void **)&device))
+        return enif_make_badarg(env);
+
+    enif_mutex_lock(device->lock);
+    result = drain_reports(env, device);
+    enif_mutex_unlock(device->lock);
+    return result;
+}
+
+// set_reader(resource, pid) -> :ok | :closed: send the select notifications
+// and the motion and buttons events to pid from now on. Re-arming hands a
+// pending notification over as well.
+static ERL_NIF_TERM set_reader(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_device *device;
+    ErlNifPid reader;
+    ERL_NIF_TERM result = atom_ok;
+
+    if (!enif_get_resource(env, argv[0], device_resource_type, (void **)&device) ||
+        !enif_get_local_pid(env, argv[1], &reader))
+        return enif_make_badarg(env);
+
+    enif_mutex_lock(device->lock);
+    if (device->fd < 0)
+    {
+        result = atom_closed;
+    }
+    else
+    {
+        device->reader = reader;
+        enif_select(env, (ErlNifEvent)device->fd, ERL_NIF_SELECT_READ, device, &device->reader, atom_undefined);
+    }
+    enif_mutex_unlock(device->lock);
+    return result;
+}
+
+// Same LED methods as the hidraw reader, in the same order
+static bool try_led_method(void *context, int method, bool on)
+{
+    int fd = *(int *)context;
+    uint8_t report[3] = {0x04, on ? 1 : 0, 0x00};
+
+    switch (method)
+    {
+    case 1:
+        return write(fd, report, 2) == 2;
+    case 2:
+        return ioctl(fd, HIDIOCSFEATURE(2), report) >= 0;
+    case 3:
+        report[0] = 0x07;
+        return ioctl(fd, HIDIOCSFEATURE(2), report) >= 0;
+    case 4:
+        return ioctl(fd, HIDIOCSFEATURE(3), report) >= 0;
+    default:
+        return false;
+    }
+}
+
+// set_led(resource, on) -> {:ok, method} | {:error, reason}
+static ERL_NIF_TERM set_led(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_device *device;
+
+    if (!enif_get_resource(env, argv[0], device_resource_type, (void **)&device))
+        return enif_make_badarg(env);
+
+    enif_mutex_lock(device->lock);
+    if (device->fd < 0)
+    {
+        enif_mutex_unlock(device->lock);
+        return error_tuple(env, atom_closed);
+    }
+
+    // Cached per model for the life of the VM (see ../common/led_cache.h)
+    int method = led_cache_send(device->vendor_id, device->product_id, try_led_method, &device->fd,
+                                enif_is_identical(argv[1], atom_true));
+    enif_mutex_unlock(device->lock);
+    if (!method)
+        return error_tuple(env, atom_all_methods_failed);
+
+    return enif_make_tuple2(env, atom_ok, enif_make_int(env, method));
+}
+
+// close_device(resource) -> :ok
+static ERL_NIF_TERM close_device(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_device *device;
+
+    if (!enif_get_resource(env, argv[0], device_resource_type, (void **)&device))
+        return enif_make_badarg(env);
+
+    enif_mutex_lock(device->lock);
+    release_fd(env, device);
+    enif_mutex_unlock(device->lock);
+    return atom_ok;
+}
+
+static void release_watch(ErlNifEnv *env, struct hidraw_watch *watch)
+{
+    int fd = watch->fd;
+
+    if (fd < 0)
+        return;
+
+    watch->fd = -1;
+
+    if (watch->selected)
+        enif_select(env, (ErlNifEvent)fd, ERL_NIF_SELECT_STOP, watch, NULL, atom_undefined);
+    else
+        close(fd);
+}
+
+static void watch_stop(ErlNifEnv *env __attribute__((unused)), void *obj, ErlNifEvent event,
+                       int is_direct_call __attribute__((unused)))
+{
+    struct hidraw_watch *watch = obj;
+
+    close((int)event);
+    watch->selected = false;
+}
+
+// The owner exited without close_watch/1; the select would keep the
+// inotify fd open forever
+static void watch_down(ErlNifEnv *env, void *obj, ErlNifPid *pid __attribute__((unused)),
+                       ErlNifMonitor *monitor __attribute__((unused)))
+{
+    release_watch(env, obj);
+}
+
+static void watch_dtor(ErlNifEnv *env __attribute__((unused)), void *obj)
+{
+    struct hidraw_watch *watch = obj;
+
+    if (watch->fd >= 0)
+        close(watch->fd);
+}
+
+// watch_devices(owner_pid) -> {:ok, watch} | {:error, reason}
+static ERL_NIF_TERM watch_devices(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ErlNifPid owner;
+
+    if (!enif_get_local_pid(env, argv[0], &owner))
+        return enif_make_badarg(env);
+
+    // IN_ATTRIB covers udev fixing permissions after creation; removal is
+    // seen by the device's own read
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0)
+        return error_tuple(env, enif_make_atom(env, "inotify_failed"));
+    if (inotify_add_watch(fd, "/dev", IN_CREATE | IN_ATTRIB) < 0)
+    {
+        close(fd);
+        return error_tuple(env, enif_make_atom(env, "inotify_failed"));
+    }
+
+    struct hidraw_watch *watch = enif_alloc_resource(watch_resource_type, sizeof(*watch));
+    watch->fd = fd;
+    watch->selected = false;
+    watch->owner = owner;
+
+    ERL_NIF_TERM resource = enif_make_resource(env, watch);
+    enif_release_resource(watch);
+
+    if (enif_monitor_process(env, watch, &owner, NULL) != 0)
+    {
+        release_watch(env, watch);
+        return error_tuple(env, enif_make_atom(env, "owner_down"));
+    }
+
+    if (enif_select(env, (ErlNifEvent)fd, ERL_NIF_SELECT_READ, watch, &owner, atom_undefined) < 0)
+    {
+        release_watch(env, watch);
+        return error_tuple(env, enif_make_atom(env, "select_failed"));
+    }
+    watch->selected = true;
+
+    return enif_make_tuple2(env, atom_ok, resource);
+}
+
+// read_watch(watch) -> [path] of the hidraw nodes created or changed since
+// the last call | :closed
+static ERL_NIF_TERM read_watch(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_watch *watch;
+    ERL_NIF_TERM list = enif_make_list(env, 0);
+
+    if (!enif_get_resource(env, argv[0], watch_resource_type, (void **)&watch))
+        return enif_make_badarg(env);
+
+    if (watch->fd < 0)
+        return atom_closed;
+
+    for (;;)
+    {
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length = read(watch->fd, buffer, sizeof(buffer));
+
+        if (length < 0 && errno == EINTR)
+            continue;
+        if (length <= 0)
+            break;
+
+        for (char *ptr = buffer; ptr < buffer + length;)
+        {
+            const struct inotify_event *event = (const struct inotify_event *)ptr;
+
+            if (event->len > 0 && strncmp(event->name, "hidraw", 6) == 0)
+            {
+                char path[300];
+                snprintf(path, sizeof(path), "/dev/%s", event->name);
+                list = enif_make_list_cell(env, make_binary(env, path), list);
+            }
+
+            ptr += sizeof(struct inotify_event) + event->len;
+        }
+    }
+
+    enif_select(env, (ErlNifEvent)watch->fd, ERL_NIF_SELECT_READ, watch, &watch->owner, atom_undefined);
+    return list;
+}
+
+// close_watch(watch) -> :ok
+static ERL_NIF_TERM close_watch(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_watch *watch;
+
+    if (!enif_get_resource(env, argv[0], watch_resource_type, (void **)&watch))
+        return enif_make_badarg(env);
+
+    release_watch(env, watch);
+    return atom_ok;
+}
+
+// set_curves(specs) -> :ok | {:error, spec}, specs being "AXES:KIND:PARAMS"
+// binaries. Replaces every curve; [] leaves all axes straight.
+static ERL_NIF_TERM set_curves(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ERL_NIF_TERM list = argv[0];
+    ERL_NIF_TERM head;
+    ErlNifBinary spec;
+    char text[256];
+
+    if (!enif_is_list(env, list))
+        return enif_make_badarg(env);
+
+    response_curve_reset();
+    while (enif_get_list_cell(env, list, &head, &list))
+    {
+        if (!enif_inspect_binary(env, head, &spec) || spec.size >= sizeof(text))
+            return enif_make_badarg(env);
+
+        memcpy(text, spec.data, spec.size);
+        text[spec.size] = '\0';
+        if (!response_curve_parse(text))
+            return error_tuple(env, head);
+    }
+    return atom_ok;
+}
+
+// calibrate(resource) -> :ok | {:error, :closed}: take the current frame as
+// the zero point and send the corrected frame
+static ERL_NIF_TERM calibrate(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    struct hidraw_device *device;
+
+    if (!enif_get_resource(env, argv[0], device_resource_type, (void **)&device))
+        return enif_make_badarg(env);
+
+    enif_mutex_lock(device->lock);
+    if (device->fd < 0)
+    {
+        enif_mutex_unlock(device->lock);
+        return error_tuple(env, atom_closed);
+    }
+
+    calibration_zero(&device->calibration, device->decoder.frame);
+    send_motion(env, device, monotonic_us());
+    enif_mutex_unlock(device->lock);
+    return atom_ok;
+}
+
+// set_auto_zero(spec) -> :ok | {:error, spec}, spec being "WINDOW:NOISE:MAX_BIAS"
+// or "off"
+static ERL_NIF_TERM set_auto_zero(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ErlNifBinary spec;
+    char text[64];
+
+    if (!enif_inspect_binary(env, argv[0], &spec) || spec.size >= sizeof(text))
+        return enif_make_badarg(env);
+
+    memcpy(text, spec.data, spec.size);
+    text[spec.size] = '\0';
+    return calibration_configure(text) ? atom_ok : error_tuple(env, argv[0]);
+}
+
+// set_idle_filter(spec) -> :ok | {:error, spec}, spec being
+// "EPSILON[:KEEPALIVE_MS]" or "off"
+static ERL_NIF_TERM set_idle_filter(ErlNifEnv *env, int argc __attribute__((unused)), const ERL_NIF_TERM argv[])
+{
+    ErlNifBinary spec;
+    char text[64];
+
+    if (!enif_inspect_binary(env, argv[0], &spec) || spec.size >= sizeof(text))
+        return enif_make_badarg(env);
+
+    memcpy(text, spec.data, spec.size);
+    text[spec.size] = '\0';
+    return idle_filter_configure(text) ? atom_ok : error_tuple(env, argv[0]);
+}
+
+static int load(ErlNifEnv *env, void **priv_data __attribute__((unused)), ERL_NIF_TERM load_info __attribute__((unused)))
+{
+    static const char *axis_names[AXIS_COUNT] = {"x", "y", "z", "rx", "ry", "rz"};
+    ErlNifResourceTypeInit init = {.dtor = device_dtor, .stop = device_stop, .down = device_down};
+
+    device_resource_type = enif_open_resource_type_x(env, "hidraw_device", &init,
+                                                      ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER, NULL);
+    if (!device_resource_type)
+        return 1;
+
+    ErlNifResourceTypeInit watch_init = {.dtor = watch_dtor, .stop = watch_stop, .down = watch_down};
+
+    watch_resource_type = enif_open_resource_type_x(env, "hidraw_watch", &watch_init,
+                                                     ERL_NIF_RT_CREATE | ERL_NIF_RT_TAKEOVER, NULL);
+    if (!watch_resource_type)
+        return 1;
+
+    atom_ok = enif_make_atom(env, "ok");
+    atom_error = enif_make_atom(env, "error");
+    atom_closed = enif_make_atom(env, "closed");
+    atom_undefined = enif_make_atom(env, "undefined");
+    atom_true = enif_make_atom(env, "true");
+    atom_hid_event = enif_make_atom(env, "hid_event");
+    atom_type = enif_make_atom(env, "type");
+    atom_motion = enif_make_atom(env, "motion");
+    atom_buttons = enif_make_atom(env, "buttons");
+    atom_status = enif_make_atom(env, "status");
+    atom_message = enif_make_atom(env, "message");
+    atom_device_id = enif_make_atom(env, "device_id");
+    atom_vendor_id = enif_make_atom(env, "vendor_id");
+    atom_product_id = enif_make_atom(env, "product_id");
+    atom_timestamp = enif_make_atom(env, "timestamp");
+    atom_data = enif_make_atom(env, "data");
+    atom_device_timestamp = enif_make_atom(env, "device_timestamp");
+    atom_received_at = enif_make_atom(env, "received_at");
+    atom_changed = enif_make_atom(env, "changed");
+    atom_no_device = enif_make_atom(env, "no_device");
+    atom_all_methods_failed = enif_make_atom(env, "all_methods_failed");
+
+    for (int i = 0; i < AXIS_COUNT; i++)
+        axis_atoms[i] = enif_make_atom(env, axis_names[i]);
+
+    return 0;
+}
+
+static ErlNifFunc nif_funcs[] = {
+    {"list_devices", 0, list_devices, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"probe_devices", 1, probe_devices, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"watch_devices", 1, watch_devices, 0},
+    {"read_watch", 1, read_watch, 0},
+    {"close_watch", 1, close_watch, 0},
+    {"open_device", 3, open_device, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"read_events", 1, read_events, 0},
+    {"set_reader", 2, set_reader, 0},
+    {"set_led", 2, set_led, ERL_NIF_DIRTY_JOB_IO_BOUND},
+    {"close_device", 1, close_device, 0},
+    {"set_curves", 1, set_curves, 0},
+    {"calibrate", 1, calibrate, 0},
+    {"set_auto_zero", 1, set_auto_zero, 0},
+    {"set_idle_filter", 1, set_idle_filter, 0},
+};
+
+ERL_NIF_INIT(Elixir.SpaceMouse.Platform.Linux.HidrawNif, nif_funcs, load, NULL, NULL, NULL)
@@ -29,7 +29,17 @@ echo "🔨 Building macOS HID reader..."
 clang -framework IOKit -framework CoreFoundation \
       -O2 -Wall -Wextra \
       -o "$BUILD_DIR/hid_reader" \
-      "$SCRIPT_DIR/hid_reader.c"
+      "$SCRIPT_DIR/hid_reader.c" \
+      "$SCRIPT_DIR/../common/port_protocol.c" \
+      "$SCRIPT_DIR/../common/capture.c" \
+      "$SCRIPT_DIR/../common/device_ids.c" \
+      "$SCRIPT_DIR/../common/led_cache.c" \
+      "$SCRIPT_DIR/../common/report_descriptor.c" \
+      "$SCRIPT_DIR/../common/calibration.c" \
+      "$SCRIPT_DIR/../common/response_curve.c" \
+      "$SCRIPT_DIR/../common/idle_filter.c" \
+      "$SCRIPT_DIR/../common/state_shm.c" \
+      "$SCRIPT_DIR/../common/event_server.c"
 
 echo "✅ Build complete: $BUILD_DIR/hid_reader"
-echo "🧪 Test with: $BUILD_DIR/hid_reader"
+echo "🧪 Test with: $BUILD_DIR/hid_reader --protocol=text"
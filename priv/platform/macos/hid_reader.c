@@ -6,129 +6,341 @@
  *
  * Responsibilities:
  * - Detect SpaceMouse device connection/disconnection
- * - Read raw HID input reports (motion, buttons)
+ * - Track every matched SpaceMouse under a stable device ID (see
+ *   ../common/device_ids.h): serial number, else location ID
+ * - Read raw HID input reports (motion, buttons) and decode each one as a
+ *   unit (see ../common/spacemouse_report.h), driven by a table compiled
+ *   from the device's report descriptor at attach time (see
+ *   ../common/report_descriptor.h); there are no per-element callbacks
  * - Send HID output reports (LED control)
  * - Handle commands from stdin (Elixir port communication)
  * - Output structured data to stdout for Elixir port communication
  *
- * Communication Protocol:
+ * Event Loop:
+ * The HID manager and stdin (a CFFileDescriptor source) are both scheduled
+ * on the main run loop, which blocks in CFRunLoopRun(). Reports and LED
+ * commands are handled as soon as they arrive, with no polling interval.
+ * Output queued by the callbacks is flushed in one writev() by a run-loop
+ * observer just before the loop sleeps; callbacks never write to stdout.
+ *
+ * LED Control (see ../common/led_cache.h):
+ * The working LED method is cached per VID/PID, so after the first probe
+ * a toggle is one transfer. --led-cache=PATH keeps the cache across runs.
+ *
+ * Capture/Replay (see ../common/capture.h):
+ * --capture=PATH records every raw input report as it is decoded.
+ * --replay=PATH opens no HID device and feeds a capture back through the
+ * same decoder from a run-loop timer, paced by --replay-speed.
+ *
+ * Shared-Memory Snapshot (see ../common/state_shm.h):
+ * --shm=NAME publishes every device's latest frame and button bitmask in
+ * a seqlock-guarded POSIX shared-memory segment for wait-free sampling.
+ *
+ * Zero-Drift Calibration (see ../common/calibration.h):
+ * A running per-axis bias, learnt while the cap is still, is subtracted
+ * from every frame before anything else sees it (--auto-zero=). The
+ * CALIBRATE command takes the current frame as the zero point.
+ *
+ * Response Curves (see ../common/response_curve.h):
+ * --curve=AXES:KIND:PARAMS maps axes through expo, S-curve or piecewise
+ * linear curves, baked into 65536-entry tables at start-up.
+ *
+ * Idle Suppression (see ../common/idle_filter.h):
+ * After calibration and curves, a frame is emitted only when it differs
+ * from the device's last emitted frame by more than --idle-filter=EPSILON;
+ * a cap coming to rest sends one all-zero frame, then nothing until it
+ * moves (optionally re-sent every KEEPALIVE_MS while reports arrive).
+ *
+ * Socket Fan-Out (see ../common/event_server.h):
+ * --socket=PATH serves the binary record stream to local clients over a
+ * Unix domain socket. The listening socket and every client are
+ * CFFileDescriptor sources; clients are flushed by the same observer.
+ *
+ * Communication Protocol (see ../common/port_protocol.h):
+ * The port selects the framing with --protocol=binary ({:packet, 2} records,
+ * the default used by PortManager) or --protocol=text (debug fallback).
+ *
  * INPUT (from Elixir via stdin):
- * - LED commands: "LED:on" or "LED:off"
+ * - LED commands: "LED:on" or "LED:off" (every device), "LED:2:on" (device 2)
+ * - Calibration: "CALIBRATE" (every device), "CALIBRATE:2" (device 2)
  *
- * OUTPUT (to Elixir via stdout):
+ * OUTPUT (to Elixir via stdout), shown in text form:
  * - Output format: "TYPE:key1=value1,key2=value2"
- * - STATUS messages: "STATUS:ready", "STATUS:device_connected", "STATUS:device_disconnected"
- * - MOTION events: "MOTION:x=123,y=456,z=789,rx=12,ry=34,rz=56"
- * - BUTTON events: "BUTTON:id=1,state=pressed" or "BUTTON:id=1,state=released"
- * - LED confirmations: "LED:state=on" or "LED:state=off"
+ * - STATUS messages: "STATUS:ready",
+ *   "STATUS:device_connected,device=1,vid=256f,pid=c635", "STATUS:device_disconnected,device=1"
+ * - MOTION events: "MOTION:device=1,t=1234567,x=123,y=456,z=789,rx=12,ry=34,rz=56"
+ * - BUTTONS events: "BUTTONS:device=1,t=1234567,buttons=3,changed=1" (hex bitmasks,
+ *   bit 0 = button 1; t: IOHID timestamp in µs)
+ * - LED confirmations: "LED:device=1,state=on,method=1"
+ * - Calibration confirmations: "STATUS:calibrated,device=1"
  *
- * Compile: clang -framework IOKit -framework CoreFoundation -o hid_reader hid_reader.c
+ * Compile: clang -framework IOKit -framework CoreFoundation -o hid_reader hid_reader.c ../common/port_protocol.c ../common/capture.c ../common/device_ids.c ../common/led_cache.c \
+ *          ../common/report_descriptor.c ../common/calibration.c ../common/response_curve.c ../common/idle_filter.c \
+ *          ../common/state_shm.c ../common/event_server.c
  */
 
 #include <IOKit/hid/IOHIDManager.h>
+#include <mach/mach_time.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <unistd.h>
-#include <sys/select.h>
+
+#include "../common/calibration.h"
+#include "../common/capture.h"
+#include "../common/device_ids.h"
+#include "../common/event_server.h"
+#include "../common/idle_filter.h"
+#include "../common/led_cache.h"
+#include "../common/port_protocol.h"
+#include "../common/report_descriptor.h"
+#include "../common/response_curve.h"
+#include "../common/spacemouse_report.h"
+#include "../common/state_shm.h"
 
 // 3Dconnexion SpaceMouse vendor ID
 #define SPACEMOUSE_VENDOR_ID 0x256F
 
-// Motion axes mapping (Generic Desktop usage page 0x01)
-#define USAGE_X 48
-#define USAGE_Y 49
-#define USAGE_Z 50
-#define USAGE_RX 51
-#define USAGE_RY 52
-#define USAGE_RZ 53
+// One matched SpaceMouse, indexed by its device ID (see device_ids.h)
+struct hid_device
+{
+    bool connected;
+    IOHIDDeviceRef ref; // NULL for replayed devices
+    uint16_t vendor_id;
+    uint16_t product_id;
+    struct report_table table; // compiled report descriptor
+    struct report_decoder decoder;
+    struct calibration calibration;
+    struct idle_filter idle_filter;
+    uint32_t button_mask;
+};
 
 // Global state
 static IOHIDManagerRef hid_manager = NULL;
-static IOHIDDeviceRef current_device = NULL;
-static bool device_connected = false;
-static bool led_state = false;
+static struct hid_device devices[MAX_DEVICES + 1];
+static CFFileDescriptorRef stdin_ref = NULL;
+static CFFileDescriptorRef stdout_ref = NULL;
+static CFRunLoopObserverRef flush_observer = NULL;
+static mach_timebase_info_data_t timebase;
+static CFRunLoopTimerRef replay_timer = NULL;
+static CFFileDescriptorRef socket_ref = NULL;
+static CFFileDescriptorRef client_refs[MAX_CLIENTS];
+
+// Replay records handled per timer firing before output gets a chance to drain
+#define REPLAY_BATCH 256
+
+static uint64_t host_time_to_us(uint64_t host_time);
+
+// Read an integer device property (vendor/product ID); 0 if missing
+static uint16_t device_property(IOHIDDeviceRef device, CFStringRef key)
+{
+    CFTypeRef value = IOHIDDeviceGetProperty(device, key);
+    int number = 0;
+
+    if (value && CFGetTypeID(value) == CFNumberGetTypeID())
+        CFNumberGetValue((CFNumberRef)value, kCFNumberIntType, &number);
+
+    return (uint16_t)number;
+}
+
+// Identity for a stable device ID: serial number if the device reports
+// one, else the USB/Bluetooth location ID
+static void device_identity(IOHIDDeviceRef device, char *identity, size_t size)
+{
+    CFTypeRef serial = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDSerialNumberKey));
+    char buffer[96];
+
+    if (serial && CFGetTypeID(serial) == CFStringGetTypeID() &&
+        CFStringGetCString((CFStringRef)serial, buffer, sizeof(buffer), kCFStringEncodingUTF8) && buffer[0])
+    {
+        snprintf(identity, size, "serial:%s", buffer);
+        return;
+    }
+
+    CFTypeRef location = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDLocationIDKey));
+    int location_id = 0;
+
+    if (location && CFGetTypeID(location) == CFNumberGetTypeID())
+        CFNumberGetValue((CFNumberRef)location, kCFNumberIntType, &location_id);
+
+    snprintf(identity, size, "location:%08x", (unsigned)location_id);
+}
+
+// Compile the device's report descriptor; table->valid stays false if the
+// property is missing or describes no axes
+static void read_report_table(IOHIDDeviceRef device, struct report_table *table)
+{
+    CFTypeRef descriptor = IOHIDDeviceGetProperty(device, CFSTR(kIOHIDReportDescriptorKey));
+
+    table->valid = false;
+    if (descriptor && CFGetTypeID(descriptor) == CFDataGetTypeID())
+    {
+        report_table_build(table, CFDataGetBytePtr((CFDataRef)descriptor),
+                           (size_t)CFDataGetLength((CFDataRef)descriptor));
+    }
+}
+
+// Device ID of an attached IOHIDDevice; 0 if unknown
+static uint8_t find_device(IOHIDDeviceRef ref)
+{
+    for (uint8_t id = 1; id <= MAX_DEVICES; id++)
+    {
+        if (devices[id].connected && devices[id].ref == ref)
+            return id;
+    }
+    return 0;
+}
+
+// Mark a device attached and announce it
+static void attach_device(uint8_t id, IOHIDDeviceRef ref, uint16_t vendor_id, uint16_t product_id)
+{
+    struct hid_device *device = &devices[id];
+
+    device->connected = true;
+    device->ref = ref;
+    device->vendor_id = vendor_id;
+    device->product_id = product_id;
+    device->button_mask = 0;
+
+    // Replayed captures carry no descriptor and use the built-in layouts
+    if (ref)
+        read_report_table(ref, &device->table);
+    else
+        device->table.valid = false;
+    report_decoder_init(&device->decoder, &device->table);
+    calibration_reset(&device->calibration);
+    idle_filter_reset(&device->idle_filter);
+
+    protocol_device_connected(id, vendor_id, product_id);
+    state_shm_device(id, true, vendor_id, product_id);
+    if (!device->table.valid)
+        protocol_info("report_layout=builtin,device=%u", id);
+}
+
+// Detach one device
+static void detach_device(uint8_t id)
+{
+    if (!devices[id].connected)
+        return;
+
+    devices[id].connected = false;
+    devices[id].ref = NULL;
+    device_ids_release(id);
+
+    protocol_device_disconnected(id);
+    state_shm_device(id, false, 0, 0);
+}
 
 // Device connection callback
 static void device_matching_callback(void *context __unused, IOReturn result __unused, void *sender __unused, IOHIDDeviceRef device)
 {
-    if (!device_connected)
+    if (find_device(device))
+        return;
+
+    char identity[128];
+    device_identity(device, identity, sizeof(identity));
+
+    uint8_t id = device_ids_acquire(identity);
+    if (!id)
     {
-        device_connected = true;
-        current_device = device;
-        printf("STATUS:device_connected\n");
-        fflush(stdout);
+        protocol_info("device_ignored=%s,reason=too_many_devices", identity);
+        return;
     }
+
+    uint16_t vendor_id = device_property(device, CFSTR(kIOHIDVendorIDKey));
+    uint16_t product_id = device_property(device, CFSTR(kIOHIDProductIDKey));
+
+    capture_device(id, host_time_to_us(mach_absolute_time()), vendor_id, product_id, true);
+    attach_device(id, device, vendor_id, product_id);
 }
 
 // Device disconnection callback
-static void device_removal_callback(void *context __unused, IOReturn result __unused, void *sender __unused, IOHIDDeviceRef device __unused)
+static void device_removal_callback(void *context __unused, IOReturn result __unused, void *sender __unused, IOHIDDeviceRef device)
 {
-    if (device_connected)
+    uint8_t id = find_device(device);
+
+    if (id)
     {
-        device_connected = false;
-        current_device = NULL;
-        printf("STATUS:device_disconnected\n");
-        fflush(stdout);
+        capture_device(id, host_time_to_us(mach_absolute_time()), 0, 0, false);
+        detach_device(id);
     }
 }
 
-// HID input report callback
-static void input_callback(void *context __unused, IOReturn result __unused, void *sender __unused, IOHIDValueRef value)
+// Convert an IOHID timestamp (mach absolute time) to microseconds
+static uint64_t host_time_to_us(uint64_t host_time)
 {
-    IOHIDElementRef element = IOHIDValueGetElement(value);
-    uint32_t usage_page = IOHIDElementGetUsagePage(element);
-    uint32_t usage = IOHIDElementGetUsage(element);
-    CFIndex int_value = IOHIDValueGetIntegerValue(value);
+    if (timebase.denom == 0)
+        mach_timebase_info(&timebase);
 
-    // Handle motion data (Generic Desktop usage page)
-    if (usage_page == 1)
-    {
-        const char *axis = NULL;
-        switch (usage)
-        {
-        case USAGE_X:
-            axis = "x";
-            break;
-        case USAGE_Y:
-            axis = "y";
-            break;
-        case USAGE_Z:
-            axis = "z";
-            break;
-        case USAGE_RX:
-            axis = "rx";
-            break;
-        case USAGE_RY:
-            axis = "ry";
-            break;
-        case USAGE_RZ:
-            axis = "rz";
-            break;
-        default:
-            return; // Ignore other axes
-        }
+    return host_time * timebase.numer / timebase.denom / 1000u;
+}
 
-        if (axis)
-        {
-            printf("MOTION:%s=%ld\n", axis, int_value);
-            fflush(stdout);
-        }
-    }
+// Emit one BUTTONS record (full bitmask plus changed bits) if any button
+// changed since the previous report
+static void emit_button_changes(uint8_t id, uint64_t timestamp_us, uint32_t new_mask)
+{
+    struct hid_device *device = &devices[id];
+    uint32_t changed = new_mask ^ device->button_mask;
 
-    // Handle button data (Button usage page)
-    else if (usage_page == 9)
+    if (changed)
     {
-        const char *state = (int_value > 0) ? "pressed" : "released";
-        printf("BUTTON:id=%d,state=%s\n", usage, state);
-        fflush(stdout);
+        protocol_buttons(id, timestamp_us, new_mask, changed);
+        state_shm_buttons(id, timestamp_us, new_mask);
     }
+
+    device->button_mask = new_mask;
+}
+
+// Emit the decoder's frame, zero-corrected and through the curves, unless
+// the idle filter suppresses it
+static void emit_motion(uint8_t id, uint64_t timestamp_us)
+{
+    struct hid_device *device = &devices[id];
+    int16_t frame[6];
+
+    calibration_apply(&device->calibration, device->decoder.frame, frame);
+    response_curve_apply(frame, frame);
+    if (!idle_filter_pass(&device->idle_filter, frame, timestamp_us))
+        return;
+    protocol_motion(id, timestamp_us, frame);
+    state_shm_motion(id, timestamp_us, frame);
+}
+
+// Decode one raw input report and emit the resulting events
+static void handle_report(uint8_t id, uint64_t timestamp_us, const uint8_t *report, size_t length)
+{
+    struct report_decoder *decoder = &devices[id].decoder;
+    int kind = decode_report(decoder, report, length);
+
+    if (kind & REPORT_MOTION)
+        emit_motion(id, timestamp_us);
+    if (kind & REPORT_BUTTONS)
+        emit_button_changes(id, timestamp_us, decoder->buttons);
+}
+
+// HID input report callback: motion and buttons are decoded one whole
+// report at a time so every MOTION line carries a complete, consistent
+// 6-axis frame. The sender is the IOHIDDevice the report came from.
+static void report_callback(void *context __unused, IOReturn result __unused, void *sender,
+                            IOHIDReportType type, uint32_t report_id __unused, uint8_t *report, CFIndex report_length,
+                            uint64_t timestamp)
+{
+    uint8_t id = find_device((IOHIDDeviceRef)sender);
+
+    if (type != kIOHIDReportTypeInput || !id)
+        return;
+
+    uint64_t timestamp_us = host_time_to_us(timestamp);
+    capture_report(id, timestamp_us, report, (size_t)report_length);
+    handle_report(id, timestamp_us, report, (size_t)report_length);
 }
 
-// Try different LED control methods for various SpaceMouse models
-static bool try_led_method(IOHIDDeviceRef device, int method, bool on)
+// Try one LED control method (see ../common/led_cache.h for the order).
+// Only failures are reported; a cached method that works stays silent.
+static bool try_led_method(void *context, int method, bool on)
 {
+    IOHIDDeviceRef device = (IOHIDDeviceRef)context;
     IOReturn result = kIOReturnError;
 
     switch (method)
@@ -138,7 +350,6 @@ static bool try_led_method(IOHIDDeviceRef device, int method, bool on)
         uint8_t report_data[2] = {0x04, on ? 1 : 0};
         result = IOHIDDeviceSetReport(device, kIOHIDReportTypeOutput,
                                       report_data[0], report_data, sizeof(report_data));
-        printf("STATUS:led_method=1,result=0x%08x\n", result);
         break;
     }
 
@@ -147,7 +358,6 @@ static bool try_led_method(IOHIDDeviceRef device, int method, bool on)
         uint8_t report_data[2] = {0x04, on ? 1 : 0};
         result = IOHIDDeviceSetReport(device, kIOHIDReportTypeFeature,
                                       report_data[0], report_data, sizeof(report_data));
-        printf("STATUS:led_method=2,result=0x%08x\n", result);
         break;
     }
 
@@ -156,7 +366,6 @@ static bool try_led_method(IOHIDDeviceRef device, int method, bool on)
         uint8_t report_data[2] = {0x07, on ? 1 : 0};
         result = IOHIDDeviceSetReport(device, kIOHIDReportTypeFeature,
                                       report_data[0], report_data, sizeof(report_data));
-        printf("STATUS:led_method=3,result=0x%08x\n", result);
         break;
     }
 
@@ -165,99 +374,338 @@ static bool try_led_method(IOHIDDeviceRef device, int method, bool on)
         uint8_t report_data[3] = {0x04, on ? 1 : 0, 0x00};
         result = IOHIDDeviceSetReport(device, kIOHIDReportTypeFeature,
                                       report_data[0], report_data, sizeof(report_data));
-        printf("STATUS:led_method=4,result=0x%08x\n", result);
         break;
     }
     }
 
-    fflush(stdout);
+    if (result != kIOReturnSuccess)
+        protocol_info("led_method=%d,result=0x%08x", method, result);
+
     return (result == kIOReturnSuccess);
 }
 
-// Send LED control command to SpaceMouse
-static bool send_led_command(bool on)
+// Send LED control command to one SpaceMouse: one IOHIDDeviceSetReport
+// round trip once the model's method is cached
+static bool send_led_command(uint8_t id, bool on)
 {
-    if (!current_device || !device_connected)
+    struct hid_device *device = &devices[id];
+
+    if (!device->connected || !device->ref)
     {
-        printf("STATUS:led_failed=device_not_available\n");
-        fflush(stdout);
+        protocol_info("led_failed=device_not_available,device=%d", id);
         return false;
     }
 
-    printf("STATUS:led_attempting=%s\n", on ? "on" : "off");
-    fflush(stdout);
-
-    // Try different LED control methods until one works
-    for (int method = 1; method <= 4; method++)
+    int method = led_cache_send(device->vendor_id, device->product_id, try_led_method, (void *)device->ref, on);
+    if (!method)
     {
-        if (try_led_method(current_device, method, on))
-        {
-            led_state = on;
-            printf("LED:state=%s,method=%d\n", on ? "on" : "off", method);
-            fflush(stdout);
-            return true;
-        }
+        protocol_info("led_failed=all_methods_failed,device=%d", id);
+        return false;
     }
 
-    printf("STATUS:led_failed=all_methods_failed\n");
-    fflush(stdout);
-    return false;
+    protocol_led(id, on, method);
+    return true;
+}
+
+// Take the current frame as the zero point and emit the corrected frame
+static void calibrate_device(uint8_t id)
+{
+    calibration_zero(&devices[id].calibration, devices[id].decoder.frame);
+    protocol_info("calibrated,device=%u", id);
+    emit_motion(id, host_time_to_us(mach_absolute_time()));
 }
 
 // Handle command from stdin
 static void handle_stdin_command(const char *line)
 {
+    uint8_t id;
+
     if (strncmp(line, "LED:", 4) == 0)
     {
-        const char *cmd = line + 4;
-        if (strcmp(cmd, "on") == 0)
+        bool on;
+
+        if (!protocol_parse_led_args(line + 4, &id, &on))
         {
-            send_led_command(true);
+            protocol_info("unknown_led_command=%s", line + 4);
         }
-        else if (strcmp(cmd, "off") == 0)
+        else if (id != 0)
         {
-            send_led_command(false);
+            send_led_command(id, on);
         }
         else
         {
-            printf("STATUS:unknown_led_command=%s\n", cmd);
-            fflush(stdout);
+            // Every attached device
+            bool any = false;
+            for (uint8_t i = 1; i <= MAX_DEVICES; i++)
+            {
+                if (devices[i].connected)
+                {
+                    send_led_command(i, on);
+                    any = true;
+                }
+            }
+            if (!any)
+                protocol_info("led_failed=device_not_available");
         }
     }
+    else if (protocol_parse_calibrate(line, &id))
+    {
+        bool any = false;
+        for (uint8_t i = 1; i <= MAX_DEVICES; i++)
+        {
+            if (devices[i].connected && (id == 0 || id == i))
+            {
+                calibrate_device(i);
+                any = true;
+            }
+        }
+        if (!any)
+            protocol_info("calibrate_failed=device_not_available");
+    }
     else
     {
-        printf("STATUS:unknown_command=%s\n", line);
-        fflush(stdout);
+        protocol_info("unknown_command=%s", line);
+    }
+}
+
+// stdin run-loop callback: fires as soon as the port writes a command
+static void stdin_callback(CFFileDescriptorRef fd_ref, CFOptionFlags callback_types __unused, void *info __unused)
+{
+    if (!protocol_read_commands(STDIN_FILENO, handle_stdin_command))
+    {
+        // Port closed by the VM
+        CFRunLoopStop(CFRunLoopGetCurrent());
+        return;
+    }
+
+    // CFFileDescriptor callbacks are one-shot; re-arm for the next command
+    CFFileDescriptorEnableCallBacks(fd_ref, kCFFileDescriptorReadCallBack);
+}
+
+// Drop the run-loop source of every client the event server has closed
+static void release_closed_clients()
+{
+    for (int client = 0; client < MAX_CLIENTS; client++)
+    {
+        if (client_refs[client] && event_server_client_fd(client) < 0)
+        {
+            CFFileDescriptorInvalidate(client_refs[client]);
+            CFRelease(client_refs[client]);
+            client_refs[client] = NULL;
+        }
+    }
+}
+
+// Flush queued output; ask for a write callback only while the pipe (or a
+// client's socket) is full
+static void flush_output()
+{
+    if (!protocol_flush())
+        CFFileDescriptorEnableCallBacks(stdout_ref, kCFFileDescriptorWriteCallBack);
+
+    event_server_flush();
+    release_closed_clients();
+
+    for (int client = 0; client < MAX_CLIENTS; client++)
+    {
+        if (client_refs[client] && event_server_client_pending(client))
+            CFFileDescriptorEnableCallBacks(client_refs[client], kCFFileDescriptorWriteCallBack);
     }
 }
 
-// Check for stdin input and process commands
-static void check_stdin_input()
+// stdout run-loop callback: the VM drained the pipe
+static void stdout_callback(CFFileDescriptorRef fd_ref __unused, CFOptionFlags callback_types __unused, void *info __unused)
+{
+    flush_output();
+}
+
+// Socket client run-loop callback: input, hangup or room to write
+static void client_callback(CFFileDescriptorRef fd_ref, CFOptionFlags callback_types, void *info)
 {
-    fd_set readfds;
-    struct timeval timeout;
+    int client = (int)(intptr_t)info;
 
-    FD_ZERO(&readfds);
-    FD_SET(STDIN_FILENO, &readfds);
+    if (callback_types & kCFFileDescriptorReadCallBack)
+    {
+        event_server_client_readable(client);
+        release_closed_clients();
+        if (client_refs[client] == fd_ref)
+            CFFileDescriptorEnableCallBacks(fd_ref, kCFFileDescriptorReadCallBack);
+    }
 
-    timeout.tv_sec = 0;
-    timeout.tv_usec = 0; // Non-blocking
+    if (callback_types & kCFFileDescriptorWriteCallBack)
+        flush_output();
+}
 
-    int result = select(STDIN_FILENO + 1, &readfds, NULL, NULL, &timeout);
+// Listening socket run-loop callback: give every new client its own source
+static void socket_callback(CFFileDescriptorRef fd_ref, CFOptionFlags callback_types __unused, void *info __unused)
+{
+    // A closed client's source must be gone before its fd number is reused
+    release_closed_clients();
 
-    if (result > 0 && FD_ISSET(STDIN_FILENO, &readfds))
+    int client;
+    while ((client = event_server_accept()) >= 0)
     {
-        char buffer[256];
-        if (fgets(buffer, sizeof(buffer), stdin))
+        CFFileDescriptorContext context = {0, (void *)(intptr_t)client, NULL, NULL, NULL};
+        CFFileDescriptorRef ref = CFFileDescriptorCreate(kCFAllocatorDefault, event_server_client_fd(client), false,
+                                                         client_callback, &context);
+        CFRunLoopSourceRef source = ref ? CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, ref, 0) : NULL;
+        if (!source)
         {
-            // Remove newline
-            char *newline = strchr(buffer, '\n');
-            if (newline)
-                *newline = '\0';
+            // Still served by the observer's flushes; a hangup shows up
+            // as a failed write instead of a read callback
+            if (ref)
+                CFRelease(ref);
+            continue;
+        }
 
-            handle_stdin_command(buffer);
+        CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+        CFRelease(source);
+        CFFileDescriptorEnableCallBacks(ref, kCFFileDescriptorReadCallBack);
+        client_refs[client] = ref;
+    }
+
+    CFFileDescriptorEnableCallBacks(fd_ref, kCFFileDescriptorReadCallBack);
+}
+
+// Run-loop observer: one flush per iteration, right before the loop sleeps
+static void flush_observer_callback(CFRunLoopObserverRef observer __unused, CFRunLoopActivity activity __unused, void *info __unused)
+{
+    flush_output();
+}
+
+// Replay: a recorded attach/detach stands in for the IOHIDManager callbacks
+static void replay_device(uint8_t id, uint64_t timestamp_us __unused, uint16_t vendor_id, uint16_t product_id, bool attached)
+{
+    if (id < 1 || id > MAX_DEVICES)
+        return;
+
+    if (attached && !devices[id].connected)
+        attach_device(id, NULL, vendor_id, product_id);
+    else if (!attached)
+        detach_device(id);
+}
+
+// Replay: a recorded report takes the same path as a live one
+static void replay_report(uint8_t id, uint64_t timestamp_us, const uint8_t *report, size_t length)
+{
+    if (id < 1 || id > MAX_DEVICES || !devices[id].connected)
+        return;
+
+    handle_report(id, timestamp_us, report, length);
+}
+
+static const struct replay_handlers replay_handlers = {
+    .device = replay_device,
+    .report = replay_report,
+};
+
+// Replay timer: deliver every record that is due, then re-arm for the next
+static void replay_timer_callback(CFRunLoopTimerRef timer, void *info __unused)
+{
+    // Max speed is paced by the port: wait while the pipe is still full
+    if (protocol_output_pending() && !protocol_flush())
+    {
+        CFRunLoopTimerSetNextFireDate(timer, CFAbsoluteTimeGetCurrent() + 0.001);
+        return;
+    }
+
+    for (int i = 0; i < REPLAY_BATCH; i++)
+    {
+        int64_t delay = replay_next_delay_us(host_time_to_us(mach_absolute_time()));
+        if (delay < 0)
+        {
+            for (uint8_t id = 1; id <= MAX_DEVICES; id++)
+                detach_device(id);
+            protocol_info("replay_complete");
+            CFRunLoopTimerInvalidate(timer);
+            return;
+        }
+        if (delay > 0)
+        {
+            CFRunLoopTimerSetNextFireDate(timer, CFAbsoluteTimeGetCurrent() + (double)delay / 1e6);
+            return;
         }
+        replay_step(&replay_handlers);
+    }
+
+    CFRunLoopTimerSetNextFireDate(timer, CFAbsoluteTimeGetCurrent());
+}
+
+// Schedule the replay timer in place of the HID manager
+static bool initialize_replay()
+{
+    // Far-future interval: the callback sets every fire date itself
+    replay_timer = CFRunLoopTimerCreate(kCFAllocatorDefault, CFAbsoluteTimeGetCurrent(), 1.0e9, 0, 0,
+                                        replay_timer_callback, NULL);
+    if (!replay_timer)
+    {
+        fprintf(stderr, "ERROR: Failed to create replay timer\n");
+        return false;
     }
+
+    CFRunLoopAddTimer(CFRunLoopGetCurrent(), replay_timer, kCFRunLoopDefaultMode);
+    return true;
+}
+
+// Register stdin, stdout and the event socket as run-loop sources next to
+// the HID manager
+static bool initialize_stdio_sources()
+{
+    stdin_ref = CFFileDescriptorCreate(kCFAllocatorDefault, STDIN_FILENO, false, stdin_callback, NULL);
+    if (!stdin_ref)
+    {
+        fprintf(stderr, "ERROR: Failed to create stdin file descriptor source\n");
+        return false;
+    }
+
+    CFRunLoopSourceRef source = CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, stdin_ref, 0);
+    if (!source)
+    {
+        fprintf(stderr, "ERROR: Failed to create stdin run loop source\n");
+        return false;
+    }
+
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+
+    CFFileDescriptorEnableCallBacks(stdin_ref, kCFFileDescriptorReadCallBack);
+
+    stdout_ref = CFFileDescriptorCreate(kCFAllocatorDefault, STDOUT_FILENO, false, stdout_callback, NULL);
+    source = stdout_ref ? CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, stdout_ref, 0) : NULL;
+    if (!source)
+    {
+        fprintf(stderr, "ERROR: Failed to create stdout run loop source\n");
+        return false;
+    }
+
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+
+    flush_observer = CFRunLoopObserverCreate(kCFAllocatorDefault, kCFRunLoopBeforeWaiting, true, 0,
+                                             flush_observer_callback, NULL);
+    if (!flush_observer)
+    {
+        fprintf(stderr, "ERROR: Failed to create flush observer\n");
+        return false;
+    }
+
+    CFRunLoopAddObserver(CFRunLoopGetCurrent(), flush_observer, kCFRunLoopDefaultMode);
+
+    if (event_server_listen_fd() < 0)
+        return true;
+
+    socket_ref = CFFileDescriptorCreate(kCFAllocatorDefault, event_server_listen_fd(), false, socket_callback, NULL);
+    source = socket_ref ? CFFileDescriptorCreateRunLoopSource(kCFAllocatorDefault, socket_ref, 0) : NULL;
+    if (!source)
+    {
+        fprintf(stderr, "ERROR: Failed to create socket run loop source\n");
+        return false;
+    }
+
+    CFRunLoopAddSource(CFRunLoopGetCurrent(), source, kCFRunLoopDefaultMode);
+    CFRelease(source);
+    CFFileDescriptorEnableCallBacks(socket_ref, kCFFileDescriptorReadCallBack);
+    return true;
 }
 
 // Create HID device matching dictionary for SpaceMouse
@@ -304,7 +752,7 @@ static bool initialize_hid_system()
     // Register callbacks
     IOHIDManagerRegisterDeviceMatchingCallback(hid_manager, device_matching_callback, NULL);
     IOHIDManagerRegisterDeviceRemovalCallback(hid_manager, device_removal_callback, NULL);
-    IOHIDManagerRegisterInputValueCallback(hid_manager, input_callback, NULL);
+    IOHIDManagerRegisterInputReportWithTimeStampCallback(hid_manager, report_callback, NULL);
 
     // Schedule with run loop
     IOHIDManagerScheduleWithRunLoop(hid_manager, CFRunLoopGetCurrent(), kCFRunLoopDefaultMode);
@@ -331,32 +779,101 @@ static void cleanup_hid_system()
         CFRelease(hid_manager);
         hid_manager = NULL;
     }
+
+    if (stdin_ref)
+    {
+        CFFileDescriptorInvalidate(stdin_ref);
+        CFRelease(stdin_ref);
+        stdin_ref = NULL;
+    }
+
+    if (stdout_ref)
+    {
+        CFFileDescriptorInvalidate(stdout_ref);
+        CFRelease(stdout_ref);
+        stdout_ref = NULL;
+    }
+
+    for (int client = 0; client < MAX_CLIENTS; client++)
+    {
+        if (client_refs[client])
+        {
+            CFFileDescriptorInvalidate(client_refs[client]);
+            CFRelease(client_refs[client]);
+            client_refs[client] = NULL;
+        }
+    }
+
+    if (socket_ref)
+    {
+        CFFileDescriptorInvalidate(socket_ref);
+        CFRelease(socket_ref);
+        socket_ref = NULL;
+    }
+
+    if (flush_observer)
+    {
+        CFRunLoopObserverInvalidate(flush_observer);
+        CFRelease(flush_observer);
+        flush_observer = NULL;
+    }
+
+    if (replay_timer)
+    {
+        CFRunLoopTimerInvalidate(replay_timer);
+        CFRelease(replay_timer);
+        replay_timer = NULL;
+    }
 }
 
 // Main entry point
-int main(int argc __unused, char *argv[] __unused)
+int main(int argc, char *argv[])
 {
-    // Initialize HID system
-    if (!initialize_hid_system())
+    protocol_init(argc, argv);
+
+    if (!capture_init(argc, argv) || !calibration_init(argc, argv) || !response_curve_init(argc, argv) ||
+        !idle_filter_init(argc, argv) || !state_shm_init(argc, argv) || !event_server_init(argc, argv))
     {
+        state_shm_close();
         return 1;
     }
 
-    // Signal ready state
-    printf("STATUS:ready\n");
-    fflush(stdout);
+    led_cache_init(argc, argv);
 
-    // Run event loop with periodic stdin checking
-    while (true)
+    // Initialize HID system, or the replay timer that stands in for it
+    if (!(replay_enabled() ? initialize_replay() : initialize_hid_system()))
     {
-        // Run HID event loop for a short time
-        CFRunLoopRunInMode(kCFRunLoopDefaultMode, 0.1, false);
+        capture_close();
+        state_shm_close();
+        event_server_close();
+        return 1;
+    }
 
-        // Check for stdin commands
-        check_stdin_input();
+    // Register the stdin command source and the output flush hooks
+    if (!initialize_stdio_sources())
+    {
+        cleanup_hid_system();
+        capture_close();
+        state_shm_close();
+        event_server_close();
+        return 1;
     }
 
-    // Cleanup (never reached in normal operation)
+    // Signal ready state
+    protocol_status(STATUS_READY);
+
+    // Block in the run loop: HID reports and stdin commands are both
+    // run-loop sources, so each is handled the moment it arrives. Returns
+    // once stdin_callback sees the port close.
+    CFRunLoopRun();
+
+    // Best effort: hand over whatever is still queued
+    protocol_flush();
+    event_server_flush();
+
+    capture_close();
+    state_shm_close();
     cleanup_hid_system();
+    event_server_close();
     return 0;
 }
@@ -0,0 +1,534 @@
+/*
+ * Synthetic SpaceMouse Reader
+ *
+ * Purpose: Stand-in for the hardware readers on machines without a
+ *          SpaceMouse (CI, build agents, load tests). Generates raw HID
+ *          reports at a fixed rate, runs them through the same decoder as
+ *          the real readers and speaks the same port protocol. The decoder
+ *          is driven by a built-in report descriptor, as it would be for a
+ *          real device.
+ *
+ * Options (in addition to --protocol=binary|text):
+ * - --rate=HZ           report rate, 10 to 10000 (default 100)
+ * - --pattern=NAME      sine, step, noise, idle or drift (default sine)
+ * - --amplitude=N       peak axis value (default 350, the device range)
+ * - --button-rate=HZ    button 1/2 press+release cycles per second
+ *                       (default 0.5, 0 disables buttons)
+ * - --seed=N            seed for noise and idle jitter (default 1)
+ * - --devices=N         simulated devices, 1 to MAX_DEVICES (default 1);
+ *                       every device replays the same generated reports
+ * - --shm=NAME          publish the latest state in shared memory, as the
+ *                       hardware readers do (see ../common/state_shm.h)
+ * - --socket=PATH       serve the binary record stream to local clients
+ *                       (see ../common/event_server.h)
+ * - --auto-zero=SPEC    zero-drift calibration, as the hardware readers
+ *                       (see ../common/calibration.h)
+ * - --curve=SPEC        per-axis response curve, as the hardware readers
+ *                       (see ../common/response_curve.h)
+ * - --idle-filter=SPEC  change-only emission, as the hardware readers
+ *                       (see ../common/idle_filter.h)
+ *
+ * Patterns:
+ * - sine   each axis sweeps 0.2-5 Hz over 10 s, phase-shifted per axis
+ * - step   one axis at a time jumps to +/-amplitude every 500 ms
+ * - noise  mean-reverting random walk on every axis
+ * - idle   puck at rest: centred frames with +/-2 counts of sensor jitter
+ * - drift  idle around a fixed offset of a few counts per axis, like a
+ *          worn cap; calibration should bring it back to zero
+ *
+ * Event Loop:
+ * poll() on stdin (and stdout while the pipe is full), the listening socket
+ * and socket clients with a timeout up to the next due report. Every due
+ * report is generated on wake-up and carries its scheduled timestamp, so
+ * frames are evenly spaced even when several go out in one writev(). Report
+ * n is due n / rate seconds after the schedule started, so rounding to whole
+ * microseconds never accumulates and the rate is exact.
+ *
+ * INPUT (from Elixir via stdin):
+ * - LED commands: "LED:on", "LED:off" or "LED:<dev>:on" (always succeed, method 1)
+ * - "RATE:HZ" and "PATTERN:NAME" change the generator while running
+ * - "CALIBRATE" or "CALIBRATE:<dev>", as the hardware readers
+ *
+ * OUTPUT: identical to the hardware readers (see ../common/port_protocol.h)
+ *
+ * Compile: cc -O2 -o hid_reader hid_reader.c ../common/port_protocol.c ../common/report_descriptor.c \
+ *          ../common/calibration.c ../common/response_curve.c ../common/idle_filter.c ../common/state_shm.c ../common/event_server.c -lm
+ */
+
+#include <errno.h>
+#include <math.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../common/calibration.h"
+#include "../common/event_server.h"
+#include "../common/idle_filter.h"
+#include "../common/port_protocol.h"
+#include "../common/report_descriptor.h"
+#include "../common/response_curve.h"
+#include "../common/spacemouse_report.h"
+#include "../common/state_shm.h"
+
+#define SIMULATED_VENDOR_ID 0x256F
+#define SIMULATED_PRODUCT_ID 0xC635
+
+#define MIN_RATE 10.0
+#define MAX_RATE 10000.0
+
+// Report descriptor of the simulated device: six 16-bit axes in report 1
+// (range -350..350), 32 one-bit buttons in report 3
+static const uint8_t report_descriptor[] = {
+    0x05, 0x01,       // Usage Page (Generic Desktop)
+    0x09, 0x08,       // Usage (Multi-axis Controller)
+    0xA1, 0x01,       // Collection (Application)
+    0xA1, 0x00,       //   Collection (Physical)
+    0x85, 0x01,       //     Report ID (1)
+    0x16, 0xA2, 0xFE, //     Logical Minimum (-350)
+    0x26, 0x5E, 0x01, //     Logical Maximum (350)
+    0x09, 0x30,       //     Usage (X)
+    0x09, 0x31,       //     Usage (Y)
+    0x09, 0x32,       //     Usage (Z)
+    0x09, 0x33,       //     Usage (RX)
+    0x09, 0x34,       //     Usage (RY)
+    0x09, 0x35,       //     Usage (RZ)
+    0x75, 0x10,       //     Report Size (16)
+    0x95, 0x06,       //     Report Count (6)
+    0x81, 0x02,       //     Input (Data, Variable, Absolute)
+    0xC0,             //   End Collection
+    0xA1, 0x00,       //   Collection (Physical)
+    0x85, 0x03,       //     Report ID (3)
+    0x05, 0x09,       //     Usage Page (Button)
+    0x19, 0x01,       //     Usage Minimum (1)
+    0x29, 0x20,       //     Usage Maximum (32)
+    0x15, 0x00,       //     Logical Minimum (0)
+    0x25, 0x01,       //     Logical Maximum (1)
+    0x75, 0x01,       //     Report Size (1)
+    0x95, 0x20,       //     Report Count (32)
+    0x81, 0x02,       //     Input (Data, Variable, Absolute)
+    0xC0,             //   End Collection
+    0xC0,             // End Collection
+};
+
+// Reports generated per wake-up at most; beyond that the schedule restarts
+// instead of bursting to catch up after a stall
+#define MAX_CATCH_UP 1000
+
+enum pattern
+{
+    PATTERN_SINE,
+    PATTERN_STEP,
+    PATTERN_NOISE,
+    PATTERN_IDLE,
+    PATTERN_DRIFT
+};
+
+static const char *pattern_names[] = {
+    [PATTERN_SINE] = "sine",
+    [PATTERN_STEP] = "step",
+    [PATTERN_NOISE] = "noise",
+    [PATTERN_IDLE] = "idle",
+    [PATTERN_DRIFT] = "drift",
+};
+
+// Rest offset of each axis in the drift pattern
+static const int drift_offset[AXIS_COUNT] = {6, -4, 3, -7, 5, -2};
+
+// Generator settings
+static double rate = 100.0;
+static enum pattern pattern = PATTERN_SINE;
+static double amplitude = 350.0;
+static double button_rate = 0.5;
+static uint32_t rng_state = 1;
+static int device_count = 1;
+
+// Generator state
+static uint64_t start_us = 0;
+static uint64_t schedule_us = 0;  // Origin of the report schedule
+static uint64_t report_index = 0; // Reports due since schedule_us
+static uint64_t next_due_us = 0;
+static double sweep_phase[AXIS_COUNT];
+static double noise_level[AXIS_COUNT];
+static struct report_table report_table;
+static struct report_decoder decoders[MAX_DEVICES + 1];
+static struct calibration calibrations[MAX_DEVICES + 1];
+static struct idle_filter idle_filters[MAX_DEVICES + 1];
+static uint32_t button_masks[MAX_DEVICES + 1];
+
+static uint64_t monotonic_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000u + (uint64_t)ts.tv_nsec / 1000u;
+}
+
+// xorshift32: fast and reproducible for a given --seed
+static uint32_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return rng_state;
+}
+
+// Uniform in [-1, 1]
+static double random_unit(void)
+{
+    return (double)next_random() / (double)UINT32_MAX * 2.0 - 1.0;
+}
+
+static double clamp_rate(double hz)
+{
+    if (hz < MIN_RATE)
+        return MIN_RATE;
+    if (hz > MAX_RATE)
+        return MAX_RATE;
+    return hz;
+}
+
+static bool parse_pattern(const char *name, enum pattern *result)
+{
+    for (size_t i = 0; i < sizeof(pattern_names) / sizeof(pattern_names[0]); i++)
+    {
+        if (strcmp(name, pattern_names[i]) == 0)
+        {
+            *result = (enum pattern)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void parse_options(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        const char *arg = argv[i];
+
+        if (strncmp(arg, "--rate=", 7) == 0)
+            rate = clamp_rate(strtod(arg + 7, NULL));
+        else if (strncmp(arg, "--pattern=", 10) == 0 && !parse_pattern(arg + 10, &pattern))
+            fprintf(stderr, "WARNING: Unknown pattern %s, using sine\n", arg + 10);
+        else if (strncmp(arg, "--amplitude=", 12) == 0)
+            amplitude = strtod(arg + 12, NULL);
+        else if (strncmp(arg, "--button-rate=", 14) == 0)
+            button_rate = strtod(arg + 14, NULL);
+        else if (strncmp(arg, "--seed=", 7) == 0)
+            rng_state = (uint32_t)strtoul(arg + 7, NULL, 10);
+        else if (strncmp(arg, "--devices=", 10) == 0)
+            device_count = atoi(arg + 10);
+    }
+
+    if (device_count < 1)
+        device_count = 1;
+    if (device_count > MAX_DEVICES)
+        device_count = MAX_DEVICES;
+
+    if (rng_state == 0)
+        rng_state = 1; // xorshift never leaves zero
+}
+
+// Fill frame with the pattern's value at time t (seconds since start)
+static void generate_frame(double t, double dt, int16_t frame[AXIS_COUNT])
+{
+    for (int axis = 0; axis < AXIS_COUNT; axis++)
+    {
+        double value = 0.0;
+
+        switch (pattern)
+        {
+        case PATTERN_SINE:
+        {
+            // Linear sweep 0.2 -> 5 Hz, integrated so the phase stays smooth
+            double frequency = 0.2 + 4.8 * fmod(t, 10.0) / 10.0;
+            sweep_phase[axis] += 2.0 * M_PI * frequency * dt;
+            value = amplitude * sin(sweep_phase[axis] + axis * M_PI / AXIS_COUNT);
+            break;
+        }
+        case PATTERN_STEP:
+        {
+            // 12 states: axis 0 positive, axis 0 negative, axis 1 positive, ...
+            int state = (int)(t / 0.5) % (AXIS_COUNT * 2);
+            if (state / 2 == axis)
+                value = (state % 2 == 0) ? amplitude : -amplitude;
+            break;
+        }
+        case PATTERN_NOISE:
+            noise_level[axis] = noise_level[axis] * 0.98 + random_unit() * amplitude * 0.1;
+            if (noise_level[axis] > amplitude)
+                noise_level[axis] = amplitude;
+            if (noise_level[axis] < -amplitude)
+                noise_level[axis] = -amplitude;
+            value = noise_level[axis];
+            break;
+        case PATTERN_IDLE:
+            value = (double)((int)(next_random() % 5) - 2);
+            break;
+        case PATTERN_DRIFT:
+            value = (double)(drift_offset[axis] + (int)(next_random() % 5) - 2);
+            break;
+        }
+
+        frame[axis] = (int16_t)lrint(value);
+    }
+}
+
+// Buttons 1 and 2 take turns: press for half a cycle, then release
+static uint32_t generate_buttons(double t)
+{
+    if (button_rate <= 0.0)
+        return 0;
+
+    double cycles = t * button_rate;
+    if (fmod(cycles, 1.0) >= 0.5)
+        return 0;
+
+    return ((long)cycles % 2 == 0) ? 0x1u : 0x2u;
+}
+
+// Emit one BUTTONS record if any button changed
+static void emit_button_changes(uint8_t device, uint64_t timestamp_us, uint32_t new_mask)
+{
+    uint32_t changed = new_mask ^ button_masks[device];
+
+    if (changed)
+    {
+        protocol_buttons(device, timestamp_us, new_mask, changed);
+        state_shm_buttons(device, timestamp_us, new_mask);
+    }
+
+    button_masks[device] = new_mask;
+}
+
+// Emit the decoder's frame, zero-corrected and through the curves, unless
+// the idle filter suppresses it
+static void emit_motion(uint8_t device, uint64_t timestamp_us)
+{
+    int16_t frame[6];
+
+    calibration_apply(&calibrations[device], decoders[device].frame, frame);
+    response_curve_apply(frame, frame);
+    if (!idle_filter_pass(&idle_filters[device], frame, timestamp_us))
+        return;
+    protocol_motion(device, timestamp_us, frame);
+    state_shm_motion(device, timestamp_us, frame);
+}
+
+// Decode one raw input report and emit the resulting event
+static void handle_report(uint8_t device, uint64_t timestamp_us, const uint8_t *report, size_t length)
+{
+    struct report_decoder *decoder = &decoders[device];
+
+    int kind = decode_report(decoder, report, length);
+
+    if (kind & REPORT_MOTION)
+        emit_motion(device, timestamp_us);
+    if (kind & REPORT_BUTTONS)
+        emit_button_changes(device, timestamp_us, decoder->buttons);
+}
+
+// Build the raw reports a SpaceMouse would send at timestamp_us
+static void simulate_report(uint64_t timestamp_us)
+{
+    double t = (double)(timestamp_us - start_us) / 1e6;
+    int16_t frame[AXIS_COUNT];
+
+    generate_frame(t, 1.0 / rate, frame);
+
+    uint8_t motion[13] = {REPORT_ID_TRANSLATION};
+    for (int axis = 0; axis < AXIS_COUNT; axis++)
+    {
+        motion[1 + axis * 2] = (uint8_t)((uint16_t)frame[axis] & 0xFF);
+        motion[2 + axis * 2] = (uint8_t)((uint16_t)frame[axis] >> 8);
+    }
+
+    uint32_t buttons = generate_buttons(t);
+    uint8_t report[5] = {REPORT_ID_BUTTONS, (uint8_t)buttons, (uint8_t)(buttons >> 8),
+                         (uint8_t)(buttons >> 16), (uint8_t)(buttons >> 24)};
+
+    for (uint8_t device = 1; device <= device_count; device++)
+    {
+        handle_report(device, timestamp_us, motion, sizeof(motion));
+
+        if (buttons != button_masks[device])
+            handle_report(device, timestamp_us, report, sizeof(report));
+    }
+}
+
+// Start a new schedule with its first report due at origin_us (at start,
+// on a rate change and after a stall)
+static void restart_schedule(uint64_t origin_us)
+{
+    schedule_us = origin_us;
+    report_index = 0;
+    next_due_us = origin_us;
+}
+
+static void advance_schedule(void)
+{
+    report_index++;
+    next_due_us = schedule_us + (uint64_t)((double)report_index * 1e6 / rate);
+}
+
+// Generate every report that is due by now
+static void run_generator(uint64_t now_us)
+{
+    int generated = 0;
+
+    while (next_due_us <= now_us)
+    {
+        if (generated++ == MAX_CATCH_UP)
+        {
+            // Stalled (suspended, debugger): resume from now, don't burst
+            protocol_info("simulator_skipped_us=%llu", (unsigned long long)(now_us - next_due_us));
+            restart_schedule(now_us);
+            advance_schedule();
+            break;
+        }
+
+        simulate_report(next_due_us);
+        advance_schedule();
+    }
+}
+
+// Handle command from stdin
+static void handle_stdin_command(const char *line)
+{
+    uint8_t device;
+    bool on;
+
+    if (strncmp(line, "LED:", 4) == 0 && protocol_parse_led_args(line + 4, &device, &on))
+    {
+        if (device > device_count)
+            protocol_info("led_failed=device_not_available,device=%d", device);
+        else if (device != 0)
+            protocol_led(device, on, 1);
+        else
+        {
+            for (uint8_t i = 1; i <= device_count; i++)
+                protocol_led(i, on, 1);
+        }
+    }
+    else if (protocol_parse_calibrate(line, &device))
+    {
+        if (device > device_count)
+            protocol_info("calibrate_failed=device_not_available,device=%d", device);
+        for (uint8_t i = 1; i <= device_count; i++)
+        {
+            if (device == 0 || device == i)
+            {
+                calibration_zero(&calibrations[i], decoders[i].frame);
+                protocol_info("calibrated,device=%u", i);
+                emit_motion(i, monotonic_us());
+            }
+        }
+    }
+    else if (strncmp(line, "RATE:", 5) == 0)
+    {
+        rate = clamp_rate(strtod(line + 5, NULL));
+        restart_schedule(next_due_us);
+        protocol_info("simulator_rate=%g", rate);
+    }
+    else if (strncmp(line, "PATTERN:", 8) == 0)
+    {
+        if (parse_pattern(line + 8, &pattern))
+            protocol_info("simulator_pattern=%s", pattern_names[pattern]);
+        else
+            protocol_info("unknown_pattern=%s", line + 8);
+    }
+    else
+    {
+        protocol_info("unknown_command=%s", line);
+    }
+}
+
+// Milliseconds until the next report is due, rounded up (poll() resolution)
+static int poll_timeout(uint64_t now_us)
+{
+    if (next_due_us <= now_us)
+        return 0;
+    return (int)((next_due_us - now_us + 999) / 1000);
+}
+
+// Main entry point
+int main(int argc, char *argv[])
+{
+    protocol_init(argc, argv);
+    parse_options(argc, argv);
+
+    if (!calibration_init(argc, argv) || !response_curve_init(argc, argv) || !idle_filter_init(argc, argv) ||
+        !state_shm_init(argc, argv) || !event_server_init(argc, argv))
+    {
+        state_shm_close();
+        return 1;
+    }
+
+    if (!report_table_build(&report_table, report_descriptor, sizeof(report_descriptor)))
+        protocol_info("report_layout=builtin");
+
+    protocol_status(STATUS_READY);
+    for (uint8_t device = 1; device <= device_count; device++)
+    {
+        report_decoder_init(&decoders[device], &report_table);
+        protocol_device_connected(device, SIMULATED_VENDOR_ID, SIMULATED_PRODUCT_ID);
+        state_shm_device(device, true, SIMULATED_VENDOR_ID, SIMULATED_PRODUCT_ID);
+    }
+    protocol_info("simulator_pattern=%s,rate=%g", pattern_names[pattern], rate);
+
+    start_us = monotonic_us();
+    restart_schedule(start_us);
+
+    bool running = true;
+    while (running)
+    {
+        bool output_blocked = !protocol_flush();
+        event_server_flush();
+
+        // stdin, stdout, the listening socket, then one entry per client
+        struct pollfd fds[3 + MAX_CLIENTS] = {
+            {.fd = STDIN_FILENO, .events = POLLIN},
+            {.fd = STDOUT_FILENO, .events = output_blocked ? POLLOUT : 0},
+            {.fd = event_server_listen_fd(), .events = POLLIN},
+        };
+        for (int client = 0; client < MAX_CLIENTS; client++)
+        {
+            fds[3 + client].fd = event_server_client_fd(client);
+            fds[3 + client].events = POLLIN | (event_server_client_pending(client) ? POLLOUT : 0);
+        }
+
+        int count = poll(fds, 3 + MAX_CLIENTS, poll_timeout(monotonic_us()));
+        if (count < 0 && errno != EINTR)
+            break;
+
+        if (count > 0 && (fds[0].revents & (POLLIN | POLLHUP)))
+            running = protocol_read_commands(STDIN_FILENO, handle_stdin_command);
+
+        for (int client = 0; count > 0 && client < MAX_CLIENTS; client++)
+        {
+            if (fds[3 + client].revents & (POLLIN | POLLHUP | POLLERR))
+                event_server_client_readable(client);
+        }
+
+        if (count > 0 && (fds[2].revents & POLLIN))
+        {
+            while (event_server_accept() >= 0)
+                ;
+        }
+
+        // A full pipe does not stop the device: the port protocol coalesces
+        // motion until the VM catches up, exactly as with real hardware
+        run_generator(monotonic_us());
+    }
+
+    // Best effort: hand over whatever is still queued
+    protocol_flush();
+    event_server_flush();
+    state_shm_close();
+    event_server_close();
+    return 0;
+}
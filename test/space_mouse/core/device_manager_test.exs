@@ -0,0 +1,95 @@
+defmodule SpaceMouse.Core.DeviceManagerTest do
+  use ExUnit.Case, async: false
+
+  alias SpaceMouse.Core.{Device, DeviceManager, DeviceState}
+
+  # A real slot of DeviceState (1-8) not used by the other tests
+  @device_id 6
+
+  setup do
+    # No reader is started here: the status events are replayed by hand
+    DeviceManager.set_auto_reconnect(false)
+
+    on_exit(fn ->
+      replay(["device_disconnected"])
+      DeviceManager.set_auto_reconnect(true)
+    end)
+  end
+
+  test "a device reconnecting straight after a disconnect gets a new process" do
+    SpaceMouse.subscribe(device: @device_id)
+
+    replay(["device_connected"])
+    first = Device.whereis(@device_id)
+    assert is_pid(first)
+    assert DeviceState.attached?(@device_id)
+
+    move(first, x: 175)
+    assert {:ok, %{x: 0.5}} = DeviceState.motion(@device_id)
+
+    replay(["device_disconnected", "device_connected"])
+    second = Device.whereis(@device_id)
+    assert is_pid(second)
+    assert second != first
+    refute Process.alive?(first)
+    assert [%{device_id: @device_id}] = Enum.filter(SpaceMouse.devices(), &(&1.device_id == @device_id))
+
+    # The new process starts from rest and owns the slot
+    assert DeviceState.attached?(@device_id)
+    assert {:ok, %{x: 0.0}} = DeviceState.motion(@device_id)
+    move(second, x: -175)
+    assert {:ok, %{x: -0.5}} = DeviceState.motion(@device_id)
+
+    assert_receive {:spacemouse_connected, %{device_id: @device_id}}
+    assert_receive {:spacemouse_disconnected, %{device_id: @device_id}}
+    assert_receive {:spacemouse_connected, %{device_id: @device_id}}
+
+    replay(["device_disconnected"])
+    refute DeviceState.attached?(@device_id)
+    assert DeviceState.motion(@device_id) == :disconnected
+
+    SpaceMouse.unsubscribe()
+  end
+
+  test "motion goes straight to the device process, status to the owner" do
+    replay(["device_connected"])
+    SpaceMouse.subscribe(device: @device_id)
+
+    # The manager cannot handle anything while suspended
+    :sys.suspend(DeviceManager)
+
+    try do
+      Device.route(%{type: :motion, device_id: @device_id, data: %{x: 350, y: 0, z: 0, rx: 0, ry: 0, rz: -175}}, self())
+      assert_receive {:spacemouse_motion, %{device_id: @device_id, x: x, rz: rz}}
+      assert_in_delta x, 1.0, 1.0e-9
+      assert_in_delta rz, -0.5, 1.0e-9
+
+      Device.route(%{type: :status, message: "ready"}, self())
+      assert_receive {:hid_event, %{type: :status, message: "ready"}}
+
+      # No process for that ID yet: the owner gets it
+      Device.route(%{type: :buttons, device_id: @device_id + 1, data: %{buttons: 1, changed: 1}}, self())
+      assert_receive {:hid_event, %{type: :buttons}}
+    after
+      :sys.resume(DeviceManager)
+      SpaceMouse.unsubscribe()
+    end
+  end
+
+  # Send one raw frame to the device process and wait until it has handled it
+  defp move(pid, values) do
+    data = Map.merge(%{x: 0, y: 0, z: 0, rx: 0, ry: 0, rz: 0}, Map.new(values))
+    Device.route(%{type: :motion, device_id: @device_id, data: data}, self())
+    :sys.get_state(pid)
+  end
+
+  # Hand status events to the manager as the platform would, back to back,
+  # and wait until it has handled them
+  defp replay(messages) do
+    for message <- messages do
+      send(DeviceManager, {:hid_event, %{type: :status, message: message, device_id: @device_id}})
+    end
+
+    :sys.get_state(DeviceManager)
+  end
+end
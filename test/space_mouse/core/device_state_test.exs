@@ -0,0 +1,90 @@
+defmodule SpaceMouse.Core.DeviceStateTest do
+  use ExUnit.Case, async: false
+
+  alias SpaceMouse.Core.DeviceState
+
+  # The highest slot, not taken by anything else in the tests
+  @device_id 8
+  @axes [:x, :y, :z, :rx, :ry, :rz]
+  # Sequence word of that slot: after the connection state and seven slots
+  @sequence_index 1 + 7 * 9 + 1
+
+  setup do
+    DeviceState.attach(@device_id)
+    on_exit(fn -> DeviceState.detach(@device_id) end)
+  end
+
+  test "reads back what was put, in millionths" do
+    {:ok, attached} = DeviceState.motion(@device_id)
+    assert Map.take(attached, @axes) == %{x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}
+
+    DeviceState.put_motion(@device_id, %{x: 0.5, y: -0.25, z: 0.1234567, rx: 1.0, ry: -1.0, rz: 0.0})
+    DeviceState.put_buttons(@device_id, 0b101)
+
+    {:ok, frame} = DeviceState.motion(@device_id)
+    assert Map.take(frame, @axes) == %{x: 0.5, y: -0.25, z: 0.123457, rx: 1.0, ry: -1.0, rz: 0.0}
+    assert DeviceState.buttons(@device_id) == 0b101
+
+    # Two sequence steps per update
+    assert frame.sequence == attached.sequence + 4
+    assert rem(frame.sequence, 2) == 0
+  end
+
+  test "a detached or unknown device reads as disconnected" do
+    assert DeviceState.attached?(@device_id)
+
+    DeviceState.detach(@device_id)
+    refute DeviceState.attached?(@device_id)
+    assert DeviceState.motion(@device_id) == :disconnected
+    assert DeviceState.buttons(@device_id) == 0
+
+    assert DeviceState.motion(9) == :disconnected
+    refute DeviceState.attached?(0)
+    assert DeviceState.put_motion(9, %{x: 1.0}) == :ok
+  end
+
+  test "a reader never sees a half-written frame" do
+    writer = spawn_link(fn -> write_frames(1) end)
+
+    for _read <- 1..20_000 do
+      {:ok, frame} = DeviceState.motion(@device_id)
+      assert frame |> Map.take(@axes) |> Map.values() |> Enum.uniq() |> length() == 1
+      assert rem(frame.sequence, 2) == 0
+    end
+
+    Process.unlink(writer)
+    Process.exit(writer, :kill)
+  end
+
+  test "a slot left mid-write reads as disconnected until the next attach" do
+    {:ok, %{sequence: sequence}} = DeviceState.motion(@device_id)
+
+    # What a writer killed between its two sequence steps leaves behind
+    :atomics.add(:persistent_term.get(DeviceState), @sequence_index, 1)
+    assert DeviceState.motion(@device_id) == :disconnected
+    assert DeviceState.buttons(@device_id) == 0
+
+    DeviceState.attach(@device_id)
+    assert {:ok, frame} = DeviceState.motion(@device_id)
+    assert rem(frame.sequence, 2) == 0
+    assert frame.sequence > sequence
+  end
+
+  test "connection state round trip" do
+    previous = DeviceState.connection_state()
+
+    for connection_state <- [:connecting, :error, :disconnected] do
+      DeviceState.put_connection_state(connection_state)
+      assert DeviceState.connection_state() == connection_state
+    end
+
+    DeviceState.put_connection_state(previous)
+  end
+
+  # All six axes carry the same value in every frame
+  defp write_frames(n) do
+    value = rem(n, 1000) / 1000
+    DeviceState.put_motion(@device_id, Map.new(@axes, &{&1, value}))
+    write_frames(n + 1)
+  end
+end
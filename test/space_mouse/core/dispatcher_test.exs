@@ -0,0 +1,140 @@
+defmodule SpaceMouse.Core.DispatcherTest do
+  use ExUnit.Case, async: false
+
+  alias SpaceMouse.Core.Dispatcher
+
+  # No reader sends events for these IDs: everything here is dispatched by hand
+  @device_id 901
+  @other_device_id 906
+
+  describe "fan-out" do
+    test "delivers a device's events to its subscribers in order" do
+      Dispatcher.subscribe(self(), @device_id)
+      burst(1..5)
+
+      assert Enum.map(1..5, fn _n -> receive_motion().x end) == [1, 2, 3, 4, 5]
+    end
+
+    test "a device subscription receives only that device, :all every device" do
+      Dispatcher.subscribe(self(), @device_id)
+      burst(@other_device_id, 1..1)
+      refute_receive {:spacemouse_motion, _payload}, 50
+
+      Dispatcher.subscribe(self(), :all)
+      burst(@other_device_id, 1..1)
+      assert_receive {:spacemouse_motion, %{device_id: @other_device_id}}
+    end
+
+    test "subscribing again adds devices, :all covers everything" do
+      assert Dispatcher.subscribe(self(), @device_id) == MapSet.new([@device_id])
+      assert Dispatcher.subscribe(self(), @other_device_id) == MapSet.new([@device_id, @other_device_id])
+      assert Dispatcher.subscribe(self(), :all) == :all
+      assert Dispatcher.subscribe(self(), @device_id) == :all
+
+      # One row per subscriber: a device covered twice still sends one copy
+      burst(1..1)
+      assert_receive {:spacemouse_motion, %{x: 1}}
+      refute_receive {:spacemouse_motion, _payload}, 50
+    end
+
+    test "every subscriber gets the event" do
+      test = self()
+
+      subscribers =
+        for n <- 1..3 do
+          spawn_link(fn ->
+            Dispatcher.subscribe(self(), @device_id)
+            send(test, {:subscribed, n})
+            receive do: ({:spacemouse_motion, payload} -> send(test, {:received, n, payload.x}))
+          end)
+        end
+
+      for n <- 1..3, do: assert_receive({:subscribed, ^n})
+      burst(7..7)
+
+      for n <- 1..length(subscribers), do: assert_receive({:received, ^n, 7})
+    end
+  end
+
+  describe "delivery modes" do
+    test ":every delivers every frame in order" do
+      Dispatcher.subscribe(self(), @device_id, :every)
+      burst(1..5)
+
+      for n <- 1..5 do
+        assert_receive {:spacemouse_motion, %{x: ^n} = payload}
+        refute Map.has_key?(payload, :dropped)
+      end
+
+      Dispatcher.ack(self())
+      refute_receive {:spacemouse_motion, _payload}, 50
+    end
+
+    test ":latest keeps one frame in flight and the newest one held until ack" do
+      Dispatcher.subscribe(self(), @device_id, :latest)
+      burst(1..5)
+
+      assert_receive {:spacemouse_motion, %{x: 1} = payload}
+      refute Map.has_key?(payload, :dropped)
+      refute_receive {:spacemouse_motion, _payload}, 50
+
+      # 2 was held, then superseded by 3, 4 and 5
+      Dispatcher.ack(self())
+      assert_receive {:spacemouse_motion, %{x: 5, dropped: 3}}
+      refute_receive {:spacemouse_motion, _payload}, 50
+    end
+
+    test "{:bounded, n} drops frames beyond the window and reports them" do
+      Dispatcher.subscribe(self(), @device_id, {:bounded, 2})
+      burst(1..5)
+
+      assert_receive {:spacemouse_motion, %{x: 1}}
+      assert_receive {:spacemouse_motion, %{x: 2}}
+      refute_receive {:spacemouse_motion, _payload}, 50
+
+      # Nothing is held: ack only opens the window again
+      Dispatcher.ack(self())
+      refute_receive {:spacemouse_motion, _payload}, 50
+
+      burst(6..6)
+      assert_receive {:spacemouse_motion, %{x: 6, dropped: 3}}
+    end
+
+    test "other events are never held" do
+      Dispatcher.subscribe(self(), @device_id, :latest)
+      burst(1..2)
+      Dispatcher.dispatch(@device_id, {:spacemouse_buttons, %{device_id: @device_id, buttons: 1, changed: 1}})
+
+      assert_receive {:spacemouse_motion, %{x: 1}}
+      assert_receive {:spacemouse_buttons, %{buttons: 1}}
+      refute_receive {:spacemouse_motion, _payload}, 50
+    end
+
+    test "an invalid delivery mode is rejected" do
+      refute Dispatcher.valid_delivery?({:bounded, 0})
+      assert_raise ArgumentError, fn -> SpaceMouse.subscribe(delivery: :sometimes) end
+    end
+  end
+
+  test "unsubscribe/1 stops delivery" do
+    Dispatcher.subscribe(self(), @device_id)
+    Dispatcher.unsubscribe(self())
+    burst(1..1)
+
+    refute_receive {:spacemouse_motion, _payload}, 50
+  end
+
+  defp burst(device_id \\ @device_id, range) do
+    for n <- range do
+      Dispatcher.dispatch(device_id, {:spacemouse_motion, %{device_id: device_id, x: n}})
+    end
+  end
+
+  defp receive_motion do
+    receive do
+      {:spacemouse_motion, payload} -> payload
+    after
+      1_000 -> flunk("no motion event")
+    end
+  end
+end
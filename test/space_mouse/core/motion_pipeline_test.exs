@@ -0,0 +1,181 @@
+defmodule SpaceMouse.Core.MotionPipelineTest do
+  use ExUnit.Case, async: true
+
+  alias SpaceMouse.Core.MotionPipeline
+
+  @zero %{x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}
+
+  describe "compile/1" do
+    test "an empty pipeline is nil and passes frames through" do
+      assert MotionPipeline.compile([]) == nil
+      assert MotionPipeline.run(nil, frame(x: 0.5), 0) == {frame(x: 0.5), nil}
+      assert MotionPipeline.metrics(nil) == []
+    end
+
+    test "rejects unknown stages and invalid options" do
+      for spec <- [
+            [{:blur, []}],
+            [:ema],
+            [{:ema, alpha: 0}],
+            [{:ema, alpha: 1.5}],
+            [{:deadzone, []}],
+            [{:deadzone, threshold: 1.0}],
+            [{:deadzone, threshold: 0.1, axes: [:w]}],
+            [{:one_euro, min_cutoff: 0}],
+            [{:clamp, limit: -1}],
+            [{:gain, x: :fast}],
+            [{:gain, w: 2.0}]
+          ] do
+        assert_raise ArgumentError, fn -> MotionPipeline.compile(spec) end
+      end
+    end
+  end
+
+  describe "stages" do
+    test ":deadzone zeroes small values and rescales the rest" do
+      pipeline = MotionPipeline.compile([{:deadzone, threshold: 0.2}])
+      {out, _pipeline} = MotionPipeline.run(pipeline, frame(x: 0.1, y: 0.6, z: -1.0, rx: 0.2), 0)
+
+      assert out.x == 0.0
+      assert_in_delta out.y, 0.5, 1.0e-9
+      assert_in_delta out.z, -1.0, 1.0e-9
+      assert out.rx == 0.0
+    end
+
+    test ":axes restricts a stage" do
+      pipeline = MotionPipeline.compile([{:deadzone, threshold: 0.2, axes: [:x]}])
+      {out, _pipeline} = MotionPipeline.run(pipeline, frame(x: 0.1, y: 0.1), 0)
+
+      assert out.x == 0.0
+      assert out.y == 0.1
+    end
+
+    test ":clamp limits every value" do
+      pipeline = MotionPipeline.compile([{:clamp, limit: 0.5}])
+      {out, _pipeline} = MotionPipeline.run(pipeline, frame(x: 0.8, y: -0.9, z: 0.3), 0)
+
+      assert out == frame(x: 0.5, y: -0.5, z: 0.3)
+    end
+
+    test ":gain scales the listed axes only" do
+      pipeline = MotionPipeline.compile([{:gain, x: 2.0, rz: 0.5}])
+      {out, _pipeline} = MotionPipeline.run(pipeline, frame(x: 0.25, y: 0.25, rz: 0.5), 0)
+
+      assert out == frame(x: 0.5, y: 0.25, rz: 0.25)
+    end
+
+    test "stages run in order" do
+      input = frame(x: 0.8)
+
+      {out, _pipeline} = MotionPipeline.run(MotionPipeline.compile([{:gain, x: 2.0}, {:clamp, limit: 1.0}]), input, 0)
+      assert out.x == 1.0
+
+      {out, _pipeline} = MotionPipeline.run(MotionPipeline.compile([{:clamp, limit: 1.0}, {:gain, x: 2.0}]), input, 0)
+      assert out.x == 1.6
+    end
+
+    test ":ema passes the first frame and then averages" do
+      pipeline = MotionPipeline.compile([{:ema, alpha: 0.25}])
+
+      {first, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.4), 0)
+      assert first.x == 0.4
+
+      {second, _pipeline} = MotionPipeline.run(pipeline, frame(x: 0.8), 1_000)
+      assert_in_delta second.x, 0.5, 1.0e-9
+    end
+
+    test ":one_euro smooths by report time and follows fast moves more closely" do
+      # 10 ms between reports at a 1 Hz cutoff
+      r = 2 * :math.pi() * 1.0 * 0.01
+      alpha = r / (r + 1)
+
+      slow = one_euro_step(beta: 0.0)
+      assert_in_delta slow.x, alpha, 1.0e-9
+
+      fast = one_euro_step(beta: 0.5)
+      assert fast.x > slow.x
+      assert fast.x < 1.0
+    end
+  end
+
+  describe "metrics/1" do
+    test "counts frames and time per stage" do
+      pipeline = MotionPipeline.compile([{:deadzone, threshold: 0.1}, {:clamp, limit: 1.0}], metrics: true)
+
+      pipeline =
+        Enum.reduce(1..3, pipeline, fn n, pipeline ->
+          {_frame, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.5), n * 1_000)
+          pipeline
+        end)
+
+      assert [%{stage: :deadzone} = deadzone, %{stage: :clamp} = clamp] = MotionPipeline.metrics(pipeline)
+
+      for metric <- [deadzone, clamp] do
+        assert metric.frames == 3
+        assert metric.total_ns >= 0
+        assert metric.mean_ns == div(metric.total_ns, 3)
+      end
+    end
+
+    test "stages are not timed unless compiled with metrics: true" do
+      pipeline = MotionPipeline.compile([{:deadzone, threshold: 0.1}])
+      {out, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.05), 0)
+
+      assert out == @zero
+      assert pipeline.counters == nil
+      assert MotionPipeline.metrics(pipeline) == []
+    end
+  end
+
+  describe "rest frame" do
+    test ":ema outputs zero on the all-zero frame and starts over from it" do
+      pipeline = MotionPipeline.compile([{:ema, alpha: 0.2}], reset_at_rest: true)
+
+      {_frame, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.5), 0)
+      {moving, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.8), 1_000)
+      assert_in_delta moving.x, 0.56, 1.0e-9
+
+      {rest, pipeline} = MotionPipeline.run(pipeline, @zero, 2_000)
+      assert rest == @zero
+
+      {next, _pipeline} = MotionPipeline.run(pipeline, frame(x: 0.5), 3_000)
+      assert_in_delta next.x, 0.1, 1.0e-9
+    end
+
+    test ":one_euro outputs zero on the all-zero frame" do
+      pipeline = MotionPipeline.compile([{:one_euro, min_cutoff: 1.0, beta: 0.01}, {:gain, x: 2.0}], reset_at_rest: true)
+
+      pipeline =
+        Enum.reduce(1..10, pipeline, fn n, pipeline ->
+          {_frame, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.6, rz: -0.3), n * 10_000)
+          pipeline
+        end)
+
+      {rest, pipeline} = MotionPipeline.run(pipeline, @zero, 110_000)
+      assert rest == @zero
+
+      # Nothing left to decay: the next frame at rest is still zero
+      {still, _pipeline} = MotionPipeline.run(pipeline, @zero, 120_000)
+      assert still == @zero
+    end
+
+    test "without reset_at_rest an all-zero frame is smoothed like any other" do
+      pipeline = MotionPipeline.compile([{:ema, alpha: 0.2}])
+
+      {_frame, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.5), 0)
+      {_frame, pipeline} = MotionPipeline.run(pipeline, frame(x: 0.8), 1_000)
+      {zero, _pipeline} = MotionPipeline.run(pipeline, @zero, 2_000)
+      assert_in_delta zero.x, 0.448, 1.0e-9
+    end
+  end
+
+  defp frame(values), do: Map.merge(@zero, Map.new(values))
+
+  # Output of the second of two frames, 10 ms apart, stepping x from 0 to 1
+  defp one_euro_step(opts) do
+    pipeline = MotionPipeline.compile([{:one_euro, [min_cutoff: 1.0] ++ opts}])
+    {_frame, pipeline} = MotionPipeline.run(pipeline, frame(y: 0.5), 0)
+    {out, _pipeline} = MotionPipeline.run(pipeline, frame(x: 1.0, y: 0.5), 10_000)
+    out
+  end
+end
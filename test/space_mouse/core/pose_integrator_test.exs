@@ -0,0 +1,142 @@
+defmodule SpaceMouse.Core.PoseIntegratorTest do
+  use ExUnit.Case, async: false
+
+  alias SpaceMouse.Core.PoseIntegrator
+
+  @device_id 903
+  @zero %{x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}
+  # A quarter turn about z: 90°/s at rz 0.5 with the default angular speed of π
+  @quarter_turn {:math.cos(:math.pi() / 4), 0.0, 0.0, :math.sin(:math.pi() / 4)}
+
+  setup do
+    on_exit(fn -> restart(nil) end)
+  end
+
+  test "integrates translation from the report timestamps" do
+    restart([])
+
+    pose = drive([{0, x: 0.5}, {100_000, []}])
+
+    assert_vector pose.position, {0.05, 0.0, 0.0}
+    assert pose.orientation == {1.0, 0.0, 0.0, 0.0}
+    assert pose.timestamp == 100_000
+  end
+
+  test "integrates rotation into a unit quaternion" do
+    restart([])
+
+    pose = drive(hold(0, 1_000_000, rz: 0.5) ++ [{1_000_000, []}])
+
+    assert_quaternion pose.orientation, @quarter_turn
+    assert_vector pose.position, {0.0, 0.0, 0.0}
+  end
+
+  test ":local translates along the device's own axes" do
+    restart(frame: :local)
+
+    pose = drive(hold(0, 1_000_000, rz: 0.5) ++ [{1_000_000, x: 0.5}, {1_100_000, []}])
+
+    assert_quaternion pose.orientation, @quarter_turn
+    assert_vector pose.position, {0.0, 0.05, 0.0}
+  end
+
+  test ":world translates along the fixed axes" do
+    restart(frame: :world)
+
+    pose = drive(hold(0, 1_000_000, rz: 0.5) ++ [{1_000_000, x: 0.5}, {1_100_000, []}])
+
+    assert_quaternion pose.orientation, @quarter_turn
+    assert_vector pose.position, {0.05, 0.0, 0.0}
+  end
+
+  test "limits linear and angular speed" do
+    restart(max_linear_speed: 0.2, max_angular_speed: :math.pi() / 2)
+
+    # |v| = √2 at full deflection on x and y, limited to 0.2 units/s
+    pose = drive([{0, x: 1.0, y: 1.0}, {100_000, []}])
+    assert_vector pose.position, {0.02 / :math.sqrt(2), 0.02 / :math.sqrt(2), 0.0}
+
+    # π rad/s at full deflection, limited to π/2: a quarter turn in 1 s
+    pose = drive(hold(100_000, 1_100_000, rz: 1.0) ++ [{1_100_000, []}])
+    assert_quaternion pose.orientation, @quarter_turn
+  end
+
+  test "integrates a gap longer than 100 ms as 100 ms" do
+    restart([])
+
+    pose = drive([{0, x: 1.0}, {1_000_000, []}])
+
+    assert_vector pose.position, {0.1, 0.0, 0.0}
+    assert pose.timestamp == 1_000_000
+  end
+
+  test "steps in fixed timesteps and carries the remainder over" do
+    restart(timestep: 10_000)
+    PoseIntegrator.subscribe(self(), device: @device_id)
+
+    pose = drive([{0, x: 1.0}, {15_000, x: 1.0}])
+    assert_vector pose.position, {0.01, 0.0, 0.0}
+    assert pose.timestamp == 10_000
+    assert_receive {:spacemouse_pose, %{device_id: @device_id, timestamp: 10_000}}
+
+    pose = drive([{20_000, []}])
+    assert_vector pose.position, {0.02, 0.0, 0.0}
+    assert pose.timestamp == 20_000
+    assert_receive {:spacemouse_pose, %{device_id: @device_id, timestamp: 20_000}}
+
+    # At rest nothing moves and nothing is sent
+    drive([{40_000, []}])
+    refute_receive {:spacemouse_pose, _pose}, 50
+  end
+
+  test "advances a held velocity between reports" do
+    restart([])
+    PoseIntegrator.subscribe(self(), device: @device_id)
+
+    # Received now, so the report clock is estimated from the BEAM clock
+    send(PoseIntegrator, {:spacemouse_motion, motion(0, System.monotonic_time(:microsecond), x: 1.0)})
+
+    assert_receive {:spacemouse_pose, %{device_id: @device_id, position: {x, _y, _z}}}, 500
+    assert x > 0.0
+  end
+
+  # Replace the running integrator with one using the given :pose config
+  defp restart(config) do
+    if config, do: Application.put_env(:space_mouse, :pose, config), else: Application.delete_env(:space_mouse, :pose)
+
+    :ok = Supervisor.terminate_child(SpaceMouse.Core.Supervisor, PoseIntegrator)
+    {:ok, _pid} = Supervisor.restart_child(SpaceMouse.Core.Supervisor, PoseIntegrator)
+  end
+
+  # Feed motion frames {device_timestamp, axes} and return the pose after
+  # them. They are stamped as received an hour from now, so the report
+  # clock estimated between reports never catches up with them and only
+  # the given timestamps move the pose.
+  defp drive(frames) do
+    received_at = System.monotonic_time(:microsecond) + 3_600_000_000
+
+    for {timestamp, values} <- frames do
+      send(PoseIntegrator, {:spacemouse_motion, motion(timestamp, received_at, values)})
+    end
+
+    {:ok, pose} = PoseIntegrator.pose(@device_id)
+    pose
+  end
+
+  # One frame every 50 ms from `from` until before `to`
+  defp hold(from, to, values), do: for(timestamp <- from..(to - 1)//50_000, do: {timestamp, values})
+
+  defp motion(timestamp, received_at, values) do
+    @zero
+    |> Map.merge(Map.new(values))
+    |> Map.merge(%{device_id: @device_id, device_timestamp: timestamp, received_at: received_at})
+  end
+
+  defp assert_vector({x1, y1, z1}, {x2, y2, z2}) do
+    for {a, b} <- [{x1, x2}, {y1, y2}, {z1, z2}], do: assert_in_delta(a, b, 1.0e-6)
+  end
+
+  defp assert_quaternion({w1, x1, y1, z1}, {w2, x2, y2, z2}) do
+    for {a, b} <- [{w1, w2}, {x1, x2}, {y1, y2}, {z1, z2}], do: assert_in_delta(a, b, 1.0e-6)
+  end
+end
@@ -0,0 +1,65 @@
+defmodule SpaceMouse.Core.SamplerTest do
+  use ExUnit.Case, async: false
+
+  alias SpaceMouse.Core.Sampler
+
+  @device_id 904
+
+  setup do
+    on_exit(fn -> send(Sampler, {:spacemouse_disconnected, %{device_id: @device_id}}) end)
+  end
+
+  test "ticks at the subscribed rate without drift" do
+    send(Sampler, {:spacemouse_connected, %{device_id: @device_id}})
+    :ok = Sampler.subscribe(self(), 200, device: @device_id)
+
+    samples = for _sample <- 1..40, do: receive_sample()
+    Sampler.unsubscribe(self())
+
+    ticks = Enum.map(samples, & &1.tick)
+    assert ticks == Enum.sort(Enum.uniq(ticks))
+    assert Enum.all?(samples, &(&1.rate == 200 and &1.device_id == @device_id))
+
+    # 5 ms per tick on average, whatever the millisecond timer rounds to
+    [first | _samples] = samples
+    last = List.last(samples)
+    assert_in_delta (last.sampled_at - first.sampled_at) / (last.tick - first.tick), 5_000, 500
+  end
+
+  test "rejects rates outside 1..1000" do
+    assert_raise ArgumentError, fn -> Sampler.subscribe(self(), 0) end
+    assert_raise ArgumentError, fn -> Sampler.subscribe(self(), 1001) end
+  end
+
+  test "interpolates the first report after a pause over at most 50 ms" do
+    now = System.monotonic_time(:microsecond)
+    send(Sampler, {:spacemouse_motion, motion(now - 10_000_000, x: 0.0)})
+    send(Sampler, {:spacemouse_motion, motion(now, x: 1.0)})
+    :ok = Sampler.subscribe(self(), 1000, device: @device_id, interpolate: true)
+
+    # Over the whole 10 s pause, x would still be near 0 after 100 ms
+    xs = Enum.map(receive_until_latest(), & &1.x)
+    Sampler.unsubscribe(self())
+
+    assert List.last(xs) == 1.0
+    assert xs == Enum.sort(xs)
+    assert System.monotonic_time(:microsecond) - now < 1_000_000
+  end
+
+  defp receive_sample do
+    receive do
+      {:spacemouse_sample, sample} -> sample
+    after
+      1_000 -> flunk("no sample")
+    end
+  end
+
+  defp receive_until_latest(acc \\ []) do
+    sample = receive_sample()
+    if sample.x == 1.0, do: Enum.reverse([sample | acc]), else: receive_until_latest([sample | acc])
+  end
+
+  defp motion(received_at, values) do
+    Map.merge(%{device_id: @device_id, received_at: received_at, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}, Map.new(values))
+  end
+end
@@ -0,0 +1,130 @@
+defmodule SpaceMouse.Core.SubscriptionFilterTest do
+  use ExUnit.Case, async: false
+
+  alias SpaceMouse.Core.{Dispatcher, SubscriptionFilter}
+
+  @device_id 902
+
+  describe "compile/1" do
+    test "no filter options compile to nil" do
+      assert SubscriptionFilter.compile([]) == nil
+      assert SubscriptionFilter.compile(device: 1, delivery: :latest) == nil
+    end
+
+    test "rejects invalid specs" do
+      for opts <- [
+            [events: [:wheel]],
+            [events: []],
+            [axes: [:w]],
+            [axes: []],
+            [min_delta: -0.1],
+            [min_delta: :small],
+            [buttons: [0]],
+            [buttons: [33]]
+          ] do
+        assert_raise ArgumentError, fn -> SubscriptionFilter.compile(opts) end
+      end
+    end
+  end
+
+  describe "evaluate/3" do
+    test "without a filter everything is sent" do
+      message = {:spacemouse_motion, motion(x: 0.5)}
+      assert SubscriptionFilter.evaluate(nil, message, nil) == {:send, message, nil}
+    end
+
+    test "events: selects event types" do
+      filter = SubscriptionFilter.compile(events: [:buttons, :connection])
+
+      assert SubscriptionFilter.evaluate(filter, {:spacemouse_motion, motion(x: 0.5)}, nil) == :skip
+      assert SubscriptionFilter.evaluate(filter, {:spacemouse_led_changed, %{to: :on}}, nil) == :skip
+      assert {:send, _message, _last} = SubscriptionFilter.evaluate(filter, {:spacemouse_connected, %{}}, nil)
+      assert {:send, _message, _last} = SubscriptionFilter.evaluate(filter, {:spacemouse_disconnected, %{}}, nil)
+      assert {:send, _message, _last} = SubscriptionFilter.evaluate(filter, buttons(1), nil)
+    end
+
+    test "axes: strips the other axes from motion payloads" do
+      filter = SubscriptionFilter.compile(axes: [:x, :rz])
+
+      assert {:send, {:spacemouse_motion, payload}, nil} =
+               SubscriptionFilter.evaluate(filter, {:spacemouse_motion, motion(x: 0.5, y: 0.2, rz: -0.1)}, nil)
+
+      assert payload == %{device_id: @device_id, device_timestamp: 0, x: 0.5, rz: -0.1}
+    end
+
+    test "min_delta: sends a frame once a selected axis has moved far enough" do
+      filter = SubscriptionFilter.compile(axes: [:x, :y], min_delta: 0.1)
+
+      assert {:send, _message, last} = SubscriptionFilter.evaluate(filter, {:spacemouse_motion, motion(x: 0.5)}, nil)
+      assert last == %{x: 0.5, y: 0.0}
+
+      assert SubscriptionFilter.evaluate(filter, {:spacemouse_motion, motion(x: 0.55)}, last) == :skip
+      assert SubscriptionFilter.evaluate(filter, {:spacemouse_motion, motion(x: 0.5, z: 0.9)}, last) == :skip
+
+      assert {:send, _message, last} = SubscriptionFilter.evaluate(filter, {:spacemouse_motion, motion(x: 0.5, y: -0.1)}, last)
+      assert last == %{x: 0.5, y: -0.1}
+    end
+
+    test "buttons: sends button events that change one of the buttons" do
+      filter = SubscriptionFilter.compile(buttons: [1, 3])
+
+      assert {:send, _message, _last} = SubscriptionFilter.evaluate(filter, buttons(0b001), nil)
+      assert {:send, _message, _last} = SubscriptionFilter.evaluate(filter, buttons(0b100), nil)
+      assert SubscriptionFilter.evaluate(filter, buttons(0b010), nil) == :skip
+    end
+  end
+
+  test "filtered frames are not counted as dropped" do
+    Dispatcher.subscribe(self(), @device_id, {:bounded, 1}, SubscriptionFilter.compile(axes: [:x], min_delta: 0.5))
+
+    for x <- [1.0, 1.1, 2.0] do
+      Dispatcher.dispatch(@device_id, {:spacemouse_motion, motion(x: x)})
+    end
+
+    # 1.1 is filtered, 2.0 is dropped: the window holds one frame
+    assert_receive {:spacemouse_motion, %{x: 1.0}}
+    refute_receive {:spacemouse_motion, _payload}, 50
+
+    Dispatcher.ack(self())
+    Dispatcher.dispatch(@device_id, {:spacemouse_motion, motion(x: 3.0)})
+    assert_receive {:spacemouse_motion, %{x: 3.0, dropped: 1}}
+  end
+
+  test "min_delta counts from the last frame sent, not the last one dropped" do
+    Dispatcher.subscribe(self(), @device_id, {:bounded, 1}, SubscriptionFilter.compile(axes: [:x], min_delta: 0.5))
+
+    for x <- [0.0, 1.0] do
+      Dispatcher.dispatch(@device_id, {:spacemouse_motion, motion(x: x)})
+    end
+
+    assert_receive {:spacemouse_motion, %{x: 0.0}}
+    refute_receive {:spacemouse_motion, _payload}, 50
+
+    # 1.2 is within min_delta of the dropped 1.0 but not of the 0.0 sent
+    Dispatcher.ack(self())
+    Dispatcher.dispatch(@device_id, {:spacemouse_motion, motion(x: 1.2)})
+    assert_receive {:spacemouse_motion, %{x: 1.2, dropped: 1}}
+  end
+
+  test "a held frame becomes the min_delta baseline when it is sent" do
+    Dispatcher.subscribe(self(), @device_id, :latest, SubscriptionFilter.compile(axes: [:x], min_delta: 0.5))
+
+    for x <- [0.0, 1.0] do
+      Dispatcher.dispatch(@device_id, {:spacemouse_motion, motion(x: x)})
+    end
+
+    assert_receive {:spacemouse_motion, %{x: 0.0}}
+    Dispatcher.ack(self())
+    assert_receive {:spacemouse_motion, %{x: 1.0}}
+
+    Dispatcher.ack(self())
+    Dispatcher.dispatch(@device_id, {:spacemouse_motion, motion(x: 1.2)})
+    refute_receive {:spacemouse_motion, _payload}, 50
+  end
+
+  defp motion(values) do
+    Map.merge(%{device_id: @device_id, device_timestamp: 0, x: 0.0, y: 0.0, z: 0.0, rx: 0.0, ry: 0.0, rz: 0.0}, Map.new(values))
+  end
+
+  defp buttons(changed), do: {:spacemouse_buttons, %{device_id: @device_id, buttons: changed, changed: changed}}
+end
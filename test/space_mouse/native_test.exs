@@ -0,0 +1,29 @@
+defmodule SpaceMouse.NativeTest do
+  use ExUnit.Case, async: true
+
+  # Unit tests of the shared C code, built by priv/platform/common/tests/build.sh
+  # when compiling in the test environment
+  @tests ~w(
+    test_report_descriptor
+    test_spacemouse_report
+    test_port_protocol
+    test_response_curve
+    test_calibration
+    test_idle_filter
+  )
+
+  @tests_dir Path.join([to_string(:code.priv_dir(:space_mouse)), "platform", "common", "tests"])
+
+  for name <- @tests do
+    test name do
+      case :os.type() do
+        {:unix, _} ->
+          {output, status} = System.cmd(Path.join(@tests_dir, unquote(name)), [], stderr_to_stdout: true)
+          assert status == 0, output
+
+        _ ->
+          :ok
+      end
+    end
+  end
+end
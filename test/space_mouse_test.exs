@@ -10,10 +10,19 @@ defmodule SpaceMouseTest do
     assert function_exported?(SpaceMouse, :subscribe, 1)
     assert function_exported?(SpaceMouse, :unsubscribe, 0)
     assert function_exported?(SpaceMouse, :unsubscribe, 1)
+    assert function_exported?(SpaceMouse, :ack, 0)
+    assert function_exported?(SpaceMouse, :subscribe_sampled, 1)
+    assert function_exported?(SpaceMouse, :unsubscribe_sampled, 0)
+    assert function_exported?(SpaceMouse, :subscribe_pose, 0)
+    assert function_exported?(SpaceMouse, :pose, 0)
     assert function_exported?(SpaceMouse, :set_led, 1)
     assert function_exported?(SpaceMouse, :get_led_state, 0)
+    assert function_exported?(SpaceMouse, :calibrate, 0)
     assert function_exported?(SpaceMouse, :connected?, 0)
     assert function_exported?(SpaceMouse, :platform_info, 0)
+    assert function_exported?(SpaceMouse, :buttons, 0)
+    assert function_exported?(SpaceMouse, :button_pressed?, 1)
+    assert function_exported?(SpaceMouse, :pipeline_metrics, 0)
   end
 
   test "platform info returns correct structure" do